@@ -66,7 +66,9 @@ namespace variant {
          * that htslib doesn't do const mostly.
          *
          * @param hdr a bcf header
-         * @param ref_fasta reference fasta file for trimming and counting
+         * @param ref_fasta reference fasta file for trimming and counting. This is
+         *                  shared by all blocks (and threads), so it must outlive
+         *                  the quantifier.
          */
         explicit BlockQuantify(bcf_hdr_t * hdr,
                                FastaFile const & ref_fasta,
@@ -90,7 +92,7 @@ namespace variant {
         void count();
 
         // result output
-        std::map<std::string, VariantStatistics> const & getCounts() const;
+        std::map<std::string, VariantCounts> const & getCounts() const;
         std::map<std::string, roc::Roc> const & getRocs() const;
         std::list<bcf1_t*> const & getVariants();
         // update a header with new required fields
@@ -102,6 +104,9 @@ namespace variant {
         // GA4GH-VCF field-based ROC counting
         virtual void rocEvaluate(bcf1_t * v);
 
+        // add the counts for a record to the counts for key
+        void countInto(std::string const & key, VariantCounts const & counts);
+
         // add ROC decision point
         void addROCValue(std::string const & roc_identifier,
                          roc::DecisionType dt,
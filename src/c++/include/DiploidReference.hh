@@ -41,6 +41,8 @@
 #include "GraphReference.hh"
 #include "Fasta.hh"
 
+#include <functional>
+
 namespace haplotypes
 {
 
@@ -107,6 +109,21 @@ public:
 
     std::list<DiploidRef> const & result();
 
+    /**
+     * Enumerate haplotype pairs for a set of Variants without keeping them.
+     *
+     * Pairs are passed to output as soon as both paths have been found, only
+     * paths which don't have a partner yet are kept.
+     */
+    void enumerate(
+        const char * chr,
+        int64_t start,
+        int64_t end,
+        std::list<variant::Variants> const & vars,
+        std::function<void(DiploidRef const &)> const & output,
+        int sample_ix = 0
+    );
+
 private:
 	DiploidReferenceImpl * _impl;
 };
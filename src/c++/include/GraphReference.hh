@@ -41,6 +41,7 @@
 #include "Fasta.hh"
 #include "Variant.hh"
 
+#include <functional>
 #include <vector>
 
 namespace haplotypes
@@ -113,6 +114,26 @@ public:
         size_t * n_hets = NULL
     );
 
+    /** receives each path as it is found, together with its nodes_used mask */
+    typedef std::function<void(Haplotype const &, uint64_t)> path_callback_t;
+
+    /**
+     * Enumerate paths for a graph, passing each path to a callback instead of
+     * collecting them (same parameters as above otherwise)
+     */
+    void enumeratePaths(
+        const char * chr,
+        int64_t start,
+        int64_t end,
+        std::vector<ReferenceNode> const & nodes,
+        std::vector<ReferenceEdge> const & edges,
+        path_callback_t const & output,
+        size_t source=0,
+        size_t sink=(size_t)-1,
+        int max_n_paths=-1,
+        size_t * n_hets = NULL
+    );
+
 private:
     GraphReferenceImpl * _impl;
 };
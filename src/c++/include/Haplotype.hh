@@ -115,7 +115,7 @@ public:
      * 
      * To save time, we keep all reference_file Fastas in a hash. When feeding in temporary 
      * files, this is problematic since they can't be deleted until the Fasta object is 
-     * deleted.
+     * deleted. The hash is kept per thread, this only resets the one for the calling thread.
      */
     static void resetRefs();
 
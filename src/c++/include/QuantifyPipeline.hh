@@ -0,0 +1,105 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/**
+ * Count blocks of comparison records in parallel
+ *
+ * \file QuantifyPipeline.hh
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#ifndef HAPLOTYPES_QUANTIFYPIPELINE_HH
+#define HAPLOTYPES_QUANTIFYPIPELINE_HH
+
+#include <memory>
+#include <map>
+#include <string>
+
+#include <htslib/vcf.h>
+
+#include "Fasta.hh"
+#include "QuantifyRegions.hh"
+#include "helpers/Roc.hh"
+
+namespace variant
+{
+    /**
+     * Records are annotated with region tags and collected into blocks of at least
+     * blocksize records (without breaking benchmarking superloci). Blocks are
+     * counted on a fixed pool of threads, and then written / added to the ROCs in
+     * the order they were added.
+     */
+    class QuantifyPipeline
+    {
+    public:
+        /**
+         * @param hdr header for all records passed to add(). This is updated with the
+         *            fields written by the quantifier. Must be destroyed externally.
+         * @param ref_fasta reference fasta file for counting, shared by all threads
+         * @param regions stratification regions to annotate records with
+         * @param qtype quantification method (see listQuantificationMethods())
+         * @param qparams quantification parameters (see makeQuantifier)
+         * @param roc_filter filters to ignore when computing ROCs
+         * @param threads number of threads for counting
+         * @param blocksize minimum number of records per block
+         */
+        QuantifyPipeline(bcf_hdr_t * hdr,
+                         FastaFile const & ref_fasta,
+                         QuantifyRegions & regions,
+                         std::string const & qtype,
+                         std::string const & qparams,
+                         std::string const & roc_filter,
+                         int threads = 1,
+                         int blocksize = 20000);
+        ~QuantifyPipeline();
+
+        QuantifyPipeline(QuantifyPipeline const &) = delete;
+        QuantifyPipeline & operator=(QuantifyPipeline const &) = delete;
+
+        /** write counted records to a VCF / BCF file, must be called before add() */
+        void setOutputVCF(std::string const & filename);
+
+        /** accumulate ROCs from all blocks, must be called before add() */
+        void setComputeRocs(bool compute_rocs = true);
+
+        /** annotate and add a copy of a record. Records must be added in sorted order */
+        void add(bcf1_t * record);
+
+        /** count and output all remaining blocks */
+        void finish();
+
+        /** ROCs after finish() */
+        std::map<std::string, roc::Roc> const & getRocs() const;
+    private:
+        struct QuantifyPipelineImpl;
+        std::unique_ptr<QuantifyPipelineImpl> _impl;
+    };
+}
+
+#endif //HAPLOTYPES_QUANTIFYPIPELINE_HH
@@ -39,6 +39,7 @@
 #include <memory>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <htslib/vcf.h>
 
@@ -80,6 +81,15 @@ namespace variant
          * @return  the region size
          */
         size_t getRegionSize(std::string const & region_name) const;
+
+        /** names of all loaded regions, in load order */
+        std::vector<std::string> const & getRegionNames() const;
+
+        /**
+         * Set the size of a region without loading intervals (used when
+         * merging partial results, which carry region names and sizes only).
+         */
+        void setRegionSize(std::string const & region_name, size_t size);
     private:
         struct QuantifyRegionsImpl;
         std::unique_ptr<QuantifyRegionsImpl> _impl;
@@ -165,6 +165,27 @@ namespace bcfhelpers {
     /** return number of reference padding bases */
     int isRefPadded(bcf1_t * line);
 
+    /**
+     * @brief Get per-contig record counts from the index of a VCF / BCF file without reading any records.
+     *
+     * @param filename the file name (a .tbi or .csi index must exist)
+     * @param counts receives contig names and numbers of records, in index order
+     * @return false if the file has no index, or if the index does not contain counts
+     */
+    bool getIndexCounts(const char * filename, std::vector< std::pair<std::string, uint64_t> > & counts);
+
+    /**
+     * @brief Get the names of the contigs which have records from the index of a VCF / BCF file.
+     *
+     * For tabix-style indexes, only the name table at the start of the index is read.
+     *
+     * @param filename the file name
+     * @param hdr the file header (BCF indexes refer to contigs by their header ids)
+     * @param contigs receives the contig names, in index order
+     * @return false if the file has no (readable) index
+     */
+    bool getIndexContigs(const char * filename, const bcf_hdr_t * hdr, std::vector<std::string> & contigs);
+
     /** shared pointer support for keeping bcf types around */
     typedef std::shared_ptr<bcf_hdr_t> p_bcf_hdr;
     typedef std::shared_ptr<bcf1_t> p_bcf1;
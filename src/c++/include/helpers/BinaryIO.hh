@@ -0,0 +1,85 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/**
+ *  \brief Fixed-width little-endian integer I/O for binary intermediate files
+ *
+ * Used for the partial ROC / variant count files, which may be written and
+ * read on different machines.
+ *
+ * \file BinaryIO.hh
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <type_traits>
+
+#include "Error.hh"
+
+namespace binaryio
+{
+    /**
+     * @brief Write an unsigned integer as sizeof(T) little-endian bytes
+     */
+    template<typename T> static inline void writeLE(std::ostream & o, T x)
+    {
+        static_assert(std::is_unsigned<T>::value, "Only unsigned integers can be written.");
+        char buf[sizeof(T)];
+        for(size_t j = 0; j < sizeof(T); ++j)
+        {
+            buf[j] = (char)((x >> (8*j)) & 0xff);
+        }
+        o.write(buf, sizeof(T));
+    }
+
+    /**
+     * @brief Read an unsigned integer written by writeLE
+     *
+     * Fails with "Unexpected end of <what>." when the stream runs out.
+     */
+    template<typename T> static inline T readLE(std::istream & i, const char * what)
+    {
+        static_assert(std::is_unsigned<T>::value, "Only unsigned integers can be read.");
+        unsigned char buf[sizeof(T)];
+        if(!i.read((char*)buf, sizeof(T)))
+        {
+            error("Unexpected end of %s.", what);
+        }
+        T x = 0;
+        for(size_t j = 0; j < sizeof(T); ++j)
+        {
+            x |= ((T)buf[j]) << (8*j);
+        }
+        return x;
+    }
+}
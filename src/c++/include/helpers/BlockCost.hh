@@ -0,0 +1,82 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/**
+ * \brief Cost estimate for comparing a superlocus
+ *
+ * Comparison time in xcmp is dominated by haplotype enumeration, which is
+ * exponential in the number of unphased hets in a superlocus (up to the
+ * enumeration limit). Each enumerated pair of haplotypes costs time
+ * proportional to the length of the block, and indels make the comparison
+ * more expensive because haplotypes then need to be aligned.
+ *
+ * \file BlockCost.hh
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace variant
+{
+
+struct BlockCost
+{
+    /** cap on the number of enumerated haplotypes (see xcmp -n) */
+    int64_t max_enum = 16768;
+    /** cost of reading / matching one record, in units of enumerated haplotypes */
+    double record_weight = 100.0;
+    /** relative extra cost per indel */
+    double indel_weight = 0.1;
+    /** relative extra cost per kb of block length */
+    double span_weight = 0.01;
+
+    /**
+     * @brief Predicted cost of one superlocus
+     *
+     * @param records number of records / lines in the superlocus
+     * @param hets number of unphased het records
+     * @param indels number of indel records
+     * @param span block length in bp
+     */
+    double operator()(int64_t records, int64_t hets, int64_t indels, int64_t span) const
+    {
+        const double enumerated = hets >= 62 ? (double)max_enum
+                                             : (double)std::min(max_enum, ((int64_t)1) << std::max((int64_t)0, hets));
+        return record_weight * (double)records
+               + enumerated
+                 * (1.0 + indel_weight * (double)indels)
+                 * (1.0 + span_weight * (double)std::max((int64_t)0, span) / 1000.0);
+    }
+};
+
+}
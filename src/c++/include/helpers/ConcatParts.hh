@@ -0,0 +1,69 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * \brief Concatenate sorted, non-overlapping VCF / BCF parts
+ *
+ * Parts written by different processes (e.g. the per-chunk outputs of
+ * xcmp) are already in order, so they can be joined without re-encoding
+ * every record: only the remainder of the block which holds the end of each
+ * part's header is re-compressed, all other BGZF blocks are copied as they
+ * are. The index is built during the copy by translating the virtual
+ * offsets of each part into the output file.
+ *
+ * \file ConcatParts.hh
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <htslib/hts.h>
+
+namespace bcfhelpers
+{
+    /**
+     * @brief Concatenate VCF / BCF parts
+     *
+     * All parts must be bgzipped VCF or BCF files of the same type, with
+     * headers that have the same contigs, INFO / FORMAT / FILTER ids and
+     * samples. The header of the first part is used for the output.
+     * Records must be sorted across parts, otherwise building the index
+     * fails.
+     *
+     * @param parts the input files, in order
+     * @param output the output file name
+     * @param index_format HTS_FMT_CSI, HTS_FMT_TBI (VCF only) or -1 to not write an index
+     */
+    void concatenateParts(std::vector<std::string> const & parts,
+                          std::string const & output,
+                          int index_format = HTS_FMT_CSI);
+}
@@ -0,0 +1,86 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * \brief Set of sequence digests with a memory budget
+ *
+ * Enumerating haplotypes for dense regions can produce very many
+ * sequences. To remove duplicates without keeping all of them in memory,
+ * only a 64 bit digest of each sequence is stored. When the digests use
+ * more than the given budget, they are written to a temporary file as a
+ * sorted run and looked up there.
+ *
+ * \file DigestSet.hh
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace hashutil
+{
+    /** 64 bit digest of a string (FNV-1a with a final mixing step) */
+    uint64_t digest(const char * s, size_t len);
+
+    static inline uint64_t digest(std::string const & s)
+    {
+        return digest(s.c_str(), s.size());
+    }
+
+    struct DigestSetImpl;
+    class DigestSet
+    {
+    public:
+        /**
+         * @param max_memory memory budget in bytes (0: keep all digests in memory)
+         * @param tmpdir directory for spilled digests (empty: system temp directory)
+         */
+        explicit DigestSet(size_t max_memory = 0, std::string const & tmpdir = "");
+        ~DigestSet();
+
+        DigestSet(DigestSet const &) = delete;
+        DigestSet & operator=(DigestSet const &) = delete;
+
+        /** add a digest, returns false if it was in the set already */
+        bool insert(uint64_t d);
+
+        /** check if a digest is in the set */
+        bool contains(uint64_t d) const;
+
+        /** number of digests in the set */
+        size_t size() const;
+
+        /** number of digests which have been written to disk */
+        size_t spilled() const;
+    private:
+        DigestSetImpl * _impl;
+    };
+}
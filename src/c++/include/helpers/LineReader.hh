@@ -0,0 +1,87 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/**
+ * \brief Fast line reader for (large) text tables
+ *
+ * Plain files are memory-mapped, compressed files and stdin are read
+ * through BGZF in large blocks. Lines and fields are returned as pointers
+ * into the buffer, so nothing is copied while scanning a file.
+ *
+ * \file LineReader.hh
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace textio
+{
+    /** a field in a line, not zero-terminated */
+    struct Field
+    {
+        const char * s;
+        size_t len;
+
+        std::string str() const { return std::string(s, len); }
+        bool operator==(const char * rhs) const;
+    };
+
+    /**
+     * Split a line at any of the characters in seps. Empty fields are
+     * kept, an empty line gives no fields.
+     */
+    void splitFields(const char * line, size_t len, std::string const & seps, std::vector<Field> & fields);
+
+    struct LineReaderImpl;
+    class LineReader
+    {
+    public:
+        /** open a file, "-" reads stdin. Gzip / BGZF-compressed files are detected automatically */
+        explicit LineReader(std::string const & filename);
+        ~LineReader();
+
+        LineReader(LineReader const &) = delete;
+        LineReader & operator=(LineReader const &) = delete;
+
+        /**
+         * Get the next line, without the line terminator. The line stays valid
+         * until the next call.
+         *
+         * @return false at the end of the input
+         */
+        bool next(Field & line);
+    private:
+        LineReaderImpl * _impl;
+    };
+}
@@ -0,0 +1,241 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/**
+ * \brief Fixed-size worker pool which processes items in parallel and
+ *        passes them on to an output function in submission order
+ *
+ * Items are pushed from a single producer thread. Up to max_in_flight
+ * items may be queued / processed / waiting for output at any time,
+ * push() blocks when this limit is reached. The output function runs on
+ * its own thread, so reading, processing and writing can overlap.
+ *
+ * \file OrderedPipeline.hh
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace parallel
+{
+
+template <typename T>
+class OrderedPipeline
+{
+public:
+    typedef std::function<void(T &)> stage_t;
+
+    /**
+     * @param workers number of worker threads which run process
+     * @param max_in_flight maximum number of items between push() and output
+     * @param process function to run on each item (on a worker thread)
+     * @param output function to run on each processed item, in the order
+     *               items were pushed (on the output thread)
+     */
+    OrderedPipeline(int workers, size_t max_in_flight, stage_t process, stage_t output) :
+        _process(process), _output(output),
+        _max_in_flight(std::max((size_t)1, max_in_flight)),
+        _next_in(0), _next_out(0), _closed(false)
+    {
+        workers = std::max(1, workers);
+        for(int i = 0; i < workers; ++i)
+        {
+            _workers.emplace_back(&OrderedPipeline::work, this);
+        }
+        _writer = std::thread(&OrderedPipeline::write, this);
+    }
+
+    ~OrderedPipeline()
+    {
+        if(_writer.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> l(_mutex);
+                if(!_error)
+                {
+                    _error = std::make_exception_ptr(std::runtime_error("Pipeline was aborted."));
+                }
+                _closed = true;
+            }
+            _cv.notify_all();
+            join();
+        }
+    }
+
+    OrderedPipeline(OrderedPipeline const &) = delete;
+    OrderedPipeline & operator=(OrderedPipeline const &) = delete;
+
+    /** add an item, blocks while too many items are in flight.
+     *  Rethrows the first exception from a processing / output function. */
+    void push(T && item)
+    {
+        std::unique_lock<std::mutex> l(_mutex);
+        _cv.wait(l, [this]() { return _error || _next_in - _next_out < _max_in_flight; });
+        if(_error)
+        {
+            std::rethrow_exception(_error);
+        }
+        _todo.emplace_back(_next_in++, std::move(item));
+        l.unlock();
+        _cv.notify_all();
+    }
+
+    /** wait for all items to be processed and output.
+     *  Rethrows the first exception from a processing / output function. */
+    void finish()
+    {
+        {
+            std::lock_guard<std::mutex> l(_mutex);
+            _closed = true;
+        }
+        _cv.notify_all();
+        join();
+        if(_error)
+        {
+            std::rethrow_exception(_error);
+        }
+    }
+
+private:
+    void join()
+    {
+        for(auto & t : _workers)
+        {
+            t.join();
+        }
+        _workers.clear();
+        _writer.join();
+    }
+
+    void fail(std::exception_ptr e)
+    {
+        {
+            std::lock_guard<std::mutex> l(_mutex);
+            if(!_error)
+            {
+                _error = e;
+            }
+        }
+        _cv.notify_all();
+    }
+
+    void work()
+    {
+        while(true)
+        {
+            std::unique_lock<std::mutex> l(_mutex);
+            _cv.wait(l, [this]() { return _error || _closed || !_todo.empty(); });
+            if(_error || _todo.empty())
+            {
+                return;
+            }
+            auto item = std::move(_todo.front());
+            _todo.pop_front();
+            l.unlock();
+
+            try
+            {
+                _process(item.second);
+            }
+            catch(...)
+            {
+                fail(std::current_exception());
+                return;
+            }
+
+            l.lock();
+            _done.emplace(item.first, std::move(item.second));
+            l.unlock();
+            _cv.notify_all();
+        }
+    }
+
+    void write()
+    {
+        while(true)
+        {
+            std::unique_lock<std::mutex> l(_mutex);
+            _cv.wait(l, [this]() {
+                return _error || _done.count(_next_out) || (_closed && _next_out == _next_in);
+            });
+            if(_error || !_done.count(_next_out))
+            {
+                return;
+            }
+            auto it = _done.find(_next_out);
+            T item = std::move(it->second);
+            _done.erase(it);
+            l.unlock();
+
+            try
+            {
+                _output(item);
+            }
+            catch(...)
+            {
+                fail(std::current_exception());
+                return;
+            }
+
+            l.lock();
+            ++_next_out;
+            l.unlock();
+            _cv.notify_all();
+        }
+    }
+
+    stage_t _process;
+    stage_t _output;
+    size_t _max_in_flight;
+
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::deque< std::pair<size_t, T> > _todo;
+    std::map<size_t, T> _done;
+    size_t _next_in;
+    size_t _next_out;
+    bool _closed;
+    std::exception_ptr _error;
+
+    std::vector<std::thread> _workers;
+    std::thread _writer;
+};
+
+}
@@ -0,0 +1,100 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/**
+ * \brief Fast positional scan of indexed VCF / BCF files
+ *
+ * Reads only what is needed to find block boundaries: CHROM, POS, REF,
+ * ALT, FILTER, INFO/END and GT. Records from several files are matched up
+ * by position and alleles the same way bcf_srs_t does it with
+ * COLLAPSE_NONE, so the resulting lines are the same as the ones we would
+ * get from a synced reader.
+ *
+ * \file PositionScanner.hh
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bcfhelpers
+{
+
+class PositionScanner
+{
+public:
+    /** a set of records at the same position, reduced to the extent of
+     *  the called records in it */
+    struct Line
+    {
+        int64_t pos;
+        int64_t end;
+        /** number of called records with an unphased het GT */
+        int hets;
+        /** number of called records which have length-changing ALTs */
+        int indels;
+    };
+
+    /**
+     * @param files the input files, these must be indexed
+     * @param apply_filters only use PASS records
+     */
+    PositionScanner(std::vector<std::string> const & files, bool apply_filters);
+    ~PositionScanner();
+
+    PositionScanner(PositionScanner const &) = delete;
+    PositionScanner & operator=(PositionScanner const &) = delete;
+
+    /** contig names in the order a synced reader would visit them */
+    std::vector<std::string> getContigs() const;
+
+    /**
+     * @brief Scan a contig
+     *
+     * Lines which have no called records (or only ones with FILTER != PASS
+     * when filtering) are not returned.
+     *
+     * @param chr the contig name
+     * @param start start reading at records overlapping this position (0-based)
+     * @param end stop after records starting after this position (-1 to read to the end)
+     * @param lines output lines, sorted by position
+     * @return false if none of the files have this contig
+     */
+    bool scan(std::string const & chr, int64_t start, int64_t end, std::vector<Line> & lines);
+
+private:
+    struct PositionScannerImpl;
+    PositionScannerImpl * _impl;
+};
+
+}
@@ -37,6 +37,7 @@
 
 #include <memory>
 #include <vector>
+#include <iostream>
 
 namespace roc
 {
@@ -207,6 +208,11 @@ namespace roc
 
         void getLevels(std::vector<Level> & target, double roc_delta=0, uint64_t flag_mask=0) const;
         Level getTotals(uint64_t flag_mask=0) const;
+
+        /** binary serialization of all observations, in order (see RocPartials.hh) */
+        void write(std::ostream & o) const;
+        /** read observations written by write() and append them to this ROC */
+        void read(std::istream & i);
     private:
         struct RocImpl;
         std::unique_ptr<RocImpl> _impl;
@@ -38,6 +38,7 @@
 
 #include "Roc.hh"
 #include "QuantifyRegions.hh"
+#include "Table.hh"
 
 namespace roc
 {
@@ -71,13 +72,31 @@ namespace roc
 
         /** compute metrics and write output */
         void write(std::ostream & o) const;
+
+        /**
+         * write final reports, see RocReports.hh
+         *
+         * @param prefix output file prefix
+         * @param filter_handling only use rows with this value in the Filter column (empty to use all rows)
+         * @param ci_alpha confidence level for Jeffreys CIs (0 to disable)
+         * @param write_counts write the extended counts table
+         */
+        void writeReports(std::string const & prefix,
+                          std::string const & filter_handling,
+                          double ci_alpha,
+                          bool write_counts) const;
     private:
+        /** compute metrics into a table (once) */
+        table::Table const & getTable() const;
+        void makeTable(table::Table & output_values) const;
+
         RocMap const & rocs;
         std::string qq_field;
         bool output_rocs;
         double roc_delta;
         variant::QuantifyRegions const & regions;
         std::vector<std::string> const & roc_regions;
+        mutable std::unique_ptr<table::Table> table;
    };
 }
 
@@ -0,0 +1,80 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * Partial quantification results for sharded runs
+ *
+ * A partial file stores the ROC observations and region sizes counted on
+ * one shard. Merging partials in genome order gives the same tables as a
+ * single quantify run over all shards.
+ *
+ * \file RocPartials.hh
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#ifndef HAPLOTYPES_ROCPARTIALS_HH
+#define HAPLOTYPES_ROCPARTIALS_HH
+
+#include "RocOutput.hh"
+
+#include <string>
+
+namespace roc
+{
+    /**
+     * Write a (gzip-compressed) binary partial results file
+     *
+     * @param filename output file name
+     * @param qq_header name of the QQ field
+     * @param rocs ROCs / counts for all strata
+     * @param regions stratification regions (only names and sizes are stored)
+     */
+    void writePartial(std::string const & filename,
+                      std::string const & qq_header,
+                      RocMap const & rocs,
+                      variant::QuantifyRegions const & regions);
+
+    /**
+     * Read a partial results file and add it to rocs / regions
+     *
+     * Observations are appended to the existing ROCs. Region sizes are
+     * taken from the first partial that has them; a warning is printed when
+     * another partial disagrees.
+     *
+     * @param filename input file name
+     * @param qq_header is set to the QQ field name if empty, otherwise it is checked against the file
+     * @param rocs ROCs to add to
+     * @param regions regions to add sizes to
+     */
+    void mergePartial(std::string const & filename,
+                      std::string & qq_header,
+                      RocMap & rocs,
+                      variant::QuantifyRegions & regions);
+}
+
+#endif //HAPLOTYPES_ROCPARTIALS_HH
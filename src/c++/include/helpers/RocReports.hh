@@ -0,0 +1,94 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * Final ROC / summary reports (replaces the pandas post-processing in
+ * Haplo/happyroc.py and qfy.py)
+ *
+ * \file RocReports.hh
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#ifndef HAPLOTYPES_ROCREPORTS_HH
+#define HAPLOTYPES_ROCREPORTS_HH
+
+#include "Table.hh"
+
+#include <string>
+#include <cstdint>
+
+namespace roc
+{
+    /**
+     * Write report files from a ROC table as created by ROCOutput:
+     *
+     * <prefix>.summary.csv      : totals for SNP / INDEL, ALL / PASS
+     * <prefix>.extended.csv     : totals for all subtypes, genotypes and subsets (if write_counts is true)
+     * <prefix>.roc.<name>.csv.gz: ROCs ("all", and "Locations.<SNP|INDEL>[.PASS|.SEL]")
+     *
+     * ROC files with these names which are not produced for the current table are removed.
+     *
+     * Ti/Tv and het/hom ratios are added for all counts, and Jeffreys
+     * confidence intervals for recall, precision and Frac_NA when
+     * 0 < ci_alpha < 1.
+     *
+     * @param roc_table the ROC table
+     * @param prefix output file prefix
+     * @param filter_handling only use rows with this value in the Filter column (empty to use all rows)
+     * @param ci_alpha confidence level for CIs
+     * @param write_counts write the extended table
+     */
+    void writeReports(table::Table const & roc_table,
+                      std::string const & prefix,
+                      std::string const & filter_handling,
+                      double ci_alpha,
+                      bool write_counts);
+
+    /**
+     * Modified Jeffreys confidence interval for binomial proportions:
+     * Brown, Cai and DasGupta: Interval Estimation for a Binomial Proportion.
+     * 2001, doi:10.1214/ss/1009213286
+     *
+     * @param x number of successes
+     * @param n number of trials
+     * @param alpha confidence level
+     * @param p estimate x / n
+     * @param lower lower bound
+     * @param upper upper bound
+     */
+    void jeffreysCI(uint64_t x, uint64_t n, double alpha,
+                    double & p, double & lower, double & upper);
+
+    /** quantile function of the beta distribution */
+    double betaQuantile(double a, double b, double q);
+
+    /** format a double like Python's repr does (NaN becomes an empty string) */
+    std::string formatDouble(double x);
+}
+
+#endif //HAPLOTYPES_ROCREPORTS_HH
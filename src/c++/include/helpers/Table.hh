@@ -38,12 +38,22 @@
 
 #include <memory>
 #include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
 
 namespace table
 {
+    /**
+     * Table of double / string values, stored by column. Row and column
+     * names are mapped to handles once, values can then be set using
+     * the handles without looking up names again.
+     */
     class Table
     {
     public:
+        typedef size_t handle_t;
+
         Table();
         Table(Table const &);
         Table(Table &&);
@@ -64,13 +74,41 @@ namespace table
         void unset(std::string const & row,
                    std::string const & column);
 
+        /** get the handle for a row / column, adding it if necessary */
+        handle_t row(std::string const & name);
+        handle_t column(std::string const & name);
+
+        /** set values using row and column handles */
+        void set(handle_t row, handle_t column, double value);
+        void set(handle_t row, handle_t column, std::string const & value);
+
+        /** handles of all rows (in the order they were added) */
+        std::vector<handle_t> getRowHandles() const;
+
+        /** find the handle for an existing column */
+        bool findColumn(std::string const & name, handle_t & column) const;
+
+        /** get several values from the same row using handles, (handle_t)-1 gives the default */
+        void getStrings(handle_t row,
+                        std::vector<handle_t> const & columns,
+                        std::vector<std::string> & values,
+                        const char * _def = ".") const;
+
         void dropRowsWithMissing(std::string const & column);
 
         bool hasRow(std::string const & row) const;
 
+        /** list row names (in the order they were added) */
+        std::vector<std::string> getRows() const;
+
         std::string getString(std::string const & row,
                               std::string const & column,
                               const char * _def = ".") const;
+        /** get several values from the same row */
+        void getStrings(std::string const & row,
+                        std::vector<std::string> const & columns,
+                        std::vector<std::string> & values,
+                        const char * _def = ".") const;
         double getDouble(std::string const & row,
                          std::string const & column,
                          double _def = std::numeric_limits<double>::quiet_NaN()) const;
@@ -0,0 +1,127 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+/**
+ * \brief Read several VCF files through separate normalisation chains and merge
+ *        the results by location
+ *
+ * \file VariantMergeReader.hh
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#pragma once
+
+#include "Variant.hh"
+#include "variant/VariantReader.hh"
+
+namespace variant
+{
+
+/**
+ * @brief Merge normalised variants from several files
+ *
+ * Each input is read using its own VariantReader. Inputs can optionally be
+ * normalised (see VariantInput, and the preprocess tool) while they are read.
+ * Normalised records are converted to the form they would have when written
+ * to VCF and read back, and all inputs are then merged into multi-sample
+ * records in the same way as VariantReader does for unprocessed files: records
+ * at the same position are combined if their alleles match exactly.
+ *
+ * This gives the same records as preprocessing each file separately and
+ * reading the results using a single VariantReader, without writing the
+ * preprocessed files.
+ */
+struct VariantMergeReaderImpl;
+class VariantMergeReader
+{
+public:
+    explicit VariantMergeReader(const char * ref_fasta);
+    ~VariantMergeReader();
+
+    /**
+     * @brief Regions / targets for all inputs, see VariantReader
+     *
+     * Must be called before addSample!
+     */
+    void setRegions(const char * regions, bool isFile);
+    void setTargets(const char * targets, bool isFile);
+
+    /**
+     * @brief change GTs on chrX/Y to be diploid for matching
+     *
+     * Must be called before addSample!
+     */
+    void setFixChrXGTs(bool fix=true);
+
+    /**
+     * @brief Add an input
+     *
+     * @param filename file name
+     * @param sname sample name (or "" to use the first sample in the file)
+     * @param normalise run the preprocess normalisation chain (removing unused alleles, padding)
+     * @param decompose decompose variants into primitives (implies normalise)
+     * @param leftshift left-shift indels (implies normalise)
+     * @return sample number to retrieve records in the calls vector in current()
+     */
+    int addSample(const char * filename, const char * sname,
+                  bool normalise, bool decompose=false, bool leftshift=false);
+
+    /** Apply filters for a sample (off by default) */
+    void setApplyFilters(bool filters, int sample);
+
+    /** Reader for a sample, e.g. to copy its header */
+    VariantReader & getReader(int sample);
+
+    /**
+     * @brief Rewind / set region to read
+     *
+     * @param chr chromosome/contig name
+     * @param startpos start position on chr (or -1 for entire chr)
+     */
+    void rewind(const char * chr=NULL, int64_t startpos=-1);
+
+    /** Return variant record at current position */
+    Variants & current();
+
+    /**
+     * @brief Advance one record
+     * @return true if a variant was retrieved, false otherwise
+     */
+    bool advance();
+
+private:
+    VariantMergeReader(VariantMergeReader const &);
+    VariantMergeReader & operator=(VariantMergeReader const &);
+
+    VariantMergeReaderImpl * _impl;
+};
+
+}
@@ -42,6 +42,7 @@
 
 #include <list>
 #include <string>
+#include <vector>
 
 namespace variant
 {
@@ -119,6 +120,14 @@ public:
     /** return a list of filename/sample pairs */
     void getSampleList(std::list< std::pair<std::string, std::string> > & files);
 
+    /**
+     * @brief Return the contigs in the order they will be read
+     *
+     * These come from the regions (see setRegions), or from the indexes / headers
+     * of the files added so far.
+     */
+    void getContigs(std::vector<std::string> & contigs) const;
+
     /**
      * @brief Rewind / set region to read
      *
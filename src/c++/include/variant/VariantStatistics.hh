@@ -43,6 +43,8 @@
 #include <json/json.h>
 #include <list>
 #include <vector>
+#include <iosfwd>
+#include <type_traits>
 
 #include <htslib/vcf.h>
 
@@ -50,6 +52,33 @@ namespace variant
 {
 typedef std::vector<std::string> StrVec;
 
+/**
+ * @brief Fixed-layout counters
+ *
+ * counts is indexed by (call type | variant type), see CT_* and VT_* below,
+ * extra by the extra count index (see getExtraCountNames). This is a POD
+ * type, it can be copied, cleared and added to without allocating.
+ */
+struct VariantCounts
+{
+    static const int N_COUNTS = 256;
+    static const int N_EXTRA = 16;
+
+    uint64_t counts[N_COUNTS];
+    uint64_t extra[N_EXTRA];
+
+    void clear();
+    VariantCounts & operator+=(VariantCounts const & rhs);
+
+    /**
+     * @brief Compact binary serialisation (non-zero entries only)
+     */
+    void write(std::ostream & o) const;
+    void read(std::istream & i);
+};
+
+static_assert(std::is_pod<VariantCounts>::value, "VariantCounts must be a POD type");
+
 struct VariantStatisticsImpl;
 class VariantStatistics
 {
@@ -71,12 +100,31 @@ public:
      * @brief add counts
      */
     void add(VariantStatistics const & rhs);
-    /** add for variants and alleles can return the types that were added to */
+    void add(VariantCounts const & rhs);
+    /** add for variants and alleles can return the types that were added to
+     *
+     * extra_counts_seen is set to a bit mask of the extra counts seen, see extraCountsToBI
+     */
     void add(bcf_hdr_t * hdr, bcf1_t * rhs, int sample, int ** types = NULL, int * ntypes = NULL,
-             std::set<std::string> ** extra_counts_seen = NULL);
+             uint16_t * extra_counts_seen = NULL);
     void add(Variants const & rhs, int sample, int ** types = NULL, int * ntypes = NULL);
     void add(const char * chr, RefVar const & rhs, int ** types = NULL, int * ntypes = NULL);
 
+    /**
+     * @brief count a record into a separate set of counters
+     *
+     * Same as add, but the totals in this object are not changed. This allows
+     * to count a record once and add the result to several counters.
+     */
+    void count(bcf_hdr_t * hdr, bcf1_t * rhs, int sample, VariantCounts & counts,
+               int ** types = NULL, int * ntypes = NULL, uint16_t * extra_counts_seen = NULL);
+
+    /** current totals */
+    VariantCounts const & getCounts() const;
+
+    /** JSON representation of a set of counts */
+    static Json::Value toJson(VariantCounts const & counts);
+
     /** resolve types to strings */
     static std::string type2string(int type);
 
@@ -87,7 +135,7 @@ public:
     size_t extraCount(const std::string& extraCountName);
 
     /* abbreviate a set of extra counts that were observed for VCF output */
-    static std::string extraCountsToBI(std::set<std::string> const & extra_counts_seen);
+    static std::string extraCountsToBI(uint16_t extra_counts_seen);
 private:
     VariantStatisticsImpl * _impl;
 };
@@ -47,7 +47,15 @@ namespace variant
 struct VariantWriterImpl;
 class VariantWriter {
 public:
-    VariantWriter(const char * filename, const char * reference);
+    /**
+     * @param filename output file name, "-" for stdout. When this is empty,
+     *                 no file is written and records can only be retrieved
+     *                 using encode()
+     * @param reference reference fasta file name
+     * @param compression_level BGZF compression level for .vcf.gz / .bcf output
+     *                          (0-9, -1 for the htslib default)
+     */
+    VariantWriter(const char * filename, const char * reference, int compression_level = -1);
 
     VariantWriter(VariantWriter const &);
     ~VariantWriter();
@@ -85,6 +93,23 @@ public:
      */
     void put(Variants const & var);
 
+    /**
+     * @brief finish the header and return it
+     *
+     * No more header lines or samples can be added after this.
+     */
+    bcf_hdr_t * getHeader();
+
+    /**
+     * @brief convert a variant to a bcf record without writing it
+     *
+     * @param var the variant records to convert
+     * @return a record using the header returned by getHeader(). This is
+     *         owned by the writer and only valid until the next call to
+     *         encode() or put()
+     */
+    bcf1_t * encode(Variants const & var);
+
 private:
     VariantWriterImpl * _impl;
 };
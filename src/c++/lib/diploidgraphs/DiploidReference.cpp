@@ -312,4 +312,81 @@ std::list<DiploidRef> const & DiploidReference::result()
     return _impl->di_haps;
 }
 
+void DiploidReference::enumerate(
+    const char * chr,
+    int64_t start,
+    int64_t end,
+    std::list<variant::Variants> const & vars,
+    std::function<void(DiploidRef const &)> const & output,
+    int sample_ix)
+{
+    size_t n_pairs = 0;
+    if(std::string(chr) != "" && start >= 0 && end >= 0 && end - start + 1 > 0)
+    {
+        std::vector<ReferenceNode> nodes;
+        std::vector<ReferenceEdge> edges;
+
+        size_t nhets = 0;
+        _impl->gr.makeGraph(vars, sample_ix, nodes, edges, &nhets);
+
+        if(_impl->max_n_paths > 0 && pow(2.0, (double)nhets) > _impl->max_n_paths)
+        {
+            error("Too many het nodes (%i) at %s:%i-%i", nhets, chr, start, end);
+        }
+
+        const std::string refsq = _impl->gr.getRefFasta().query(chr, start, end);
+
+        // paths which haven't been paired yet, by nodes_used mask
+        std::unordered_map<uint64_t, std::string> unpaired;
+
+        // nhets is updated by enumeratePaths before the first path is passed on
+        _impl->gr.enumeratePaths(chr, start, end, nodes, edges,
+            [&](Haplotype const & hap, uint64_t nodes_used)
+            {
+                if(nhets == 0)
+                {
+                    DiploidRef r = {false, hap.noVar(), hap.seq(start, end), "", refsq};
+                    if(r.h1 == refsq)
+                    {
+                        r.homref = true;
+                    }
+                    output(r);
+                    ++n_pairs;
+                    return;
+                }
+
+                // if we have het nodes, each pair of haplotypes must cover them all
+                const uint64_t nh_mask = (((uint64_t)1) << (int)(nhets)) - 1;
+                auto opposite_path = unpaired.find((~nodes_used) & nh_mask);
+                if(opposite_path == unpaired.end())
+                {
+                    unpaired[nodes_used] = hap.seq(start, end);
+                    return;
+                }
+
+                DiploidRef r = {
+                    true,
+                    false,
+                    opposite_path->second,
+                    hap.seq(start, end),
+                    refsq
+                };
+                unpaired.erase(opposite_path);
+
+                // see setRegion
+                if( (r.h1 == refsq || r.h2 == refsq) && r.h1 != r.h2)
+                {
+                    r.homref = true;
+                }
+                output(r);
+                ++n_pairs;
+            },
+            0, (size_t)-1, _impl->max_n_paths, &nhets);
+    }
+    if(n_pairs == 0)
+    {
+        error("Cannot find matching haplotype pairs at %s:%i-%i", chr, start, end);
+    }
+}
+
 }  // namespace haplotypes
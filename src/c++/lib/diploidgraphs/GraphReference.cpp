@@ -39,6 +39,7 @@
 #include "Fasta.hh"
 #include "helpers/StringUtil.hh"
 #include "helpers/GraphUtil.hh"
+#include "helpers/DigestSet.hh"
 
 #include "variant/VariantAlleleRemover.hh"
 #include "variant/VariantAlleleSplitter.hh"
@@ -509,6 +510,31 @@ void GraphReference::enumeratePaths(
     std::vector<uint64_t> * nodes_used_vec,
     size_t * n_hets
 )
+{
+    enumeratePaths(chr, start, end, nodes, edges,
+                   [&target, nodes_used_vec](Haplotype const & ht, uint64_t nodes_used)
+                   {
+                       target.push_back(ht);
+                       if(nodes_used_vec != NULL)
+                       {
+                           nodes_used_vec->push_back(nodes_used);
+                       }
+                   },
+                   source, sink, max_n_paths, n_hets);
+}
+
+void GraphReference::enumeratePaths(
+    const char * chr,
+    int64_t start,
+    int64_t end,
+    std::vector<ReferenceNode> const & nodes,
+    std::vector<ReferenceEdge> const & edges,
+    path_callback_t const & output,
+    size_t source,
+    size_t sink,
+    int max_n_paths,
+    size_t * n_hets
+)
 {
     // make adjacency list from edge list
     std::vector< std::list< size_t > > adj;
@@ -562,7 +588,7 @@ void GraphReference::enumeratePaths(
                      ReferenceNode::color_t _color,
                      Haplotype const & _up_to_here,
                      uint64_t _nodes_used,
-                     std::set < std::string > const & _sequences_seen,
+                     std::set < uint64_t > const & _sequences_seen,
                      size_t _homs_used
         ) :
             node(_node),  next_choice(_next_choice), color(_color),
@@ -583,7 +609,7 @@ void GraphReference::enumeratePaths(
 
         uint64_t nodes_used; // track which nodes were used
 
-        std::set<std::string> sequences_seen; // HAP-147 track sequences we have seen already
+        std::set<uint64_t> sequences_seen; // HAP-147 track (digests of) sequences we have seen already
 
         size_t homs_used;  // count the hom variants we have used already
 
@@ -598,8 +624,8 @@ void GraphReference::enumeratePaths(
     ReferenceNode::color_t current_path_color = nodes[source].color;
     Haplotype ht(chr, _impl->refsq.getFilename().c_str());
     nodes[source].appendToHaplotype(ht);
-    std::set<std::string> sequences_seen;
-    sequences_seen.insert(ht.seq(start, end));
+    std::set<uint64_t> sequences_seen;
+    sequences_seen.insert(hashutil::digest(ht.seq(start, end)));
     uint64_t nodes_used = node_masks[source];
     size_t homs_used = 0;
     if(nodes[source].color == ReferenceNode::black && nodes[source].type == ReferenceNode::alternative)
@@ -611,7 +637,8 @@ void GraphReference::enumeratePaths(
     hlist.push_back(branchpoint(source, adj[source].begin(), current_path_color, ht,
                                 nodes_used, sequences_seen, homs_used));
 
-    while(!hlist.empty() && target.size() < ((size_t)max_n_paths))
+    size_t n_paths = 0;
+    while(!hlist.empty() && n_paths < ((size_t)max_n_paths))
     {
         branchpoint & current(hlist.front());
 
@@ -675,11 +702,12 @@ void GraphReference::enumeratePaths(
                 // Note we only need to do this if we already used het variants. Otherwise,
                 // we don't really have a choice and need to produce the same sequence twice.
                 std::string modified_rp = ht.seq(start, end);
+                const uint64_t modified_rp_digest = hashutil::digest(modified_rp);
                 // mark that we used this node on this path
                 nodes_used |= node_masks[nextone];
                 if(nodes[nextone].type == ReferenceNode::alternative && nodes_used != 0)
                 {
-                    if(sequences_seen.count(modified_rp))
+                    if(sequences_seen.count(modified_rp_digest))
                     {
 #ifdef _DEBUG_GRAPHREFERENCE
                         std::cerr << "Ignoring branch where we see the same sequence twice " << start << "-" << end << ": " << modified_rp << " seen: ";
@@ -691,7 +719,7 @@ void GraphReference::enumeratePaths(
                         cont = false;
                         break;
                     }
-                    sequences_seen.insert(modified_rp);
+                    sequences_seen.insert(modified_rp_digest);
                 }
 
                 if(nodes[nextone].color == ReferenceNode::black && nodes[nextone].type == ReferenceNode::alternative)
@@ -711,17 +739,11 @@ void GraphReference::enumeratePaths(
                     if(homs_used == homs && !(sink != (size_t)-1 && nodes[nextone].start > nodes[sink].start))
                     {
                         // save all blocks with no out edges
-                        target.push_back(ht);
-                        if(nodes_used_vec != NULL)
-                        {
-                            nodes_used_vec->push_back(nodes_used);
-                        }
+                        output(ht, nodes_used);
+                        ++n_paths;
 #ifdef _DEBUG_GRAPHREFERENCE
-                        std::cerr << "Finished path from BP " << current.bp_id << " at " << target[target.size()-1].seq(start, end);
-                        if(nodes_used_vec)
-                        {
-                            std::cerr << " u: " << std::bitset<64>((*nodes_used_vec)[nodes_used_vec->size()-1]).to_string();
-                        }
+                        std::cerr << "Finished path from BP " << current.bp_id << " at " << ht.seq(start, end);
+                        std::cerr << " u: " << std::bitset<64>(nodes_used).to_string();
                         std::cerr << "\n";
 #endif
                     }
@@ -762,17 +784,13 @@ void GraphReference::enumeratePaths(
     }
 
     // no final haps because all is homref?
-    if(target.empty() && hets == 0 && homs == 0)
+    if(n_paths == 0 && hets == 0 && homs == 0)
     {
-        target.push_back(Haplotype(chr, _impl->refsq.getFilename().c_str()));
-
-        if(nodes_used_vec != NULL)
-        {
-            nodes_used_vec->push_back(0);
-        }
+        output(Haplotype(chr, _impl->refsq.getFilename().c_str()), 0);
+        ++n_paths;
     }
 
-    if(target.empty())
+    if(n_paths == 0)
     {
         error("Failed to create any haplotype sequences from variants at %s:%i-%i", chr, start, end);
     }
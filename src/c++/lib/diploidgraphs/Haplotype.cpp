@@ -52,7 +52,9 @@ namespace haplotypes
 {
 
 
-static std::map<std::string, std::shared_ptr<FastaFile> > FS_REF;
+// one set of open references per thread, so haplotypes can be enumerated
+// in parallel without sharing file handles
+static thread_local std::map<std::string, std::shared_ptr<FastaFile> > FS_REF;
 
 void Haplotype::resetRefs()
 {
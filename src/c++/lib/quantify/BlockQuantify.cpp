@@ -99,7 +99,6 @@ namespace variant {
                                  std::string const & params) :
         _impl(std::unique_ptr<BlockQuantifyImpl>(new BlockQuantifyImpl{hdr,
                                                     ref_fasta,
-                                                    nullptr,
                                                     BlockQuantifyImpl::count_map_t(),
                                                     BlockQuantifyImpl::variantlist_t(),
                                                     bcfhelpers::getSampleNames(hdr),
@@ -108,7 +107,10 @@ namespace variant {
                                                     params.find("count_unk") != std::string::npos,
                                                     params.find("output_vtc") != std::string::npos,
                                                     params.find("count_homref") != std::string::npos,
-                                                    params.find("extended_counts") != std::string::npos
+                                                    params.find("extended_counts") != std::string::npos,
+                                                    VariantStatistics(ref_fasta,
+                                                                      params.find("count_homref") != std::string::npos),
+                                                    VariantCounts()
         }))
     {
     }
@@ -130,6 +132,18 @@ namespace variant {
         _impl->filters_to_ignore.insert(_fs.cbegin(), _fs.cend());
     }
 
+    void BlockQuantify::countInto(std::string const & key, VariantCounts const & counts)
+    {
+        auto it = _impl->count_map.find(key);
+        if (it == _impl->count_map.end())
+        {
+            VariantCounts c;
+            c.clear();
+            it = _impl->count_map.emplace(key, c).first;
+        }
+        it->second += counts;
+    }
+
     // add ROC decision point
     void BlockQuantify::addROCValue(std::string const & roc_identifier,
                                     roc::DecisionType dt,
@@ -269,7 +283,6 @@ namespace variant {
 
     void BlockQuantify::count()
     {
-        _impl->fasta_to_use.reset(new FastaFile(_impl->ref_fasta));
 #ifdef DEBUG_BLOCKQUANTIFY
         int lastpos = 0;
         std::cerr << "starting block." << "\n";
@@ -427,7 +440,6 @@ namespace variant {
 #ifdef DEBUG_BLOCKQUANTIFY
         std::cerr << "finished block " << lastpos << " - " << _impl->variants.size() << " records on thread " << std::this_thread::get_id() << "\n";
 #endif
-        _impl->fasta_to_use.reset(nullptr);
     }
 
     // GA4GH-VCF field-based ROC counting
@@ -484,7 +496,7 @@ namespace variant {
     }
 
     // result output
-    std::map<std::string, VariantStatistics> const & BlockQuantify::getCounts() const
+    std::map<std::string, VariantCounts> const & BlockQuantify::getCounts() const
     {
         return _impl->count_map;
     }
@@ -59,11 +59,11 @@ namespace variant
         ~BlockQuantifyImpl();
 
         bcf_hdr_t * hdr;
+        // shared between all blocks, FastaFile::query is thread-safe
         FastaFile const & ref_fasta;
-        std::unique_ptr<FastaFile> fasta_to_use;
 
         typedef std::list<std::string> samplenames_t;
-        typedef std::map<std::string, VariantStatistics> count_map_t;
+        typedef std::map<std::string, VariantCounts> count_map_t;
         typedef std::list<bcf1_t *> variantlist_t;
         typedef std::map<std::string, roc::Roc> rocmap_t;
         typedef std::set<std::string> filterset_t;
@@ -78,6 +78,10 @@ namespace variant
         bool output_vtc;
         bool count_homref;
         bool extended_counts;
+
+        // classifies / counts each record once, results are added to count_map
+        VariantStatistics stats;
+        VariantCounts record_counts;
     };
 }
 
@@ -100,6 +100,7 @@ namespace variant
         std::vector<std::string> lts;
 
         int si = 0;
+        std::string key;
         for (auto const &s : _impl->samples) {
             std::string type = bcfhelpers::getFormatString(_impl->hdr, v, "BD", si);
             std::string kind = bcfhelpers::getFormatString(_impl->hdr, v, "BK", si);
@@ -110,44 +111,34 @@ namespace variant
 
             bds.push_back(type);
 
+            // count this variant once and determine the types seen
+            VariantCounts & rc = _impl->record_counts;
+            rc.clear();
+            int *types;
+            int ntypes = 0;
+            uint16_t extracounts = 0;
+            _impl->stats.count(_impl->hdr, v, si, rc, &types, &ntypes, &extracounts);
+
             // count "all"
-            std::string key = "all:" + s;
-            auto it = _impl->count_map.find(key);
-            if (it == _impl->count_map.end()) {
-                it = _impl->count_map.emplace(key, VariantStatistics(*(_impl->fasta_to_use),
-                                                                     _impl->count_homref)).first;
-            }
-            it->second.add(_impl->hdr, v, si);
+            key.assign("all:");
+            key += s;
+            countInto(key, rc);
 
             // count all and specific type instance in
             // all samples
-            key = type + ":" + kind + ":" + tag_string + ":" + s;
+            key.assign(type);
+            key += ":";
+            key += kind;
+            key += ":";
+            key += tag_string;
+            key += ":";
+            key += s;
 #ifdef DEBUG_GA4GH_QUANTIFY
             std::cerr << key << "\n";
 #endif
+            countInto(key, rc);
 
-            it = _impl->count_map.find(key);
-            if (it == _impl->count_map.end()) {
-                it = _impl->count_map.emplace(key, VariantStatistics(*(_impl->fasta_to_use),
-                                                                     _impl->count_homref)).first;
-            }
-
-            // determine the types seen in the variant
-            int *types;
-            int ntypes = 0;
-            std::set<std::string> * p_extracounts = NULL;
-
-            // count this variant
-            it->second.add(_impl->hdr, v, si, &types, &ntypes, &p_extracounts);
-
-            if(p_extracounts)
-            {
-                bis.push_back(VariantStatistics::extraCountsToBI(*p_extracounts));
-            }
-            else
-            {
-                bis.push_back(".");
-            }
+            bis.push_back(VariantStatistics::extraCountsToBI(extracounts));
 
             // aggregate the things we have seen across samples
             uint64_t vts_seen = 0;
@@ -0,0 +1,254 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/**
+ * Count blocks of comparison records in parallel
+ *
+ * \file QuantifyPipeline.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#include "QuantifyPipeline.hh"
+#include "BlockQuantify.hh"
+
+#include "helpers/BCFHelpers.hh"
+#include "helpers/OrderedPipeline.hh"
+#include "helpers/StringUtil.hh"
+
+#include <htslib/hts.h>
+
+#include "Error.hh"
+
+namespace variant
+{
+    typedef std::unique_ptr<BlockQuantify> block_t;
+
+    struct QuantifyPipeline::QuantifyPipelineImpl
+    {
+        QuantifyPipelineImpl(bcf_hdr_t * _hdr,
+                             FastaFile const & _ref_fasta,
+                             QuantifyRegions & _regions,
+                             std::string const & _qtype,
+                             std::string const & _qparams,
+                             std::string const & _roc_filter,
+                             int _blocksize) :
+            hdr(_hdr), ref_fasta(_ref_fasta), regions(_regions),
+            qtype(_qtype), qparams(_qparams), roc_filter(_roc_filter),
+            blocksize(_blocksize)
+        {}
+
+        ~QuantifyPipelineImpl()
+        {
+            // stop counting before closing the output
+            blocks.reset();
+            if(writer)
+            {
+                hts_close(writer);
+            }
+        }
+
+        block_t makeBlock()
+        {
+            block_t b = makeQuantifier(hdr, ref_fasta, qtype, qparams);
+            b->rocFiltering(roc_filter);
+            return b;
+        }
+
+        /** this is where things actually get written to files */
+        void output(block_t & block)
+        {
+            // output variants
+            if(writer)
+            {
+                auto const & variants = block->getVariants();
+                for(auto & v : variants)
+                {
+                    bcf_write1(writer, hdr, v);
+                }
+            }
+
+            // update ROC data
+            if(compute_rocs)
+            {
+                auto const & rm = block->getRocs();
+                for(auto const & r : rm)
+                {
+                    auto it = rocs.find(r.first);
+                    if (it == rocs.end()) {
+                        rocs.insert(r);
+                    }
+                    else
+                    {
+                        it->second.add(r.second);
+                    }
+                }
+            }
+
+            // free the records as soon as they have been written
+            block.reset();
+        }
+
+        bcf_hdr_t * hdr;
+        FastaFile const & ref_fasta;
+        QuantifyRegions & regions;
+        std::string qtype;
+        std::string qparams;
+        std::string roc_filter;
+        int blocksize;
+
+        htsFile * writer = nullptr;
+        bool compute_rocs = false;
+        std::map<std::string, roc::Roc> rocs;
+
+        block_t current;
+        std::string current_chr;
+        int previous_bs = -1;
+        int vars_in_block = 0;
+
+        std::unique_ptr<parallel::OrderedPipeline<block_t> > blocks;
+    };
+
+    QuantifyPipeline::QuantifyPipeline(bcf_hdr_t * hdr,
+                                       FastaFile const & ref_fasta,
+                                       QuantifyRegions & regions,
+                                       std::string const & qtype,
+                                       std::string const & qparams,
+                                       std::string const & roc_filter,
+                                       int threads,
+                                       int blocksize) :
+        _impl(new QuantifyPipelineImpl(hdr, ref_fasta, regions, qtype, qparams, roc_filter, blocksize))
+    {
+        _impl->current = _impl->makeBlock();
+        // update the header
+        _impl->current->updateHeader(hdr);
+        bcf_hdr_sync(hdr);
+
+        /** each block can be counted in parallel, but we need to write out the variants
+         *  sequentially. We limit the number of blocks in memory so reading cannot run
+         *  too far ahead of counting and writing.
+         */
+        QuantifyPipelineImpl * impl = _impl.get();
+        _impl->blocks.reset(new parallel::OrderedPipeline<block_t>(
+            threads, (size_t)(2*threads + 1),
+            [](block_t & block) { block->count(); },
+            [impl](block_t & block) { impl->output(block); }));
+    }
+
+    QuantifyPipeline::~QuantifyPipeline() {}
+
+    void QuantifyPipeline::setOutputVCF(std::string const & filename)
+    {
+        const char * mode = "wu";
+
+        if(stringutil::endsWith(filename, ".vcf.gz"))
+        {
+            mode = "wz";
+        }
+        else if(stringutil::endsWith(filename, ".bcf"))
+        {
+            mode = "wb";
+        }
+
+        if(!filename.empty() && filename[0] == '-')
+        {
+            _impl->writer = hts_open("-", mode);
+        }
+        else
+        {
+            _impl->writer = hts_open(filename.c_str(), mode);
+        }
+        if(!_impl->writer)
+        {
+            error("Cannot open %s for writing.", filename.c_str());
+        }
+        bcf_hdr_write(_impl->writer, _impl->hdr);
+    }
+
+    void QuantifyPipeline::setComputeRocs(bool compute_rocs)
+    {
+        _impl->compute_rocs = compute_rocs;
+    }
+
+    void QuantifyPipeline::add(bcf1_t * record)
+    {
+        if(!_impl->blocks)
+        {
+            error("Cannot add records after QuantifyPipeline::finish().");
+        }
+        // copying also syncs records which were built in memory (e.g. by VariantWriter::encode)
+        bcf1_t * v = bcf_dup(record);
+        bcf_unpack(v, BCF_UN_INFO);
+        _impl->regions.annotate(_impl->hdr, v);
+
+        const std::string vchr = bcfhelpers::getChrom(_impl->hdr, v);
+        if(vchr != _impl->current_chr)
+        {
+            // reset bs on chr switch
+            _impl->previous_bs = -1;
+        }
+        _impl->current_chr = vchr;
+
+        const int current_bs = bcfhelpers::getInfoInt(_impl->hdr, v, "BS");
+
+        // don't break benchmarking superloci across threads
+        if(_impl->vars_in_block > _impl->blocksize
+           && (current_bs < 0 || _impl->previous_bs < 0 || (current_bs != _impl->previous_bs)))
+        {
+            // blocks while too many blocks are waiting to be counted / written
+            _impl->blocks->push(std::move(_impl->current));
+            _impl->current = _impl->makeBlock();
+            _impl->vars_in_block = 0;
+        }
+
+        _impl->current->add(v);
+        ++_impl->vars_in_block;
+        _impl->previous_bs = current_bs;
+    }
+
+    void QuantifyPipeline::finish()
+    {
+        if(!_impl->blocks)
+        {
+            return;
+        }
+        _impl->blocks->push(std::move(_impl->current));
+        _impl->blocks->finish();
+        _impl->blocks.reset();
+        if(_impl->writer)
+        {
+            hts_close(_impl->writer);
+            _impl->writer = nullptr;
+        }
+    }
+
+    std::map<std::string, roc::Roc> const & QuantifyPipeline::getRocs() const
+    {
+        return _impl->rocs;
+    }
+}
@@ -330,6 +330,27 @@ namespace variant
         }
         return size_it->second;
     }
-}
 
+    std::vector<std::string> const & QuantifyRegions::getRegionNames() const
+    {
+        return _impl->names;
+    }
+
+    void QuantifyRegions::setRegionSize(std::string const & region_name, size_t size)
+    {
+        size_t label_id;
+        auto label_it = _impl->label_map.find(region_name);
+        if(label_it == _impl->label_map.end())
+        {
+            label_id = _impl->names.size();
+            _impl->names.push_back(region_name);
+            _impl->label_map[region_name] = label_id;
+        }
+        else
+        {
+            label_id = label_it->second;
+        }
+        _impl->region_sizes[label_id] = size;
+    }
+}
 
@@ -216,6 +216,7 @@ namespace variant
         // count all and specific type instance in
         // all samples
         int i = 0;
+        std::string key;
         for (auto const &s : _impl->samples) {
             // figure out if this is a no-call first
             int gt[MAX_GT];
@@ -225,19 +226,18 @@ namespace variant
             const bool isNoCall = ngt == 0 || std::all_of(&gt[0], &gt[ngt], [](int x) { return x < 0; });
             const bool isHomref = ngt > 0 && std::all_of(&gt[0], &gt[ngt], [](int x) { return x == 0; });
 
-            // count as "all"
-            std::string key = "all:" + s;
-
-            // see if we already have a statistics counter for this kind of variant
-            auto it = _impl->count_map.find(key);
-            if (it == _impl->count_map.end()) {
-                it = _impl->count_map.emplace(key, VariantStatistics(*(_impl->fasta_to_use),
-                                                                     _impl->count_homref)).first;
-            }
+            // count this variant once, the result is added to "all" and to the type-specific counts
+            VariantCounts & rc = _impl->record_counts;
+            rc.clear();
             int *types;
             int ntypes = 0;
-            std::set<std::string> * p_extracounts = NULL;
-            it->second.add(_impl->hdr, v, i, &types, &ntypes, &p_extracounts);
+            uint16_t extracounts = 0;
+            _impl->stats.count(_impl->hdr, v, i, rc, &types, &ntypes, &extracounts);
+
+            // count as "all"
+            key.assign("all:");
+            key += s;
+            countInto(key, rc);
 
             // aggregate the things we have seen across samples
             uint64_t vts_seen = 0;
@@ -252,14 +252,7 @@ namespace variant
                 }
             }
 
-            if(p_extracounts)
-            {
-                bis.push_back(VariantStatistics::extraCountsToBI(*p_extracounts));
-            }
-            else
-            {
-                bis.push_back(".");
-            }
+            bis.push_back(VariantStatistics::extraCountsToBI(extracounts));
 
             /** vt = 0 -> UNK
              *  vt = 1 -> SNP
@@ -291,15 +284,11 @@ namespace variant
             // determine the types seen in the variant
             if(fail || isNoCall || (i == 1 && q_filtered))
             {
-                key = ".:.:" + tag_string + ":" + s;
-
-                it = _impl->count_map.find(key);
-                if (it == _impl->count_map.end()) {
-                    it = _impl->count_map.emplace(key, VariantStatistics(*(_impl->fasta_to_use),
-                                                                         _impl->count_homref)).first;
-                }
-                // count this variant
-                it->second.add(_impl->hdr, v, i);
+                key.assign(".:.:");
+                key += tag_string;
+                key += ":";
+                key += s;
+                countInto(key, rc);
 
                 if(fail)
                 {
@@ -370,17 +359,14 @@ namespace variant
                     qqs.push_back(bcfhelpers::getFormatFloat(_impl->hdr, v, roc_field.c_str(), i));
                 }
 
-                key = this_type + ":" + kind + ":" + tag_string + ":" + s;
-
-                it = _impl->count_map.find(key);
-                if (it == _impl->count_map.end())
-                {
-                    it = _impl->count_map.emplace(key, VariantStatistics(*(_impl->fasta_to_use),
-                                                                         _impl->count_homref)).first;
-                }
-
-                // count this variant
-                it->second.add(_impl->hdr, v, i);
+                key.assign(this_type);
+                key += ":";
+                key += kind;
+                key += ":";
+                key += tag_string;
+                key += ":";
+                key += s;
+                countInto(key, rc);
             }
             ++i;
         }
@@ -40,6 +40,9 @@
 #include <cstdio>
 #include <sstream>
 #include <htslib/vcf.h>
+#include <htslib/tbx.h>
+#include <htslib/bgzf.h>
+#include <cstring>
 #include <memory>
 #include <limits>
 #include <set>
@@ -540,7 +543,7 @@ namespace bcfhelpers
                       << " max_ad = " << max_ad << " retrieved: " << values.size()
                       << "\n";
         }
-        for(size_t q = 0; q < values.size(); ++q)
+        for(size_t q = 0; q < values.size() && (int)q < max_ad; ++q)
         {
             ad[q] = values[q];
         }
@@ -920,4 +923,191 @@ namespace bcfhelpers
         }
         return max_match;
     }
+
+    /** per-contig record counts from the index */
+    bool getIndexCounts(const char * filename, std::vector< std::pair<std::string, uint64_t> > & counts)
+    {
+        counts.clear();
+        htsFile * fp = hts_open(filename, "r");
+        if(!fp)
+        {
+            return false;
+        }
+        bcf_hdr_t * hdr = bcf_hdr_read(fp);
+
+        // BCF files have a CSI index with contig names in the header, VCF files usually a tabix index
+        tbx_t * tbx_idx = NULL;
+        hts_idx_t * idx = NULL;
+        if(hdr && hts_get_format(fp)->format == bcf)
+        {
+            idx = bcf_index_load(filename);
+        }
+        else if(hdr)
+        {
+            tbx_idx = tbx_index_load(filename);
+            if(tbx_idx)
+            {
+                idx = tbx_idx->idx;
+            }
+        }
+
+        // indexes written by old versions of tabix have no counts
+        bool success = false;
+        if(idx)
+        {
+            int count = 0;
+            const char ** names = tbx_idx ? tbx_seqnames(tbx_idx, &count) : bcf_index_seqnames(idx, hdr, &count);
+            for(int i = 0; i < count; ++i)
+            {
+                const int tid = tbx_idx ? tbx_name2id(tbx_idx, names[i]) : bcf_hdr_name2id(hdr, names[i]);
+                uint64_t mapped = 0, unmapped = 0;
+                // contigs without records have no counts
+                if(tid >= 0 && hts_idx_get_stat(idx, tid, &mapped, &unmapped) == 0)
+                {
+                    success = true;
+                }
+                counts.push_back(std::make_pair(std::string(names[i]), mapped));
+            }
+            free(names);
+        }
+
+        if(tbx_idx)
+        {
+            tbx_destroy(tbx_idx);
+        }
+        else if(idx)
+        {
+            hts_idx_destroy(idx);
+        }
+        if(hdr)
+        {
+            bcf_hdr_destroy(hdr);
+        }
+        hts_close(fp);
+
+        if(!success)
+        {
+            counts.clear();
+        }
+        return success;
+    }
+
+    /** contig names from the index */
+    bool getIndexContigs(const char * filename, const bcf_hdr_t * hdr, std::vector<std::string> & contigs)
+    {
+        contigs.clear();
+
+        // tabix indexes store the tabix configuration and the contig names before the bins
+        // (CSI indexes of VCF files keep these in the aux data). Like htslib, we look for
+        // a .csi index first.
+        for(const char * suffix : {".csi", ".tbi"})
+        {
+            const std::string index_name = std::string(filename) + suffix;
+            BGZF * fp = bgzf_open(index_name.c_str(), "r");
+            if(!fp)
+            {
+                continue;
+            }
+
+            char magic[4];
+            std::vector<char> meta;
+            bool ok = bgzf_read(fp, magic, 4) == 4;
+            if(ok && memcmp(magic, "TBI\1", 4) == 0)
+            {
+                // n_ref, format, col_seq, col_beg, col_end, meta, skip, l_nm, names
+                int32_t x[8];
+                ok = bgzf_read(fp, x, sizeof(x)) == sizeof(x);
+                if(ok)
+                {
+                    if(ed_is_big())
+                    {
+                        for(int i = 0; i < 8; ++i)
+                        {
+                            ed_swap_4p(&x[i]);
+                        }
+                    }
+                    ok = x[7] >= 0;
+                }
+                if(ok)
+                {
+                    meta.resize(28 + (size_t)x[7]);
+                    memcpy(meta.data(), x + 1, 28);
+                    ok = x[7] == 0 || bgzf_read(fp, meta.data() + 28, (size_t)x[7]) == x[7];
+                }
+            }
+            else if(ok && memcmp(magic, "CSI\1", 4) == 0)
+            {
+                // min_shift, depth, l_aux, aux
+                int32_t x[3];
+                ok = bgzf_read(fp, x, sizeof(x)) == sizeof(x);
+                if(ok)
+                {
+                    if(ed_is_big())
+                    {
+                        for(int i = 0; i < 3; ++i)
+                        {
+                            ed_swap_4p(&x[i]);
+                        }
+                    }
+                    ok = x[2] >= 0;
+                }
+                if(ok && x[2] > 0)
+                {
+                    meta.resize((size_t)x[2]);
+                    ok = bgzf_read(fp, meta.data(), (size_t)x[2]) == x[2];
+                }
+            }
+            else
+            {
+                ok = false;
+            }
+            bgzf_close(fp);
+
+            if(!ok)
+            {
+                return false;
+            }
+
+            if(meta.size() >= 28)
+            {
+                int32_t l_nm = 0;
+                memcpy(&l_nm, meta.data() + 24, 4);
+                if(ed_is_big())
+                {
+                    ed_swap_4p(&l_nm);
+                }
+                if(l_nm < 0 || meta.size() < 28 + (size_t)l_nm)
+                {
+                    return false;
+                }
+                const char * nm = meta.data() + 28;
+                const char * nm_end = nm + l_nm;
+                while(nm < nm_end)
+                {
+                    const size_t len = strnlen(nm, (size_t)(nm_end - nm));
+                    contigs.emplace_back(nm, len);
+                    nm += len + 1;
+                }
+                return true;
+            }
+            // BCF indexes have no name table
+            break;
+        }
+
+        // contig ids which have records are found from the bins of the full index
+        hts_idx_t * idx = bcf_index_load(filename);
+        if(!idx)
+        {
+            return false;
+        }
+        int count = 0;
+        const char ** names = bcf_index_seqnames(idx, const_cast<bcf_hdr_t*>(hdr), &count);
+        for(int i = 0; i < count; ++i)
+        {
+            contigs.push_back(names[i]);
+        }
+        free(names);
+        hts_idx_destroy(idx);
+        return true;
+    }
 } // namespace bcfhelpers
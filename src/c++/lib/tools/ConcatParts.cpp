@@ -0,0 +1,519 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * \brief BGZF-level concatenation of VCF / BCF parts
+ *
+ * \file ConcatParts.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#include "helpers/ConcatParts.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+
+#include <htslib/bgzf.h>
+#include <htslib/hfile.h>
+#include <htslib/kstring.h>
+#include <htslib/tbx.h>
+#include <htslib/vcf.h>
+
+#include "Error.hh"
+
+namespace bcfhelpers
+{
+
+namespace _concatparts
+{
+    static const int MIN_SHIFT = 14;
+
+    /** empty BGZF block written at the end of each file */
+    static const char BGZF_EOF[28] = {
+        '\037', '\213', '\010', '\4', '\0', '\0', '\0', '\0', '\0', '\377', '\6', '\0', '\102', '\103',
+        '\2', '\0', '\033', '\0', '\3', '\0', '\0', '\0', '\0', '\0', '\0', '\0', '\0', '\0'
+    };
+
+    struct KString
+    {
+        KString() : s{0, 0, nullptr} {}
+        ~KString() { free(s.s); }
+        KString(KString const &) = delete;
+        KString & operator=(KString const &) = delete;
+        kstring_t s;
+    };
+
+    /** interval of a record + virtual offset of its end, as needed by hts_idx_push */
+    struct Entry
+    {
+        int tid;
+        int64_t beg;
+        int64_t end;
+        uint64_t voffset;
+    };
+
+    /** contig ids for VCF, numbered in order of appearance like tabix does */
+    struct ContigNames
+    {
+        int get(const char * name, size_t len)
+        {
+            const std::string n(name, len);
+            auto it = ids.find(n);
+            if(it != ids.end())
+            {
+                return it->second;
+            }
+            const int id = (int)names.size();
+            ids[n] = id;
+            names.push_back(n);
+            return id;
+        }
+
+        /** index meta data, see tbx_set_meta */
+        void setMeta(hts_idx_t * idx) const
+        {
+            uint32_t x[7];
+            memcpy(x, &tbx_conf_vcf, 24);
+            int l_nm = 0;
+            for(auto const & n : names)
+            {
+                l_nm += (int)n.size() + 1;
+            }
+            x[6] = (uint32_t)l_nm;
+            if(ed_is_big())
+            {
+                for(int i = 0; i < 7; ++i)
+                {
+                    x[i] = ed_swap_4(x[i]);
+                }
+            }
+            uint8_t * meta = (uint8_t*)malloc((size_t)l_nm + 28);
+            memcpy(meta, x, 28);
+            int l = 28;
+            for(auto const & n : names)
+            {
+                memcpy(meta + l, n.c_str(), n.size() + 1);
+                l += (int)n.size() + 1;
+            }
+            hts_idx_set_meta(idx, l, meta, 0);
+        }
+
+        std::unordered_map<std::string, int> ids;
+        std::vector<std::string> names;
+    };
+
+    /** get the interval of a VCF line the same way tabix does */
+    static bool parseVCFInterval(kstring_t const & s, ContigNames & names, Entry & e)
+    {
+        const char * p = s.s;
+        const char * end = s.s + s.l;
+        int col = 1;
+        e.tid = -1;
+        e.beg = e.end = -1;
+        while(p <= end)
+        {
+            const char * q = (const char *)memchr(p, '\t', end - p);
+            if(!q)
+            {
+                q = end;
+            }
+            if(col == 1)
+            {
+                e.tid = names.get(p, q - p);
+            }
+            else if(col == 2)
+            {
+                char * pe = nullptr;
+                e.beg = e.end = strtol(p, &pe, 0);
+                if(pe == p)
+                {
+                    return false;
+                }
+                e.beg = std::max((int64_t)0, e.beg - 1);
+                e.end = std::max((int64_t)1, e.end);
+            }
+            else if(col == 4)
+            {
+                if(q > p)
+                {
+                    e.end = e.beg + (q - p);
+                }
+            }
+            else if(col == 8)
+            {
+                for(const char * ip = p; ip < q; )
+                {
+                    const char * iq = (const char *)memchr(ip, ';', q - ip);
+                    if(!iq)
+                    {
+                        iq = q;
+                    }
+                    if(iq - ip > 4 && strncmp(ip, "END=", 4) == 0)
+                    {
+                        e.end = strtol(ip + 4, nullptr, 0);
+                        break;
+                    }
+                    ip = iq + 1;
+                }
+                break;
+            }
+            p = q + 1;
+            ++col;
+        }
+        return e.tid >= 0 && e.beg >= 0 && e.end >= 0;
+    }
+
+    /** check that records from b can be written using header a */
+    static bool headersMatch(const bcf_hdr_t * a, const bcf_hdr_t * b, bool is_bcf)
+    {
+        for(int t = 0; t < 3; ++t)
+        {
+            // VCF records reference ids by name, only the samples must be the same
+            if(!is_bcf && t != BCF_DT_SAMPLE)
+            {
+                continue;
+            }
+            if(a->n[t] != b->n[t])
+            {
+                return false;
+            }
+            for(int j = 0; j < a->n[t]; ++j)
+            {
+                if(strcmp(a->id[t][j].key, b->id[t][j].key) != 0)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /** copy compressed blocks from a file starting at offset, leaving out the EOF marker */
+    static void copyBlocks(std::string const & filename, int64_t offset, BGZF * out)
+    {
+        FILE * f = fopen(filename.c_str(), "rb");
+        if(!f)
+        {
+            error("Cannot open %s", filename.c_str());
+        }
+        fseeko(f, 0, SEEK_END);
+        int64_t file_end = (int64_t)ftello(f);
+        if(file_end >= offset + 28)
+        {
+            char eof[28];
+            fseeko(f, file_end - 28, SEEK_SET);
+            if(fread(eof, 1, 28, f) == 28 && memcmp(eof, BGZF_EOF, 28) == 0)
+            {
+                file_end -= 28;
+            }
+        }
+        fseeko(f, offset, SEEK_SET);
+        std::vector<char> buffer(1024*1024);
+        int64_t remaining = file_end - offset;
+        while(remaining > 0)
+        {
+            const size_t n = fread(buffer.data(), 1, (size_t)std::min(remaining, (int64_t)buffer.size()), f);
+            if(n == 0 || bgzf_raw_write(out, buffer.data(), n) != (ssize_t)n)
+            {
+                fclose(f);
+                error("Failed to copy blocks from %s", filename.c_str());
+            }
+            remaining -= n;
+        }
+        fclose(f);
+        // bgzf_raw_write does not keep track of this
+        out->block_address += file_end - offset;
+    }
+}
+
+void concatenateParts(std::vector<std::string> const & parts,
+                      std::string const & output,
+                      int index_format)
+{
+    using namespace _concatparts;
+    if(parts.empty())
+    {
+        error("No parts to concatenate into %s", output.c_str());
+    }
+
+    std::unique_ptr<htsFile, int(*)(htsFile*)> out(nullptr, hts_close);
+    std::unique_ptr<bcf_hdr_t, void(*)(bcf_hdr_t*)> out_hdr(nullptr, bcf_hdr_destroy);
+    std::unique_ptr<hts_idx_t, void(*)(hts_idx_t*)> idx(nullptr, hts_idx_destroy);
+    std::unique_ptr<bcf1_t, void(*)(bcf1_t*)> rec(bcf_init(), bcf_destroy);
+    KString str;
+    ContigNames names;
+    bool is_bcf = false;
+    BGZF * ob = nullptr;
+
+    const auto push = [&idx, &output](Entry const & e)
+    {
+        if(idx && hts_idx_push(idx.get(), e.tid, e.beg, e.end, e.voffset, 1) < 0)
+        {
+            error("Cannot index %s, the parts must be sorted and must not overlap.", output.c_str());
+        }
+    };
+
+    for(size_t ipart = 0; ipart < parts.size(); ++ipart)
+    {
+        std::string const & part = parts[ipart];
+        std::unique_ptr<htsFile, int(*)(htsFile*)> in(hts_open(part.c_str(), "r"), hts_close);
+        if(!in)
+        {
+            error("Cannot open %s", part.c_str());
+        }
+        const htsFormat * format = hts_get_format(in.get());
+        if(format->compression != bgzf || (format->format != vcf && format->format != bcf))
+        {
+            error("%s is not a bgzipped VCF or BCF file", part.c_str());
+        }
+        std::unique_ptr<bcf_hdr_t, void(*)(bcf_hdr_t*)> hdr(bcf_hdr_read(in.get()), bcf_hdr_destroy);
+        if(!hdr)
+        {
+            error("Cannot read header from %s", part.c_str());
+        }
+
+        if(ipart == 0)
+        {
+            is_bcf = format->format == bcf;
+            if(is_bcf && index_format == HTS_FMT_TBI)
+            {
+                error("BCF files cannot be indexed using tabix.");
+            }
+            out.reset(hts_open(output.c_str(), is_bcf ? "wb" : "wz"));
+            if(!out)
+            {
+                error("Cannot write %s", output.c_str());
+            }
+            if(bcf_hdr_write(out.get(), hdr.get()) < 0)
+            {
+                error("Cannot write header to %s", output.c_str());
+            }
+            ob = out->fp.bgzf;
+            // the header goes into its own blocks
+            if(bgzf_flush(ob) < 0)
+            {
+                error("Cannot write to %s", output.c_str());
+            }
+            if(index_format == HTS_FMT_CSI && is_bcf)
+            {
+                // see bcf_index
+                int64_t max_len = 0;
+                for(int i = 0; i < hdr->n[BCF_DT_CTG]; ++i)
+                {
+                    if(hdr->id[BCF_DT_CTG][i].val)
+                    {
+                        max_len = std::max(max_len, (int64_t)hdr->id[BCF_DT_CTG][i].val->info[0]);
+                    }
+                }
+                if(!max_len)
+                {
+                    max_len = ((int64_t)1 << 31) - 1;
+                }
+                max_len += 256;
+                int n_lvls = 0;
+                for(int64_t s = 1 << MIN_SHIFT; max_len > s; ++n_lvls, s <<= 3);
+                idx.reset(hts_idx_init(hdr->n[BCF_DT_CTG], HTS_FMT_CSI, bgzf_tell(ob), MIN_SHIFT, n_lvls));
+            }
+            else if(index_format == HTS_FMT_CSI)
+            {
+                idx.reset(hts_idx_init(0, HTS_FMT_CSI, bgzf_tell(ob), MIN_SHIFT, (TBX_MAX_SHIFT - MIN_SHIFT + 2) / 3));
+            }
+            else if(index_format == HTS_FMT_TBI)
+            {
+                idx.reset(hts_idx_init(0, HTS_FMT_TBI, bgzf_tell(ob), MIN_SHIFT, 5));
+            }
+            out_hdr = std::move(hdr);
+        }
+        else
+        {
+            if(is_bcf != (format->format == bcf))
+            {
+                error("Cannot concatenate VCF and BCF parts (%s).", part.c_str());
+            }
+            if(!headersMatch(out_hdr.get(), hdr.get(), is_bcf))
+            {
+                error("The header of %s does not match the header of %s", part.c_str(), parts[0].c_str());
+            }
+        }
+
+        // text VCF is read through a kstream by htslib, so we need our own BGZF handle
+        std::unique_ptr<BGZF, int(*)(BGZF*)> vcf_in(nullptr, bgzf_close);
+        BGZF * ib = nullptr;
+        if(is_bcf)
+        {
+            ib = in->fp.bgzf;
+        }
+        else
+        {
+            vcf_in.reset(bgzf_open(part.c_str(), "r"));
+            if(!vcf_in)
+            {
+                error("Cannot open %s", part.c_str());
+            }
+            ib = vcf_in.get();
+            // skip header lines, stop with the block holding the first record loaded
+            while(true)
+            {
+                if(ib->block_offset >= ib->block_length)
+                {
+                    if(bgzf_read_block(ib) < 0)
+                    {
+                        error("Cannot read %s", part.c_str());
+                    }
+                    if(ib->block_length == 0)
+                    {
+                        break;
+                    }
+                }
+                if(((const char *)ib->uncompressed_block)[ib->block_offset] != '#')
+                {
+                    break;
+                }
+                if(bgzf_getline(ib, '\n', &str.s) < 0)
+                {
+                    break;
+                }
+            }
+        }
+
+        // the rest of the block which contains the end of the header gets re-compressed
+        int64_t tail_block = -1;
+        int tail_start = 0;
+        std::string tail;
+        if(ib->block_length > 0)
+        {
+            tail_block = ib->block_address;
+            tail_start = ib->block_offset;
+            tail.assign((const char *)ib->uncompressed_block + ib->block_offset,
+                        (size_t)(ib->block_length - ib->block_offset));
+        }
+        // all blocks after it are copied verbatim
+        const int64_t copy_from = htell(ib->fp);
+        int64_t out_base = -1;
+        std::vector<Entry> tail_entries;
+
+        const auto write_tail = [&]()
+        {
+            size_t written = 0;
+            for(auto & e : tail_entries)
+            {
+                const size_t upto = (size_t)((e.voffset & 0xffff) - tail_start);
+                if(upto > written && bgzf_write(ob, tail.c_str() + written, upto - written) < 0)
+                {
+                    error("Cannot write to %s", output.c_str());
+                }
+                written = upto;
+                e.voffset = (uint64_t)bgzf_tell(ob);
+                push(e);
+            }
+            if(tail.size() > written && bgzf_write(ob, tail.c_str() + written, tail.size() - written) < 0)
+            {
+                error("Cannot write to %s", output.c_str());
+            }
+            if(bgzf_flush(ob) < 0)
+            {
+                error("Cannot write to %s", output.c_str());
+            }
+            out_base = ob->block_address;
+        };
+
+        Entry e;
+        while(true)
+        {
+            if(is_bcf)
+            {
+                if(bcf_read(in.get(), hdr ? hdr.get() : out_hdr.get(), rec.get()) < 0)
+                {
+                    break;
+                }
+                e.tid = rec->rid;
+                e.beg = rec->pos;
+                e.end = rec->pos + rec->rlen;
+            }
+            else
+            {
+                if(bgzf_getline(ib, '\n', &str.s) < 0)
+                {
+                    break;
+                }
+                if(!parseVCFInterval(str.s, names, e))
+                {
+                    error("Cannot parse VCF record in %s: %s", part.c_str(), str.s.s);
+                }
+            }
+            e.voffset = (uint64_t)bgzf_tell(ib);
+
+            if(out_base < 0 && (int64_t)(e.voffset >> 16) == tail_block)
+            {
+                tail_entries.push_back(e);
+                continue;
+            }
+            if(out_base < 0)
+            {
+                write_tail();
+            }
+            const int64_t block = (int64_t)(e.voffset >> 16) - copy_from + out_base;
+            e.voffset = ((uint64_t)block << 16) | (e.voffset & 0xffff);
+            push(e);
+        }
+        if(out_base < 0)
+        {
+            write_tail();
+        }
+        vcf_in.reset();
+        in.reset();
+        copyBlocks(part, copy_from, ob);
+    }
+
+    if(idx)
+    {
+        hts_idx_finish(idx.get(), bgzf_tell(ob));
+    }
+    if(hts_close(out.release()) != 0)
+    {
+        error("Error closing %s", output.c_str());
+    }
+    if(idx)
+    {
+        if(!is_bcf)
+        {
+            names.setMeta(idx.get());
+        }
+        if(hts_idx_save(idx.get(), output.c_str(), index_format) < 0)
+        {
+            error("Cannot write index for %s", output.c_str());
+        }
+    }
+}
+
+}
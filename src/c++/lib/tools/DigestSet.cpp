@@ -0,0 +1,309 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * \brief Set of sequence digests with a memory budget
+ *
+ * \file DigestSet.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#include "helpers/DigestSet.hh"
+
+#include <boost/filesystem.hpp>
+
+#include <cstdio>
+#include <algorithm>
+#include <memory>
+#include <queue>
+#include <unordered_set>
+#include <vector>
+
+#include "Error.hh"
+
+namespace hashutil
+{
+
+uint64_t digest(const char * s, size_t len)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for(size_t i = 0; i < len; ++i)
+    {
+        h ^= (uint64_t)(unsigned char)s[i];
+        h *= 1099511628211ULL;
+    }
+    // FNV-1a doesn't mix the last characters well, finish with the splitmix64 finalizer
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+namespace _digestset
+{
+    // number of digests per block, lookups in a spilled run read one block
+    static const size_t BLOCK = 512;
+    // merge spilled runs when there are more than this
+    static const size_t MAX_RUNS = 8;
+
+    /** sorted digests in a temporary file + the first digest of each block */
+    struct Run
+    {
+        explicit Run(std::string const & _filename) : filename(_filename), fp(nullptr), count(0), last(0) {}
+        ~Run()
+        {
+            if(fp)
+            {
+                fclose(fp);
+            }
+            boost::system::error_code ec;
+            boost::filesystem::remove(filename, ec);
+        }
+        Run(Run const &) = delete;
+        Run & operator=(Run const &) = delete;
+
+        void open()
+        {
+            fp = fopen(filename.c_str(), "w+b");
+            if(!fp)
+            {
+                error("Cannot write temporary file %s", filename.c_str());
+            }
+        }
+
+        /** add the next digest, these must be passed in sorted order */
+        void append(uint64_t d)
+        {
+            if(count % BLOCK == 0)
+            {
+                fences.push_back(d);
+            }
+            output.push_back(d);
+            if(output.size() >= 16*BLOCK)
+            {
+                flush();
+            }
+            last = d;
+            ++count;
+        }
+
+        void flush()
+        {
+            if(!output.empty() && fwrite(output.data(), sizeof(uint64_t), output.size(), fp) != output.size())
+            {
+                error("Cannot write temporary file %s", filename.c_str());
+            }
+            output.clear();
+        }
+
+        void close()
+        {
+            flush();
+            std::vector<uint64_t>().swap(output);
+            fflush(fp);
+        }
+
+        /** read n digests starting at position pos */
+        void read(size_t pos, size_t n, std::vector<uint64_t> & buffer) const
+        {
+            buffer.resize(n);
+            if(fseek(fp, (long)(pos * sizeof(uint64_t)), SEEK_SET) != 0
+               || fread(buffer.data(), sizeof(uint64_t), n, fp) != n)
+            {
+                error("Cannot read temporary file %s", filename.c_str());
+            }
+        }
+
+        bool contains(uint64_t d, std::vector<uint64_t> & buffer) const
+        {
+            if(count == 0 || d < fences.front() || d > last)
+            {
+                return false;
+            }
+            const size_t block = (size_t)(std::upper_bound(fences.begin(), fences.end(), d) - fences.begin()) - 1;
+            if(fences[block] == d)
+            {
+                return true;
+            }
+            const size_t pos = block * BLOCK;
+            read(pos, std::min(BLOCK, count - pos), buffer);
+            return std::binary_search(buffer.begin(), buffer.end(), d);
+        }
+
+        std::string filename;
+        FILE * fp;
+        size_t count;
+        std::vector<uint64_t> fences;
+        uint64_t last;
+        std::vector<uint64_t> output;
+    };
+}
+
+struct DigestSetImpl
+{
+    size_t max_memory;
+    boost::filesystem::path tmpdir;
+    std::unordered_set<uint64_t> digests;
+    std::vector< std::unique_ptr<_digestset::Run> > runs;
+    size_t spilled;
+    mutable std::vector<uint64_t> buffer;
+
+    size_t memory() const
+    {
+        // nodes hold the digest and a pointer, plus one pointer per bucket
+        return digests.size() * (sizeof(uint64_t) + 2*sizeof(void*)) + digests.bucket_count() * sizeof(void*);
+    }
+
+    std::unique_ptr<_digestset::Run> newRun() const
+    {
+        return std::unique_ptr<_digestset::Run>(new _digestset::Run(
+            (tmpdir / boost::filesystem::unique_path("digests.%%%%-%%%%-%%%%-%%%%.bin")).string()));
+    }
+
+    void spill()
+    {
+        std::vector<uint64_t> sorted(digests.begin(), digests.end());
+        std::sort(sorted.begin(), sorted.end());
+        std::unordered_set<uint64_t>().swap(digests);
+        runs.push_back(newRun());
+        runs.back()->open();
+        for(uint64_t d : sorted)
+        {
+            runs.back()->append(d);
+        }
+        runs.back()->close();
+        spilled += sorted.size();
+        if(runs.size() > _digestset::MAX_RUNS)
+        {
+            mergeRuns();
+        }
+    }
+
+    /** merge all spilled runs into one */
+    void mergeRuns()
+    {
+        typedef std::pair<uint64_t, size_t> entry_t;
+        std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t> > heads;
+        std::vector< std::vector<uint64_t> > buffers(runs.size());
+        std::vector<size_t> read_pos(runs.size(), 0);
+        std::vector<size_t> buffer_pos(runs.size(), 0);
+
+        const auto refill = [this, &buffers, &read_pos, &buffer_pos, &heads](size_t r)
+        {
+            if(buffer_pos[r] == buffers[r].size())
+            {
+                const size_t n = std::min(_digestset::BLOCK * 16, runs[r]->count - read_pos[r]);
+                if(n == 0)
+                {
+                    return;
+                }
+                runs[r]->read(read_pos[r], n, buffers[r]);
+                read_pos[r] += n;
+                buffer_pos[r] = 0;
+            }
+            heads.push(std::make_pair(buffers[r][buffer_pos[r]++], r));
+        };
+
+        for(size_t r = 0; r < runs.size(); ++r)
+        {
+            refill(r);
+        }
+
+        std::unique_ptr<_digestset::Run> merged = newRun();
+        merged->open();
+        while(!heads.empty())
+        {
+            const entry_t e = heads.top();
+            heads.pop();
+            merged->append(e.first);
+            refill(e.second);
+        }
+        merged->close();
+
+        runs.clear();
+        runs.push_back(std::move(merged));
+    }
+};
+
+DigestSet::DigestSet(size_t max_memory, std::string const & tmpdir)
+{
+    _impl = new DigestSetImpl();
+    _impl->max_memory = max_memory;
+    _impl->tmpdir = tmpdir.empty() ? boost::filesystem::temp_directory_path() : boost::filesystem::path(tmpdir);
+    _impl->spilled = 0;
+}
+
+DigestSet::~DigestSet()
+{
+    delete _impl;
+}
+
+bool DigestSet::insert(uint64_t d)
+{
+    if(contains(d))
+    {
+        return false;
+    }
+    _impl->digests.insert(d);
+    if(_impl->max_memory > 0 && _impl->memory() > _impl->max_memory)
+    {
+        _impl->spill();
+    }
+    return true;
+}
+
+bool DigestSet::contains(uint64_t d) const
+{
+    if(_impl->digests.count(d))
+    {
+        return true;
+    }
+    for(auto const & r : _impl->runs)
+    {
+        if(r->contains(d, _impl->buffer))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t DigestSet::size() const
+{
+    return _impl->digests.size() + _impl->spilled;
+}
+
+size_t DigestSet::spilled() const
+{
+    return _impl->spilled;
+}
+
+}
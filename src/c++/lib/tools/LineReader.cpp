@@ -0,0 +1,251 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/**
+ * \brief Fast line reader for (large) text tables
+ *
+ * \file LineReader.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#include "helpers/LineReader.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <htslib/bgzf.h>
+
+#include "Error.hh"
+
+namespace textio
+{
+
+bool Field::operator==(const char * rhs) const
+{
+    return strlen(rhs) == len && memcmp(s, rhs, len) == 0;
+}
+
+void splitFields(const char * line, size_t len, std::string const & seps, std::vector<Field> & fields)
+{
+    fields.clear();
+    if(len == 0)
+    {
+        return;
+    }
+    const char * end = line + len;
+    const char * p = line;
+    if(seps.size() == 1)
+    {
+        // memchr is vectorized in most C libraries
+        while(true)
+        {
+            const char * q = (const char *)memchr(p, seps[0], (size_t)(end - p));
+            if(!q)
+            {
+                fields.push_back(Field{p, (size_t)(end - p)});
+                break;
+            }
+            fields.push_back(Field{p, (size_t)(q - p)});
+            p = q + 1;
+        }
+    }
+    else
+    {
+        while(true)
+        {
+            const char * q = std::find_first_of(p, end, seps.begin(), seps.end());
+            fields.push_back(Field{p, (size_t)(q - p)});
+            if(q == end)
+            {
+                break;
+            }
+            p = q + 1;
+        }
+    }
+}
+
+struct LineReaderImpl
+{
+    ~LineReaderImpl()
+    {
+        if(map)
+        {
+            munmap((void*)map, map_size);
+        }
+        if(fd >= 0)
+        {
+            close(fd);
+        }
+        if(bgzf)
+        {
+            bgzf_close(bgzf);
+        }
+    }
+
+    /** memory-mapped plain files */
+    bool mapped = false;
+    int fd = -1;
+    const char * map = nullptr;
+    size_t map_size = 0;
+    size_t pos = 0;
+
+    /** compressed files and stdin */
+    BGZF * bgzf = nullptr;
+    std::vector<char> buffer;
+    size_t buf_start = 0;
+    size_t buf_end = 0;
+    bool eof = false;
+};
+
+LineReader::LineReader(std::string const & filename)
+{
+    std::unique_ptr<LineReaderImpl> impl(new LineReaderImpl());
+    if(filename != "-")
+    {
+        impl->fd = open(filename.c_str(), O_RDONLY);
+        if(impl->fd < 0)
+        {
+            error("Cannot open %s", filename.c_str());
+        }
+
+        unsigned char magic[2] = {0, 0};
+        const bool compressed = pread(impl->fd, magic, 2, 0) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+        struct stat st;
+        if(!compressed && fstat(impl->fd, &st) == 0 && S_ISREG(st.st_mode))
+        {
+            impl->mapped = true;
+            if(st.st_size > 0)
+            {
+                void * m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, impl->fd, 0);
+                if(m == MAP_FAILED)
+                {
+                    error("Cannot map %s", filename.c_str());
+                }
+                madvise(m, (size_t)st.st_size, MADV_SEQUENTIAL);
+                impl->map = (const char *)m;
+                impl->map_size = (size_t)st.st_size;
+            }
+            _impl = impl.release();
+            return;
+        }
+        // BGZF takes over the file descriptor
+        impl->bgzf = bgzf_dopen(impl->fd, "r");
+        impl->fd = -1;
+    }
+    else
+    {
+        impl->bgzf = bgzf_dopen(fileno(stdin), "r");
+    }
+    if(!impl->bgzf)
+    {
+        error("Cannot read %s", filename.c_str());
+    }
+    impl->buffer.resize(1024*1024);
+    _impl = impl.release();
+}
+
+LineReader::~LineReader()
+{
+    delete _impl;
+}
+
+bool LineReader::next(Field & line)
+{
+    if(_impl->mapped)
+    {
+        if(_impl->pos >= _impl->map_size)
+        {
+            return false;
+        }
+        const char * p = _impl->map + _impl->pos;
+        const size_t rest = _impl->map_size - _impl->pos;
+        const char * nl = (const char *)memchr(p, '\n', rest);
+        line.s = p;
+        line.len = nl ? (size_t)(nl - p) : rest;
+        _impl->pos += line.len + 1;
+        return true;
+    }
+
+    while(true)
+    {
+        const char * p = _impl->buffer.data() + _impl->buf_start;
+        const size_t rest = _impl->buf_end - _impl->buf_start;
+        const char * nl = (const char *)memchr(p, '\n', rest);
+        if(nl)
+        {
+            line.s = p;
+            line.len = (size_t)(nl - p);
+            _impl->buf_start += line.len + 1;
+            return true;
+        }
+        if(_impl->eof)
+        {
+            if(rest == 0)
+            {
+                return false;
+            }
+            // last line without a line terminator
+            line.s = p;
+            line.len = rest;
+            _impl->buf_start = _impl->buf_end;
+            return true;
+        }
+
+        // keep the incomplete line and read the next block
+        memmove(_impl->buffer.data(), p, rest);
+        _impl->buf_start = 0;
+        _impl->buf_end = rest;
+        if(_impl->buf_end == _impl->buffer.size())
+        {
+            _impl->buffer.resize(2*_impl->buffer.size());
+        }
+        // larger reads can hang on plain gzip input in htslib 1.3
+        const size_t to_read = std::min(_impl->buffer.size() - _impl->buf_end, (size_t)BGZF_MAX_BLOCK_SIZE);
+        const ssize_t r = bgzf_read(_impl->bgzf, _impl->buffer.data() + _impl->buf_end, to_read);
+        if(r < 0)
+        {
+            error("Error reading input");
+        }
+        if(r == 0)
+        {
+            _impl->eof = true;
+        }
+        _impl->buf_end += (size_t)r;
+    }
+}
+
+}
@@ -0,0 +1,647 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * \brief Positional scanner implementation
+ *
+ * \file PositionScanner.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#include "helpers/PositionScanner.hh"
+#include "helpers/BCFHelpers.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <set>
+
+#include <htslib/hts.h>
+#include <htslib/kstring.h>
+#include <htslib/tbx.h>
+#include <htslib/vcf.h>
+
+#include "Error.hh"
+
+namespace bcfhelpers
+{
+
+namespace _positionscanner
+{
+    // maximum indexable coordinate, see synced_bcf_reader.c
+    static const int MAX_COORDINATE = 0x7fffffff;
+
+    /** what we need to know about a record */
+    struct Record
+    {
+        int64_t pos = -1;
+        /** end of the reference allele, -1 if it cannot be determined */
+        int64_t end = -1;
+        int64_t rlen = 0;
+        /** record is called and passes filters */
+        bool use = false;
+        /** some sample has an unphased het GT */
+        bool het = false;
+        std::string ref;
+        /** comma-separated ALT alleles, empty if there are none */
+        std::string alt;
+    };
+
+    static size_t countAlleles(std::string const & alt)
+    {
+        return alt.empty() ? 1 : 2 + (size_t)std::count(alt.begin(), alt.end(), ',');
+    }
+
+    /** check if a comma-separated list of alleles contains an allele */
+    static bool hasAllele(std::string const & alleles, const char * allele, size_t length)
+    {
+        size_t p = 0;
+        while(p <= alleles.size())
+        {
+            size_t q = alleles.find(',', p);
+            if(q == std::string::npos)
+            {
+                q = alleles.size();
+            }
+            if(q - p == length && alleles.compare(p, length, allele, length) == 0)
+            {
+                return true;
+            }
+            p = q + 1;
+        }
+        return false;
+    }
+
+    /** exact allele match as done by the synced reader with COLLAPSE_NONE */
+    static bool allelesMatch(Record const & tmpl, Record const & line)
+    {
+        if(tmpl.rlen != line.rlen || tmpl.ref != line.ref)
+        {
+            return false;
+        }
+        if(tmpl.alt == line.alt)
+        {
+            return true;
+        }
+        if(tmpl.alt.empty() || countAlleles(tmpl.alt) != countAlleles(line.alt))
+        {
+            return false;
+        }
+        size_t p = 0;
+        while(p <= tmpl.alt.size())
+        {
+            size_t q = tmpl.alt.find(',', p);
+            if(q == std::string::npos)
+            {
+                q = tmpl.alt.size();
+            }
+            if(!hasAllele(line.alt, tmpl.alt.c_str() + p, q - p))
+            {
+                return false;
+            }
+            p = q + 1;
+        }
+        return true;
+    }
+
+    /** any ALT allele which changes the length or is symbolic */
+    static bool isIndel(Record const & r)
+    {
+        size_t p = 0;
+        while(p < r.alt.size())
+        {
+            size_t q = r.alt.find(',', p);
+            if(q == std::string::npos)
+            {
+                q = r.alt.size();
+            }
+            if(q - p != r.ref.size() || r.alt[p] == '<')
+            {
+                return true;
+            }
+            p = q + 1;
+        }
+        return false;
+    }
+
+    /** determine the reference extent, see getLocation */
+    static void setLocation(Record & r, int64_t end_field)
+    {
+        if(end_field > 0)
+        {
+            r.end = end_field - 1;
+        }
+        else if(r.ref.find_first_of(".-") != std::string::npos)
+        {
+            r.end = -1;
+        }
+        else
+        {
+            r.end = r.pos + (int64_t)r.ref.size() - 1;
+        }
+    }
+
+    static const char * nextField(const char * p, const char * e, char sep)
+    {
+        const char * q = (const char *)memchr(p, sep, e - p);
+        return q ? q : e;
+    }
+
+    /** parse the columns we need from a VCF line */
+    static void parseVCFLine(kstring_t const & s, bool apply_filters, Record & r)
+    {
+        const char * e = s.s + s.l;
+        const char * fields[9];
+        size_t lengths[9];
+        int nfields = 0;
+        const char * p = s.s;
+        while(nfields < 9 && p <= e)
+        {
+            const char * q = nextField(p, e, '\t');
+            fields[nfields] = p;
+            lengths[nfields] = q - p;
+            ++nfields;
+            p = q + 1;
+        }
+        if(nfields < 8)
+        {
+            error("Invalid VCF line: %s", s.s);
+        }
+        const char * samples = (nfields == 9 && p < e) ? p : nullptr;
+
+        r.pos = strtoll(fields[1], nullptr, 10) - 1;
+        r.ref.assign(fields[3], lengths[3]);
+        if(lengths[4] == 1 && fields[4][0] == '.')
+        {
+            r.alt.clear();
+        }
+        else
+        {
+            r.alt.assign(fields[4], lengths[4]);
+        }
+
+        int64_t end_field = -1;
+        const char * info_end = fields[7] + lengths[7];
+        for(const char * ip = fields[7]; ip < info_end; )
+        {
+            const char * iq = nextField(ip, info_end, ';');
+            if(iq - ip > 4 && strncmp(ip, "END=", 4) == 0)
+            {
+                end_field = strtoll(ip + 4, nullptr, 10);
+            }
+            ip = iq + 1;
+        }
+        r.rlen = end_field >= 0 ? end_field - r.pos : (int64_t)r.ref.size();
+
+        bool pass = true;
+        if(apply_filters && !(lengths[6] == 1 && fields[6][0] == '.'))
+        {
+            const char * filter_end = fields[6] + lengths[6];
+            for(const char * fp = fields[6]; fp < filter_end; )
+            {
+                const char * fq = nextField(fp, filter_end, ';');
+                if(fq - fp != 4 || strncmp(fp, "PASS", 4) != 0)
+                {
+                    pass = false;
+                    break;
+                }
+                fp = fq + 1;
+            }
+        }
+
+        // find GT in FORMAT
+        bool called = false;
+        r.het = false;
+        int gt_index = -1;
+        if(samples)
+        {
+            const char * format_end = fields[8] + lengths[8];
+            int k = 0;
+            for(const char * fp = fields[8]; fp < format_end; ++k)
+            {
+                const char * fq = nextField(fp, format_end, ':');
+                if(fq - fp == 2 && fp[0] == 'G' && fp[1] == 'T')
+                {
+                    gt_index = k;
+                    break;
+                }
+                fp = fq + 1;
+            }
+        }
+        if(pass && gt_index >= 0)
+        {
+            int max_ploidy = 0;
+            for(const char * sp = samples; sp < e; )
+            {
+                const char * sq = nextField(sp, e, '\t');
+                // find GT sub-field
+                const char * gp = sp;
+                for(int k = 0; k < gt_index && gp < sq; ++k)
+                {
+                    gp = nextField(gp, sq, ':') + 1;
+                }
+                if(gp < sq)
+                {
+                    const char * gq = nextField(gp, sq, ':');
+                    int ploidy = 0;
+                    long first_allele = -1;
+                    bool phased = false;
+                    for(const char * ap = gp; ap <= gq; ++ploidy)
+                    {
+                        const char * aq = ap;
+                        while(aq < gq && *aq != '/' && *aq != '|')
+                        {
+                            ++aq;
+                        }
+                        if(aq > ap && *ap != '.')
+                        {
+                            const long allele = strtol(ap, nullptr, 10);
+                            if(allele > 0)
+                            {
+                                called = true;
+                            }
+                            if(first_allele < 0)
+                            {
+                                first_allele = allele;
+                            }
+                            else if(allele != first_allele && !phased)
+                            {
+                                r.het = true;
+                            }
+                        }
+                        phased = phased || (aq < gq && *aq == '|');
+                        ap = aq + 1;
+                    }
+                    max_ploidy = std::max(max_ploidy, ploidy);
+                }
+                sp = sq + 1;
+            }
+            if(max_ploidy > MAX_GT)
+            {
+                std::cerr << "[W] Found a variant with more " << max_ploidy << " > " << MAX_GT
+                          << " (max) alt alleles. These become no-calls." << "\n";
+                called = false;
+            }
+        }
+        r.use = pass && called;
+        setLocation(r, end_field);
+    }
+
+    struct Reader
+    {
+        explicit Reader(std::string const & _filename) : filename(_filename)
+        {
+            fp = hts_open(filename.c_str(), "r");
+            if(!fp)
+            {
+                error("Cannot open %s", filename.c_str());
+            }
+            const htsFormat * format = hts_get_format(fp);
+            if(format->compression != bgzf)
+            {
+                error("File %s is not bgzip-compressed", filename.c_str());
+            }
+            hdr = bcf_hdr_read(fp);
+            if(!hdr)
+            {
+                error("Cannot read header from %s", filename.c_str());
+            }
+            if(format->format == vcf)
+            {
+                tbx = tbx_index_load(filename.c_str());
+            }
+            else if(format->format == bcf)
+            {
+                idx = bcf_index_load(filename.c_str());
+                rec = bcf_init1();
+            }
+            else
+            {
+                error("Unsupported file type: %s", filename.c_str());
+            }
+            if(!tbx && !idx)
+            {
+                error("Failed to open or file not indexed: %s", filename.c_str());
+            }
+            pass_id = bcf_hdr_id2int(hdr, BCF_DT_ID, "PASS");
+        }
+
+        ~Reader()
+        {
+            if(itr)
+            {
+                hts_itr_destroy(itr);
+            }
+            if(rec)
+            {
+                bcf_destroy(rec);
+            }
+            if(tbx)
+            {
+                tbx_destroy(tbx);
+            }
+            if(idx)
+            {
+                hts_idx_destroy(idx);
+            }
+            bcf_hdr_destroy(hdr);
+            hts_close(fp);
+            free(str.s);
+        }
+
+        Reader(Reader const &) = delete;
+        Reader & operator=(Reader const &) = delete;
+
+        std::vector<std::string> getContigs() const
+        {
+            int n = 0;
+            const char ** names = tbx ? tbx_seqnames(tbx, &n) : bcf_hdr_seqnames(hdr, &n);
+            std::vector<std::string> result(names, names + n);
+            free(names);
+            return result;
+        }
+
+        /** start reading at chr:start, returns false if the contig is not in this file */
+        bool seek(std::string const & chr, int64_t start, int64_t _end)
+        {
+            if(itr)
+            {
+                hts_itr_destroy(itr);
+                itr = nullptr;
+            }
+            buffer.clear();
+            end = _end;
+            const int tid = tbx ? tbx_name2id(tbx, chr.c_str()) : bcf_hdr_name2id(hdr, chr.c_str());
+            if(tid < 0)
+            {
+                return false;
+            }
+            const int beg = (int)std::max((int64_t)0, start);
+            itr = tbx ? tbx_itr_queryi(tbx, tid, beg, MAX_COORDINATE)
+                      : bcf_itr_queryi(idx, tid, beg, MAX_COORDINATE);
+            if(!itr)
+            {
+                error("Could not seek to %s:%i in %s", chr.c_str(), beg + 1, filename.c_str());
+            }
+            return true;
+        }
+
+        /** read the next record, false at the end of the contig */
+        bool read(bool apply_filters, Record & r)
+        {
+            if(!itr)
+            {
+                return false;
+            }
+            if(tbx)
+            {
+                if(tbx_itr_next(fp, tbx, itr, &str) < 0)
+                {
+                    return false;
+                }
+                parseVCFLine(str, apply_filters, r);
+            }
+            else
+            {
+                if(bcf_itr_next(fp, itr, rec) < 0)
+                {
+                    return false;
+                }
+                readBCFRecord(apply_filters, r);
+            }
+            return end < 0 || r.pos <= end;
+        }
+
+        void readBCFRecord(bool apply_filters, Record & r)
+        {
+            bcf_unpack(rec, BCF_UN_STR | BCF_UN_FLT);
+            r.pos = rec->pos;
+            r.rlen = rec->rlen;
+            r.ref = rec->d.allele[0];
+            r.alt.clear();
+            for(int j = 1; j < rec->n_allele; ++j)
+            {
+                if(j > 1)
+                {
+                    r.alt += ",";
+                }
+                r.alt += rec->d.allele[j];
+            }
+
+            bool pass = true;
+            if(apply_filters)
+            {
+                for(int j = 0; j < rec->d.n_flt; ++j)
+                {
+                    if(rec->d.flt[j] != pass_id)
+                    {
+                        pass = false;
+                        break;
+                    }
+                }
+            }
+
+            bool called = false;
+            r.het = false;
+            for(int isample = 0; pass && !(called && r.het) && isample < rec->n_sample; ++isample)
+            {
+                int gts[MAX_GT];
+                int ngt = 0;
+                bool phased = false;
+                getGT(hdr, rec, isample, gts, ngt, phased);
+                for(int j = 0; j < ngt && j < MAX_GT; ++j)
+                {
+                    if(gts[j] > 0)
+                    {
+                        called = true;
+                    }
+                    if(!phased && j > 0 && gts[j] >= 0 && gts[0] >= 0 && gts[j] != gts[0])
+                    {
+                        r.het = true;
+                    }
+                }
+            }
+            r.use = pass && called;
+            setLocation(r, r.use ? getInfoInt(hdr, rec, "END", -1) : -1);
+        }
+
+        /** make sure all records at the current position are buffered */
+        void fill(bool apply_filters)
+        {
+            while(itr && (buffer.empty() || buffer.back().pos == buffer.front().pos))
+            {
+                buffer.emplace_back();
+                if(!read(apply_filters, buffer.back()))
+                {
+                    buffer.pop_back();
+                    hts_itr_destroy(itr);
+                    itr = nullptr;
+                }
+            }
+        }
+
+        std::string filename;
+        htsFile * fp = nullptr;
+        bcf_hdr_t * hdr = nullptr;
+        tbx_t * tbx = nullptr;
+        hts_idx_t * idx = nullptr;
+        hts_itr_t * itr = nullptr;
+        bcf1_t * rec = nullptr;
+        kstring_t str = {0, 0, nullptr};
+        int pass_id = -1;
+        int64_t end = -1;
+        std::vector<Record> buffer;
+    };
+}
+
+struct PositionScanner::PositionScannerImpl
+{
+    std::vector<std::unique_ptr<_positionscanner::Reader>> readers;
+    bool apply_filters;
+};
+
+PositionScanner::PositionScanner(std::vector<std::string> const & files, bool apply_filters) :
+    _impl(new PositionScannerImpl())
+{
+    _impl->apply_filters = apply_filters;
+    for(auto const & f : files)
+    {
+        _impl->readers.emplace_back(new _positionscanner::Reader(f));
+    }
+}
+
+PositionScanner::~PositionScanner()
+{
+    delete _impl;
+}
+
+std::vector<std::string> PositionScanner::getContigs() const
+{
+    std::vector<std::string> result;
+    std::set<std::string> seen;
+    for(auto const & r : _impl->readers)
+    {
+        for(auto const & c : r->getContigs())
+        {
+            if(seen.insert(c).second)
+            {
+                result.push_back(c);
+            }
+        }
+    }
+    return result;
+}
+
+bool PositionScanner::scan(std::string const & chr, int64_t start, int64_t end, std::vector<Line> & lines)
+{
+    using namespace _positionscanner;
+    bool found = false;
+    for(auto & r : _impl->readers)
+    {
+        found = r->seek(chr, start, end) || found;
+    }
+    if(!found)
+    {
+        return false;
+    }
+
+    std::vector<Record> selected;
+    selected.reserve(_impl->readers.size());
+    while(true)
+    {
+        int64_t min_pos = std::numeric_limits<int64_t>::max();
+        for(auto & r : _impl->readers)
+        {
+            r->fill(_impl->apply_filters);
+            if(!r->buffer.empty())
+            {
+                min_pos = std::min(min_pos, r->buffer.front().pos);
+            }
+        }
+        if(min_pos == std::numeric_limits<int64_t>::max())
+        {
+            break;
+        }
+
+        // pick one record per reader, matching the alleles of the first one
+        selected.clear();
+        for(auto & r : _impl->readers)
+        {
+            if(r->buffer.empty() || r->buffer.front().pos != min_pos)
+            {
+                continue;
+            }
+            size_t irec = 0;
+            if(!selected.empty())
+            {
+                for(; irec < r->buffer.size() && r->buffer[irec].pos == min_pos; ++irec)
+                {
+                    if(allelesMatch(selected.front(), r->buffer[irec]))
+                    {
+                        break;
+                    }
+                }
+                if(irec == r->buffer.size() || r->buffer[irec].pos != min_pos)
+                {
+                    continue;
+                }
+            }
+            selected.push_back(std::move(r->buffer[irec]));
+            r->buffer.erase(r->buffer.begin() + irec);
+        }
+
+        Line line{-1, -1, 0, 0};
+        for(auto const & rec : selected)
+        {
+            if(!rec.use)
+            {
+                continue;
+            }
+            if(rec.end < 0)
+            {
+                std::cerr << "[W] Unsupported REF allele with undefined length: " << rec.ref << "\n";
+                continue;
+            }
+            line.pos = line.pos < 0 ? rec.pos : std::min(line.pos, rec.pos);
+            line.end = std::max(line.end, rec.end);
+            line.hets += rec.het ? 1 : 0;
+            line.indels += isIndel(rec) ? 1 : 0;
+        }
+        if(line.pos >= 0)
+        {
+            lines.push_back(line);
+        }
+    }
+    return true;
+}
+
+}
@@ -38,7 +38,11 @@
 #include <algorithm>
 #include <cmath>
 #include <fstream>
+#include <cstring>
 #include <helpers/StringUtil.hh>
+#include "helpers/BinaryIO.hh"
+
+#include "Error.hh"
 
 namespace roc
 {
@@ -162,6 +166,43 @@ namespace roc
         _impl->obs.push_back(rhs);
     }
 
+    void Roc::write(std::ostream & o) const
+    {
+        binaryio::writeLE<uint64_t>(o, _impl->obs.size());
+        for(auto const & x : _impl->obs)
+        {
+            uint64_t level_bits;
+            static_assert(sizeof(level_bits) == sizeof(x.level), "Doubles must be 64 bits wide.");
+            memcpy(&level_bits, &x.level, sizeof(level_bits));
+            binaryio::writeLE<uint64_t>(o, level_bits);
+            o.put((char)to_underlying(x.dt));
+            binaryio::writeLE<uint64_t>(o, x.n);
+            binaryio::writeLE<uint64_t>(o, x.flags);
+        }
+    }
+
+    void Roc::read(std::istream & i)
+    {
+        const uint64_t count = binaryio::readLE<uint64_t>(i, "ROC data");
+        // don't trust the count blindly for preallocation, the file might be truncated
+        _impl->obs.reserve(_impl->obs.size() + std::min(count, (uint64_t)(1 << 20)));
+        for(uint64_t k = 0; k < count; ++k)
+        {
+            Observation x;
+            const uint64_t level_bits = binaryio::readLE<uint64_t>(i, "ROC data");
+            memcpy(&x.level, &level_bits, sizeof(level_bits));
+            const int dt = i.get();
+            if(dt < 0 || dt >= NDecisionTypes)
+            {
+                error("Invalid decision type in ROC data.");
+            }
+            x.dt = (DecisionType)dt;
+            x.n = binaryio::readLE<uint64_t>(i, "ROC data");
+            x.flags = binaryio::readLE<uint64_t>(i, "ROC data");
+            _impl->obs.push_back(x);
+        }
+    }
+
     Level Roc::getTotals(uint64_t flag_mask) const
     {
         Level last;
@@ -33,6 +33,7 @@
  *
  */
 
+#include <array>
 #include <list>
 #include <cmath>
 #include <set>
@@ -40,6 +41,7 @@
 #include <limits>
 
 #include "helpers/RocOutput.hh"
+#include "helpers/RocReports.hh"
 #include "helpers/Table.hh"
 #include "helpers/StringUtil.hh"
 #include "Error.hh"
@@ -157,6 +159,44 @@ namespace roc
         METRICS::QUERY_TOTAL,
     };
 
+    /** column handles in the output table */
+    struct TableColumns
+    {
+        explicit TableColumns(table::Table & _table) : table(_table)
+        {
+            for(int k = 0; k < KEYS::SIZE; ++k)
+            {
+                keys[k] = table.column(SKEYS[k]);
+            }
+            for(int m = 0; m < METRICS::SIZE; ++m)
+            {
+                metrics[m] = table.column(SMETRICS[m]);
+            }
+        }
+
+        /** column for counts by subtype / genotype, e.g. TRUTH.TP.het */
+        table::Table::handle_t metric(METRICS::_METRICS m, std::string const & suffix)
+        {
+            auto it = by_suffix.find(suffix);
+            if(it == by_suffix.end())
+            {
+                it = by_suffix.emplace(suffix, std::array<table::Table::handle_t, METRICS::SIZE>()).first;
+                it->second.fill((table::Table::handle_t)-1);
+            }
+            table::Table::handle_t & h = it->second[m];
+            if(h == (table::Table::handle_t)-1)
+            {
+                h = table.column(_S(m) + "." + suffix);
+            }
+            return h;
+        }
+
+        table::Table & table;
+        std::array<table::Table::handle_t, KEYS::SIZE> keys;
+        std::array<table::Table::handle_t, METRICS::SIZE> metrics;
+        std::map<std::string, std::array<table::Table::handle_t, METRICS::SIZE> > by_suffix;
+    };
+
     /** helper to write values from a single level */
     void _addLevel(const std::string & type,
                    const std::string & subtype,
@@ -165,97 +205,101 @@ namespace roc
                    const std::string & subset,
                    const std::string & qq_field,
                    Level const & l,
-                   table::Table & table,
+                   TableColumns & columns,
                    bool counts_only,
                    variant::QuantifyRegions const & regions)
     {
+        table::Table & table = columns.table;
+        auto const & K = columns.keys;
+        auto const & M = columns.metrics;
+
         // don't write rows for ti / tv / genotypes, but rather show the counts inline
         if(subtype != "ti" && subtype != "tv" && genotype == "*")
         {
-            std::string prefix;
+            table::Table::handle_t row;
             if(std::isnan(l.level))
             {
-                prefix =  type + "\t" + subtype + "\t*\t" + filter + "\t" + subset + "\t*";
-                table.set(prefix, _S(KEYS::QQ), "*");
+                row = table.row(type + "\t" + subtype + "\t*\t" + filter + "\t" + subset + "\t*");
+                table.set(row, K[KEYS::QQ], "*");
             }
             else
             {
-                prefix = type + "\t" + subtype + "\t*\t"
-                         + filter + "\t" + subset + "\t" + std::to_string(l.level);
-                table.set(prefix, _S(KEYS::QQ), l.level);
+                row = table.row(type + "\t" + subtype + "\t*\t"
+                                + filter + "\t" + subset + "\t" + std::to_string(l.level));
+                table.set(row, K[KEYS::QQ], l.level);
             }
-            table.set(prefix, _S(KEYS::Type), type);
-            table.set(prefix, _S(KEYS::Subtype), subtype);
-            table.set(prefix, _S(KEYS::Genotype), genotype);
-            table.set(prefix, _S(KEYS::Subset), subset);
-            table.set(prefix, _S(KEYS::Filter), filter);
-            table.set(prefix, _S(KEYS::QQ_Field), qq_field);
-
-            table.set(prefix, _S(METRICS::TP), l.tp());
-            table.set(prefix, _S(METRICS::TP2), l.tp2());
-            table.set(prefix, _S(METRICS::FP), l.fp());
-            table.set(prefix, _S(METRICS::UNK), l.unk());
-            table.set(prefix, _S(METRICS::FP_al), l.fp_al());
-            table.set(prefix, _S(METRICS::FP_gt), l.fp_gt());
-            table.set(prefix, _S(METRICS::Subset_Size), regions.getRegionSize(subset));
+            table.set(row, K[KEYS::Type], type);
+            table.set(row, K[KEYS::Subtype], subtype);
+            table.set(row, K[KEYS::Genotype], genotype);
+            table.set(row, K[KEYS::Subset], subset);
+            table.set(row, K[KEYS::Filter], filter);
+            table.set(row, K[KEYS::QQ_Field], qq_field);
+
+            table.set(row, M[METRICS::TP], l.tp());
+            table.set(row, M[METRICS::TP2], l.tp2());
+            table.set(row, M[METRICS::FP], l.fp());
+            table.set(row, M[METRICS::UNK], l.unk());
+            table.set(row, M[METRICS::FP_al], l.fp_al());
+            table.set(row, M[METRICS::FP_gt], l.fp_gt());
+            table.set(row, M[METRICS::Subset_Size], regions.getRegionSize(subset));
             if(!counts_only)
             {
-                table.set(prefix, _S(METRICS::FN), l.fn());
-                table.set(prefix, _S(METRICS::Recall), l.recall());
-                table.set(prefix, _S(METRICS::Precision), l.precision());
-                table.set(prefix, _S(METRICS::F1_Score), l.fScore());
-                table.set(prefix, _S(METRICS::Frac_NA), l.na());
-                table.set(prefix, _S(METRICS::TRUTH_TOTAL), l.totalTruth());
-                table.set(prefix, _S(METRICS::QUERY_TOTAL), l.totalQuery());
+                table.set(row, M[METRICS::FN], l.fn());
+                table.set(row, M[METRICS::Recall], l.recall());
+                table.set(row, M[METRICS::Precision], l.precision());
+                table.set(row, M[METRICS::F1_Score], l.fScore());
+                table.set(row, M[METRICS::Frac_NA], l.na());
+                table.set(row, M[METRICS::TRUTH_TOTAL], l.totalTruth());
+                table.set(row, M[METRICS::QUERY_TOTAL], l.totalQuery());
             }
         } else {
             // save ti and tv counts for computing ratios later
             if(genotype == "*" && (subtype == "ti" || subtype == "tv"))
             {
-                std::string subtype_agg_prefix;
+                table::Table::handle_t row;
                 if(std::isnan(l.level))
                 {
-                    subtype_agg_prefix =  type + "\t*\t*\t" + filter + "\t" + subset + "\t*";
+                    row = table.row(type + "\t*\t*\t" + filter + "\t" + subset + "\t*");
                 }
                 else
                 {
-                    subtype_agg_prefix = type + "\t*\t*\t"
-                             + filter + "\t" + subset + "\t" + std::to_string(l.level);
+                    row = table.row(type + "\t*\t*\t"
+                                    + filter + "\t" + subset + "\t" + std::to_string(l.level));
                 }
-                table.set(subtype_agg_prefix, _S(METRICS::TP) + "." + subtype, l.tp());
-                table.set(subtype_agg_prefix, _S(METRICS::TP2) + "." + subtype, l.tp2());
-                table.set(subtype_agg_prefix, _S(METRICS::FP) + "." + subtype, l.fp());
-                table.set(subtype_agg_prefix, _S(METRICS::UNK) + "." + subtype, l.unk());
+                table.set(row, columns.metric(METRICS::TP, subtype), l.tp());
+                table.set(row, columns.metric(METRICS::TP2, subtype), l.tp2());
+                table.set(row, columns.metric(METRICS::FP, subtype), l.fp());
+                table.set(row, columns.metric(METRICS::UNK, subtype), l.unk());
                 if(!counts_only)
                 {
-                    table.set(subtype_agg_prefix, _S(METRICS::FN) + "." + subtype, l.fn());
-                    table.set(subtype_agg_prefix, _S(METRICS::TRUTH_TOTAL) + "." + subtype, l.totalTruth());
-                    table.set(subtype_agg_prefix, _S(METRICS::QUERY_TOTAL) + "." + subtype, l.totalQuery());
+                    table.set(row, columns.metric(METRICS::FN, subtype), l.fn());
+                    table.set(row, columns.metric(METRICS::TRUTH_TOTAL, subtype), l.totalTruth());
+                    table.set(row, columns.metric(METRICS::QUERY_TOTAL, subtype), l.totalQuery());
                 }
             }
 
             // save het / hom counts for ratios
             if(genotype != "*" && subtype != "ti" && subtype != "tv")
             {
-                std::string genotype_agg_prefix;
+                table::Table::handle_t row;
                 if(std::isnan(l.level))
                 {
-                    genotype_agg_prefix =  type + "\t" + subtype + "\t*\t" + filter + "\t" + subset + "\t*";
+                    row = table.row(type + "\t" + subtype + "\t*\t" + filter + "\t" + subset + "\t*");
                 }
                 else
                 {
-                    genotype_agg_prefix = type + "\t" + subtype + "\t*\t" + "\t"
-                             + filter + "\t" + subset + "\t" + std::to_string(l.level);
+                    row = table.row(type + "\t" + subtype + "\t*\t" + "\t"
+                                    + filter + "\t" + subset + "\t" + std::to_string(l.level));
                 }
-                table.set(genotype_agg_prefix, _S(METRICS::TP) + "." + genotype, l.tp());
-                table.set(genotype_agg_prefix, _S(METRICS::TP2) + "." + genotype, l.tp2());
-                table.set(genotype_agg_prefix, _S(METRICS::FP) + "." + genotype, l.fp());
-                table.set(genotype_agg_prefix, _S(METRICS::UNK) + "." + genotype, l.unk());
+                table.set(row, columns.metric(METRICS::TP, genotype), l.tp());
+                table.set(row, columns.metric(METRICS::TP2, genotype), l.tp2());
+                table.set(row, columns.metric(METRICS::FP, genotype), l.fp());
+                table.set(row, columns.metric(METRICS::UNK, genotype), l.unk());
                 if(!counts_only)
                 {
-                    table.set(genotype_agg_prefix, _S(METRICS::FN) + "." + genotype, l.fn());
-                    table.set(genotype_agg_prefix, _S(METRICS::TRUTH_TOTAL) + "." + genotype, l.totalTruth());
-                    table.set(genotype_agg_prefix, _S(METRICS::QUERY_TOTAL) + "." + genotype, l.totalQuery());
+                    table.set(row, columns.metric(METRICS::FN, genotype), l.fn());
+                    table.set(row, columns.metric(METRICS::TRUTH_TOTAL, genotype), l.totalTruth());
+                    table.set(row, columns.metric(METRICS::QUERY_TOTAL, genotype), l.totalQuery());
                 }
             }
         }
@@ -263,9 +307,31 @@ namespace roc
 
     void ROCOutput::write(std::ostream &out_roc) const
     {
-        /** populate output table */
-        table::Table output_values;
+        out_roc << getTable();
+    }
+
+    void ROCOutput::writeReports(std::string const & prefix,
+                                 std::string const & filter_handling,
+                                 double ci_alpha,
+                                 bool write_counts) const
+    {
+        roc::writeReports(getTable(), prefix, filter_handling, ci_alpha, write_counts);
+    }
 
+    table::Table const & ROCOutput::getTable() const
+    {
+        if(!table)
+        {
+            table.reset(new table::Table());
+            makeTable(*table);
+        }
+        return *table;
+    }
+
+    void ROCOutput::makeTable(table::Table & output_values) const
+    {
+        /** populate output table */
+        TableColumns columns(output_values);
         std::set<std::string> filters;
         const std::list<std::pair<std::string, uint64_t> > gts = {
             {"het",    roc::OBS_FLAG_HET},
@@ -351,7 +417,7 @@ namespace roc
             for (auto const &st : subtypes)
             {
                 const roc::Level l = m.second.getTotals(st.second);
-                _addLevel(type, st.first.first, st.first.second, filter, subset, qq_field, l, output_values, counts_only, regions);
+                _addLevel(type, st.first.first, st.first.second, filter, subset, qq_field, l, columns, counts_only, regions);
 
                 // don't write ROCs for filters
                 // we could make this optional, but not sure it is really necessary
@@ -361,12 +427,11 @@ namespace roc
                     m.second.getLevels(levels, roc_delta, st.second);
                     for (auto const &l2 : levels)
                     {
-                        _addLevel(type, st.first.first, st.first.second, filter, subset, qq_field, l2, output_values, counts_only, regions);
+                        _addLevel(type, st.first.first, st.first.second, filter, subset, qq_field, l2, columns, counts_only, regions);
                     }
                 }
             }
         }
         output_values.dropRowsWithMissing(_S(KEYS::Type));
-        out_roc << output_values;
     }
 }
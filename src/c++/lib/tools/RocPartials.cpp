@@ -0,0 +1,198 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * Partial quantification results for sharded runs
+ *
+ * \file RocPartials.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#include "helpers/RocPartials.hh"
+#include "helpers/BinaryIO.hh"
+
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include "Error.hh"
+
+namespace roc
+{
+    namespace _partials
+    {
+        static const char MAGIC[8] = {'H', 'A', 'P', 'Q', 'P', 'R', 'T', '1'};
+
+        void writeU64(std::ostream & o, uint64_t v)
+        {
+            binaryio::writeLE<uint64_t>(o, v);
+        }
+
+        uint64_t readU64(std::istream & i, std::string const & filename)
+        {
+            return binaryio::readLE<uint64_t>(i, ("partial results file " + filename).c_str());
+        }
+
+        void writeString(std::ostream & o, std::string const & s)
+        {
+            writeU64(o, s.size());
+            o.write(s.c_str(), s.size());
+        }
+
+        std::string readString(std::istream & i, std::string const & filename)
+        {
+            const uint64_t len = readU64(i, filename);
+            std::string result;
+            // read in chunks so a corrupt length doesn't allocate the world
+            char buf[4096];
+            uint64_t remaining = len;
+            while(remaining > 0)
+            {
+                const std::streamsize chunk = (std::streamsize)std::min(remaining, (uint64_t)sizeof(buf));
+                if(!i.read(buf, chunk))
+                {
+                    error("Unexpected end of partial results file %s", filename.c_str());
+                }
+                result.append(buf, (size_t)chunk);
+                remaining -= chunk;
+            }
+            return result;
+        }
+    }
+
+    using namespace _partials;
+
+    void writePartial(std::string const & filename,
+                      std::string const & qq_header,
+                      RocMap const & rocs,
+                      variant::QuantifyRegions const & regions)
+    {
+        std::ofstream file(filename, std::ios_base::out | std::ios_base::binary);
+        if(!file)
+        {
+            error("Cannot write partial results to %s", filename.c_str());
+        }
+        {
+            boost::iostreams::filtering_ostream out;
+            out.push(boost::iostreams::gzip_compressor());
+            out.push(file);
+
+            out.write(MAGIC, sizeof(MAGIC));
+            writeString(out, qq_header);
+
+            auto const & names = regions.getRegionNames();
+            writeU64(out, names.size());
+            for(auto const & name : names)
+            {
+                writeString(out, name);
+                writeU64(out, regions.getRegionSize(name));
+            }
+
+            writeU64(out, rocs.size());
+            for(auto const & r : rocs)
+            {
+                writeString(out, r.first);
+                r.second.write(out);
+            }
+            if(!out)
+            {
+                error("Failed to write partial results to %s", filename.c_str());
+            }
+        }
+        file.close();
+        if(file.fail())
+        {
+            error("Failed to write partial results to %s", filename.c_str());
+        }
+    }
+
+    void mergePartial(std::string const & filename,
+                      std::string & qq_header,
+                      RocMap & rocs,
+                      variant::QuantifyRegions & regions)
+    {
+        std::ifstream file(filename, std::ios_base::in | std::ios_base::binary);
+        if(!file)
+        {
+            error("Cannot open partial results file %s", filename.c_str());
+        }
+        boost::iostreams::filtering_istream in;
+        in.push(boost::iostreams::gzip_decompressor());
+        in.push(file);
+
+        char magic[sizeof(MAGIC)];
+        if(!in.read(magic, sizeof(MAGIC)) || !std::equal(magic, magic + sizeof(MAGIC), MAGIC))
+        {
+            error("%s is not a quantify partial results file.", filename.c_str());
+        }
+
+        const std::string file_qq = readString(in, filename);
+        if(qq_header.empty())
+        {
+            qq_header = file_qq;
+        }
+        else if(qq_header != file_qq)
+        {
+            std::cerr << "[W] partial results in " << filename << " use QQ field " << file_qq
+                      << " rather than " << qq_header << "\n";
+        }
+
+        const uint64_t nregions = readU64(in, filename);
+        for(uint64_t j = 0; j < nregions; ++j)
+        {
+            const std::string name = readString(in, filename);
+            const uint64_t size = readU64(in, filename);
+            if(!regions.hasRegions(name))
+            {
+                regions.setRegionSize(name, size);
+            }
+            else if(regions.getRegionSize(name) != size)
+            {
+                std::cerr << "[W] region " << name << " has size " << size << " in " << filename
+                          << " but " << regions.getRegionSize(name) << " in a previous partial.\n";
+            }
+        }
+
+        const uint64_t nrocs = readU64(in, filename);
+        for(uint64_t j = 0; j < nrocs; ++j)
+        {
+            const std::string name = readString(in, filename);
+            try
+            {
+                rocs[name].read(in);
+            }
+            catch(std::runtime_error const & e)
+            {
+                error("Cannot read ROC %s from %s: %s", name.c_str(), filename.c_str(), e.what());
+            }
+        }
+    }
+}
@@ -0,0 +1,821 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * Final ROC / summary reports
+ *
+ * \file RocReports.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#include "helpers/RocReports.hh"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include <htslib/bgzf.h>
+
+#include "Error.hh"
+
+namespace roc
+{
+    namespace _reports
+    {
+        enum ColumnType
+        {
+            STRING,     // passed through as-is
+            COUNT,      // integer, missing values become 0
+            FLOAT,      // double, missing values are NaN
+        };
+
+        struct Column
+        {
+            std::string name;
+            ColumnType type;
+        };
+
+        static const char * KEY_COLUMNS[] = {
+            "Type", "Subtype", "Subset", "Filter", "Genotype", "QQ.Field", "QQ"
+        };
+        static const int N_KEY_COLUMNS = 7;
+
+        static const char * COUNT_TYPES[] = {
+            "TRUTH.TOTAL", "TRUTH.TP", "TRUTH.FN",
+            "QUERY.TOTAL", "QUERY.TP", "QUERY.FP",
+            "QUERY.UNK"
+        };
+        static const int N_COUNT_TYPES = 7;
+
+        /** column order and types as in RESULT_ALLCOLUMNS in happyroc.py */
+        static std::vector<Column> makeColumns()
+        {
+            std::vector<Column> columns;
+            for(int i = 0; i < N_KEY_COLUMNS; ++i)
+            {
+                columns.push_back({KEY_COLUMNS[i], STRING});
+            }
+            columns.push_back({"METRIC.Recall", FLOAT});
+            columns.push_back({"METRIC.Precision", FLOAT});
+            columns.push_back({"METRIC.Frac_NA", FLOAT});
+            columns.push_back({"METRIC.F1_Score", FLOAT});
+            columns.push_back({"FP.gt", COUNT});
+            columns.push_back({"FP.al", COUNT});
+            columns.push_back({"Subset.Size", STRING});
+            for(int i = 0; i < N_COUNT_TYPES; ++i)
+            {
+                const std::string ct = COUNT_TYPES[i];
+                columns.push_back({ct, COUNT});
+                columns.push_back({ct + ".ti", STRING});
+                columns.push_back({ct + ".tv", STRING});
+                columns.push_back({ct + ".het", STRING});
+                columns.push_back({ct + ".homalt", STRING});
+                // computed below
+                columns.push_back({ct + ".TiTv_ratio", FLOAT});
+                columns.push_back({ct + ".het_hom_ratio", FLOAT});
+            }
+            return columns;
+        }
+
+        static const char * CI_COLUMNS[] = {
+            "METRIC.Recall.Lower", "METRIC.Recall.Upper",
+            "METRIC.Precision.Lower", "METRIC.Precision.Upper",
+            "METRIC.Frac_NA.Lower", "METRIC.Frac_NA.Upper",
+        };
+        static const int N_CI_COLUMNS = 6;
+
+        static const char * SUMMARY_COLUMNS[] = {
+            "Type", "Filter",
+            "TRUTH.TOTAL", "TRUTH.TP", "TRUTH.FN",
+            "QUERY.TOTAL", "QUERY.FP", "QUERY.UNK",
+            "FP.gt",
+            "METRIC.Recall", "METRIC.Precision", "METRIC.Frac_NA",
+            "TRUTH.TOTAL.TiTv_ratio", "QUERY.TOTAL.TiTv_ratio",
+            "TRUTH.TOTAL.het_hom_ratio", "QUERY.TOTAL.het_hom_ratio",
+        };
+        static const int N_SUMMARY_COLUMNS = 16;
+
+        struct Value
+        {
+            std::string s;
+            double d;
+            ColumnType type;
+
+            std::string toString() const
+            {
+                switch(type)
+                {
+                    case STRING:
+                        return s;
+                    case COUNT:
+                        return std::to_string((int64_t) d);
+                    case FLOAT:
+                        return formatDouble(d);
+                }
+                return s;
+            }
+        };
+
+        typedef std::vector<Value> Row;
+
+        /** like pandas.to_numeric(errors="coerce") */
+        static double toNumeric(std::string const & s)
+        {
+            if(s.empty())
+            {
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+            char * end = nullptr;
+            const double d = strtod(s.c_str(), &end);
+            if(end == s.c_str() || *end != 0)
+            {
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+            return d;
+        }
+
+        static double ratio(double a, double b)
+        {
+            const double r = a / b;
+            if(std::isinf(r))
+            {
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+            return r;
+        }
+
+        static std::string csvEscape(std::string const & s)
+        {
+            if(s.find_first_of(",\"\r\n") == std::string::npos)
+            {
+                return s;
+            }
+            std::string result = "\"";
+            for(char c : s)
+            {
+                if(c == '"')
+                {
+                    result += "\"\"";
+                }
+                else
+                {
+                    result += c;
+                }
+            }
+            result += "\"";
+            return result;
+        }
+
+        /** write CSV, optionally bgzipped */
+        static void writeCSV(std::string const & filename,
+                             std::vector<std::string> const & header,
+                             std::vector<Row> const & rows,
+                             std::vector<size_t> const & selected_columns,
+                             std::vector<size_t> const & selected_rows,
+                             bool compress)
+        {
+            std::ostringstream oss;
+            for(size_t j = 0; j < selected_columns.size(); ++j)
+            {
+                if(j > 0)
+                {
+                    oss << ",";
+                }
+                oss << csvEscape(header[selected_columns[j]]);
+            }
+            oss << "\n";
+            for(size_t i : selected_rows)
+            {
+                for(size_t j = 0; j < selected_columns.size(); ++j)
+                {
+                    if(j > 0)
+                    {
+                        oss << ",";
+                    }
+                    oss << csvEscape(rows[i][selected_columns[j]].toString());
+                }
+                oss << "\n";
+            }
+
+            const std::string data = oss.str();
+            if(compress)
+            {
+                BGZF * fp = bgzf_open(filename.c_str(), "w");
+                if(!fp)
+                {
+                    error("Cannot open %s for writing.", filename.c_str());
+                }
+                if(bgzf_write(fp, data.c_str(), data.size()) != (ssize_t)data.size())
+                {
+                    bgzf_close(fp);
+                    error("Failed to write to %s", filename.c_str());
+                }
+                bgzf_close(fp);
+            }
+            else
+            {
+                std::ofstream out(filename.c_str());
+                if(!out)
+                {
+                    error("Cannot open %s for writing.", filename.c_str());
+                }
+                out << data;
+            }
+        }
+
+        /** compute ratios and CIs for a set of rows */
+        static void addDerived(std::vector<Row> & rows,
+                               std::map<std::string, size_t> const & colindex,
+                               double ci_alpha)
+        {
+            const bool do_ci = 0 < ci_alpha && ci_alpha < 1;
+            std::map<std::pair<uint64_t, uint64_t>, std::array<double, 3>> ci_cache;
+            auto ci = [&ci_cache, ci_alpha](uint64_t x, uint64_t n, double & lower, double & upper) {
+                auto it = ci_cache.find(std::make_pair(x, n));
+                if(it == ci_cache.end())
+                {
+                    std::array<double, 3> r;
+                    jeffreysCI(x, n, ci_alpha, r[0], r[1], r[2]);
+                    it = ci_cache.emplace(std::make_pair(x, n), r).first;
+                }
+                lower = it->second[1];
+                upper = it->second[2];
+            };
+            // column indices for ratios: ti, tv, TiTv_ratio, het, homalt, het_hom_ratio
+            std::vector<std::array<size_t, 6>> ratio_columns;
+            for(int i = 0; i < N_COUNT_TYPES; ++i)
+            {
+                const std::string ct = COUNT_TYPES[i];
+                ratio_columns.push_back({{colindex.at(ct + ".ti"), colindex.at(ct + ".tv"),
+                                          colindex.at(ct + ".TiTv_ratio"),
+                                          colindex.at(ct + ".het"), colindex.at(ct + ".homalt"),
+                                          colindex.at(ct + ".het_hom_ratio")}});
+            }
+            const size_t c_truth_tp = colindex.at("TRUTH.TP"), c_truth_fn = colindex.at("TRUTH.FN"),
+                         c_query_tp = colindex.at("QUERY.TP"), c_query_fp = colindex.at("QUERY.FP"),
+                         c_query_unk = colindex.at("QUERY.UNK"), c_query_total = colindex.at("QUERY.TOTAL");
+
+            for(auto & row : rows)
+            {
+                for(auto const & rc : ratio_columns)
+                {
+                    row[rc[2]].d = ratio(toNumeric(row[rc[0]].s), toNumeric(row[rc[1]].s));
+                    row[rc[5]].d = ratio(toNumeric(row[rc[3]].s), toNumeric(row[rc[4]].s));
+                }
+                if(!do_ci)
+                {
+                    continue;
+                }
+                const uint64_t truth_tp = (uint64_t) row[c_truth_tp].d;
+                const uint64_t truth_fn = (uint64_t) row[c_truth_fn].d;
+                const uint64_t query_tp = (uint64_t) row[c_query_tp].d;
+                const uint64_t query_fp = (uint64_t) row[c_query_fp].d;
+                const uint64_t query_unk = (uint64_t) row[c_query_unk].d;
+                const uint64_t query_total = (uint64_t) row[c_query_total].d;
+
+                double lower, upper;
+                ci(truth_tp, truth_tp + truth_fn, lower, upper);
+                row.push_back({"", lower, FLOAT});
+                row.push_back({"", upper, FLOAT});
+                ci(query_tp, query_tp + query_fp, lower, upper);
+                row.push_back({"", lower, FLOAT});
+                row.push_back({"", upper, FLOAT});
+                ci(query_unk, query_total, lower, upper);
+                row.push_back({"", lower, FLOAT});
+                row.push_back({"", upper, FLOAT});
+            }
+        }
+
+        /** row order for output, see _postprocessRocData */
+        static void sortRows(std::vector<Row> & rows)
+        {
+            std::stable_sort(rows.begin(), rows.end(), [](Row const & a, Row const & b) {
+                for(int i = 0; i < N_KEY_COLUMNS; ++i)
+                {
+                    const int c = a[i].s.compare(b[i].s);
+                    if(c != 0)
+                    {
+                        return c < 0;
+                    }
+                }
+                return false;
+            });
+        }
+
+        /** names of all ROC tables which writeReports can produce */
+        static std::vector<std::string> rocNames()
+        {
+            std::vector<std::string> names{"all"};
+            for(const char * type : {"SNP", "INDEL"})
+            {
+                for(const char * filter : {"", ".PASS", ".SEL"})
+                {
+                    names.push_back(std::string("Locations.") + type + filter);
+                }
+            }
+            return names;
+        }
+
+        static std::string sanitizeName(std::string const & name)
+        {
+            std::string result = name;
+            for(auto & c : result)
+            {
+                if(!isalnum(c) && c != '.' && c != '-' && c != '_')
+                {
+                    c = '_';
+                }
+            }
+            return result;
+        }
+    }
+
+    void writeReports(table::Table const & roc_table,
+                      std::string const & prefix,
+                      std::string const & filter_handling,
+                      double ci_alpha,
+                      bool write_counts)
+    {
+        using namespace _reports;
+        const std::vector<Column> columns = makeColumns();
+        std::vector<std::string> header;
+        std::map<std::string, size_t> colindex;
+        for(auto const & c : columns)
+        {
+            colindex[c.name] = header.size();
+            header.push_back(c.name);
+        }
+        const bool do_ci = 0 < ci_alpha && ci_alpha < 1;
+        if(do_ci)
+        {
+            for(int i = 0; i < N_CI_COLUMNS; ++i)
+            {
+                colindex[CI_COLUMNS[i]] = header.size();
+                header.push_back(CI_COLUMNS[i]);
+            }
+        }
+
+        // read and convert the table
+        std::vector<Row> all;
+        std::vector<table::Table::handle_t> column_handles;
+        for(auto const & c : columns)
+        {
+            table::Table::handle_t h = (table::Table::handle_t)-1;
+            roc_table.findColumn(c.name, h);
+            column_handles.push_back(h);
+        }
+        const size_t c_filter_in = colindex["Filter"];
+        std::vector<std::string> values;
+        for(auto const rh : roc_table.getRowHandles())
+        {
+            roc_table.getStrings(rh, column_handles, values);
+            if(!filter_handling.empty() && values[c_filter_in] != filter_handling)
+            {
+                continue;
+            }
+            Row row;
+            row.reserve(header.size());
+            for(size_t j = 0; j < columns.size(); ++j)
+            {
+                auto const & c = columns[j];
+                Value v;
+                v.type = c.type;
+                v.s = std::move(values[j]);
+                v.d = c.type == STRING ? std::numeric_limits<double>::quiet_NaN() : toNumeric(v.s);
+                if(c.type == COUNT && std::isnan(v.d))
+                {
+                    v.d = 0;
+                }
+                else if(c.type == COUNT)
+                {
+                    v.d = std::trunc(v.d);
+                }
+                row.push_back(std::move(v));
+            }
+            all.push_back(std::move(row));
+        }
+
+        if(all.empty())
+        {
+            // minimal table with SNP and INDEL rows
+            for(const char * type : {"SNP", "INDEL"})
+            {
+                Row row;
+                for(auto const & c : columns)
+                {
+                    Value v;
+                    v.type = c.type == STRING ? FLOAT : c.type;
+                    v.d = c.type == COUNT ? 0 : std::numeric_limits<double>::quiet_NaN();
+                    row.push_back(v);
+                }
+                for(const char * k : {"Subtype", "Genotype", "Subset", "QQ"})
+                {
+                    row[colindex[k]] = {"*", 0, STRING};
+                }
+                row[colindex["Type"]] = {type, 0, STRING};
+                row[colindex["Filter"]] = {"ALL", 0, STRING};
+                row[colindex["QQ.Field"]] = {"nan", 0, STRING};
+                all.push_back(row);
+            }
+        }
+
+        addDerived(all, colindex, ci_alpha);
+        sortRows(all);
+
+        std::vector<size_t> all_columns(header.size());
+        for(size_t j = 0; j < header.size(); ++j)
+        {
+            all_columns[j] = j;
+        }
+
+        // ROC tables for SNP / INDEL in different filter modes
+        std::map<std::string, std::vector<size_t>> rocs;
+        const size_t c_type = colindex["Type"], c_subtype = colindex["Subtype"],
+                     c_subset = colindex["Subset"], c_filter = colindex["Filter"],
+                     c_genotype = colindex["Genotype"], c_qq = colindex["QQ"];
+        for(size_t i = 0; i < all.size(); ++i)
+        {
+            Row const & row = all[i];
+            rocs["all"].push_back(i);
+            if((row[c_type].s == "SNP" || row[c_type].s == "INDEL")
+               && row[c_subset].s == "*"
+               && row[c_genotype].s == "*"
+               && row[c_subtype].s == "*"
+               && row[c_qq].s != "*")
+            {
+                if(row[c_filter].s == "ALL")
+                {
+                    rocs["Locations." + row[c_type].s].push_back(i);
+                }
+                else if(row[c_filter].s == "PASS" || row[c_filter].s == "SEL")
+                {
+                    rocs["Locations." + row[c_type].s + "." + row[c_filter].s].push_back(i);
+                }
+            }
+        }
+
+        for(auto const & r : rocs)
+        {
+            writeCSV(prefix + ".roc." + sanitizeName(r.first) + ".csv.gz",
+                     header, all, all_columns, r.second, true);
+        }
+
+        // ROC files left over from an earlier run with the same prefix would look
+        // like output of this run
+        for(auto const & name : rocNames())
+        {
+            if(rocs.count(name) == 0)
+            {
+                std::remove((prefix + ".roc." + sanitizeName(name) + ".csv.gz").c_str());
+            }
+        }
+
+        // totals only
+        std::vector<size_t> extended_rows;
+        std::vector<size_t> summary_rows;
+        for(size_t i = 0; i < all.size(); ++i)
+        {
+            Row const & row = all[i];
+            if(row[c_qq].s != "*" || (row[c_filter].s != "ALL" && row[c_filter].s != "PASS"))
+            {
+                continue;
+            }
+            extended_rows.push_back(i);
+            if(row[c_subtype].s == "*" && row[c_genotype].s == "*" && row[c_subset].s == "*")
+            {
+                summary_rows.push_back(i);
+            }
+        }
+
+        std::vector<size_t> summary_columns;
+        for(int j = 0; j < N_SUMMARY_COLUMNS; ++j)
+        {
+            summary_columns.push_back(colindex[SUMMARY_COLUMNS[j]]);
+        }
+        writeCSV(prefix + ".summary.csv", header, all, summary_columns, summary_rows, false);
+
+        if(write_counts)
+        {
+            writeCSV(prefix + ".extended.csv", header, all, all_columns, extended_rows, false);
+        }
+    }
+
+    /** continued fraction for the incomplete beta function (modified Lentz's method) */
+    static double betacf(double a, double b, double x)
+    {
+        static const int MAXIT = 1000000;
+        static const double EPS = std::numeric_limits<double>::epsilon();
+        static const double FPMIN = std::numeric_limits<double>::min() / EPS;
+
+        const double qab = a + b;
+        const double qap = a + 1.0;
+        const double qam = a - 1.0;
+        double c = 1.0;
+        double d = 1.0 - qab * x / qap;
+        if (std::fabs(d) < FPMIN)
+        {
+            d = FPMIN;
+        }
+        d = 1.0 / d;
+        double h = d;
+        for (int m = 1; m <= MAXIT; ++m)
+        {
+            const int m2 = 2 * m;
+            double aa = m * (b - m) * x / ((qam + m2) * (a + m2));
+            d = 1.0 + aa * d;
+            if (std::fabs(d) < FPMIN)
+            {
+                d = FPMIN;
+            }
+            c = 1.0 + aa / c;
+            if (std::fabs(c) < FPMIN)
+            {
+                c = FPMIN;
+            }
+            d = 1.0 / d;
+            h *= d * c;
+            aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2));
+            d = 1.0 + aa * d;
+            if (std::fabs(d) < FPMIN)
+            {
+                d = FPMIN;
+            }
+            c = 1.0 + aa / c;
+            if (std::fabs(c) < FPMIN)
+            {
+                c = FPMIN;
+            }
+            d = 1.0 / d;
+            const double del = d * c;
+            h *= del;
+            if (std::fabs(del - 1.0) <= EPS)
+            {
+                return h;
+            }
+        }
+        error("Incomplete beta function did not converge for a=%g b=%g x=%g", a, b, x);
+        return h;
+    }
+
+    /** regularized incomplete beta function I_x(a, b) */
+    static double betai(double a, double b, double x)
+    {
+        if (x <= 0)
+        {
+            return 0;
+        }
+        if (x >= 1)
+        {
+            return 1;
+        }
+        const double lbt = std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b)
+                           + a * std::log(x) + b * std::log1p(-x);
+        if (x < (a + 1.0) / (a + b + 2.0))
+        {
+            return std::exp(lbt) * betacf(a, b, x) / a;
+        }
+        else
+        {
+            return 1.0 - std::exp(lbt) * betacf(b, a, 1.0 - x) / b;
+        }
+    }
+
+    double betaQuantile(double a, double b, double q)
+    {
+        if (q <= 0)
+        {
+            return 0;
+        }
+        if (q >= 1)
+        {
+            return 1;
+        }
+        // for upper quantiles, solve the mirrored problem to keep precision
+        if (q > 0.5)
+        {
+            return 1.0 - betaQuantile(b, a, 1.0 - q);
+        }
+
+        const double lbeta = std::lgamma(a) + std::lgamma(b) - std::lgamma(a + b);
+        double lo = 0, hi = 1;
+        // initial guess, see Numerical Recipes invbetai / Abramowitz & Stegun 26.5.22
+        double x;
+        if (a >= 1 && b >= 1)
+        {
+            const double t = std::sqrt(-2 * std::log(q));
+            const double z = t - (2.30753 + t * 0.27061) / (1 + t * (0.99229 + t * 0.04481));
+            const double al = (z * z - 3) / 6;
+            const double h = 2 / (1 / (2 * a - 1) + 1 / (2 * b - 1));
+            const double w = z * std::sqrt(al + h) / h
+                             - (1 / (2 * b - 1) - 1 / (2 * a - 1)) * (al + 5. / 6. - 2 / (3 * h));
+            x = a / (a + b * std::exp(2 * w));
+        }
+        else
+        {
+            const double t = std::exp(a * std::log(a / (a + b))) / a;
+            const double u = std::exp(b * std::log(b / (a + b))) / b;
+            const double w = t + u;
+            if (q < t / w)
+            {
+                x = std::pow(a * w * q, 1 / a);
+            }
+            else
+            {
+                x = 1 - std::pow(b * w * (1 - q), 1 / b);
+            }
+        }
+        if (!(x > 0 && x < 1))
+        {
+            x = a / (a + b);
+        }
+        for (int iter = 0; iter < 1000; ++iter)
+        {
+            const double f = betai(a, b, x) - q;
+            if (f == 0)
+            {
+                return x;
+            }
+            if (f < 0)
+            {
+                lo = x;
+            }
+            else
+            {
+                hi = x;
+            }
+            // Newton step, fall back to bisection when leaving the bracket
+            const double pdf = std::exp((a - 1) * std::log(x) + (b - 1) * std::log1p(-x) - lbeta);
+            double xn = x - f / pdf;
+            if (!(xn > lo && xn < hi))
+            {
+                xn = 0.5 * (lo + hi);
+            }
+            if (std::fabs(xn - x) <= 4 * std::numeric_limits<double>::epsilon() * x
+                || hi - lo <= 4 * std::numeric_limits<double>::epsilon() * x)
+            {
+                return xn;
+            }
+            x = xn;
+        }
+        return x;
+    }
+
+    void jeffreysCI(uint64_t x, uint64_t n, double alpha,
+                    double & p, double & lower, double & upper)
+    {
+        // HAP-240 avoid division by zero
+        if (n == 0)
+        {
+            p = 0.0;
+            lower = 0.0;
+            upper = 1.0;
+            return;
+        }
+
+        p = ((double) x) / n;
+        const double a = x + 0.5;
+        const double b = n - x + 0.5;
+
+        // lower bound
+        if (x == n)
+        {
+            lower = std::pow(alpha / 2, 1.0 / n);
+        }
+        else if (x <= 1)
+        {
+            lower = 0.0;
+        }
+        else
+        {
+            lower = betaQuantile(a, b, alpha / 2);
+        }
+
+        // upper bound
+        if (x == 0)
+        {
+            upper = 1 - std::pow(alpha / 2, 1.0 / n);
+        }
+        else if (x + 1 >= n)
+        {
+            upper = 1.0;
+        }
+        else
+        {
+            upper = betaQuantile(a, b, 1 - alpha / 2);
+        }
+
+        // avoid values outside the unit range due to potential numerical inaccuracy
+        lower = std::max(lower, 0.0);
+        upper = std::min(upper, 1.0);
+    }
+
+    std::string formatDouble(double x)
+    {
+        if (std::isnan(x))
+        {
+            return "";
+        }
+        if (std::isinf(x))
+        {
+            return x > 0 ? "inf" : "-inf";
+        }
+
+        // shortest representation that round-trips
+        char buf[64];
+        // any decimal with up to 15 significant digits survives the round trip, so the
+        // shortest form can be obtained by stripping zeros from the 15-digit representation
+        for (int prec = 14; prec < 17; ++prec)
+        {
+            snprintf(buf, sizeof(buf), "%.*e", prec, x);
+            if (strtod(buf, nullptr) == x)
+            {
+                break;
+            }
+        }
+
+        // split into sign, digits and exponent
+        std::string s(buf);
+        std::string sign;
+        if (s[0] == '-')
+        {
+            sign = "-";
+            s = s.substr(1);
+        }
+        const size_t epos = s.find('e');
+        const int exponent = atoi(s.c_str() + epos + 1);
+        std::string digits;
+        for (size_t i = 0; i < epos; ++i)
+        {
+            if (s[i] != '.')
+            {
+                digits += s[i];
+            }
+        }
+        while (digits.size() > 1 && digits.back() == '0')
+        {
+            digits.pop_back();
+        }
+
+        std::string result;
+        if (exponent < -4 || exponent >= 16)
+        {
+            result = digits.substr(0, 1);
+            if (digits.size() > 1)
+            {
+                result += "." + digits.substr(1);
+            }
+            char ebuf[16];
+            snprintf(ebuf, sizeof(ebuf), "e%c%02d", exponent < 0 ? '-' : '+', std::abs(exponent));
+            result += ebuf;
+        }
+        else if (exponent < 0)
+        {
+            result = "0." + std::string((size_t) (-exponent - 1), '0') + digits;
+        }
+        else
+        {
+            if (digits.size() <= (size_t) exponent + 1)
+            {
+                result = digits + std::string(exponent + 1 - digits.size(), '0') + ".0";
+            }
+            else
+            {
+                result = digits.substr(0, (size_t) exponent + 1) + "." + digits.substr((size_t) exponent + 1);
+            }
+        }
+        return sign + result;
+    }
+}
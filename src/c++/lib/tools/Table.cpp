@@ -33,11 +33,13 @@
  *
  */
 
+
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
 #include <limits>
 #include <unordered_map>
 #include <vector>
-#include <list>
 #include <set>
 
 #include "helpers/Table.hh"
@@ -47,77 +49,125 @@
  {
      namespace _tableImpl
      {
-         struct OptionalValue
-         {
-             OptionalValue() :
-                 dvalue(std::numeric_limits<double>::quiet_NaN()), status(MISSING) {}
-
-             explicit OptionalValue(double _value) :
-                 dvalue(_value), status(DOUBLE) {}
+         enum Status : uint8_t {
+             MISSING = 0,
+             DOUBLE,
+             STRING
+         };
 
-             explicit OptionalValue(std::string const & s) :
-                 svalue(s), status(STRING) {}
+         /** values in a column, by row handle. Strings are only allocated for columns which have some */
+         struct Column
+         {
+             std::vector<double> dvalues;
+             std::vector<uint8_t> status;
+             std::vector<std::string> svalues;
 
-             OptionalValue & operator=(double val)
+             Status get(size_t row) const
              {
-                 dvalue = val;
-                 svalue = "";
-                 status = DOUBLE;
-                 return *this;
+                 return row < status.size() ? (Status)status[row] : MISSING;
              }
 
-             OptionalValue & operator=(std::string const & s)
+             void set(size_t row, double value)
              {
-                 dvalue = std::numeric_limits<double>::quiet_NaN();
-                 svalue = s;
-                 status = STRING;
-                 return *this;
+                 if(row >= status.size())
+                 {
+                     dvalues.resize(row + 1, std::numeric_limits<double>::quiet_NaN());
+                     status.resize(row + 1, MISSING);
+                 }
+                 dvalues[row] = value;
+                 status[row] = DOUBLE;
+                 if(row < svalues.size())
+                 {
+                     svalues[row].clear();
+                 }
              }
 
-             void reset()
+             void set(size_t row, std::string const & value)
              {
-                 svalue = "";
-                 dvalue = std::numeric_limits<double>::quiet_NaN();
-                 status = MISSING;
+                 if(row >= status.size())
+                 {
+                     dvalues.resize(row + 1, std::numeric_limits<double>::quiet_NaN());
+                     status.resize(row + 1, MISSING);
+                 }
+                 if(row >= svalues.size())
+                 {
+                     svalues.resize(status.size());
+                 }
+                 dvalues[row] = std::numeric_limits<double>::quiet_NaN();
+                 svalues[row] = value;
+                 status[row] = STRING;
              }
 
-             enum Status {
-                 MISSING,
-                 DOUBLE,
-                 STRING
-             };
-
-             double dvalue;
-             std::string svalue;
-             Status status;
+             void reset(size_t row)
+             {
+                 if(row < status.size())
+                 {
+                     dvalues[row] = std::numeric_limits<double>::quiet_NaN();
+                     status[row] = MISSING;
+                 }
+                 if(row < svalues.size())
+                 {
+                     svalues[row].clear();
+                 }
+             }
 
-             std::string toString() const
+             bool getString(size_t row, std::string & result) const
              {
-                 switch(status)
+                 switch(get(row))
                  {
-                     case STRING: return svalue;
-                     case DOUBLE: return std::to_string(dvalue);
-                     case MISSING: return ".";
+                     case STRING: result = svalues[row]; return true;
+                     case DOUBLE: result = formatDouble(dvalues[row]); return true;
+                     case MISSING: break;
                  }
-                 return ".";
+                 return false;
              }
 
-             operator bool() { return status != MISSING; }
-             operator double() {
-                 return status == DOUBLE ? dvalue :
-                        std::numeric_limits<double>::quiet_NaN();
+             /** same format as std::to_string, without allocating */
+             static const char * formatDouble(double value)
+             {
+                 static thread_local char buffer[512];
+                 snprintf(buffer, sizeof(buffer), "%f", value);
+                 return buffer;
              }
-             operator std::string() {
-                 return toString();
+
+             double getDouble(size_t row) const
+             {
+                 return get(row) == DOUBLE ? dvalues[row] : std::numeric_limits<double>::quiet_NaN();
              }
          };
-
-         typedef std::unordered_map<std::string, OptionalValue> Column;
      }
 
      struct Table::TableImpl
      {
-         std::unordered_map<std::string, _tableImpl::Column> rows;
+         /** handles by name. Rows are written in the order they were added,
+          *  removed rows are reset and their handles are not used again */
+         std::unordered_map<std::string, size_t> row_index;
+         std::vector<std::string> row_names;
+         std::vector<bool> row_live;
+         std::unordered_map<std::string, size_t> column_index;
+         std::vector<std::string> column_names;
+         std::vector<_tableImpl::Column> columns;
+
+         bool findRow(std::string const & name, size_t & row) const
+         {
+             auto it = row_index.find(name);
+             if(it == row_index.end())
+             {
+                 return false;
+             }
+             row = it->second;
+             return true;
+         }
+
+         _tableImpl::Column const * findColumn(std::string const & name) const
+         {
+             auto it = column_index.find(name);
+             if(it == column_index.end())
+             {
+                 return nullptr;
+             }
+             return &columns[it->second];
+         }
      };
 
      Table::Table() : _impl(new TableImpl()) {}
@@ -144,117 +194,216 @@
          return *this;
      }
 
+     Table::handle_t Table::row(std::string const & name)
+     {
+         auto it = _impl->row_index.find(name);
+         if(it != _impl->row_index.end())
+         {
+             return it->second;
+         }
+         const size_t r = _impl->row_names.size();
+         _impl->row_names.push_back(name);
+         _impl->row_live.push_back(true);
+         _impl->row_index.emplace(name, r);
+         return r;
+     }
+
+     Table::handle_t Table::column(std::string const & name)
+     {
+         auto it = _impl->column_index.find(name);
+         if(it != _impl->column_index.end())
+         {
+             return it->second;
+         }
+         const size_t c = _impl->column_names.size();
+         _impl->column_names.push_back(name);
+         _impl->columns.emplace_back();
+         _impl->column_index.emplace(name, c);
+         return c;
+     }
+
+     void Table::set(handle_t row, handle_t column, double value)
+     {
+         _impl->columns[column].set(row, value);
+     }
+
+     void Table::set(handle_t row, handle_t column, std::string const & value)
+     {
+         _impl->columns[column].set(row, value);
+     }
+
+     std::vector<Table::handle_t> Table::getRowHandles() const
+     {
+         std::vector<handle_t> result;
+         result.reserve(_impl->row_index.size());
+         for(size_t r = 0; r < _impl->row_names.size(); ++r)
+         {
+             if(_impl->row_live[r])
+             {
+                 result.push_back(r);
+             }
+         }
+         return result;
+     }
+
+     bool Table::findColumn(std::string const & name, handle_t & column) const
+     {
+         auto it = _impl->column_index.find(name);
+         if(it == _impl->column_index.end())
+         {
+             return false;
+         }
+         column = it->second;
+         return true;
+     }
+
+     void Table::getStrings(handle_t row,
+                            std::vector<handle_t> const & columns,
+                            std::vector<std::string> & values,
+                            const char * _def) const
+     {
+         values.resize(columns.size());
+         for(size_t j = 0; j < columns.size(); ++j)
+         {
+             if(columns[j] >= _impl->columns.size()
+                || !_impl->columns[columns[j]].getString(row, values[j]))
+             {
+                 values[j] = _def;
+             }
+         }
+     }
+
      void Table::set(std::string const & row,
                      std::string const & column,
                      double value
      )
      {
-         auto row_it = _impl->rows.find(row);
-         if(row_it == _impl->rows.end())
-         {
-             row_it = _impl->rows.emplace(row, _tableImpl::Column()).first;
-         }
-         row_it->second[column] = value;
+         set(this->row(row), this->column(column), value);
      }
 
      void Table::set(std::string const & row,
                      std::string const & column,
                      std::string const & value)
      {
-         auto row_it = _impl->rows.find(row);
-         if(row_it == _impl->rows.end())
-         {
-             row_it = _impl->rows.emplace(row, _tableImpl::Column()).first;
-         }
-         row_it->second[column] = value;
+         set(this->row(row), this->column(column), value);
      }
 
      void Table::unset(std::string const & row,
                 std::string const & column)
      {
-         auto row_it = _impl->rows.find(row);
-         if(row_it == _impl->rows.end())
+         size_t r;
+         if(!_impl->findRow(row, r))
          {
              return;
          }
-         auto col_it = row_it->second.find(column);
-         if(col_it == row_it->second.end())
+         auto c = _impl->column_index.find(column);
+         if(c == _impl->column_index.end())
          {
              return;
          }
-         row_it->second.erase(col_it);
+         _impl->columns[c->second].reset(r);
      }
 
      bool Table::hasRow(std::string const & row) const
      {
-         return _impl->rows.find(row) != _impl->rows.end();
+         return _impl->row_index.find(row) != _impl->row_index.end();
+     }
+
+     std::vector<std::string> Table::getRows() const
+     {
+         std::vector<std::string> result;
+         result.reserve(_impl->row_index.size());
+         for(size_t r = 0; r < _impl->row_names.size(); ++r)
+         {
+             if(_impl->row_live[r])
+             {
+                 result.push_back(_impl->row_names[r]);
+             }
+         }
+         return result;
      }
 
      std::string Table::getString(std::string const & row,
                            std::string const & column,
                            const char * _def) const
      {
-         auto row_it = _impl->rows.find(row);
-         if(row_it == _impl->rows.end())
+         size_t r;
+         std::string result;
+         auto c = _impl->findColumn(column);
+         if(!c || !_impl->findRow(row, r) || !c->getString(r, result))
          {
              return _def;
          }
-         auto col_it = row_it->second.find(column);
-         if(col_it == row_it->second.end())
+         return result;
+     }
+
+     void Table::getStrings(std::string const & row,
+                            std::vector<std::string> const & columns,
+                            std::vector<std::string> & values,
+                            const char * _def) const
+     {
+         values.resize(columns.size());
+         size_t r;
+         const bool has_row = _impl->findRow(row, r);
+         for(size_t j = 0; j < columns.size(); ++j)
          {
-             return _def;
+             auto c = has_row ? _impl->findColumn(columns[j]) : nullptr;
+             if(!c || !c->getString(r, values[j]))
+             {
+                 values[j] = _def;
+             }
          }
-         return col_it->second;
      }
 
      double Table::getDouble(std::string const & row,
                            std::string const & column,
                       double _def) const
      {
-         auto row_it = _impl->rows.find(row);
-         if(row_it == _impl->rows.end())
-         {
-             return _def;
-         }
-         auto col_it = row_it->second.find(column);
-         if(col_it == row_it->second.end())
+         size_t r;
+         auto c = _impl->findColumn(column);
+         if(!c || !_impl->findRow(row, r) || c->get(r) == _tableImpl::MISSING)
          {
              return _def;
          }
-         return col_it->second;
+         return c->getDouble(r);
      }
 
      void Table::dropRowsWithMissing(std::string const & column)
      {
-         typedef std::unordered_map<std::string, _tableImpl::Column>::iterator row_iterator;
-         std::list<row_iterator> to_delete;
-         for(auto row_it = _impl->rows.begin(); row_it != _impl->rows.end(); ++row_it)
+         auto c = _impl->findColumn(column);
+         auto row_it = _impl->row_index.begin();
+         while(row_it != _impl->row_index.end())
          {
-             auto col_it = row_it->second.find(column);
-             if(col_it == row_it->second.end())
+             if(!c || c->get(row_it->second) == _tableImpl::MISSING)
              {
-                 to_delete.push_back(row_it);
+                 for(auto & col : _impl->columns)
+                 {
+                     col.reset(row_it->second);
+                 }
+                 _impl->row_live[row_it->second] = false;
+                 row_it = _impl->row_index.erase(row_it);
              }
-             else if(col_it->second.status == _tableImpl::OptionalValue::MISSING)
+             else
              {
-                 to_delete.push_back(row_it);
+                 ++row_it;
              }
          }
-
-         for(auto const & row_it : to_delete)
-         {
-             _impl->rows.erase(row_it);
-         }
      }
 
      std::ostream & operator<< (std::ostream & o, Table const & t)
      {
-         std::set<std::string> columns;
-         for(auto const & r : t._impl->rows)
+         // columns which have values, sorted by name
+         std::set<std::pair<std::string, size_t>> columns;
+         for(size_t c = 0; c < t._impl->columns.size(); ++c)
          {
-             for(auto const & c : r.second)
+             auto const & status = t._impl->columns[c].status;
+             for(size_t r = 0; r < status.size(); ++r)
              {
-                 columns.insert(c.first);
+                 if(status[r] != _tableImpl::MISSING)
+                 {
+                     columns.emplace(t._impl->column_names[c], c);
+                     break;
+                 }
              }
          }
 
@@ -269,12 +418,16 @@
              {
                  first = false;
              }
-             o << c;
+             o << c.first;
          }
          o << "\n";
 
-         for(auto const & r : t._impl->rows)
+         for(size_t r = 0; r < t._impl->row_names.size(); ++r)
          {
+             if(!t._impl->row_live[r])
+             {
+                 continue;
+             }
              first = true;
              for(auto const & c : columns)
              {
@@ -286,14 +439,12 @@
                  {
                      first = false;
                  }
-                 auto c_it = r.second.find(c);
-                 if(c_it == r.second.end())
-                 {
-                     o << ".";
-                 }
-                 else
+                 auto const & col = t._impl->columns[c.second];
+                 switch(col.get(r))
                  {
-                     o << c_it->second.toString();
+                     case _tableImpl::STRING: o << col.svalues[r]; break;
+                     case _tableImpl::DOUBLE: o << _tableImpl::Column::formatDouble(col.dvalues[r]); break;
+                     case _tableImpl::MISSING: o << "."; break;
                  }
              }
              o << "\n";
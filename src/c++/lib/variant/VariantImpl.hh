@@ -126,11 +126,11 @@ struct VariantReaderImpl
 
 struct VariantWriterImpl
 {
-    VariantWriterImpl(const char * fname, const char * refname) :
+    VariantWriterImpl(const char * fname, const char * refname, int level) :
         write_formats(false), filename(fname), referencename(refname),
-        header_done(false), reference(refname)
+        compression_level(level), header_done(false), reference(refname)
     {
-        const char * mode = "wu";
+        std::string mode = "wu";
 
         if(stringutil::endsWith(fname, ".vcf.gz"))
         {
@@ -141,13 +141,23 @@ struct VariantWriterImpl
             mode = "wb";
         }
 
-        if(strlen(fname) > 0 && fname[0] == '-')
+        if(mode != "wu" && compression_level >= 0 && compression_level <= 9)
         {
-            fp = hts_open("-", mode);
+            mode += std::to_string(compression_level);
+        }
+
+        if(strlen(fname) == 0)
+        {
+            // records are only encoded, see VariantWriter::encode
+            fp = nullptr;
+        }
+        else if(fname[0] == '-')
+        {
+            fp = hts_open("-", mode.c_str());
         }
         else
         {
-            fp = hts_open(fname, mode);
+            fp = hts_open(fname, mode.c_str());
         }
 
         hdr = bcf_hdr_init("w");
@@ -159,7 +169,10 @@ struct VariantWriterImpl
     {
         bcf_destroy1(rec);
         bcf_hdr_destroy(hdr);
-        hts_close(fp);
+        if(fp)
+        {
+            hts_close(fp);
+        }
     }
 
     void writeHeader();
@@ -170,6 +183,7 @@ struct VariantWriterImpl
 
     std::string filename;
     std::string referencename;
+    int compression_level;
     std::vector<std::string> samples;
 
     // internal
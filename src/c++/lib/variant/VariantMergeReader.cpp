@@ -0,0 +1,498 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+
+/**
+ * \brief Read several VCF files through separate normalisation chains and merge
+ *        the results by location
+ *
+ * \file VariantMergeReader.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#include "variant/VariantMergeReader.hh"
+
+#include "VariantInput.hh"
+#include "Fasta.hh"
+#include "Error.hh"
+
+#include <boost/algorithm/string.hpp>
+
+#include <deque>
+#include <memory>
+#include <algorithm>
+
+namespace variant
+{
+
+namespace
+{
+    struct MergeInput
+    {
+        VariantReader reader;
+        // null if the input is not normalised
+        std::unique_ptr<VariantInput> input;
+        std::deque<Variants> buffer;
+        bool apply_filters = false;
+        bool done = false;
+    };
+
+    /** alleles of a record, to match records like synced_bcf_reader does */
+    std::string recordKey(Variants const & v)
+    {
+        std::vector<std::string> alts;
+        for(RefVar const & rv : v.variation)
+        {
+            alts.push_back(rv.alt);
+        }
+        std::sort(alts.begin(), alts.end());
+        std::string key = std::to_string(v.pos) + ":" + std::to_string(v.pos + v.len - 1);
+        for(auto const & a : alts)
+        {
+            key += ";" + a;
+        }
+        return key;
+    }
+}
+
+struct VariantMergeReaderImpl
+{
+    explicit VariantMergeReaderImpl(const char * ref_fasta) : ref(ref_fasta), ref_fasta(ref_fasta) {}
+
+    FastaFile ref;
+    std::string ref_fasta;
+
+    std::string regions, targets;
+    bool regions_file = false, targets_file = false;
+    bool fix_chrX = false;
+
+    std::vector< std::unique_ptr<MergeInput> > inputs;
+    Variants current;
+
+    /**
+     * Turn a normalised record into the record we would get after writing it
+     * using VariantWriter and reading it back using VariantReader: all alleles
+     * span the REF allele, GTs are diploid, AN / AC / END are not kept.
+     *
+     * @return false if the record would not be read back
+     */
+    bool toRecord(Variants const & v, Variants & out)
+    {
+        if(v.variation.empty() || v.calls.empty())
+        {
+            // homref / empty records don't have non-ref GTs
+            return false;
+        }
+        std::vector<std::string> alleles;
+        toAlleles(ref, v.chr.c_str(), v.variation, alleles);
+
+        out.chr = v.chr;
+        out.pos = v.pos;
+        out.len = (int64_t) alleles[0].size();
+        out.variation.clear();
+
+        std::map<std::string, int> vl;
+        std::vector<int> allele_map(alleles.size(), -1);
+        for(size_t j = 1; j < alleles.size(); ++j)
+        {
+            RefVar rv;
+            rv.start = out.pos;
+            rv.end = out.pos + out.len - 1;
+            rv.alt = alleles[j];
+            boost::to_upper(rv.alt);
+            if(rv.alt == "<DEL>")
+            {
+                rv.alt = "";
+            }
+            else if(rv.alt == "*" || rv.alt == "<NON_REF>")
+            {
+                continue;
+            }
+            const std::string rvr(rv.repr());
+            auto al = vl.find(rvr);
+            if(al == vl.end())
+            {
+                out.variation.push_back(rv);
+                allele_map[j] = (int) out.variation.size();
+                vl[rvr] = (int) out.variation.size();
+            }
+            else
+            {
+                allele_map[j] = al->second;
+            }
+        }
+
+        out.calls = v.calls;
+        for(Call & c : out.calls)
+        {
+            for(size_t i = 0; i < MAX_GT; ++i)
+            {
+                if(i >= c.ngt || c.gt[i] < 0)
+                {
+                    c.gt[i] = -1;
+                }
+                else if(c.gt[i] > 0)
+                {
+                    c.gt[i] = c.gt[i] < (int) allele_map.size() ? allele_map[c.gt[i]] : -1;
+                }
+            }
+            c.ngt = MAX_GT;
+        }
+        out.ambiguous_alleles.clear();
+        out.ambiguous_alleles.resize(out.calls.size());
+
+        out.infos = v.infos;
+        for(const char * id : {"AN", "AC", "END"})
+        {
+            out.infos.removeMember(id);
+        }
+        return true;
+    }
+
+    /** read one record from an input, return false at the end */
+    bool pull(MergeInput & in)
+    {
+        if(in.done)
+        {
+            return false;
+        }
+        if(in.input)
+        {
+            VariantProcessor & vp = in.input->getProcessor();
+            if(!vp.advance())
+            {
+                in.done = true;
+                return false;
+            }
+            Variants rec;
+            if(toRecord(vp.current(), rec))
+            {
+                in.buffer.push_back(rec);
+            }
+        }
+        else
+        {
+            if(!in.reader.advance())
+            {
+                in.done = true;
+                return false;
+            }
+            in.buffer.push_back(in.reader.current());
+        }
+        return true;
+    }
+
+    /** combine the next matching records from all inputs into current */
+    bool next()
+    {
+        int result;
+        while((result = merge()) == 0) {}
+        return result > 0;
+    }
+
+    /**
+     * Combine the records at the next position
+     * @return 1 if a record was made, 0 if all records were filtered / homref, -1 at the end
+     */
+    int merge()
+    {
+        for(auto & in : inputs)
+        {
+            while(in->buffer.empty() && pull(*in)) {}
+        }
+
+        // the first input that has records determines the chromosome
+        std::string chr;
+        int64_t pos = -1;
+        for(auto & in : inputs)
+        {
+            if(in->buffer.empty())
+            {
+                continue;
+            }
+            Variants const & head = in->buffer.front();
+            if(chr.empty())
+            {
+                chr = head.chr;
+                pos = head.pos;
+            }
+            else if(head.chr == chr && head.pos < pos)
+            {
+                pos = head.pos;
+            }
+        }
+        if(chr.empty())
+        {
+            return -1;
+        }
+
+        const auto at_pos = [&chr, pos](Variants const & v) { return v.chr == chr && v.pos == pos; };
+
+        // get all records at this position
+        for(auto & in : inputs)
+        {
+            while(!in->buffer.empty() && at_pos(in->buffer.back()) && pull(*in)) {}
+        }
+
+        current = Variants();
+        current.chr = chr;
+        current.pos = 0;
+        current.len = 0;
+        current.calls.resize(inputs.size());
+        current.ambiguous_alleles.resize(inputs.size());
+
+        std::string tmpl_key;
+        std::map<std::string, int> vl;
+        int ncalls = 0;
+        int n_non_ref_calls = 0;
+        for(size_t sid = 0; sid < inputs.size(); ++sid)
+        {
+            MergeInput & in = *inputs[sid];
+            Call & call = current.calls[sid];
+            call.ngt = 0;
+            call.phased = false;
+            call.nfilter = 0;
+
+            // first record at this position is the template, other inputs
+            // must match its alleles exactly
+            auto it = in.buffer.begin();
+            for(; it != in.buffer.end() && at_pos(*it); ++it)
+            {
+                if(tmpl_key.empty())
+                {
+                    tmpl_key = recordKey(*it);
+                    break;
+                }
+                if(recordKey(*it) == tmpl_key)
+                {
+                    break;
+                }
+            }
+            if(it == in.buffer.end() || !at_pos(*it))
+            {
+                continue;
+            }
+
+            Variants rec = *it;
+            in.buffer.erase(it);
+
+            if(current.pos < rec.pos)
+            {
+                current.pos = rec.pos;
+                current.len = rec.len;
+            }
+            else if(current.pos == rec.pos)
+            {
+                current.len = std::max(current.len, rec.len);
+            }
+
+            std::vector<int> allele_map(rec.variation.size() + 1, -1);
+            for(size_t j = 0; j < rec.variation.size(); ++j)
+            {
+                const std::string rvr(rec.variation[j].repr());
+                auto al = vl.find(rvr);
+                if(al == vl.end())
+                {
+                    current.variation.push_back(rec.variation[j]);
+                    vl[rvr] = (int) current.variation.size();
+                    allele_map[j + 1] = (int) current.variation.size();
+                }
+                else
+                {
+                    allele_map[j + 1] = al->second;
+                }
+            }
+
+            Call const & rc = rec.calls[0];
+            bool fail = false;
+            for(size_t f = 0; f < rc.nfilter; ++f)
+            {
+                if(rc.filter[f] != "PASS" && rc.filter[f] != ".")
+                {
+                    fail = true;
+                }
+            }
+            if(in.apply_filters && fail)
+            {
+                continue;
+            }
+            ++ncalls;
+
+            call = rc;
+            for(size_t i = 0; i < call.ngt; ++i)
+            {
+                if(call.gt[i] > 0)
+                {
+                    ++n_non_ref_calls;
+                    call.gt[i] = call.gt[i] < (int) allele_map.size() ? allele_map[call.gt[i]] : -1;
+                }
+            }
+            if(!rec.ambiguous_alleles.empty())
+            {
+                current.ambiguous_alleles[sid] = rec.ambiguous_alleles[0];
+            }
+
+            for(auto const & id : rec.infos.getMemberNames())
+            {
+                // only take first instance
+                if(!current.infos.isMember(id))
+                {
+                    current.infos[id] = rec.infos[id];
+                }
+            }
+        }
+
+        // homref / filtered -> go again
+        return (ncalls == 0 || n_non_ref_calls == 0) ? 0 : 1;
+    }
+};
+
+VariantMergeReader::VariantMergeReader(const char * ref_fasta) : _impl(new VariantMergeReaderImpl(ref_fasta))
+{
+}
+
+VariantMergeReader::~VariantMergeReader()
+{
+    delete _impl;
+}
+
+void VariantMergeReader::setRegions(const char * regions, bool isFile)
+{
+    _impl->regions = regions;
+    _impl->regions_file = isFile;
+}
+
+void VariantMergeReader::setTargets(const char * targets, bool isFile)
+{
+    _impl->targets = targets;
+    _impl->targets_file = isFile;
+}
+
+void VariantMergeReader::setFixChrXGTs(bool fix)
+{
+    _impl->fix_chrX = fix;
+}
+
+int VariantMergeReader::addSample(const char * filename, const char * sname,
+                                  bool normalise, bool decompose, bool leftshift)
+{
+    std::unique_ptr<MergeInput> in(new MergeInput());
+    if(_impl->fix_chrX)
+    {
+        in->reader.setFixChrXGTs(true);
+    }
+    if(!_impl->regions.empty())
+    {
+        in->reader.setRegions(_impl->regions.c_str(), _impl->regions_file);
+    }
+    if(!_impl->targets.empty())
+    {
+        in->reader.setTargets(_impl->targets.c_str(), _impl->targets_file);
+    }
+    in->reader.addSample(filename, sname);
+    in->reader.setApplyFilters(false);
+
+    if(normalise || decompose || leftshift)
+    {
+        // same as preprocess -V decompose -L leftshift
+        in->reader.setReturnHomref(false);
+        const bool prep = decompose || leftshift;
+        in->input = std::move(std::unique_ptr<VariantInput>(new VariantInput(
+            _impl->ref_fasta.c_str(),
+            prep,                   // bool leftshift
+            true,                   // bool refpadding
+            true,                   // bool trimalleles
+            prep,                   // bool splitalleles
+            prep ? 2 : 0,           // int mergebylocation
+            true,                   // bool uniqalleles
+            true,                   // bool calls_only
+            false,                  // bool homref_split
+            decompose,              // bool primitives
+            false,                  // bool homref_output
+            leftshift ? 1024 : 0,   // int64_t leftshift_limit
+            false
+        )));
+        in->input->getProcessor().setReader(in->reader, VariantBufferMode::buffer_block, 10*30);
+    }
+    else
+    {
+        // homref records are matched to the other inputs like in a multi-sample VariantReader
+        in->reader.setReturnHomref(true);
+    }
+    _impl->inputs.push_back(std::move(in));
+    return (int) _impl->inputs.size() - 1;
+}
+
+void VariantMergeReader::setApplyFilters(bool filters, int sample)
+{
+    if(sample < 0 || sample >= (int) _impl->inputs.size())
+    {
+        error("Invalid sample index %i", sample);
+    }
+    _impl->inputs[sample]->apply_filters = filters;
+}
+
+VariantReader & VariantMergeReader::getReader(int sample)
+{
+    if(sample < 0 || sample >= (int) _impl->inputs.size())
+    {
+        error("Invalid sample index %i", sample);
+    }
+    return _impl->inputs[sample]->reader;
+}
+
+void VariantMergeReader::rewind(const char * chr, int64_t startpos)
+{
+    for(auto & in : _impl->inputs)
+    {
+        if(in->input)
+        {
+            in->input->getProcessor().rewind(chr, startpos);
+        }
+        else
+        {
+            in->reader.rewind(chr, startpos);
+        }
+        in->buffer.clear();
+        in->done = false;
+    }
+}
+
+Variants & VariantMergeReader::current()
+{
+    return _impl->current;
+}
+
+bool VariantMergeReader::advance()
+{
+    return _impl->next();
+}
+
+} // namespace variant
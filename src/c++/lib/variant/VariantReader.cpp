@@ -252,6 +252,26 @@ void VariantReader::getSampleList(std::list< std::pair<std::string, std::string>
     }
 }
 
+/**
+ * @brief Return the contigs in the order they will be read
+ *
+ * Without explicit regions, the synced reader makes its region list from
+ * the contigs in the index (or header) of each file as it is added.
+ */
+void VariantReader::getContigs(std::vector<std::string> & contigs) const
+{
+    contigs.clear();
+    bcf_sr_regions_t * regions = _impl->files->regions;
+    if(!regions)
+    {
+        return;
+    }
+    for(int i = 0; i < regions->nseqs; ++i)
+    {
+        contigs.push_back(regions->seq_names[i]);
+    }
+}
+
 
 /**
  * @brief Interface to htslib regions functionality
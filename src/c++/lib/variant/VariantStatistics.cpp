@@ -37,10 +37,13 @@
 #include "Fasta.hh"
 #include "Alignment.hh"
 #include "helpers/BCFHelpers.hh"
+#include "helpers/BinaryIO.hh"
 #include "Error.hh"
 
 #include <memory>
 #include <bitset>
+#include <algorithm>
+#include <iostream>
 #include <htslib/vcf.h>
 
 // #define DEBUG_VARIANTSTATISTICS
@@ -110,7 +113,7 @@ const char * CT_NAMES [] = {
 };
 
 /** we count 256 distinct things */
-static const int VS_COUNTS = 256;
+static const int VS_COUNTS = VariantCounts::N_COUNTS;
 
 const int XC_TI = 0;
 const int XC_TV = 1;
@@ -143,7 +146,85 @@ const char * XC_NAMES [] = {
     "unknown",
 };
 
-static const int XC_COUNTS = 16;
+static const int XC_COUNTS = VariantCounts::N_EXTRA;
+
+void VariantCounts::clear()
+{
+    memset(counts, 0, sizeof(uint64_t)*N_COUNTS);
+    memset(extra, 0, sizeof(uint64_t)*N_EXTRA);
+}
+
+VariantCounts & VariantCounts::operator+=(VariantCounts const & rhs)
+{
+    for(int i = 0; i < N_COUNTS; ++i)
+    {
+        counts[i] += rhs.counts[i];
+    }
+    for(int i = 0; i < N_EXTRA; ++i)
+    {
+        extra[i] += rhs.extra[i];
+    }
+    return *this;
+}
+
+/**
+ * Binary format: "VC", version byte, number of non-zero entries (uint16),
+ * then (index : uint16, value : uint64) for each non-zero entry. Indexes
+ * >= N_COUNTS refer to extra counts. Integers are little-endian.
+ */
+static const char VC_MAGIC[] = {'V', 'C', 1};
+
+void VariantCounts::write(std::ostream & o) const
+{
+    uint16_t nz = 0;
+    for(int i = 0; i < N_COUNTS + N_EXTRA; ++i)
+    {
+        const uint64_t x = i < N_COUNTS ? counts[i] : extra[i - N_COUNTS];
+        if(x)
+        {
+            ++nz;
+        }
+    }
+    o.write(VC_MAGIC, sizeof(VC_MAGIC));
+    binaryio::writeLE<uint16_t>(o, nz);
+    for(int i = 0; i < N_COUNTS + N_EXTRA; ++i)
+    {
+        const uint64_t x = i < N_COUNTS ? counts[i] : extra[i - N_COUNTS];
+        if(x)
+        {
+            binaryio::writeLE<uint16_t>(o, (uint16_t)i);
+            binaryio::writeLE<uint64_t>(o, x);
+        }
+    }
+}
+
+void VariantCounts::read(std::istream & in)
+{
+    char magic[sizeof(VC_MAGIC)];
+    if(!in.read(magic, sizeof(VC_MAGIC)) || memcmp(magic, VC_MAGIC, sizeof(VC_MAGIC)) != 0)
+    {
+        error("Invalid variant counts header.");
+    }
+    clear();
+    const uint16_t nz = binaryio::readLE<uint16_t>(in, "variant counts");
+    for(uint16_t j = 0; j < nz; ++j)
+    {
+        const uint16_t i = binaryio::readLE<uint16_t>(in, "variant counts");
+        const uint64_t x = binaryio::readLE<uint64_t>(in, "variant counts");
+        if(i < N_COUNTS)
+        {
+            counts[i] = x;
+        }
+        else if(i < N_COUNTS + N_EXTRA)
+        {
+            extra[i - N_COUNTS] = x;
+        }
+        else
+        {
+            error("Invalid variant counts index: %i", (int)i);
+        }
+    }
+}
 
 struct VariantStatisticsImpl
 {
@@ -151,10 +232,11 @@ struct VariantStatisticsImpl
         ref(ref_fasta), count_homref(_count_homref),
         alignment(makeAlignment("klibg"))
     {
-        memset(counts, 0, sizeof(size_t)*VS_COUNTS);
+        totals.clear();
+        target = &totals;
         memset(rtypes, 0, sizeof(int)*VS_COUNTS);
-        memset(extraCounts, 0, sizeof(size_t)*XC_COUNTS);
         nrtypes = 0;
+        extra_counts_seen = 0;
         rtype_bs.reset();
     }
 
@@ -163,11 +245,12 @@ struct VariantStatisticsImpl
     VariantStatisticsImpl(VariantStatisticsImpl const & rhs) : ref(rhs.ref),
         alignment(makeAlignment("klibg"))
     {
-        memcpy(counts, rhs.counts, sizeof(size_t)*VS_COUNTS);
-        memcpy(extraCounts, rhs.extraCounts, sizeof(size_t)*XC_COUNTS);
+        totals = rhs.totals;
+        target = &totals;
         count_homref = rhs.count_homref;
         nrtypes = rhs.nrtypes;
         memcpy(rtypes, rhs.rtypes, sizeof(int)*256);
+        extra_counts_seen = rhs.extra_counts_seen;
         rtype_bs = rhs.rtype_bs;
     }
 
@@ -200,13 +283,6 @@ struct VariantStatisticsImpl
         return 0;
     }
 
-    void addExtras(const VariantStatisticsImpl& rhs) {
-        for(size_t i = 0; i < XC_COUNTS; ++i)
-        {
-            extraCounts[i] += rhs.extraCounts[i];
-        }
-    }
-
     /** add single allele */
     int add_al(const char * chr, RefVar const & rhs)
     {
@@ -223,44 +299,44 @@ struct VariantStatisticsImpl
                       total_hom,
                       ti, tv);
 
-        extraCounts[XC_TI] += ti;
-        extraCounts[XC_TV] += tv;
+        target->extra[XC_TI] += ti;
+        target->extra[XC_TV] += tv;
 
         if(ti)
         {
-            extra_counts_seen.insert(XC_NAMES[XC_TI]);
+            seen(XC_TI);
         }
         if(tv)
         {
-            extra_counts_seen.insert(XC_NAMES[XC_TV]);
+            seen(XC_TV);
         }
 
         if(total_snp == 0)
         {
             if(total_ins > 0 && total_ins <= 5)
             {
-                extra_counts_seen.insert(XC_NAMES[XC_I1_5]);
+                seen(XC_I1_5);
             }
             else if(total_ins >= 6 && total_ins <= 15)
             {
-                extra_counts_seen.insert(XC_NAMES[XC_I6_15]);
+                seen(XC_I6_15);
             }
             else if(total_ins >= 16)
             {
-                extra_counts_seen.insert(XC_NAMES[XC_I16_PLUS]);
+                seen(XC_I16_PLUS);
             }
 
             if(total_del > 0 && total_del <= 5)
             {
-                extra_counts_seen.insert(XC_NAMES[XC_D1_5]);
+                seen(XC_D1_5);
             }
             else if(total_del >= 6 && total_del <= 15)
             {
-                extra_counts_seen.insert(XC_NAMES[XC_D6_15]);
+                seen(XC_D6_15);
             }
             else if(total_del >= 16)
             {
-                extra_counts_seen.insert(XC_NAMES[XC_D16_PLUS]);
+                seen(XC_D16_PLUS);
             }
         }
         else
@@ -268,15 +344,15 @@ struct VariantStatisticsImpl
             const size_t total_indel = total_ins + total_del;
             if(total_indel > 0 && total_indel <= 5)
             {
-                extra_counts_seen.insert(XC_NAMES[XC_C1_5]);
+                seen(XC_C1_5);
             }
             else if(total_indel >= 6 && total_indel <= 15)
             {
-                extra_counts_seen.insert(XC_NAMES[XC_C6_15]);
+                seen(XC_C6_15);
             }
             else if(total_indel >= 16)
             {
-                extra_counts_seen.insert(XC_NAMES[XC_C16_PLUS]);
+                seen(XC_C16_PLUS);
             }
         }
 
@@ -297,8 +373,6 @@ struct VariantStatisticsImpl
         return t;
     }
 
-    size_t counts[VS_COUNTS];
-
     // keep track of returned types
     void count(int rt, size_t n) {
         if(!n) {
@@ -308,13 +382,17 @@ struct VariantStatisticsImpl
             rtype_bs[rt & 0xff] = 1;
             rtypes[nrtypes++] = rt;
         }
-        counts[rt & 0xff] += n;
+        target->counts[rt & 0xff] += n;
+    }
+
+    void seen(int xc) {
+        extra_counts_seen |= (uint16_t) (1 << xc);
     }
 
     void reset_rtypes() {
         nrtypes = 0;
         rtype_bs.reset();
-        extra_counts_seen.clear();
+        extra_counts_seen = 0;
     }
 
     void getExtraCountNames(StrVec& extraCountNames) {
@@ -331,7 +409,7 @@ struct VariantStatisticsImpl
         {
             if (extraCountName == XC_NAMES[j])
             {
-                return extraCounts[j];
+                return totals.extra[j];
             }
         }
 
@@ -345,7 +423,7 @@ struct VariantStatisticsImpl
         {
             if (extraCountName == XC_NAMES[j])
             {
-                extraCounts[j] = count;
+                totals.extra[j] = count;
                 return;
             }
         }
@@ -356,14 +434,16 @@ struct VariantStatisticsImpl
 
     int rtypes[256];
     int nrtypes;
-    std::set<std::string> extra_counts_seen;
+    uint16_t extra_counts_seen;
     std::bitset<256> rtype_bs;
 
     FastaFile const & ref;
     bool count_homref;
     std::unique_ptr<Alignment> alignment;
 
-    size_t extraCounts[XC_COUNTS];
+    VariantCounts totals;
+    // counts go here, this is either totals or a VariantCounts passed to count()
+    VariantCounts * target;
 };
 
 
@@ -400,11 +480,11 @@ void VariantStatistics::read(Json::Value const & root)
         std::string k = VariantStatisticsImpl::c2n((uint64_t) i);
         if (root.isMember(k))
         {
-            _impl->counts[i] = root[k].asUInt64();
+            _impl->totals.counts[i] = root[k].asUInt64();
         }
         else
         {
-            _impl->counts[i] = 0;
+            _impl->totals.counts[i] = 0;
         }
     }
 
@@ -419,28 +499,34 @@ void VariantStatistics::read(Json::Value const & root)
 }
 
 Json::Value VariantStatistics::write() const
+{
+    Json::Value root = toJson(_impl->totals);
+#ifdef DEBUG_VARIANTSTATISTICS
+    Json::StyledWriter sw;
+    std::cerr << sw.write(root) << std::endl;
+#endif
+    return root;
+}
+
+Json::Value VariantStatistics::toJson(VariantCounts const & counts)
 {
     Json::Value root;
     for (int i = 0; i < VS_COUNTS; ++i)
     {
-        if (_impl->counts[i])
+        if (counts.counts[i])
         {
-            root[VariantStatisticsImpl::c2n((uint64_t) i)] = Json::Value::UInt64(_impl->counts[i]);
+            root[VariantStatisticsImpl::c2n((uint64_t) i)] = Json::Value::UInt64(counts.counts[i]);
         }
     }
 
-    StrVec extraCountNames;
-    _impl->getExtraCountNames(extraCountNames);
-
-    for (const std::string& extraCountName : extraCountNames) {
-        root[extraCountName]
-            = Json::Value::UInt64(_impl->extraCount(extraCountName));
+    for (int j = 0; j < XC_COUNTS; ++j)
+    {
+        // unused slots are all called "unknown", only output the first one
+        if(!root.isMember(XC_NAMES[j]))
+        {
+            root[XC_NAMES[j]] = Json::Value::UInt64(counts.extra[j]);
+        }
     }
-
-#ifdef DEBUG_VARIANTSTATISTICS
-    Json::StyledWriter sw;
-    std::cerr << sw.write(root) << std::endl;
-#endif
     return root;
 }
 
@@ -449,17 +535,38 @@ Json::Value VariantStatistics::write() const
  */
 void VariantStatistics::add(VariantStatistics const & rhs)
 {
-    for (int i = 0; i < VS_COUNTS; ++i)
+    _impl->totals += rhs._impl->totals;
+}
+
+void VariantStatistics::add(VariantCounts const & rhs)
+{
+    _impl->totals += rhs;
+}
+
+VariantCounts const & VariantStatistics::getCounts() const
+{
+    return _impl->totals;
+}
+
+void VariantStatistics::count(bcf_hdr_t * hdr, bcf1_t * rhs, int sample, VariantCounts & counts,
+                              int ** rtypes, int * nrtypes, uint16_t * extra_counts_seen)
+{
+    _impl->target = &counts;
+    try
     {
-        _impl->counts[i] += rhs._impl->counts[i];
+        add(hdr, rhs, sample, rtypes, nrtypes, extra_counts_seen);
     }
-
-    _impl->addExtras(*(rhs._impl));
+    catch(...)
+    {
+        _impl->target = &_impl->totals;
+        throw;
+    }
+    _impl->target = &_impl->totals;
 }
 
 
 void VariantStatistics::add(bcf_hdr_t * hdr, bcf1_t * rhs, int sample, int ** rtypes, int * nrtypes,
-                            std::set<std::string> ** extra_counts_seen)
+                            uint16_t * extra_counts_seen)
 {
     if(rtypes && nrtypes) { _impl->reset_rtypes(); }
 
@@ -555,7 +662,7 @@ void VariantStatistics::add(bcf_hdr_t * hdr, bcf1_t * rhs, int sample, int ** rt
     _impl->count(location_type | types, 1);
 
     if(rtypes && nrtypes) { *rtypes = _impl->rtypes; *nrtypes = _impl->nrtypes; }
-    if(extra_counts_seen) { *extra_counts_seen = &(_impl->extra_counts_seen); }
+    if(extra_counts_seen) { *extra_counts_seen = _impl->extra_counts_seen; }
 }
 
 void VariantStatistics::add(Variants const & rhs, int sample, int ** rtypes, int * nrtypes)
@@ -656,16 +763,34 @@ size_t VariantStatistics::extraCount(const std::string& extraCountName)
     return _impl->extraCount(extraCountName);
 }
 
-std::string VariantStatistics::extraCountsToBI(std::set<std::string> const & extra_counts_seen)
+std::string VariantStatistics::extraCountsToBI(uint16_t extra_counts_seen)
 {
+    // output names in alphabetical order
+    static const struct _xc_order {
+        _xc_order() {
+            for(int j = 0; j < XC_COUNTS; ++j) {
+                order[j] = j;
+            }
+            std::sort(&order[0], &order[XC_COUNTS], [](int a, int b) {
+                return strcmp(XC_NAMES[a], XC_NAMES[b]) < 0;
+            });
+        }
+        int order[XC_COUNTS];
+    } xc_order;
+
     std::string result;
-    for(auto const & x : extra_counts_seen)
+    for(int j = 0; j < XC_COUNTS; ++j)
     {
+        const int x = xc_order.order[j];
+        if(!(extra_counts_seen & (1 << x)))
+        {
+            continue;
+        }
         if(!result.empty())
         {
             result += ",";
         }
-        result += x;
+        result += XC_NAMES[x];
     }
     if(result.empty())
     {
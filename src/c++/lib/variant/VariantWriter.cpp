@@ -47,14 +47,15 @@
 namespace variant
 {
 
-    VariantWriter::VariantWriter(const char * filename, const char * reference)
+    VariantWriter::VariantWriter(const char * filename, const char * reference, int compression_level)
     {
-        _impl = new VariantWriterImpl(filename, reference);
+        _impl = new VariantWriterImpl(filename, reference, compression_level);
     }
 
     VariantWriter::VariantWriter(VariantWriter const & rhs)
     {
-        _impl = new VariantWriterImpl(rhs._impl->filename.c_str(), rhs._impl->referencename.c_str());
+        _impl = new VariantWriterImpl(rhs._impl->filename.c_str(), rhs._impl->referencename.c_str(),
+                                      rhs._impl->compression_level);
         for(std::string const & s : rhs._impl->samples)
         {
             addSample(s.c_str());
@@ -77,7 +78,8 @@ namespace variant
             return *this;
         }
         delete _impl;
-        _impl = new VariantWriterImpl(rhs._impl->filename.c_str(), rhs._impl->referencename.c_str());
+        _impl = new VariantWriterImpl(rhs._impl->filename.c_str(), rhs._impl->referencename.c_str(),
+                                      rhs._impl->compression_level);
         for(std::string const & s : rhs._impl->samples)
         {
             addSample(s.c_str());
@@ -199,11 +201,35 @@ namespace variant
 
         bcf_hdr_add_sample(hdr, NULL);
         bcf_hdr_set_version(hdr, "VCFv4.1");
-        bcf_hdr_write(fp, hdr);
+        if(fp)
+        {
+            bcf_hdr_write(fp, hdr);
+        }
         header_done = true;
     }
 
+    bcf_hdr_t * VariantWriter::getHeader()
+    {
+        if(!_impl->header_done)
+        {
+            _impl->writeHeader();
+        }
+        // bcf_hdr_write would normally do this
+        bcf_hdr_sync(_impl->hdr);
+        return _impl->hdr;
+    }
+
     void VariantWriter::put(Variants const & var)
+    {
+        bcf1_t * rec = encode(var);
+        if(!_impl->fp)
+        {
+            error("Cannot write variants, VariantWriter was created without an output file.");
+        }
+        bcf_write1(_impl->fp, _impl->hdr, rec);
+    }
+
+    bcf1_t * VariantWriter::encode(Variants const & var)
     {
         if(!_impl->header_done)
         {
@@ -659,7 +685,7 @@ namespace variant
             delete [] ambiguous;
         }
 
-        bcf_write1(_impl->fp, hdr, rec);
+        return rec;
     }
 
 } // namespace variant
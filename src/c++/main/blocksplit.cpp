@@ -39,9 +39,15 @@
 #include "Variant.hh"
 #include "helpers/StringUtil.hh"
 #include "helpers/GraphUtil.hh"
+#include "helpers/BlockCost.hh"
+#include "helpers/OrderedPipeline.hh"
+#include "helpers/PositionScanner.hh"
 
+#include <atomic>
 #include <fstream>
+#include <iomanip>
 #include <limits>
+#include <mutex>
 #include <htslib/synced_bcf_reader.h>
 #include <htslib/vcf.h>
 
@@ -71,6 +77,11 @@ int main(int argc, char* argv[]) {
 
     int nblocks = 32;
     int nvars = 100;
+    int threads = 1;
+
+    // balance blocks by predicted comparison cost rather than by variant count
+    bool balance_cost = true;
+    variant::BlockCost block_cost;
 
     bool verbose = false;
 
@@ -92,6 +103,12 @@ int main(int argc, char* argv[]) {
             ("nblocks,b", po::value<int>(), "Maximum number of blocks to break into (32).")
             ("nvars,v", po::value<int>(), "Minimum number of variants per block (100).")
             ("apply-filters,f", po::value<bool>(), "Apply filtering in VCF.")
+            ("threads", po::value<int>(), "Number of threads to use (contigs are read in parallel).")
+            ("cost-model", po::value<std::string>(), "How to balance blocks: count (number of variants) or complexity (predicted comparison cost, default).")
+            ("max-enum", po::value<int64_t>(), "Enumeration threshold used in the comparison (16768).")
+            ("record-weight", po::value<double>(), "Cost per record relative to one enumerated haplotype (100).")
+            ("indel-weight", po::value<double>(), "Relative extra cost per indel in a superlocus (0.1).")
+            ("span-weight", po::value<double>(), "Relative extra cost per kb of superlocus length (0.01).")
             ("verbose", po::value<bool>(), "Verbose output.")
         ;
 
@@ -210,6 +227,48 @@ int main(int argc, char* argv[]) {
             nvars = vm["nvars"].as< int >();
         }
 
+        if (vm.count("threads"))
+        {
+            threads = vm["threads"].as< int >();
+        }
+
+        if (vm.count("cost-model"))
+        {
+            const std::string model = vm["cost-model"].as< std::string >();
+            if(model == "count")
+            {
+                balance_cost = false;
+            }
+            else if(model == "complexity")
+            {
+                balance_cost = true;
+            }
+            else
+            {
+                error("Unknown cost model: %s", model.c_str());
+            }
+        }
+
+        if (vm.count("max-enum"))
+        {
+            block_cost.max_enum = vm["max-enum"].as< int64_t >();
+        }
+
+        if (vm.count("record-weight"))
+        {
+            block_cost.record_weight = vm["record-weight"].as< double >();
+        }
+
+        if (vm.count("indel-weight"))
+        {
+            block_cost.indel_weight = vm["indel-weight"].as< double >();
+        }
+
+        if (vm.count("span-weight"))
+        {
+            block_cost.span_weight = vm["span-weight"].as< double >();
+        }
+
     }
     catch (po::error & e)
     {
@@ -229,243 +288,383 @@ int main(int argc, char* argv[]) {
 
     try
     {
-        bcf_srs_t * reader = bcf_sr_init();
-        reader->require_index = 1;
-        reader->collapse = COLLAPSE_NONE;
-        reader->streaming = 0;
-        if(!regions_bed.empty())
-        {
-            int result = bcf_sr_set_regions(reader, regions_bed.c_str(), 1);
-            if(result < 0)
-            {
-                error("Failed to set regions string %s.", regions_bed.c_str());
-            }
-        }
-        if(!targets_bed.empty())
-        {
-            int result = bcf_sr_set_targets(reader, targets_bed.c_str(), 1, 1);
-            if(result < 0)
-            {
-                error("Failed to set targets string %s.", targets_bed.c_str());
-            }
-        }
-        for(auto const & file : files)
-        {
-            if (!bcf_sr_add_reader(reader, file.c_str()))
-            {
-                error("Failed to open or file not indexed: %s\n", file.c_str());
-            }
-        }
-
-        bool stop_after_chr_change = false;
-        if(!chr.empty())
-        {
-            int success = 0;
-            if(start < 0)
-            {
-                success = bcf_sr_seek(reader, chr.c_str(), 0);
-            }
-            else
-            {
-                success = bcf_sr_seek(reader, chr.c_str(), start);
-                std::cerr << "starting at " << chr << ":" << start << "\n";
-            }
-            if(success == -reader->nreaders)
-            {
-                // cannot seek -> return no output
-                // write blocks
-                if(out_bed == "-" || out_bed == "")
-                {
-                    return 0;
-                }
-                else
-                {
-                    if(verbose)
-                    {
-                        std::cerr << "Writing to " << out_bed << "\n";
-                    }
-                    volatile std::ofstream f(out_bed.c_str());
-                    return 0;
-                }
-            }
-            stop_after_chr_change = true;
-        }
-
         int64_t rcount = 0;
         int64_t last_end = -1;
         int64_t vars = 0, total_vars = 0;
+        double cost = 0, total_cost = 0;
+
+        // current superlocus
+        int64_t sl_start = -1, sl_records = 0, sl_hets = 0, sl_indels = 0;
 
         struct Breakpoint
         {
             std::string chr;
             int64_t pos;
             int64_t vars;
+            double cost;
         };
 
         std::list< Breakpoint > breakpoints;
 
-        const auto add_bp = [&breakpoints, nvars, nblocks, &chr, &vars, verbose](int64_t bp)
+        const auto add_bp = [&breakpoints, nvars, nblocks, &chr, &vars, &cost, verbose](int64_t bp)
         {
             if (vars > nvars)
             {
                 if(verbose)
                 {
-                    std::cerr << "Break point at " << chr << ":" << bp << " (" << vars << " variants)" << "\n";
+                    std::cerr << "Break point at " << chr << ":" << bp << " (" << vars << " variants, cost "
+                              << cost << ")" << "\n";
                 }
-                breakpoints.push_back(Breakpoint{chr, bp, vars});
+                breakpoints.push_back(Breakpoint{chr, bp, vars, cost});
                 vars = 0;
+                cost = 0;
             }
         };
 
+        // add the predicted cost of the superlocus that ends at last_end
+        const auto end_superlocus = [&]()
+        {
+            if(sl_records > 0)
+            {
+                const double c = block_cost(sl_records, sl_hets, sl_indels, last_end - sl_start + 1);
+                cost += c;
+                total_cost += c;
+            }
+            sl_start = -1;
+            sl_records = 0;
+            sl_hets = 0;
+            sl_indels = 0;
+        };
+
         std::string firstchr;
+        bool stop_after_chr_change = !chr.empty();
 
-        int nl = 1;
-        while(nl)
+        // process the extent of the called records at one position, returns false to stop
+        const auto add_line = [&](std::string const & v_chr, int64_t v_pos, int64_t v_end,
+                                  int64_t v_hets, int64_t v_indels) -> bool
         {
-            nl = bcf_sr_next_line(reader);
-            if (nl <= 0)
+            if(rlimit != -1 && rcount >= rlimit)
+            {
+                return false;
+            }
+            if(end != -1 && ( (v_pos > end) || (chr != "" && v_chr != chr)) )
+            {
+                return false;
+            }
+            if(stop_after_chr_change && chr != "" && v_chr != chr)
+            {
+                return false;
+            }
+            if (firstchr.size() == 0)
+            {
+                firstchr = v_chr;
+            }
+            if(chr != "" && v_chr != chr)
+            {
+                end_superlocus();
+                last_end = -1;
+            }
+            chr = v_chr;
+
+            if(message > 0 && (rcount % message) == 0)
+            {
+                std::cerr << "From " << chr << ":" << last_end << " ("
+                          << breakpoints.size() << " bps, " << vars << " vars)"
+                          << " -- " << v_chr << ":" << v_pos << "-" << v_end << "\n";
+            }
+
+            vars++;
+            total_vars++;
+
+            if(last_end >= 0 && v_pos > last_end + window) // can split here
             {
-                break;
+                end_superlocus();
+                add_bp(last_end);
+            }
+            if(sl_start < 0)
+            {
+                sl_start = v_pos;
             }
+            ++sl_records;
+            sl_hets += v_hets;
+            sl_indels += v_indels;
+            last_end = std::max(last_end, v_end);
+
+            ++rcount;
+            return true;
+        };
 
-            if(rlimit != -1)
+        const auto write_empty = [&out_bed, verbose]()
+        {
+            // cannot seek -> return no output
+            if(out_bed != "-" && out_bed != "")
             {
-                if(rcount >= rlimit)
+                if(verbose)
                 {
-                    break;
+                    std::cerr << "Writing to " << out_bed << "\n";
                 }
+                volatile std::ofstream f(out_bed.c_str());
             }
+        };
 
-            std::string v_chr;
-            int64_t v_pos = -1, v_end = -1;
-            for(int isample = 0; isample < reader->nreaders; ++isample)
+        if(regions_bed.empty() && targets_bed.empty())
+        {
+            // positional scan, contigs are read in parallel and processed in order
+            std::vector<std::string> contigs;
+            std::vector<std::unique_ptr<bcfhelpers::PositionScanner>> scanners;
+            scanners.emplace_back(new bcfhelpers::PositionScanner(files, apply_filters));
+            int64_t scan_start = 0;
+            if(!chr.empty())
             {
-                if(!bcf_sr_has_line(reader, isample))
+                contigs.push_back(chr);
+                if(start >= 0)
                 {
-                    continue;
+                    scan_start = start;
+                    std::cerr << "starting at " << chr << ":" << start << "\n";
                 }
-                bcf_hdr_t * hdr = reader->readers[isample].header;
-                bcf1_t * line = reader->readers[isample].buffer[0];
-                bcf_unpack(line, BCF_UN_FLT);
+            }
+            else
+            {
+                contigs = scanners.front()->getContigs();
+            }
 
-                if(apply_filters)
+            struct ContigLines
+            {
+                std::string chr;
+                bool found;
+                std::vector<bcfhelpers::PositionScanner::Line> lines;
+            };
+
+            std::mutex scanners_mutex;
+            std::atomic<bool> done(false);
+            bool found = false;
+            parallel::OrderedPipeline<ContigLines> pipeline(
+                std::min(threads, (int)contigs.size()), 2 * (size_t)std::max(1, threads),
+                [&](ContigLines & c)
                 {
-                    bool fail = false;
-                    for(int j = 0; j < line->d.n_flt; ++j)
+                    if(done)
                     {
-                        std::string filter = "PASS";
-                        int k = line->d.flt[j];
-
-                        if(k >= 0)
-                        {
-                            filter = bcf_hdr_int2id(hdr, BCF_DT_ID, line->d.flt[j]);
-                        }
-                        if(filter != "PASS")
+                        return;
+                    }
+                    std::unique_ptr<bcfhelpers::PositionScanner> scanner;
+                    {
+                        std::lock_guard<std::mutex> l(scanners_mutex);
+                        if(!scanners.empty())
                         {
-                            fail = true;
-                            break;
+                            scanner = std::move(scanners.back());
+                            scanners.pop_back();
                         }
                     }
-                    // skip failing
-                    if(fail)
+                    if(!scanner)
                     {
-                        continue;
+                        scanner.reset(new bcfhelpers::PositionScanner(files, apply_filters));
                     }
-                }
-                bcf_unpack(line, BCF_UN_ALL);
-
-                bool call_this_pos = false;
-                for(int rsample = 0; rsample < line->n_sample; ++rsample)
+                    c.found = scanner->scan(c.chr, scan_start, end, c.lines);
+                    std::lock_guard<std::mutex> l(scanners_mutex);
+                    scanners.push_back(std::move(scanner));
+                },
+                [&](ContigLines & c)
                 {
-                    int gts[MAX_GT];
-                    int ngt = 0;
-                    bool phased = false;
-                    bcfhelpers::getGT(hdr, line, rsample, gts, ngt, phased);
-                    for(int j = 0; j < ngt; ++j)
+                    found = found || c.found;
+                    for(auto const & line : c.lines)
                     {
-                        if(gts[j] > 0)
+                        if(done || !add_line(c.chr, line.pos, line.end, line.hets, line.indels))
                         {
-                            call_this_pos = true;
+                            done = true;
                             break;
                         }
                     }
-                    if(call_this_pos)
-                    {
-                        break;
-                    }
+                    c.lines.clear();
+                    c.lines.shrink_to_fit();
+                });
+            for(auto const & c : contigs)
+            {
+                if(done)
+                {
+                    break;
                 }
+                pipeline.push(ContigLines{c, false, {}});
+            }
+            pipeline.finish();
 
-                if(!call_this_pos)
+            if(!contigs.empty() && !found)
+            {
+                write_empty();
+                return 0;
+            }
+        }
+        else
+        {
+            bcf_srs_t * reader = bcf_sr_init();
+            reader->require_index = 1;
+            reader->collapse = COLLAPSE_NONE;
+            reader->streaming = 0;
+            if(!regions_bed.empty())
+            {
+                int result = bcf_sr_set_regions(reader, regions_bed.c_str(), 1);
+                if(result < 0)
                 {
-                    continue;
+                    error("Failed to set regions string %s.", regions_bed.c_str());
                 }
-
-                v_chr = bcfhelpers::getChrom(hdr, line);
-                // rely on synced_reader to give us records on the same chr
-                int64_t this_v_pos = -1;
-                int64_t this_v_end = -1;
-                try
+            }
+            if(!targets_bed.empty())
+            {
+                int result = bcf_sr_set_targets(reader, targets_bed.c_str(), 1, 1);
+                if(result < 0)
                 {
-                    bcfhelpers::getLocation(hdr, line, this_v_pos, this_v_end);
+                    error("Failed to set targets string %s.", targets_bed.c_str());
                 }
-                catch(bcfhelpers::importexception const & e)
+            }
+            for(auto const & file : files)
+            {
+                if (!bcf_sr_add_reader(reader, file.c_str()))
                 {
-                    std::cerr << e.what() << "\n";
-                    continue;
+                    error("Failed to open or file not indexed: %s\n", file.c_str());
                 }
-                if(v_pos < 0)
+            }
+
+            if(!chr.empty())
+            {
+                int success = 0;
+                if(start < 0)
                 {
-                    v_pos = this_v_pos;
+                    success = bcf_sr_seek(reader, chr.c_str(), 0);
                 }
                 else
                 {
-                    v_pos = std::min(this_v_pos, v_pos);
+                    success = bcf_sr_seek(reader, chr.c_str(), start);
+                    std::cerr << "starting at " << chr << ":" << start << "\n";
+                }
+                if(success == -reader->nreaders)
+                {
+                    bcf_sr_destroy(reader);
+                    write_empty();
+                    return 0;
                 }
-                v_end = std::max(this_v_end, v_end);
             }
 
-            if(v_chr.empty() || v_pos < 0 || v_end < 0)
+            int nl = 1;
+            while(nl)
             {
-                continue;
-            }
+                nl = bcf_sr_next_line(reader);
+                if (nl <= 0)
+                {
+                    break;
+                }
 
-            if(end != -1 && ( (v_pos > end) || (chr != "" && v_chr != chr)) )
-            {
-                break;
-            }
-            if(stop_after_chr_change && chr != "" && v_chr != chr)
-            {
-                break;
-            }
-            if (firstchr.size() == 0)
-            {
-                firstchr = v_chr;
-            }
-            if(chr != "" && v_chr != chr)
-            {
-                last_end = -1;
-            }
-            chr = v_chr;
+                std::string v_chr;
+                int64_t v_pos = -1, v_end = -1, v_hets = 0, v_indels = 0;
+                for(int isample = 0; isample < reader->nreaders; ++isample)
+                {
+                    if(!bcf_sr_has_line(reader, isample))
+                    {
+                        continue;
+                    }
+                    bcf_hdr_t * hdr = reader->readers[isample].header;
+                    bcf1_t * line = reader->readers[isample].buffer[0];
+                    bcf_unpack(line, BCF_UN_FLT);
 
-            if(message > 0 && (rcount % message) == 0)
-            {
-                std::cerr << "From " << chr << ":" << last_end << " ("
-                          << breakpoints.size() << " bps, " << vars << " vars)"
-                          << " -- " << v_chr << ":" << v_pos << "-" << v_end << "\n";
-            }
+                    if(apply_filters)
+                    {
+                        const int pass_id = bcf_hdr_id2int(hdr, BCF_DT_ID, "PASS");
+                        bool fail = false;
+                        for(int j = 0; j < line->d.n_flt; ++j)
+                        {
+                            if(line->d.flt[j] != pass_id)
+                            {
+                                fail = true;
+                                break;
+                            }
+                        }
+                        // skip failing
+                        if(fail)
+                        {
+                            continue;
+                        }
+                    }
 
-            vars++;
-            total_vars++;
+                    bool call_this_pos = false;
+                    bool het = false;
+                    for(int rsample = 0; rsample < line->n_sample; ++rsample)
+                    {
+                        int gts[MAX_GT];
+                        int ngt = 0;
+                        bool phased = false;
+                        bcfhelpers::getGT(hdr, line, rsample, gts, ngt, phased);
+                        for(int j = 0; j < ngt; ++j)
+                        {
+                            if(gts[j] > 0)
+                            {
+                                call_this_pos = true;
+                            }
+                            if(!phased && j > 0 && gts[j] >= 0 && gts[0] >= 0 && gts[j] != gts[0])
+                            {
+                                het = true;
+                            }
+                        }
+                        if(call_this_pos && het)
+                        {
+                            break;
+                        }
+                    }
 
-            if(last_end >= 0 && v_pos > last_end + window) // can split here
-            {
-                add_bp(last_end);
-            }
-            last_end = std::max(last_end, v_end);
+                    if(!call_this_pos)
+                    {
+                        continue;
+                    }
 
-            ++rcount;
+                    bool indel = false;
+                    const size_t ref_len = strlen(line->d.allele[0]);
+                    for(int j = 1; j < line->n_allele; ++j)
+                    {
+                        if(strlen(line->d.allele[j]) != ref_len || line->d.allele[j][0] == '<')
+                        {
+                            indel = true;
+                            break;
+                        }
+                    }
+
+                    v_chr = bcfhelpers::getChrom(hdr, line);
+                    // rely on synced_reader to give us records on the same chr
+                    int64_t this_v_pos = -1;
+                    int64_t this_v_end = -1;
+                    try
+                    {
+                        bcfhelpers::getLocation(hdr, line, this_v_pos, this_v_end);
+                    }
+                    catch(bcfhelpers::importexception const & e)
+                    {
+                        std::cerr << e.what() << "\n";
+                        continue;
+                    }
+                    if(v_pos < 0)
+                    {
+                        v_pos = this_v_pos;
+                    }
+                    else
+                    {
+                        v_pos = std::min(this_v_pos, v_pos);
+                    }
+                    v_end = std::max(this_v_end, v_end);
+                    v_hets += het ? 1 : 0;
+                    v_indels += indel ? 1 : 0;
+                }
+
+                if(v_chr.empty() || v_pos < 0 || v_end < 0)
+                {
+                    continue;
+                }
+
+                if(!add_line(v_chr, v_pos, v_end, v_hets, v_indels))
+                {
+                    break;
+                }
+            }
+            bcf_sr_destroy(reader);
         }
 
+        end_superlocus();
+
         // write blocks
         std::ostream * outputfile = NULL;
 
@@ -486,39 +685,56 @@ int main(int argc, char* argv[]) {
         start = 0;
         int64_t vpb = 0;
         int64_t target_vpb = std::max(nvars, ((int)total_vars) / nblocks);
+        double cpb = 0;
+        const double target_cpb = total_cost / std::max(1, nblocks);
+        // variants and cost in blocks written so far, the last block gets the rest
+        int64_t written_vars = 0;
+        double written_cost = 0;
 
         if(end <= 0)
         {
             end = std::numeric_limits<int>::max();
         }
 
+        // blocks are written as chr, start, end, number of variants, predicted cost
+        const auto write_block = [&](int64_t block_end, int64_t block_vars, double block_cost)
+        {
+            *outputfile << chr << "\t" << start << "\t" << block_end << "\t"
+                        << block_vars << "\t" << std::fixed << std::setprecision(1) << block_cost << "\n";
+            written_vars += block_vars;
+            written_cost += block_cost;
+        };
+
         for (auto & b : breakpoints)
         {
             if (chr != b.chr)
             {
-                *outputfile << chr << "\t" << start << "\t" << std::max(start + window + 1, end) << "\n";
+                write_block(std::max(start + window + 1, end), vpb, cpb);
                 chr = b.chr;
                 start = 1;
                 vpb = 0;
+                cpb = 0;
             }
             vpb += b.vars;
-            if(vpb > target_vpb)
+            cpb += b.cost;
+            if(balance_cost ? cpb > target_cpb : vpb > target_vpb)
             {
-                *outputfile << chr << "\t" << start << "\t" << b.pos + window + 1 << "\n";
+                write_block(b.pos + window + 1, vpb, cpb);
                 start = b.pos + window + 1;
                 vpb = 0;
+                cpb = 0;
             }
         }
         if(chr != "")
         {
-            *outputfile << chr << "\t" << start << "\t" << std::max(start + window + 1, end) << "\n";
+            write_block(std::max(start + window + 1, end),
+                        total_vars - written_vars, std::max(0.0, total_cost - written_cost));
         }
 
         if(out_bed != "-" && out_bed != "")
         {
             delete outputfile;
         }
-        bcf_sr_destroy(reader);
     }
     catch(std::runtime_error & e)
     {
@@ -0,0 +1,176 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * \brief Concatenate sorted VCF / BCF parts at the BGZF block level and index the result
+ *
+ * \file concatparts.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <fstream>
+
+#include "helpers/ConcatParts.hh"
+
+#include "Version.hh"
+#include "Error.hh"
+
+int main(int argc, char* argv[]) {
+    namespace po = boost::program_options;
+
+    std::vector<std::string> parts;
+    std::string output;
+    int index_format = HTS_FMT_CSI;
+
+    try
+    {
+        // Declare the supported options.
+        po::options_description desc("Allowed options");
+        desc.add_options()
+            ("help,h", "produce help message")
+            ("version", "Show version")
+            ("input-file", po::value<std::vector<std::string> >(), "The input VCF/BCF parts, in order.")
+            ("parts-list,F", po::value<std::string>(), "Read the names of the input parts from a file (one per line).")
+            ("output,o", po::value<std::string>(), "The output file name.")
+            ("index", po::value<std::string>(), "Index to write: csi (default), tbi (VCF only) or none.")
+        ;
+
+        po::positional_options_description popts;
+        popts.add("input-file", -1);
+
+        po::options_description cmdline_options;
+        cmdline_options
+            .add(desc)
+        ;
+
+        po::variables_map vm;
+
+        po::store(po::command_line_parser(argc, argv).
+                  options(cmdline_options).positional(popts).run(), vm);
+        po::notify(vm);
+
+        if (vm.count("version"))
+        {
+            std::cout << "concatparts version " << HAPLOTYPES_VERSION << "\n";
+            return 0;
+        }
+
+        if (vm.count("help"))
+        {
+            std::cout << desc << "\n";
+            return 1;
+        }
+
+        if (vm.count("parts-list"))
+        {
+            const std::string list = vm["parts-list"].as< std::string >();
+            std::ifstream f(list.c_str());
+            if(!f)
+            {
+                std::cerr << "Cannot read " << list << "\n";
+                return 1;
+            }
+            std::string line;
+            while(std::getline(f, line))
+            {
+                if(!line.empty())
+                {
+                    parts.push_back(line);
+                }
+            }
+        }
+
+        if (vm.count("input-file"))
+        {
+            const std::vector<std::string> files = vm["input-file"].as< std::vector<std::string> >();
+            parts.insert(parts.end(), files.begin(), files.end());
+        }
+
+        if (vm.count("output"))
+        {
+            output = vm["output"].as< std::string >();
+        }
+
+        if (vm.count("index"))
+        {
+            const std::string idx = vm["index"].as< std::string >();
+            if(idx == "csi")
+            {
+                index_format = HTS_FMT_CSI;
+            }
+            else if(idx == "tbi")
+            {
+                index_format = HTS_FMT_TBI;
+            }
+            else if(idx == "none")
+            {
+                index_format = -1;
+            }
+            else
+            {
+                std::cerr << "Unknown index type: " << idx << "\n";
+                return 1;
+            }
+        }
+
+        if(parts.empty())
+        {
+            std::cerr << "Please specify at least one input file.\n";
+            return 1;
+        }
+
+        if (output == "")
+        {
+            std::cerr << "Please specify an output file.\n";
+            return 1;
+        }
+    }
+    catch (po::error & e)
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    try
+    {
+        bcfhelpers::concatenateParts(parts, output, index_format);
+    }
+    catch(std::runtime_error & e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    catch(std::logic_error & e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -42,6 +42,7 @@
 #include "VariantInput.hh"
 #include "helpers/StringUtil.hh"
 #include "helpers/GraphUtil.hh"
+#include "helpers/DigestSet.hh"
 
 #include <fstream>
 
@@ -70,6 +71,8 @@ int main(int argc, char* argv[]) {
 
     bool apply_filters = true;
     bool preprocess = true;
+    bool unique = true;
+    int64_t max_memory = 1024;
 
     try
     {
@@ -85,6 +88,9 @@ int main(int argc, char* argv[]) {
             ("max-n-haplotypes", po::value<int>(), "Maximum number of haplotypes to enumerate.")
             ("apply-filters,f", po::value<int>(), "Apply filters in VCF (default to 1)")
             ("preprocess,P", po::value<bool>(), "Preprocess variants")
+            ("unique", po::value<bool>(), "Only write each pair of haplotype sequences once (on by default).")
+            ("max-memory", po::value<int64_t>(), "Memory budget in MB for finding duplicate pairs. "
+                "When this is exceeded, sequence digests are moved to temporary files (0: no limit).")
         ;
 
         po::positional_options_description popts;
@@ -167,6 +173,16 @@ int main(int argc, char* argv[]) {
         {
             preprocess = vm["preprocess"].as<bool>() != 0;
         }
+
+        if (vm.count("unique"))
+        {
+            unique = vm["unique"].as< bool >();
+        }
+
+        if (vm.count("max-memory"))
+        {
+            max_memory = vm["max-memory"].as< int64_t >();
+        }
     }
     catch (po::error & e)
     {
@@ -217,16 +233,31 @@ int main(int argc, char* argv[]) {
 
         std::list<Variants> vars;
         vi.get(chr.c_str(), start, end, vars);
-        dr.setRegion(chr.c_str(), start, end, vars, ix);
 
-        while(dr.hasNext())
-        {
-            DiploidRef & hp (dr.next());
-
-            *out << hp << "\n";
-
-            dr.advance();
-        }
+        // write pairs as they are found
+        hashutil::DigestSet seen((size_t)std::max((int64_t)0, max_memory) * 1024 * 1024);
+        dr.enumerate(chr.c_str(), start, end, vars,
+            [&](DiploidRef const & hp)
+            {
+                if(unique)
+                {
+                    // the same pair can be found with the haplotypes swapped
+                    std::string key = hp.het ? "het:" : "hom:";
+                    if(hp.het && hp.h2 < hp.h1)
+                    {
+                        key += hp.h2 + "|" + hp.h1;
+                    }
+                    else
+                    {
+                        key += hp.h1 + "|" + hp.h2;
+                    }
+                    if(!seen.insert(hashutil::digest(key)))
+                    {
+                        return;
+                    }
+                }
+                *out << hp << "\n";
+            }, ix);
 
 
         if(out_fasta != "" && out_fasta != "-")
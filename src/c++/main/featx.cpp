@@ -0,0 +1,694 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * \brief VCF feature extraction
+ *
+ * \details Extract a list of features from each VCF record into a tab-separated table
+ *          with one column per feature. Features are specified like in
+ *          Tools/vcfextract.py: CHROM, POS, ID, REF, ALT, QUAL, FILTER, I.<info field>
+ *          and S.<sample column>.<format field>, optionally with an index suffix ([n]).
+ *          Columns contain the field text as found in the VCF (index suffixes
+ *          are not applied), missing fields are written as empty columns and
+ *          present INFO flags as "True".
+ *
+ *          Indexed files are read in shards (contigs, split into windows when the
+ *          contig length is known) in parallel; the output keeps the record order.
+ *
+ * \file featx.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#include <boost/program_options.hpp>
+
+#include "Version.hh"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <regex>
+
+#include <htslib/vcf.h>
+#include <htslib/tbx.h>
+
+#include "helpers/OrderedPipeline.hh"
+
+// error needs to come after boost headers.
+#include "Error.hh"
+
+namespace
+{
+    /** one output column */
+    struct Feature
+    {
+        // the first seven are also the VCF column numbers
+        enum Kind { CHROM, POS, ID, REF, ALT, QUAL, FILTER, INFO, FORMAT, CONSTANT };
+
+        explicit Feature(std::string const & f) : spec(f), column(-1)
+        {
+            // same as splitIndex in vcfextract.py
+            static const std::regex index_re("(.*)\\[([0-9]+)\\].*");
+            std::smatch m;
+            std::string name = f;
+            if(std::regex_match(f, m, index_re))
+            {
+                name = m[1];
+            }
+
+            std::string lower = f;
+            std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+            auto starts = [&lower](const char * prefix) -> bool
+            {
+                return lower.compare(0, strlen(prefix), prefix) == 0;
+            };
+
+            if(starts("chr"))
+            {
+                kind = CHROM;
+            }
+            else if(starts("pos"))
+            {
+                kind = POS;
+            }
+            else if(starts("id"))
+            {
+                kind = ID;
+            }
+            else if(starts("ref"))
+            {
+                kind = REF;
+            }
+            else if(starts("alt"))
+            {
+                kind = ALT;
+            }
+            else if(starts("qual"))
+            {
+                kind = QUAL;
+            }
+            else if(starts("fil"))
+            {
+                kind = FILTER;
+            }
+            else if(f.compare(0, 2, "I.") == 0)
+            {
+                kind = INFO;
+                key = name.substr(2);
+            }
+            else if(f.compare(0, 2, "S.") == 0)
+            {
+                kind = FORMAT;
+                // S.<sample>.<field>: sample n is VCF column 8 + n
+                const size_t dot1 = name.find('.', 2);
+                if(dot1 == std::string::npos)
+                {
+                    error("Invalid sample feature: %s", f.c_str());
+                }
+                size_t dot2 = name.find('.', dot1 + 1);
+                try
+                {
+                    column = 8 + std::stoi(name.substr(2, dot1 - 2));
+                }
+                catch(std::logic_error const &)
+                {
+                    error("Invalid sample feature: %s", f.c_str());
+                }
+                key = name.substr(dot1 + 1, dot2 == std::string::npos ? std::string::npos : dot2 - dot1 - 1);
+            }
+            else
+            {
+                kind = CONSTANT;
+            }
+        }
+
+        std::string spec;
+        Kind kind;
+        std::string key;
+        int column;
+    };
+
+    typedef std::pair<const char *, size_t> Token;
+
+    inline void split(const char * s, size_t len, char sep, std::vector<Token> & result)
+    {
+        result.clear();
+        const char * end = s + len;
+        while(true)
+        {
+            const char * next = (const char *)memchr(s, sep, end - s);
+            if(!next)
+            {
+                result.emplace_back(s, end - s);
+                break;
+            }
+            result.emplace_back(s, next - s);
+            s = next + 1;
+        }
+    }
+
+    inline Token strip(Token t)
+    {
+        while(t.second > 0 && isspace(*t.first))
+        {
+            ++t.first;
+            --t.second;
+        }
+        while(t.second > 0 && isspace(t.first[t.second - 1]))
+        {
+            --t.second;
+        }
+        return t;
+    }
+
+    inline bool equals(Token const & t, std::string const & s)
+    {
+        return t.second == s.size() && s.compare(0, s.size(), t.first, t.second) == 0;
+    }
+
+    /** extracts the feature columns from VCF text lines */
+    class Extractor
+    {
+    public:
+        explicit Extractor(std::vector<Feature> const & _features) : features(_features)
+        {
+            for(auto const & f : features)
+            {
+                if(f.kind == Feature::INFO)
+                {
+                    have_info = true;
+                }
+            }
+            values.resize(features.size());
+            present.resize(features.size());
+        }
+
+        /** append the row for a VCF line to out */
+        void extract(const char * line, size_t len, std::string & out)
+        {
+            split(line, len, '\t', columns);
+            if(columns.size() < 8)
+            {
+                error("Invalid VCF line: %s", line);
+            }
+
+            if(have_info)
+            {
+                std::fill(present.begin(), present.end(), false);
+                split(columns[7].first, columns[7].second, ';', info);
+                for(auto const & entry : info)
+                {
+                    const char * eq = (const char *)memchr(entry.first, '=', entry.second);
+                    const Token k = strip(Token(entry.first, eq ? eq - entry.first : entry.second));
+                    for(size_t i = 0; i < features.size(); ++i)
+                    {
+                        if(features[i].kind == Feature::INFO && equals(k, features[i].key))
+                        {
+                            // later entries replace earlier ones, like in a dict
+                            present[i] = true;
+                            values[i] = eq ? strip(Token(eq + 1, entry.first + entry.second - eq - 1))
+                                           : Token("True", 4);
+                        }
+                    }
+                }
+            }
+
+            int sample_column = -1;
+            for(size_t i = 0; i < features.size(); ++i)
+            {
+                if(i > 0)
+                {
+                    out += '\t';
+                }
+                Feature const & f = features[i];
+                switch(f.kind)
+                {
+                    case Feature::CHROM:
+                    case Feature::POS:
+                    case Feature::ID:
+                    case Feature::REF:
+                    case Feature::ALT:
+                    case Feature::QUAL:
+                    case Feature::FILTER:
+                        out.append(columns[f.kind].first, columns[f.kind].second);
+                        break;
+                    case Feature::INFO:
+                        if(present[i])
+                        {
+                            out.append(values[i].first, values[i].second);
+                        }
+                        break;
+                    case Feature::FORMAT:
+                        if(f.column < (int)columns.size() && columns.size() > 8)
+                        {
+                            if(f.column != sample_column)
+                            {
+                                split(columns[8].first, columns[8].second, ':', format_keys);
+                                split(columns[f.column].first, columns[f.column].second, ':', format_values);
+                                sample_column = f.column;
+                            }
+                            // vcfextract.py gives no values for a sample with fewer
+                            // fields than given in FORMAT
+                            if(format_values.size() < format_keys.size())
+                            {
+                                break;
+                            }
+                            for(size_t j = format_keys.size(); j > 0; --j)
+                            {
+                                if(equals(format_keys[j - 1], f.key))
+                                {
+                                    out.append(format_values[j - 1].first, format_values[j - 1].second);
+                                    break;
+                                }
+                            }
+                        }
+                        break;
+                    case Feature::CONSTANT:
+                        out += f.spec;
+                        break;
+                }
+            }
+            out += '\n';
+        }
+
+    private:
+        std::vector<Feature> const & features;
+        bool have_info = false;
+        std::vector<Token> columns, info, format_keys, format_values;
+        std::vector<Token> values;
+        std::vector<bool> present;
+    };
+
+    /** a part of the input file, and the output rows for it */
+    struct Shard
+    {
+        std::string chr;
+        int64_t start;  // 0-based, records are assigned to the shard containing their POS
+        int64_t end;
+        std::string rows;
+    };
+
+    /** Indexed VCF / BCF input which can be read in shards */
+    class ShardReader
+    {
+    public:
+        explicit ShardReader(std::string const & filename)
+        {
+            fp = hts_open(filename.c_str(), "r");
+            if(!fp)
+            {
+                error("Cannot open %s", filename.c_str());
+            }
+            hdr = bcf_hdr_read(fp);
+            if(!hdr)
+            {
+                error("Cannot read header from %s", filename.c_str());
+            }
+            if(hts_get_format(fp)->format == bcf)
+            {
+                idx = bcf_index_load(filename.c_str());
+                rec = bcf_init();
+            }
+            else
+            {
+                tbx = tbx_index_load(filename.c_str());
+            }
+            str.l = str.m = 0;
+            str.s = NULL;
+        }
+
+        ~ShardReader()
+        {
+            free(str.s);
+            if(rec)
+            {
+                bcf_destroy(rec);
+            }
+            if(idx)
+            {
+                hts_idx_destroy(idx);
+            }
+            if(tbx)
+            {
+                tbx_destroy(tbx);
+            }
+            bcf_hdr_destroy(hdr);
+            hts_close(fp);
+        }
+
+        bool indexed() const
+        {
+            return idx != NULL || tbx != NULL;
+        }
+
+        /** contigs in index order */
+        std::vector<std::string> contigs() const
+        {
+            std::vector<std::string> result;
+            int n = 0;
+            const char ** names = tbx ? tbx_seqnames(tbx, &n) : bcf_index_seqnames(idx, hdr, &n);
+            for(int i = 0; i < n; ++i)
+            {
+                result.push_back(names[i]);
+            }
+            free(names);
+            return result;
+        }
+
+        /** contig length from the header, or -1 if not known */
+        int64_t length(std::string const & chr) const
+        {
+            const int rid = bcf_hdr_name2id(hdr, chr.c_str());
+            if(rid < 0 || !hdr->id[BCF_DT_CTG][rid].val)
+            {
+                return -1;
+            }
+            const int64_t l = (int64_t)hdr->id[BCF_DT_CTG][rid].val->info[0];
+            return l > 0 ? l : -1;
+        }
+
+        /** extract the rows for all records with POS in the shard */
+        void read(Shard & s, Extractor & ex)
+        {
+            const int tid = tbx ? tbx_name2id(tbx, s.chr.c_str()) : bcf_hdr_name2id(hdr, s.chr.c_str());
+            if(tid < 0)
+            {
+                return;
+            }
+            hts_itr_t * itr = tbx ? tbx_itr_queryi(tbx, tid, s.start, s.end)
+                                  : bcf_itr_queryi(idx, tid, s.start, s.end);
+            if(!itr)
+            {
+                return;
+            }
+            while(next(itr))
+            {
+                // records overlapping the shard start belong to the previous shard
+                const char * tab = strchr(str.s, '\t');
+                const int64_t pos = tab ? strtoll(tab + 1, NULL, 10) - 1 : -1;
+                if(pos < s.start || pos >= s.end)
+                {
+                    continue;
+                }
+                ex.extract(str.s, str.l, s.rows);
+            }
+            hts_itr_destroy(itr);
+        }
+
+        /** extract rows for all records, in file order */
+        template<typename output_t>
+        void readAll(Extractor & ex, output_t output)
+        {
+            std::string rows;
+            while(true)
+            {
+                if(rec)
+                {
+                    if(bcf_read(fp, hdr, rec) < 0)
+                    {
+                        break;
+                    }
+                    str.l = 0;
+                    vcf_format(hdr, rec, &str);
+                    str.s[--str.l] = 0;
+                }
+                else
+                {
+                    if(hts_getline(fp, 2, &str) < 0)
+                    {
+                        break;
+                    }
+                    if(str.l == 0 || str.s[0] == '#')
+                    {
+                        continue;
+                    }
+                }
+                ex.extract(str.s, str.l, rows);
+                if(rows.size() > 1024*1024)
+                {
+                    output(rows);
+                    rows.clear();
+                }
+            }
+            output(rows);
+        }
+
+    private:
+        bool next(hts_itr_t * itr)
+        {
+            if(tbx)
+            {
+                return tbx_itr_next(fp, tbx, itr, &str) >= 0;
+            }
+            if(bcf_itr_next(fp, itr, rec) < 0)
+            {
+                return false;
+            }
+            str.l = 0;
+            vcf_format(hdr, rec, &str);
+            // remove the newline
+            str.s[--str.l] = 0;
+            return true;
+        }
+
+        htsFile * fp = NULL;
+        bcf_hdr_t * hdr = NULL;
+        hts_idx_t * idx = NULL;
+        tbx_t * tbx = NULL;
+        bcf1_t * rec = NULL;
+        kstring_t str;
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    namespace po = boost::program_options;
+
+    std::string file;
+    std::string output_file;
+    std::vector<std::string> feature_specs;
+    int threads = 1;
+    int64_t shard_size = 10000000;
+
+    try
+    {
+        try
+        {
+            // Declare the supported options.
+            po::options_description desc("Allowed options");
+            desc.add_options()
+                ("help,h", "produce help message")
+                ("version", "Show version")
+                ("input-file", po::value<std::string>(), "The input VCF / BCF file.")
+                ("output-file,o", po::value<std::string>(), "The output TSV file (default: stdout).")
+                ("feature,F", po::value<std::vector<std::string> >(), "Feature to extract (can be given multiple "
+                    "times): CHROM, POS, ID, REF, ALT, QUAL, FILTER, I.<info field> or S.<sample>.<format field>.")
+                ("threads", po::value<int>(), "Number of threads to use (indexed inputs are read in parallel).")
+                ("shard-size", po::value<int64_t>(), "Size of the parts of each contig which are read in parallel.")
+            ;
+
+            po::positional_options_description popts;
+            popts.add("input-file", 1);
+
+            po::options_description cmdline_options;
+            cmdline_options
+                .add(desc)
+            ;
+
+            po::variables_map vm;
+
+            po::store(po::command_line_parser(argc, argv).
+                      options(cmdline_options).positional(popts).run(), vm);
+            po::notify(vm);
+
+            if (vm.count("version"))
+            {
+                std::cout << "featx version " << HAPLOTYPES_VERSION << "\n";
+                return 0;
+            }
+
+            if (vm.count("help"))
+            {
+                std::cout << desc << "\n";
+                return 1;
+            }
+
+            if (vm.count("input-file"))
+            {
+                file = vm["input-file"].as< std::string >();
+            }
+
+            if (vm.count("output-file"))
+            {
+                output_file = vm["output-file"].as< std::string >();
+            }
+
+            if (vm.count("feature"))
+            {
+                feature_specs = vm["feature"].as< std::vector<std::string> >();
+            }
+
+            if (vm.count("threads"))
+            {
+                threads = vm["threads"].as< int >();
+            }
+
+            if (vm.count("shard-size"))
+            {
+                shard_size = vm["shard-size"].as< int64_t >();
+            }
+
+            if(file.empty() || feature_specs.empty())
+            {
+                std::cerr << "Please specify an input file and at least one feature.\n";
+                return 1;
+            }
+            if(shard_size <= 0)
+            {
+                std::cerr << "The shard size must be positive.\n";
+                return 1;
+            }
+        }
+        catch (po::error & e)
+        {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+
+        std::vector<Feature> features;
+        for(auto const & f : feature_specs)
+        {
+            features.emplace_back(f);
+        }
+
+        std::ofstream output_stream;
+        if(!output_file.empty() && output_file != "-")
+        {
+            output_stream.open(output_file);
+            if(!output_stream)
+            {
+                error("Cannot write %s", output_file.c_str());
+            }
+        }
+        std::ostream & output = output_stream.is_open() ? output_stream : std::cout;
+
+        for(size_t i = 0; i < feature_specs.size(); ++i)
+        {
+            output << (i > 0 ? "\t" : "") << feature_specs[i];
+        }
+        output << "\n";
+
+        std::unique_ptr<ShardReader> first(new ShardReader(file));
+        if(!first->indexed())
+        {
+            Extractor ex(features);
+            first->readAll(ex, [&output](std::string const & rows) { output << rows; });
+        }
+        else
+        {
+            std::vector<Shard> shards;
+            for(auto const & chr : first->contigs())
+            {
+                const int64_t len = first->length(chr);
+                if(len < 0)
+                {
+                    shards.push_back(Shard{chr, 0, std::numeric_limits<int32_t>::max(), ""});
+                    continue;
+                }
+                for(int64_t start = 0; start < len; start += shard_size)
+                {
+                    // last shard also gets anything past the contig length given in the header
+                    const int64_t end = start + shard_size >= len ? std::numeric_limits<int32_t>::max()
+                                                                  : start + shard_size;
+                    shards.push_back(Shard{chr, start, end, ""});
+                }
+            }
+
+            // each worker thread needs its own file handle
+            std::mutex readers_mutex;
+            std::vector<std::unique_ptr<ShardReader> > readers;
+            readers.push_back(std::move(first));
+
+            parallel::OrderedPipeline<Shard> pipeline(
+                std::max(1, std::min(threads, (int)shards.size())), 2 * (size_t)std::max(1, threads),
+                [&](Shard & s)
+                {
+                    std::unique_ptr<ShardReader> reader;
+                    {
+                        std::lock_guard<std::mutex> l(readers_mutex);
+                        if(!readers.empty())
+                        {
+                            reader = std::move(readers.back());
+                            readers.pop_back();
+                        }
+                    }
+                    if(!reader)
+                    {
+                        reader.reset(new ShardReader(file));
+                    }
+                    Extractor ex(features);
+                    reader->read(s, ex);
+                    std::lock_guard<std::mutex> l(readers_mutex);
+                    readers.push_back(std::move(reader));
+                },
+                [&](Shard & s)
+                {
+                    output << s.rows;
+                    s.rows.clear();
+                    s.rows.shrink_to_fit();
+                });
+            for(auto & s : shards)
+            {
+                pipeline.push(std::move(s));
+            }
+            pipeline.finish();
+        }
+
+        output.flush();
+        if(!output)
+        {
+            error("Failed to write output.");
+        }
+    }
+    catch(std::runtime_error & e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    catch(std::logic_error & e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
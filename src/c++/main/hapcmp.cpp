@@ -47,6 +47,11 @@
 #include <fstream>
 #include <chrono>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+#include "helpers/OrderedPipeline.hh"
 
 // error needs to come after program_options. 
 #include "Error.hh"
@@ -54,6 +59,92 @@
 using namespace variant;
 using namespace haplotypes;
 
+namespace
+{
+    /** a line from the input regions and the comparison output for it */
+    struct Block
+    {
+        // lines which don't specify a region are passed through
+        std::string line;
+        bool is_region;
+
+        std::string chr;
+        int64_t start;
+        int64_t end;
+
+        std::string bed;
+        std::string diffs;
+        std::string errors;
+    };
+
+    /** compare the variants in a block and format bed, diff and error output */
+    void compareBlock(VariantReader & vr, DiploidCompare & dc, Block & b,
+                      int ix1, int ix2, bool output_sequences, bool output_diffs)
+    {
+        try
+        {
+            std::ostringstream partial_bed;
+            vr.rewind(b.chr.c_str(), b.start);
+            std::list<Variants> vars;
+
+            while(vr.advance())
+            {
+                Variants & v = vr.current();
+                if(b.chr != v.chr)
+                {
+                    // break on change of chr
+                    break;
+                }
+                if(v.pos > b.end)
+                {
+                    break;
+                }
+
+                vars.push_back(v);
+            }
+            dc.setRegion(b.chr.c_str(), b.start, b.end, vars, ix1, ix2);
+            DiploidComparisonResult const & dcr = dc.getResult();
+
+            printDiploidComparisonResult(partial_bed, dcr, output_sequences);
+            partial_bed << "\n";
+
+            if (output_diffs)
+            {
+                Json::FastWriter fastWriter;
+                b.diffs = fastWriter.write(toJson(dcr));
+            }
+
+            b.bed = partial_bed.str();
+        }
+        catch(std::runtime_error &e)
+        {
+            std::ostringstream bed, errors;
+            bed << b.chr << "\t" << b.start << "\t" << b.end+1 << "\t" << dco_unknown << "\t.\t.\t.\t.\t.\t.\t.\n";
+            errors << "[E] Error comparing block at " << b.chr << ":" << b.start << "-" << b.end << " - " << e.what() << "\n";
+            b.bed = bed.str();
+            b.diffs.clear();
+            b.errors = errors.str();
+        }
+        catch(std::logic_error &e)
+        {
+            std::ostringstream bed, errors;
+            bed << b.chr << "\t" << b.start << "\t" << b.end+1 << "\t" << dco_unknown << "\t.\t.\t.\t.\t.\t.\t.\n";
+            errors << "[E] Logic error comparing block at " << b.chr << ":" << b.start << "-" << b.end << " - " << e.what()  << "\n";
+            b.bed = bed.str();
+            b.diffs.clear();
+            b.errors = errors.str();
+        }
+    }
+
+    /** VariantReader and comparator for a worker thread */
+    struct Comparator
+    {
+        Comparator(VariantReader const & _vr, DiploidCompare const & _dc) : vr(_vr), dc(_dc) {}
+        VariantReader vr;
+        DiploidCompare dc;
+    };
+}
+
 int main(int argc, char* argv[]) {
     namespace po = boost::program_options;
 
@@ -80,6 +171,8 @@ int main(int argc, char* argv[]) {
     bool apply_filters = false;
     bool do_alignment = false;
 
+    int threads = 1;
+
     try
     {
         // Declare the supported options.
@@ -100,6 +193,7 @@ int main(int argc, char* argv[]) {
             ("limit,l", po::value<int64_t>(), "Maximum number of haplotype blocks to process.")
             ("apply-filters,f", po::value<bool>(), "Apply filtering in VCF.")
             ("do-alignment", po::value<bool>(), "Perform alignments on mismatching haplotypes to find best approximate match.")
+            ("threads", po::value<int>(), "Number of threads to use for comparing blocks (output stays in input order).")
         ;
 
         po::positional_options_description popts;
@@ -233,6 +327,11 @@ int main(int argc, char* argv[]) {
             do_alignment = vm["do-alignment"].as< bool >();
         }
 
+        if (vm.count("threads"))
+        {
+            threads = vm["threads"].as< int >();
+        }
+
     } 
     catch (po::error & e)
     {
@@ -297,7 +396,57 @@ int main(int argc, char* argv[]) {
             diff_out_stream = new std::ofstream(out_diffs.c_str());
         }
 
-        Json::FastWriter fastWriter;
+        // write output in the order of the input regions
+        const auto output_block = [bed_out_stream, error_out_stream, diff_out_stream] (Block & b) {
+            if(!b.is_region)
+            {
+                std::cout << b.line;
+                return;
+            }
+            if(diff_out_stream)
+            {
+                *diff_out_stream << b.diffs;
+            }
+            *bed_out_stream << b.bed;
+            *error_out_stream << b.errors;
+        };
+
+        // with more than one thread, blocks are compared by workers which each
+        // have their own VariantReader and comparator
+        std::mutex comparators_mutex;
+        std::vector< std::unique_ptr<Comparator> > comparators;
+        std::unique_ptr< parallel::OrderedPipeline<Block> > pipeline;
+        if(threads > 1)
+        {
+            pipeline.reset(new parallel::OrderedPipeline<Block>(
+                threads, 4 * (size_t)threads,
+                [&](Block & b)
+                {
+                    if(!b.is_region)
+                    {
+                        return;
+                    }
+                    std::unique_ptr<Comparator> c;
+                    {
+                        std::lock_guard<std::mutex> l(comparators_mutex);
+                        if(!comparators.empty())
+                        {
+                            c = std::move(comparators.back());
+                            comparators.pop_back();
+                        }
+                        else
+                        {
+                            c.reset(new Comparator(vr, dc));
+                            c->dc.setMaxHapEnum(max_n_haplotypes);
+                            c->dc.setDoAlignments(do_alignment);
+                        }
+                    }
+                    compareBlock(c->vr, c->dc, b, ix1, ix2, output_sequences, diff_out_stream != NULL);
+                    std::lock_guard<std::mutex> l(comparators_mutex);
+                    comparators.push_back(std::move(c));
+                },
+                output_block));
+        }
 
         int64_t nhb = 0;
         int64_t last_pos = std::numeric_limits<int64_t>::max();
@@ -313,18 +462,21 @@ int main(int argc, char* argv[]) {
                 break;
             }
 
-            std::string line;
-            std::getline(*in, line);
+            Block b;
+            b.is_region = false;
+            std::getline(*in, b.line);
 
             std::vector<std::string> v;
 
-            stringutil::split(line, v, "\t");
+            stringutil::split(b.line, v, "\t");
             // we want >= 3 columns
             if(v.size() > 3)
             {
-                std::string chr = v[0];
-                int64_t start = std::stoll(v[1]);
-                int64_t end = std::stoll(v[2]) - 1;
+                b.is_region = true;
+                b.chr = v[0];
+                b.start = std::stoll(v[1]);
+                b.end = std::stoll(v[2]) - 1;
+                b.line.clear();
 
                 if(progress)
                 {
@@ -336,72 +488,40 @@ int main(int argc, char* argv[]) {
                     {
                         auto secs_since_start = chrono::duration_cast<chrono::seconds>(end_time - start_time).count();
                         std::string mbps = "";
-                        if(last_pos < end)
+                        if(last_pos < b.end)
                         {
                             mbps = " mpbs: ";
-                            mbps += std::to_string(double(end - last_pos) / double(secs_since_start) * 1e-6);
+                            mbps += std::to_string(double(b.end - last_pos) / double(secs_since_start) * 1e-6);
                         }
                         else
                         {
-                            last_pos = end;                            
+                            last_pos = b.end;
                         }
                         last_time = end_time;
 
-                        std::cerr << "[PROGRESS] Total time: " << secs_since_start << "s Pos: " << end << mbps << "\n";
-                    }                    
-                }
-
-                try
-                {
-                    std::ostringstream partial_bed;
-                    vr.rewind(chr.c_str(), start);
-                    std::list<Variants> vars;
-
-                    while(vr.advance())
-                    {
-                        Variants & v = vr.current();
-                        if(chr != v.chr)
-                        {
-                            // break on change of chr
-                            break;
-                        }
-                        if(v.pos > end)
-                        {
-                            break;
-                        }
-
-                        vars.push_back(v);
-                    }
-                    dc.setRegion(chr.c_str(), start, end, vars, ix1, ix2);
-                    DiploidComparisonResult const & dcr = dc.getResult();
-
-                    printDiploidComparisonResult(partial_bed, dcr, output_sequences);
-                    partial_bed << "\n";
-
-                    if (diff_out_stream)
-                    {
-                        *diff_out_stream << fastWriter.write(toJson(dcr));
+                        std::cerr << "[PROGRESS] Total time: " << secs_since_start << "s Pos: " << b.end << mbps << "\n";
                     }
-
-                    *bed_out_stream << partial_bed.str();
-                }
-                catch(std::runtime_error &e)
-                {
-                    *bed_out_stream << chr << "\t" << start << "\t" << end+1 << "\t" << dco_unknown << "\t.\t.\t.\t.\t.\t.\t.\n";
-                    *error_out_stream << "[E] Error comparing block at " << chr << ":" << start << "-" << end << " - " << e.what() << "\n";
-                }
-                catch(std::logic_error &e)
-                {
-                    *bed_out_stream << chr << "\t" << start << "\t" << end+1 << "\t" << dco_unknown << "\t.\t.\t.\t.\t.\t.\t.\n";
-                    *error_out_stream << "[E] Logic error comparing block at " << chr << ":" << start << "-" << end << " - " << e.what()  << "\n";
                 }
+            }
 
+            if(pipeline)
+            {
+                pipeline->push(std::move(b));
             }
             else
             {
-                std::cout << line;
+                if(b.is_region)
+                {
+                    compareBlock(vr, dc, b, ix1, ix2, output_sequences, diff_out_stream != NULL);
+                }
+                output_block(b);
             }
-        }        
+        }
+
+        if(pipeline)
+        {
+            pipeline->finish();
+        }
 
         if(regions != "-")
         {
@@ -43,6 +43,7 @@
 #include "GraphReference.hh"
 #include "helpers/StringUtil.hh"
 #include "helpers/GraphUtil.hh"
+#include "helpers/DigestSet.hh"
 
 #include <fstream>
 
@@ -130,6 +131,8 @@ int main(int argc, char* argv[]) {
     int max_n_haplotypes = 4096;
     bool apply_filters = true;
     bool preprocess = true;
+    bool unique = true;
+    int64_t max_memory = 1024;
 
     try
     {
@@ -146,6 +149,9 @@ int main(int argc, char* argv[]) {
             ("apply-filters,f", po::value<bool>(), "Apply filtering in VCF.")
             ("preprocess,P", po::value<bool>(), "Preprocess variants")
             ("max-n-haplotypes", po::value<int>(), "Maximum number of haplotypes to enumerate.")
+            ("unique", po::value<bool>(), "Only write each haplotype sequence once (on by default).")
+            ("max-memory", po::value<int64_t>(), "Memory budget in MB for finding duplicate sequences. "
+                "When this is exceeded, sequence digests are moved to temporary files (0: no limit).")
         ;
 
         po::positional_options_description popts;
@@ -234,6 +240,15 @@ int main(int argc, char* argv[]) {
             max_n_haplotypes = vm["max-n-haplotypes"].as< int >();
         }
 
+        if (vm.count("unique"))
+        {
+            unique = vm["unique"].as< bool >();
+        }
+
+        if (vm.count("max-memory"))
+        {
+            max_memory = vm["max-memory"].as< int64_t >();
+        }
     }
     catch (po::error & e)
     {
@@ -284,19 +299,25 @@ int main(int argc, char* argv[]) {
 
         if(out_fasta != "")
         {
-            std::vector<Haplotype> haps;
             std::ofstream fout(out_fasta.c_str());
+            hashutil::DigestSet seen((size_t)std::max((int64_t)0, max_memory) * 1024 * 1024);
 
-            gr.enumeratePaths(chr.c_str(), start, end, nodes, edges, haps, 0, (size_t)-1, max_n_haplotypes);
-
+            // write haplotypes as they are found
             int i = 0;
-            for(auto const & hap : haps)
-            {
-                fout << ">hap_" << i++ << ":" << stringutil::formatPos(chr, start, end)
-                     << ":hb=" << stringutil::formatPos(hap.chr(), hap.start(), hap.end())
-                     << "\n";
-                fout << hap.seq(start, end) << "\n";
-            }
+            gr.enumeratePaths(chr.c_str(), start, end, nodes, edges,
+                [&](Haplotype const & hap, uint64_t)
+                {
+                    const std::string seq = hap.seq(start, end);
+                    if(unique && !seen.insert(hashutil::digest(seq)))
+                    {
+                        return;
+                    }
+                    fout << ">hap_" << i++ << ":" << stringutil::formatPos(chr, start, end)
+                         << ":hb=" << stringutil::formatPos(hap.chr(), hap.start(), hap.end())
+                         << "\n";
+                    fout << seq << "\n";
+                },
+                0, (size_t)-1, max_n_haplotypes);
         }
     }
     catch(std::runtime_error & e)
@@ -44,18 +44,279 @@
 #include "VariantInput.hh"
 
 #include "helpers/StringUtil.hh"
+#include "helpers/OrderedPipeline.hh"
+#include "helpers/ConcatParts.hh"
 
 #include <boost/filesystem.hpp>
 
 #include <string>
 #include <vector>
 #include <fstream>
+#include <map>
+#include <memory>
 #include <set>
 
 #include "Error.hh"
 
 using namespace variant;
 
+namespace
+{
+    struct MergeSettings
+    {
+        std::vector<std::string> files;
+        std::string ref_fasta;
+        std::string regions_bed;
+        std::string targets_bed;
+        bool apply_filters;
+        bool leftshift;
+        bool trimalleles;
+        bool splitalleles;
+        int mergebylocation;
+        bool uniqalleles;
+        bool calls_only;
+        bool homref_split;
+        bool primitives;
+        bool process_formats;
+        int64_t message;
+    };
+
+    /**
+     * Split a regions file by contig, for reading each contig separately.
+     * Seeking with regions would read to the end of the contig, so each
+     * contig gets a regions file that only has its own lines.
+     */
+    std::map<std::string, std::string> splitRegions(std::string const & regions, boost::filesystem::path const & dir)
+    {
+        // htslib uses the file name to tell 0-based bed files from 1-based ones
+        const bool is_bed = stringutil::endsWith(regions, ".bed") || stringutil::endsWith(regions, ".bed.gz");
+        htsFile * fp = hts_open(regions.c_str(), "r");
+        if(!fp)
+        {
+            error("Cannot read regions from %s", regions.c_str());
+        }
+        std::map<std::string, std::string> result;
+        std::map<std::string, std::unique_ptr<std::ofstream> > outputs;
+        kstring_t l;
+        l.l = l.m = 0;
+        l.s = NULL;
+        while(hts_getline(fp, 2, &l) >= 0)
+        {
+            if(l.l == 0 || l.s[0] == '#')
+            {
+                continue;
+            }
+            const char * tab = strchr(l.s, '\t');
+            const std::string chr = tab ? std::string(l.s, tab - l.s) : std::string(l.s);
+            auto it = outputs.find(chr);
+            if(it == outputs.end())
+            {
+                const std::string name = (dir / ("regions." + std::to_string(outputs.size()) +
+                                                 (is_bed ? ".bed" : ".txt"))).string();
+                result[chr] = name;
+                it = outputs.emplace(chr, std::unique_ptr<std::ofstream>(new std::ofstream(name))).first;
+            }
+            *(it->second) << l.s << "\n";
+        }
+        free(l.s);
+        hts_close(fp);
+        return result;
+    }
+
+    bool isBgzfOutput(std::string const & filename)
+    {
+        return stringutil::endsWith(filename, ".vcf.gz") || stringutil::endsWith(filename, ".bcf");
+    }
+
+    /** set regions / targets / filtering and add all input files */
+    void setupReader(VariantReader & r, MergeSettings const & settings, bool verbose)
+    {
+        if(settings.regions_bed != "")
+        {
+            r.setRegions(settings.regions_bed.c_str(), true);
+        }
+        if(settings.targets_bed != "")
+        {
+            r.setTargets(settings.targets_bed.c_str(), true);
+        }
+
+        r.setApplyFilters(settings.apply_filters);
+
+        for(std::string const & f : settings.files)
+        {
+            std::vector<std::string> v;
+            stringutil::split(f, v, ":");
+
+            std::string filename, sample = "";
+
+            // in case someone passes a ":"
+            assert(v.size() > 0);
+
+            filename = v[0];
+
+            if(v.size() > 1)
+            {
+                sample = v[1];
+            }
+            if(verbose)
+            {
+                std::cerr << "Adding file '" << filename << "' / sample '" << sample << "'" << "\n";
+            }
+            r.addSample(filename.c_str(), sample.c_str());
+        }
+    }
+
+    /** add output samples and header */
+    void setupWriters(VariantReader & r, MergeSettings const & settings,
+                      VariantWriter & w, VariantWriter * p_homref_writer, bool verbose)
+    {
+        w.setWriteFormats(settings.process_formats);
+        if (p_homref_writer)
+        {
+            p_homref_writer->setWriteFormats(settings.process_formats);
+        }
+
+        std::list< std::pair<std::string, std::string> > samples;
+        r.getSampleList(samples);
+
+        std::set<std::string> samplenames;
+        for (auto const & p : samples)
+        {
+            std::string sname = p.second;
+            if (sname == "")
+            {
+                sname = boost::filesystem::path(p.first).stem().string();
+            }
+            int i = 1;
+            while (samplenames.count(sname))
+            {
+                if(p.second == "")
+                {
+                    sname = boost::filesystem::path(p.first).stem().string() + "." + std::to_string(i++);
+                }
+                else
+                {
+                    sname = p.second + "." + std::to_string(i++);
+                }
+            }
+            samplenames.insert(sname);
+            if(verbose)
+            {
+                std::cerr << "Writing '" << p.first << ":" << p.second << "' as sample '" << sname << "'" << "\n";
+            }
+            w.addSample(sname.c_str());
+            if (p_homref_writer)
+            {
+                p_homref_writer->addSample(sname.c_str());
+            }
+        }
+
+        w.addHeader(r);
+        if (p_homref_writer)
+        {
+            p_homref_writer->addHeader(r);
+        }
+    }
+
+    /**
+     * Run the processing chain on the records from r and write the result
+     *
+     * @param chr if not empty, stop when reaching a different chromosome
+     * @param end stop after this position
+     * @param rlimit maximum number of records to process
+     */
+    void merge(VariantReader & r, MergeSettings const & settings,
+               VariantWriter & w, VariantWriter * p_homref_writer,
+               std::string const & chr, int64_t end, int64_t rlimit)
+    {
+        VariantInput vi(
+            settings.ref_fasta.c_str(),
+            settings.leftshift,           // bool leftshift
+            true,                         // bool refpadding
+            settings.trimalleles,         // bool trimalleles = false,
+            settings.splitalleles,        // bool splitalleles = false,
+            settings.mergebylocation,     // int mergebylocation = false,
+            settings.uniqalleles,         // bool uniqalleles = false,
+            settings.calls_only,          // bool calls_only = true,
+            settings.homref_split,        // bool homref_split = false
+            settings.primitives,          // bool primitives = false
+            p_homref_writer != NULL       // homref output
+            );
+
+        vi.getProcessor().setReader(r, VariantBufferMode::buffer_block, 100);
+
+        VariantProcessor & proc = vi.getProcessor();
+        VariantProcessor & proc_homref = vi.getProcessor(VariantInput::homref);
+
+        int64_t rcount = 0;
+
+        bool advance1 = proc.advance();
+        bool advance2 = p_homref_writer ? proc_homref.advance() : false;
+
+        while(advance1 || advance2)
+        {
+            if(rlimit != -1)
+            {
+                if(rcount >= rlimit)
+                {
+                    break;
+                }
+            }
+
+            if (advance1)
+            {
+                Variants & v = proc.current();
+                if (chr.size() != 0 && chr != v.chr)
+                {
+                    // chromosome changed and location was given => abort
+                    while(advance2)
+                    {
+                        Variants & v = proc_homref.current();
+                        if(v.chr != chr)
+                        {
+                            break;
+                        }
+                        p_homref_writer->put(v);
+                        advance2 = settings.homref_split ? proc_homref.advance() : false;
+                    }
+                    break;
+                }
+                if(end != -1 && v.pos > end)
+                {
+                    break;
+                }
+                w.put(v);
+                if(settings.message > 0 && (rcount % settings.message) == 0)
+                {
+                    std::cout << stringutil::formatPos(v.chr.c_str(), v.pos) << ": " << v << "\n";
+                }
+            }
+
+            // make sure our homref variant output doesn't fill up all memory
+            while(advance2 && p_homref_writer)
+            {
+                Variants & v = proc_homref.current();
+                if(chr.size() != 0 && chr != v.chr)
+                {
+                    advance2 = false;
+                    break;
+                }
+                p_homref_writer->put(v);
+                advance2 = proc_homref.advance();
+            }
+
+            advance1 = proc.advance();
+            // the homref processor is fed from the main one, it runs empty whenever
+            // it has caught up and gets more blocks as we advance
+            if(p_homref_writer)
+            {
+                advance2 = proc_homref.advance();
+            }
+            ++rcount;
+        }
+    }
+}
+
 int main(int argc, char* argv[]) {
     namespace po = boost::program_options;
     namespace bf = boost::filesystem;
@@ -86,6 +347,7 @@ int main(int argc, char* argv[]) {
     std::string homref_vcf = "";
 
     bool process_formats = false;
+    int threads = 1;
 
     try
     {
@@ -115,6 +377,8 @@ int main(int argc, char* argv[]) {
             ("process-split", po::value<bool>(), "Enables splitalleles, trimalleles, unique-alleles, leftshift.")
             ("process-full", po::value<bool>(), "Enables splitalleles, trimalleles, unique-alleles, leftshift, mergebylocation.")
             ("process-formats", po::value<bool>(), "Process GQ/DP/AD format fields.")
+            ("threads", po::value<int>(), "Number of threads to use (contigs are merged in parallel, "
+                "needs bgzipped VCF or BCF output).")
         ;
 
         po::positional_options_description popts;
@@ -265,6 +529,11 @@ int main(int argc, char* argv[]) {
             process_formats = vm["process-formats"].as< bool >();
         }
 
+        if (vm.count("threads"))
+        {
+            threads = vm["threads"].as< int >();
+        }
+
         if(files.size() == 0)
         {
             std::cerr << "Please specify at least one input file / sample.\n";
@@ -285,159 +554,134 @@ int main(int argc, char* argv[]) {
 
     try
     {
-        VariantReader r;
-        if(regions_bed != "")
-        {
-            r.setRegions(regions_bed.c_str(), true);
-        }
-        if(targets_bed != "")
-        {
-            r.setTargets(targets_bed.c_str(), true);
-        }
-
-        VariantWriter w(output.c_str(), ref_fasta.c_str());
-        std::shared_ptr<VariantWriter> p_homref_writer;
-        if (homref_vcf.size() != 0)
-        {
-            p_homref_writer = std::make_shared<VariantWriter>(homref_vcf.c_str(), ref_fasta.c_str());
-        }
+        MergeSettings settings;
+        settings.files = files;
+        settings.ref_fasta = ref_fasta;
+        settings.regions_bed = regions_bed;
+        settings.targets_bed = targets_bed;
+        settings.apply_filters = apply_filters;
+        settings.leftshift = leftshift;
+        settings.trimalleles = trimalleles;
+        settings.splitalleles = splitalleles;
+        settings.mergebylocation = mergebylocation;
+        settings.uniqalleles = uniqalleles;
+        settings.calls_only = calls_only;
+        settings.homref_split = homref_split;
+        settings.primitives = primitives;
+        settings.process_formats = process_formats;
+        settings.message = message;
 
-        w.setWriteFormats(process_formats);
-        if (p_homref_writer)
-        {
-            p_homref_writer->setWriteFormats(process_formats);
-        }
+        VariantReader r;
+        setupReader(r, settings, true);
 
-        r.setApplyFilters(apply_filters);
+        std::vector<std::string> contigs;
+        r.getContigs(contigs);
 
-        for(std::string const & f : files)
+        const bool bgzf_output = isBgzfOutput(output) && (homref_vcf.empty() || isBgzfOutput(homref_vcf));
+        if(threads > 1 && (!chr.empty() || rlimit != -1 || !bgzf_output || contigs.size() < 2))
         {
-            std::vector<std::string> v;
-            stringutil::split(f, v, ":");
-
-            std::string filename, sample = "";
-
-            // in case someone passes a ":"
-            assert(v.size() > 0);
-
-            filename = v[0];
-
-            if(v.size() > 1)
-            {
-                sample = v[1];
-            }
-            std::cerr << "Adding file '" << filename << "' / sample '" << sample << "'" << "\n";
-            r.addSample(filename.c_str(), sample.c_str());
+            std::cerr << "[W] Using a single thread: parallel merging needs bgzipped VCF / BCF output, "
+                      << "more than one contig and no --location or --limit-records." << "\n";
+            threads = 1;
         }
 
-        std::list< std::pair<std::string, std::string> > samples;
-        r.getSampleList(samples);
-
-        std::set<std::string> samplenames;
-        for (auto const & p : samples)
+        if(threads <= 1)
         {
-            std::string sname = p.second;
-            if (sname == "")
-            {
-                sname = boost::filesystem::path(p.first).stem().string();
-            }
-            int i = 1;
-            while (samplenames.count(sname))
-            {
-                if(p.second == "")
-                {
-                    sname = boost::filesystem::path(p.first).stem().string() + "." + std::to_string(i++);
-                }
-                else
-                {
-                    sname = p.second + "." + std::to_string(i++);
-                }
-            }
-            samplenames.insert(sname);
-            std::cerr << "Writing '" << p.first << ":" << p.second << "' as sample '" << sname << "'" << "\n";
-            w.addSample(sname.c_str());
-            if (p_homref_writer)
+            VariantWriter w(output.c_str(), ref_fasta.c_str());
+            std::unique_ptr<VariantWriter> p_homref_writer;
+            if (homref_vcf.size() != 0)
             {
-                p_homref_writer->addSample(sname.c_str());
+                p_homref_writer.reset(new VariantWriter(homref_vcf.c_str(), ref_fasta.c_str()));
             }
+            setupWriters(r, settings, w, p_homref_writer.get(), true);
+            r.rewind(chr.c_str(), start);
+            merge(r, settings, w, p_homref_writer.get(), chr, end, rlimit);
         }
-
-        w.addHeader(r);
-        if (p_homref_writer)
+        else
         {
-            p_homref_writer->addHeader(r);
-        }
-        r.rewind(chr.c_str(), start);
-
-        VariantInput vi(
-            ref_fasta.c_str(),
-            leftshift,           // bool leftshift
-            true,                // bool refpadding
-            trimalleles,         // bool trimalleles = false,
-            splitalleles,        // bool splitalleles = false,
-            mergebylocation,     // int mergebylocation = false,
-            uniqalleles,         // bool uniqalleles = false,
-            calls_only,          // bool calls_only = true,
-            homref_split,        // bool homref_split = false
-            primitives,          // bool primitives = false
-            (bool)p_homref_writer// homref output
-            );
-
-        vi.getProcessor().setReader(r, VariantBufferMode::buffer_block, 100);
-
-        VariantProcessor & proc = vi.getProcessor();
-        VariantProcessor & proc_homref = vi.getProcessor(VariantInput::homref);
-
-        int64_t rcount = 0;
+            // contigs are merged independently into parts, which are then concatenated
+            // in the order the reader would have returned them
+            const bf::path parts_dir = bf::temp_directory_path() / bf::unique_path("multimerge.%%%%-%%%%-%%%%");
+            bf::create_directories(parts_dir);
+            const std::string suffix = stringutil::endsWith(output, ".bcf") ? ".bcf" : ".vcf.gz";
+            const std::string homref_suffix = stringutil::endsWith(homref_vcf, ".bcf") ? ".bcf" : ".vcf.gz";
 
-        bool advance1 = proc.advance();
-        bool advance2 = p_homref_writer ? proc_homref.advance() : false;
-
-        while(advance1 || advance2)
-        {
-            if(rlimit != -1)
+            std::map<std::string, std::string> contig_regions;
+            if(!regions_bed.empty())
             {
-                if(rcount >= rlimit)
-                {
-                    break;
-                }
+                contig_regions = splitRegions(regions_bed, parts_dir);
             }
 
-            if (advance1)
+            struct Part
             {
-                Variants & v = proc.current();
-                if (chr.size() != 0 && chr != v.chr)
-                {
-                    // chromosome changed and location was given => abort
-                    while(advance2)
+                std::string chr;
+                std::string regions;
+                std::string output;
+                std::string homref_output;
+            };
+
+            std::vector<std::string> outputs, homref_outputs;
+            try
+            {
+                parallel::OrderedPipeline<Part> pipeline(
+                    std::min(threads, (int)contigs.size()), 2 * (size_t)threads,
+                    [&settings](Part & p)
                     {
-                        Variants & v = proc_homref.current();
-                        p_homref_writer->put(v);
-                        advance2 = homref_split ? proc_homref.advance() : false;
-                    }
-                    break;
-                }
-                if(end != -1 && v.pos > end)
+                        VariantReader pr;
+                        MergeSettings part_settings = settings;
+                        if(!p.regions.empty())
+                        {
+                            part_settings.regions_bed = p.regions;
+                        }
+                        setupReader(pr, part_settings, false);
+                        VariantWriter pw(p.output.c_str(), settings.ref_fasta.c_str());
+                        std::unique_ptr<VariantWriter> p_homref_writer;
+                        if(!p.homref_output.empty())
+                        {
+                            p_homref_writer.reset(new VariantWriter(p.homref_output.c_str(),
+                                                                    settings.ref_fasta.c_str()));
+                        }
+                        setupWriters(pr, settings, pw, p_homref_writer.get(), false);
+                        // make sure the part has a header even when there are no records
+                        pw.getHeader();
+                        if(p_homref_writer)
+                        {
+                            p_homref_writer->getHeader();
+                        }
+                        if(p.regions.empty())
+                        {
+                            pr.rewind(p.chr.c_str(), -1);
+                        }
+                        merge(pr, settings, pw, p_homref_writer.get(), p.chr, -1, -1);
+                    },
+                    [&outputs, &homref_outputs](Part & p)
+                    {
+                        outputs.push_back(p.output);
+                        if(!p.homref_output.empty())
+                        {
+                            homref_outputs.push_back(p.homref_output);
+                        }
+                    });
+                for(size_t i = 0; i < contigs.size(); ++i)
                 {
-                    break;
+                    const std::string prefix = (parts_dir / ("part." + std::to_string(i))).string();
+                    pipeline.push(Part{contigs[i], contig_regions[contigs[i]], prefix + suffix,
+                                       homref_vcf.empty() ? std::string() : prefix + ".homref" + homref_suffix});
                 }
-                w.put(v);
-                if(message > 0 && (rcount % message) == 0)
+                pipeline.finish();
+
+                bcfhelpers::concatenateParts(outputs, output, -1);
+                if(!homref_vcf.empty())
                 {
-                    std::cout << stringutil::formatPos(v.chr.c_str(), v.pos) << ": " << v << "\n";
+                    bcfhelpers::concatenateParts(homref_outputs, homref_vcf, -1);
                 }
             }
-
-            // make sure our homref variant output doesn't fill up all memory
-            while(advance2 && p_homref_writer)
+            catch(...)
             {
-                Variants & v = proc_homref.current();
-                p_homref_writer->put(v);
-                advance2 = proc_homref.advance();
+                bf::remove_all(parts_dir);
+                throw;
             }
-
-            advance1 = proc.advance();
-            ++rcount;
+            bf::remove_all(parts_dir);
         }
     }
     catch(std::runtime_error & e)
@@ -91,6 +91,7 @@ int main(int argc, char* argv[]) {
     bool preprocess = false;
     bool leftshift = false;
     bool haploid_X = false;
+    int compression_level = -1;
 
     try
     {
@@ -111,6 +112,8 @@ int main(int argc, char* argv[]) {
             ("limit", po::value<int64_t>(), "Maximum number of records to process.")
             ("preprocess-variants,V", po::value<bool>(), "Apply variant normalisations, trimming, realignment for complex variants (off by default).")
             ("leftshift,L", po::value<bool>(), "Left-shift indel alleles (off by default).")
+            ("compression-level", po::value<int>(), "BGZF compression level for .vcf.gz / .bcf output (0-9, 1 is fastest). "
+                "The default is the htslib default.")
         ;
 
         po::positional_options_description popts;
@@ -175,6 +178,11 @@ int main(int argc, char* argv[]) {
             leftshift = vm["leftshift"].as< bool >();
         }
 
+        if (vm.count("compression-level"))
+        {
+            compression_level = vm["compression-level"].as< int >();
+        }
+
         if (vm.count("haploid-x"))
         {
             haploid_X = vm["haploid-x"].as< bool >();
@@ -284,7 +292,7 @@ int main(int argc, char* argv[]) {
             stop_after_chr_change = true;
         }
 
-        VariantWriter vw(out_vcf.c_str(), ref_fasta.c_str());
+        VariantWriter vw(out_vcf.c_str(), ref_fasta.c_str(), compression_level);
         vw.addHeader(vr);
         vw.setWriteFormats(true);
         std::list< std::pair<std::string, std::string> > files;
@@ -49,17 +49,15 @@
 #include <fstream>
 #include <map>
 #include <memory>
-#include <queue>
-#include <mutex>
-#include <future>
 #include <htslib/synced_bcf_reader.h>
 #include <helpers/BCFHelpers.hh>
 #include <helpers/RocOutput.hh>
+#include <helpers/RocPartials.hh>
 #include <htslib/vcf.h>
 
 #include "Error.hh"
 
-#include "BlockQuantify.hh"
+#include "QuantifyPipeline.hh"
 #include "QuantifyRegions.hh"
 
 using namespace variant;
@@ -69,7 +67,7 @@ int main(int argc, char* argv[]) {
     namespace po = boost::program_options;
     namespace bf = boost::filesystem;
 
-    std::string file;
+    std::vector<std::string> files;
     std::string output_roc;
     std::string output_vcf;
     std::string ref;
@@ -80,6 +78,16 @@ int main(int argc, char* argv[]) {
     std::string roc_filter = "";
     double roc_delta = 0.1;
 
+    // final reports
+    std::string output_summary;
+    std::string summary_filter;
+    double ci_alpha = 0;
+    bool write_counts = true;
+
+    // sharded runs
+    std::string output_partial;
+    bool merge_partials = false;
+
     // limits
     std::string chr;
     int64_t start = -1;
@@ -110,10 +118,17 @@ int main(int argc, char* argv[]) {
             desc.add_options()
                 ("help,h", "produce help message")
                 ("version", "Show version")
-                ("input-file", po::value<std::string>(), "The input file")
+                ("input-file", po::value<std::vector<std::string> >(), "The input file (or partial results files with --merge)")
                 ("output-file,o", po::value<std::string>(), "The output file name (TSV Format).")
                 ("output-vcf,v", po::value<std::string>(), "Annotated VCF file (with bed annotations).")
-                ("output-summary", po::value<std::string>(), "Output a summary table with TP / FP / FN / UNK counts, precision, recall, etc.")
+                ("output-summary", po::value<std::string>(), "Output a summary table with TP / FP / FN / UNK counts, precision, recall, etc. "
+                    "This is a file prefix, the summary, extended and ROC CSV files are written to <prefix>.summary.csv, "
+                    "<prefix>.extended.csv and <prefix>.roc.*.csv.gz")
+                ("summary-filter", po::value<std::string>(), "Only use rows with this filter (e.g. ALL / PASS) for --output-summary.")
+                ("ci-alpha", po::value<double>(), "Confidence level for Jeffrey's CI for recall, precision and fraction of non-assessed calls (0 to disable).")
+                ("write-counts", po::value<bool>(), "Write extended counts with --output-summary (default is 1).")
+                ("write-partial", po::value<std::string>(), "Write binary partial results (counts and ROC observations) which can be combined using --merge.")
+                ("merge", "Merge partial results files given as inputs (in genome order) rather than reading a VCF.")
                 ("output-filter-rocs", po::value<bool>(), "Output ROC levels for filters.")
                 ("roc-filter", po::value<std::string>(), "Ignore certain filters when creating a ROC.")
                 ("roc-delta", po::value<double>(), "Minium spacing of levels on ROC QQ trace.")
@@ -168,7 +183,17 @@ int main(int argc, char* argv[]) {
 
             if (vm.count("input-file"))
             {
-                file = vm["input-file"].as< std::string >();
+                files = vm["input-file"].as< std::vector<std::string> >();
+            }
+
+            if (vm.count("merge"))
+            {
+                merge_partials = true;
+            }
+
+            if (vm.count("write-partial"))
+            {
+                output_partial = vm["write-partial"].as< std::string >();
             }
 
             if (vm.count("output-file"))
@@ -214,6 +239,11 @@ int main(int argc, char* argv[]) {
             {
                 qq_header = vm["qq-header"].as< std::string >();
             }
+            else if (vm.count("merge"))
+            {
+                // taken from the partial results files
+                qq_header = "";
+            }
             else
             {
                 qq_header = qq;
@@ -279,19 +309,31 @@ int main(int argc, char* argv[]) {
                 blocksize = vm["blocksize"].as< int >();
             }
 
-            if(file.size() == 0)
+            if(merge_partials)
+            {
+                if(files.empty())
+                {
+                    std::cerr << "Please specify partial results files to merge.\n";
+                    return 1;
+                }
+                if(vm.count("regions"))
+                {
+                    std::cerr << "[W] region sizes are taken from the partial results files when merging, ignoring -R.\n";
+                }
+            }
+            else if(files.size() != 1)
             {
                 std::cerr << "Please specify one input file / sample.\n";
                 return 1;
             }
 
-            if (output_roc == "")
+            if (output_roc == "" && (merge_partials || output_partial == ""))
             {
                 std::cerr << "Please specify an output file.\n";
                 return 1;
             }
 
-            if (vm.count("regions"))
+            if (vm.count("regions") && !merge_partials)
             {
                 std::vector<std::string> rnames = vm["regions"].as< std::vector<std::string> >();
                 regions.load(rnames, fixchr);
@@ -301,6 +343,32 @@ int main(int argc, char* argv[]) {
             {
                 roc_regions = vm["roc-regions"].as< std::vector<std::string> >();
             }
+
+            if (vm.count("output-summary"))
+            {
+                output_summary = vm["output-summary"].as< std::string >();
+                // summaries are written from the ROC output, partials alone won't produce one
+                if(output_roc.empty())
+                {
+                    std::cerr << "--output-summary needs an output file (-o), use --merge on the partial results to write a summary.\n";
+                    return 1;
+                }
+            }
+
+            if (vm.count("summary-filter"))
+            {
+                summary_filter = vm["summary-filter"].as< std::string >();
+            }
+
+            if (vm.count("ci-alpha"))
+            {
+                ci_alpha = vm["ci-alpha"].as< double >();
+            }
+
+            if (vm.count("write-counts"))
+            {
+                write_counts = vm["write-counts"].as< bool >();
+            }
         }
         catch (po::error & e)
         {
@@ -308,6 +376,25 @@ int main(int argc, char* argv[]) {
             return 1;
         }
 
+        if(merge_partials)
+        {
+            roc::RocMap rocs;
+            for(auto const & f : files)
+            {
+                roc::mergePartial(f, qq_header, rocs, regions);
+            }
+            std::ofstream out_roc(output_roc);
+            roc::ROCOutput ro(rocs, qq_header, output_rocs, roc_delta, regions, roc_regions);
+            ro.write(out_roc);
+            out_roc.close();
+            if(!output_summary.empty())
+            {
+                ro.writeReports(output_summary, summary_filter, ci_alpha, write_counts);
+            }
+            return 0;
+        }
+
+        const std::string & file = files.front();
         FastaFile ref_fasta(ref.c_str());
         bcf_srs_t * reader = bcf_sr_init();
         reader->require_index = 1;
@@ -368,64 +455,30 @@ int main(int argc, char* argv[]) {
         }
         qparams += "extended_counts;";
 
-        std::unique_ptr<BlockQuantify> p_bq(std::move(makeQuantifier(hdr, ref_fasta, qtype, qparams)));
-        p_bq->rocFiltering(roc_filter);
-
-        // update the header
-        p_bq->updateHeader(hdr);
-
-        htsFile * writer = nullptr;
+        /** records are annotated and counted in blocks on a fixed pool of threads,
+         *  and then written in order */
+        QuantifyPipeline pipeline(hdr, ref_fasta, regions, qtype, qparams, roc_filter, threads, blocksize);
 
         if (output_vcf != "")
         {
-
-            const char * mode = "wu";
-
-            if(stringutil::endsWith(output_vcf, ".vcf.gz"))
-            {
-                mode = "wz";
-            }
-            else if(stringutil::endsWith(output_vcf, ".bcf"))
-            {
-                mode = "wb";
-            }
-
-            if(!output_vcf.empty() && output_vcf[0] == '-')
-            {
-                writer = hts_open("-", mode);
-            }
-            else
-            {
-                writer = hts_open(output_vcf.c_str(), mode);
-            }
-            bcf_hdr_write(writer, hdr);
+            pipeline.setOutputVCF(output_vcf);
         }
 
         /** local function to count variants in all samples */
         int64_t rcount = 0;
         std::string current_chr = "";
-        int vars_in_block = 0;
-        /** async stuff. each block can be counted in parallel, but we need to
-         *  write out the variants sequentially.
-         *  Therefore, we keep a future for each block to be able to join
-         *  when it's processed
-         */
-        std::queue<std::pair <
-            std::future<void>,
-            std::unique_ptr<BlockQuantify>
-        >> blocks;
-
 
         int truth_sample_id = -1;
         int query_sample_id = -1;
 
         if(bcf_hdr_nsamples(hdr) < 2)
         {
-            if(!output_roc.empty())
+            if(!output_roc.empty() || !output_partial.empty())
             {
                 std::cerr << "[W] not enough samples in input file. Switching off ROC table calculation" << "\n";
             }
             output_roc = "";
+            output_partial = "";
         }
         else
         {
@@ -442,60 +495,18 @@ int main(int argc, char* argv[]) {
             }
             if(truth_sample_id < 0 || query_sample_id < 0)
             {
-                if(!output_roc.empty())
+                if(!output_roc.empty() || !output_partial.empty())
                 {
                     std::cerr << "[W] Input VCF does not have TRUTH and QUERY samples. Switching off ROC table calculation" << "\n";
                 }
                 output_roc = "";
+                output_partial = "";
             }
         }
 
-        std::unique_ptr<std::map<std::string, roc::Roc> > roc_map;
-        if(!output_roc.empty())
-        {
-            roc_map.reset(new std::map<std::string, roc::Roc>());
-        }
-
-        /** this is where things actually get written to files */
-        auto output_counts = [&writer, &roc_map, &blocks, hdr, truth_sample_id, query_sample_id](int min_size) {
-            while(blocks.size() > (unsigned )min_size)
-            {
-                // make sure we have run this block
-                blocks.front().first.get();
-
-                // output variants
-                if(writer)
-                {
-                    auto const & variants = blocks.front().second->getVariants();
-                    for(auto & v : variants)
-                    {
-                        bcf_write1(writer, hdr, v);
-                    }
-                }
-
-                // update ROC data
-                if(roc_map)
-                {
-                    auto const & rm = blocks.front().second->getRocs();
-                    for(auto const & r : rm)
-                    {
-                        auto it = roc_map->find(r.first);
-                        if (it == roc_map->end()) {
-                            roc_map->insert(r);
-                        }
-                        else
-                        {
-                            it->second.add(r.second);
-                        }
-                    }
-                }
-
-                blocks.pop();
-            }
-        };
+        pipeline.setComputeRocs(!output_roc.empty() || !output_partial.empty());
 
         int nl = 1;
-        int previous_bs = -1;
         while(nl)
         {
             nl = bcf_sr_next_line(reader);
@@ -522,12 +533,6 @@ int main(int argc, char* argv[]) {
                 break;
             }
 
-            if(vchr != current_chr)
-            {
-                // reset bs on chr switch
-                previous_bs = -1;
-            }
-
             if(apply_filters)
             {
                 bcf_unpack(line, BCF_UN_FLT);
@@ -556,29 +561,9 @@ int main(int argc, char* argv[]) {
                 }
             }
 
-            bcf_unpack(line, BCF_UN_INFO);
-            regions.annotate(hdr, line);
-
             current_chr = vchr;
 
-            const int current_bs = bcfhelpers::getInfoInt(hdr, line, "BS");
-
-            // don't break benchmarking superloci across threads
-            if(vars_in_block > blocksize && (current_bs < 0 || previous_bs < 0 || (current_bs != previous_bs)))
-            {
-                std::future<void> f = std::async(std::launch::async, &BlockQuantify::count, p_bq.get());
-                // clear / write out some blocks (make sure we have at least 2xthreads tasks left)
-                output_counts(threads);
-                blocks.emplace(std::move(f), std::move(p_bq));
-                p_bq = std::move(makeQuantifier(hdr, ref_fasta, qtype, qparams));
-                p_bq->rocFiltering(roc_filter);
-                vars_in_block = 0;
-
-            }
-
-            p_bq->add(bcf_dup(line));
-            ++vars_in_block;
-            previous_bs = current_bs;
+            pipeline.add(line);
 
             if (message > 0 && (rcount % message) == 0)
             {
@@ -588,26 +573,26 @@ int main(int argc, char* argv[]) {
             ++rcount;
         }
 
-        {
-            std::future<void> f = std::async(&BlockQuantify::count, p_bq.get());
-            // clear / write out some blocks (make sure we have at least 2xthreads tasks left)
-            blocks.emplace(std::move(f), std::move(p_bq));
-        }
-        // clear remaining
-        output_counts(0);
+        // count and write remaining blocks
+        pipeline.finish();
+        bcf_sr_destroy(reader);
 
-        if(writer)
+        // write partial results before ROCOutput sorts the observations
+        if(!output_partial.empty())
         {
-            hts_close(writer);
+            roc::writePartial(output_partial, qq_header, pipeline.getRocs(), regions);
         }
-        bcf_sr_destroy(reader);
 
-        if(roc_map)
+        if(!output_roc.empty())
         {
             std::ofstream out_roc(output_roc);
-            roc::ROCOutput ro(*roc_map, qq_header, output_rocs, roc_delta, regions, roc_regions);
+            roc::ROCOutput ro(pipeline.getRocs(), qq_header, output_rocs, roc_delta, regions, roc_regions);
             ro.write(out_roc);
             out_roc.close();
+            if(!output_summary.empty())
+            {
+                ro.writeReports(output_summary, summary_filter, ci_alpha, write_counts);
+            }
         }
     }
     catch(std::runtime_error & e)
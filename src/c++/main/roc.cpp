@@ -38,7 +38,10 @@
 
 #include "Version.hh"
 #include "helpers/StringUtil.hh"
+#include "helpers/LineReader.hh"
 
+#include <algorithm>
+#include <cctype>
 #include <iostream>
 #include <limits>
 #include <string>
@@ -47,7 +50,7 @@
 #include <cstdlib>
 #include <map>
 #include <set>
-#include <boost/algorithm/string.hpp>
+#include <stdexcept>
 
 #include "Error.hh"
 
@@ -279,165 +282,154 @@ int main(int argc, char* argv[]) {
     std::map<std::string, int> filter_stats_fp;
     std::map<std::string, int> filter_stats_fn;
 
-    for (auto i : files) {
-        std::istream * in = NULL;
-        bool deleteme = false;
-        if(i == "-") {
-            in = &std::cin;
-        } else {
-            in = new std::ifstream(i.c_str());
-            deleteme = true;
-        }
+    // filters which don't count when checking if a record was filtered
+    std::vector<std::string> filters_to_remove;
+    stringutil::split(filter_name, filters_to_remove, ";,");
+    const bool remove_all_filters = std::find(filters_to_remove.begin(), filters_to_remove.end(), "*")
+                                    != filters_to_remove.end();
 
-        // read input data
-        int min_columns = std::max(value_column, tag_column);
-        min_columns = std::max(filter_column, min_columns);
+    std::vector<textio::Field> v;
+    std::vector<textio::Field> filters;
+    std::string value_str;
+    try
+    {
+        for (auto const & i : files) {
+            textio::LineReader in(i);
 
-        int hc = header_lines;
-        while(in->good()) {
-            std::string line;
-            std::getline(*in, line);
-            std::vector<std::string> v;
-            stringutil::split(line, v, sep, true);
+            // read input data
+            int min_columns = std::max(value_column, tag_column);
+            min_columns = std::max(filter_column, min_columns);
 
-            if(hc > 0) {
-                if (!value.empty() || !tag.empty() || !filter.empty())
+            int hc = header_lines;
+            textio::Field line;
+            while(in.next(line)) {
+                if(line.len > 0 && line.s[line.len-1] == '\r')
                 {
-                    for (size_t i = 0; i < v.size(); ++i)
+                    --line.len;
+                }
+                textio::splitFields(line.s, line.len, sep, v);
+
+                if(hc > 0) {
+                    if (!value.empty() || !tag.empty() || !filter.empty())
                     {
-                        v[i] = stringutil::replaceAll(v[i], "\r", "");
-                        if(!v[i].empty() && v[i] == value) {
-                            value_column = i;
-                        }
-                        if(!v[i].empty() && v[i] == tag) {
-                            tag_column = i;
-                        }
-                        if(!v[i].empty() && v[i] == filter) {
-                            filter_column = i;
+                        for (size_t i = 0; i < v.size(); ++i)
+                        {
+                            const std::string name = stringutil::replaceAll(v[i].str(), "\r", "");
+                            if(!name.empty() && name == value) {
+                                value_column = i;
+                            }
+                            if(!name.empty() && name == tag) {
+                                tag_column = i;
+                            }
+                            if(!name.empty() && name == filter) {
+                                filter_column = i;
+                            }
                         }
                     }
+                    min_columns = std::max(value_column, tag_column);
+                    min_columns = std::max(filter_column, min_columns);
+                    --hc;
+                    continue;
                 }
-                min_columns = std::max(value_column, tag_column);
-                min_columns = std::max(filter_column, min_columns);
-                --hc;
-                continue;
-            }
 
-            if(((int)v.size()) < min_columns + 1) {
-                ++total_ignored;
-                continue;
-            }
+                if(((int)v.size()) < min_columns + 1) {
+                    ++total_ignored;
+                    continue;
+                }
 
-            std::string & ltag = v[tag_column];
-            boost::algorithm::to_lower(ltag);
+                // tags are matched case-insensitively on their first two characters
+                textio::Field const & ltag = v[tag_column];
+                const char t0 = ltag.len > 0 ? (char)tolower(ltag.s[0]) : 0;
+                const char t1 = ltag.len > 1 ? (char)tolower(ltag.s[1]) : 0;
 
-            // true if filtered by other filter than the one we're looking at. These go to the beginning.
-            bool filtered_other = false;
+                // true if filtered by other filter than the one we're looking at. These go to the beginning.
+                bool filtered_other = false;
 
-            if (filter_column >= 0)
-            {
-                std::vector<std::string> filters;
-                std::string fcol = v[filter_column];
-                if(fcol == "." || fcol == "PASS") {
-                    fcol = "";
-                }
-                stringutil::split(fcol, filters, ";,");
-                for (auto f : filters)
+                if (filter_column >= 0)
                 {
-                    auto q = filter_stats.find(f);
-                    if(q != filter_stats.end()) {
-                        q->second++;
-                    } else {
-                        filter_stats[f] = 1;
+                    textio::Field const & fcol = v[filter_column];
+                    filters.clear();
+                    if(!(fcol == ".") && !(fcol == "PASS"))
+                    {
+                        textio::splitFields(fcol.s, fcol.len, ";,", filters);
                     }
-                    if (ltag == "tp")
+                    for (auto const & f : filters)
                     {
-                        auto q = filter_stats_tp.find(f);
-                        if(q != filter_stats_tp.end()) {
-                            q->second++;
-                        } else {
-                            filter_stats_tp[f] = 1;
-                        }
-                    } else if (ltag == "fp") {
-                        auto q = filter_stats_fp.find(f);
-                        if(q != filter_stats_fp.end()) {
-                            q->second++;
-                        } else {
-                            filter_stats_fp[f] = 1;
+                        if(f.len == 0)
+                        {
+                            continue;
                         }
-                    } else if (ltag == "fn") {
-                        auto q = filter_stats_fn.find(f);
-                        if(q != filter_stats_fn.end()) {
-                            q->second++;
-                        } else {
-                            filter_stats_fn[f] = 1;
+                        if(verbose)
+                        {
+                            const std::string fname = f.str();
+                            filter_stats[fname]++;
+                            if (ltag.len == 2)
+                            {
+                                if(t0 == 't' && t1 == 'p') {
+                                    filter_stats_tp[fname]++;
+                                } else if(t0 == 'f' && t1 == 'p') {
+                                    filter_stats_fp[fname]++;
+                                } else if(t0 == 'f' && t1 == 'n') {
+                                    filter_stats_fn[fname]++;
+                                }
+                            }
                         }
-                    }
-                }
 
-                if(!filter_name.empty())
-                {
-                    auto it = filters.begin();
-                    std::vector<std::string> _filters_to_remove;
-                    stringutil::split(filter_name, _filters_to_remove, ";,");
-                    std::set<std::string> filters_to_remove;
-                    for (auto f : _filters_to_remove) {
-                        filters_to_remove.insert(f);
-                        if(f == "*")
+                        if(!remove_all_filters && !filtered_other)
                         {
-                            filters.clear();
-                            break;
+                            filtered_other = true;
+                            for (auto const & r : filters_to_remove)
+                            {
+                                if(f == r.c_str())
+                                {
+                                    filtered_other = false;
+                                    break;
+                                }
+                            }
                         }
                     }
-                    while(it != filters.end())
+                    if (filtered_other)
                     {
-                        if(filters_to_remove.count(*it) > 0) {
-                            filters.erase(it);
-                            it = filters.begin();
-                        } else {
-                            ++it;
-                        }
+                        ++total_filtered;
                     }
                 }
-                if (!filters.empty())
-                {
-                    ++total_filtered;
-                    filtered_other = true;
-                }
-            }
 
-            tag_t ttag = tag_t::fn;
-
-            if(ltag.substr(0, 2) == "tp") {
-                ttag = tag_t::tp;
-                ++total_tp;
-            } else if(ltag.substr(0, 2) == "fp") {
-                ttag = tag_t::fp;
-                ++total_fp;
-            } else if(ltag.substr(0, 2) == "fn") {
-                ttag = tag_t::fn;
-                ++total_fn;
-            } else {
-                ++total_ignored;
-                continue;
-            }
+                tag_t ttag = tag_t::fn;
+
+                if(t0 == 't' && t1 == 'p') {
+                    ttag = tag_t::tp;
+                    ++total_tp;
+                } else if(t0 == 'f' && t1 == 'p') {
+                    ttag = tag_t::fp;
+                    ++total_fp;
+                } else if(t0 == 'f' && t1 == 'n') {
+                    ttag = tag_t::fn;
+                    ++total_fn;
+                } else {
+                    ++total_ignored;
+                    continue;
+                }
 
-            double xvalue = atof(v[value_column].c_str());
-            if(v[value_column] == "")
-            {
-                xvalue = 0;
-            }
-            if (filtered_other)
-            {
-                xvalue = std::numeric_limits<double>::min();
+                double xvalue = 0;
+                if (filtered_other)
+                {
+                    xvalue = std::numeric_limits<double>::min();
+                }
+                else if(v[value_column].len > 0)
+                {
+                    // fields aren't zero-terminated
+                    value_str.assign(v[value_column].s, v[value_column].len);
+                    xvalue = atof(value_str.c_str());
+                }
+                data.add(xvalue, ttag);
             }
-            data.add(xvalue, ttag);
-        }
-        if (deleteme)
-        {
-            delete in;
         }
     }
+    catch(std::runtime_error & e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
     if(verbose) {
         std::cerr << "tp: " << total_tp << " fp: " << total_fp << " fn: " << total_fn
                   << " filtered: " << total_filtered << " ignored: " << total_ignored << "\n";
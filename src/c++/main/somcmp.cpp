@@ -0,0 +1,658 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/**
+ * \brief Somatic comparison: allele matching, FP / ambiguous region classification and counting
+ *
+ * \details Reads a normalized truth and query VCF in one synced pass. Records are matched
+ *          like bcftools isec (same position and alleles), unmatched query records are
+ *          classified using FP and ambiguous region bed files, and every category is
+ *          counted like bcftools stats counts records.
+ *
+ * \file somcmp.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#include <boost/program_options.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include "Version.hh"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <set>
+#include <memory>
+
+#include <htslib/synced_bcf_reader.h>
+#include <htslib/tbx.h>
+#include <helpers/StringUtil.hh>
+
+// error needs to come after boost headers.
+#include "Error.hh"
+
+#include "json/json.h"
+
+namespace
+{
+    /** bed interval, 1-based and half-open like in Tools.bedintervaltree */
+    struct BedInterval
+    {
+        int64_t start;
+        int64_t end;
+        int64_t max_end;    // maximum end of this and all previous intervals on the chromosome
+        std::vector<std::string> value;  // label, followed by the extra bed columns
+    };
+
+    /** FP / ambiguous regions by chromosome */
+    class BedRegions
+    {
+    public:
+        /**
+         * Add all intervals from a bed file
+         * @param filename bed file name
+         * @param label_column column to get the label from, or -1 to use fixed_label
+         * @param fixed_label label when label_column < 0
+         * @param fixchr prefix chromosome names with "chr"
+         */
+        void add(std::string const & filename, int label_column, std::string const & fixed_label, bool fixchr)
+        {
+            htsFile * bedfile = hts_open(filename.c_str(), stringutil::endsWith(filename, ".gz") ? "rz" : "r");
+            if(!bedfile)
+            {
+                error("Cannot open bed file %s", filename.c_str());
+            }
+
+            kstring_t l;
+            l.l = l.m = 0;
+            l.s = NULL;
+            std::vector<std::string> v;
+            while (hts_getline(bedfile, 2, &l) >= 0)
+            {
+                // like som.py, also split comma and semicolon - separated values
+                std::string line(l.s);
+                std::replace(line.begin(), line.end(), ';', '\t');
+                std::replace(line.begin(), line.end(), ',', '\t');
+                const size_t first = line.find_first_not_of(" \t\r\n");
+                if(first == std::string::npos)
+                {
+                    continue;
+                }
+                line = line.substr(first, line.find_last_not_of(" \t\r\n") - first + 1);
+
+                v.clear();
+                size_t pos = 0;
+                while(true)
+                {
+                    const size_t next = line.find('\t', pos);
+                    v.push_back(line.substr(pos, next == std::string::npos ? std::string::npos : next - pos));
+                    if(next == std::string::npos)
+                    {
+                        break;
+                    }
+                    pos = next + 1;
+                }
+
+                if(v.size() < 3 || v[0] == "track" || v[0] == "browser" || v[0][0] == '#')
+                {
+                    continue;
+                }
+
+                BedInterval iv;
+                try
+                {
+                    iv.start = std::stoll(v[1]) + 1;
+                    iv.end = std::stoll(v[2]) + 1;
+                }
+                catch(std::logic_error const &)
+                {
+                    std::cerr << "[W] ignoring invalid interval in " << filename << " : " << l.s << "\n";
+                    continue;
+                }
+
+                std::string label = fixed_label;
+                if(label_column >= 0)
+                {
+                    if((int)v.size() <= label_column)
+                    {
+                        error("Missing label column %i in %s : %s", label_column + 1, filename.c_str(), l.s);
+                    }
+                    label = v[label_column];
+                }
+
+                std::string chr = v[0];
+                if(fixchr)
+                {
+                    boost::algorithm::replace_all(chr, "chr", "");
+                    chr = "chr" + chr;
+                }
+
+                iv.value.push_back(label);
+                iv.value.insert(iv.value.end(), v.begin() + 3, v.end());
+                bases_by_label[label] += iv.end - iv.start;
+                bases_by_label_and_chr[label][chr] += iv.end - iv.start;
+                intervals[chr].push_back(iv);
+            }
+            free(l.s);
+            hts_close(bedfile);
+        }
+
+        /** sort intervals for overlap queries, call after all files have been added */
+        void finalize()
+        {
+            for(auto & c : intervals)
+            {
+                std::stable_sort(c.second.begin(), c.second.end(),
+                                 [](BedInterval const & a, BedInterval const & b) -> bool
+                                 {
+                                     return a.start < b.start;
+                                 });
+                int64_t max_end = std::numeric_limits<int64_t>::min();
+                for(auto & iv : c.second)
+                {
+                    max_end = std::max(max_end, iv.end);
+                    iv.max_end = max_end;
+                }
+            }
+        }
+
+        /** get all intervals overlapping chr:[start, end) */
+        void intersect(std::string const & chr, int64_t start, int64_t end,
+                       std::vector<BedInterval const *> & result) const
+        {
+            result.clear();
+            auto c = intervals.find(chr);
+            if(c == intervals.end())
+            {
+                return;
+            }
+            auto it = std::lower_bound(c->second.begin(), c->second.end(), end,
+                                       [](BedInterval const & iv, int64_t x) -> bool
+                                       {
+                                           return iv.start < x;
+                                       });
+            while(it != c->second.begin())
+            {
+                --it;
+                if(it->max_end <= start)
+                {
+                    break;
+                }
+                if(it->end > start)
+                {
+                    result.push_back(&(*it));
+                }
+            }
+        }
+
+        std::map<std::string, int64_t> bases_by_label;
+        std::map<std::string, std::map<std::string, int64_t> > bases_by_label_and_chr;
+    private:
+        std::map<std::string, std::vector<BedInterval> > intervals;
+    };
+
+    /** the numbers bcftools stats reports in its SN section */
+    struct Counts
+    {
+        int samples = 0;
+        int records = 0;
+        int noalts = 0;
+        int snps = 0;
+        int mnps = 0;
+        int indels = 0;
+        int others = 0;
+        int mals = 0;
+        int snp_mals = 0;
+
+        void add(bcf1_t * line)
+        {
+            bcf_unpack(line, BCF_UN_STR);
+            const int line_type = bcf_get_variant_types(line);
+            ++records;
+            if(line_type == VCF_REF)
+            {
+                ++noalts;
+            }
+            if(line_type & VCF_SNP)
+            {
+                ++snps;
+            }
+            if(line_type & VCF_INDEL)
+            {
+                ++indels;
+            }
+            if(line_type & VCF_MNP)
+            {
+                ++mnps;
+            }
+            if(line_type & VCF_OTHER)
+            {
+                ++others;
+            }
+            if(line->n_allele > 2)
+            {
+                ++mals;
+                if(line_type == VCF_SNP)
+                {
+                    ++snp_mals;
+                }
+            }
+        }
+
+        Json::Value toJson() const
+        {
+            Json::Value v;
+            v["samples"] = samples;
+            v["records"] = records;
+            v["no-ALTs"] = noalts;
+            v["SNPs"] = snps;
+            v["MNPs"] = mnps;
+            v["indels"] = indels;
+            v["others"] = others;
+            v["multiallelic sites"] = mals;
+            v["multiallelic SNP sites"] = snp_mals;
+            return v;
+        }
+    };
+
+    /** bgzipped VCF output which is tabix-indexed when closed */
+    class VcfOutput
+    {
+    public:
+        VcfOutput(std::string const & _filename, bcf_hdr_t * _hdr) : filename(_filename), hdr(_hdr)
+        {
+            fp = hts_open(filename.c_str(), "wz");
+            if(!fp)
+            {
+                error("Cannot write %s", filename.c_str());
+            }
+            bcf_hdr_write(fp, hdr);
+        }
+
+        ~VcfOutput()
+        {
+            if(fp)
+            {
+                hts_close(fp);
+            }
+        }
+
+        void write(bcf1_t * line)
+        {
+            if(bcf_write1(fp, hdr, line) < 0)
+            {
+                error("Failed to write to %s", filename.c_str());
+            }
+        }
+
+        void close()
+        {
+            hts_close(fp);
+            fp = NULL;
+            if(tbx_index_build(filename.c_str(), 0, &tbx_conf_vcf) < 0)
+            {
+                error("Cannot index %s", filename.c_str());
+            }
+        }
+    private:
+        std::string filename;
+        bcf_hdr_t * hdr;
+        htsFile * fp;
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    namespace po = boost::program_options;
+
+    std::vector<std::string> files;
+    std::string output_file;
+    std::string output_vcfs;
+    std::string fp_regions;
+    std::vector<std::string> ambi_regions;
+    bool ambi_fp = false;
+    bool count_unk = false;
+    bool fixchr = false;
+
+    try
+    {
+        try
+        {
+            // Declare the supported options.
+            po::options_description desc("Allowed options");
+            desc.add_options()
+                ("help,h", "produce help message")
+                ("version", "Show version")
+                ("input-file", po::value<std::vector<std::string> >(), "The normalized truth and query VCF files (indexed).")
+                ("output-file,o", po::value<std::string>(), "The output JSON file with counts (default: stdout).")
+                ("output-vcfs", po::value<std::string>(), "Write the records in each category to VCFs in this directory: "
+                    "tpfn/0000.vcf.gz (FN), tpfn/0002.vcf.gz (TP, truth records), tpfn/0003.vcf.gz (TP, query records), "
+                    "fp.vcf.gz, ambi.vcf.gz, unk.vcf.gz.")
+                ("fp-regions,f", po::value<std::string>(), "Bed file with regions in which unmatched query calls are FPs.")
+                ("ambiguous-regions,a", po::value<std::vector<std::string> >(), "Bed file(s) with ambiguous regions, "
+                    "labelled in column 5.")
+                ("ambi-fp", po::value<bool>(), "Count unmatched calls in ambiguous regions labelled \"fp\" as FPs.")
+                ("count-unk", po::value<bool>(), "Count unmatched calls outside FP / ambiguous regions as unknown "
+                    "instead of as FPs.")
+                ("fixchr", po::value<bool>(), "Add chr prefix to the chromosome names in the bed files.")
+            ;
+
+            po::positional_options_description popts;
+            popts.add("input-file", -1);
+
+            po::options_description cmdline_options;
+            cmdline_options
+                .add(desc)
+            ;
+
+            po::variables_map vm;
+
+            po::store(po::command_line_parser(argc, argv).
+                      options(cmdline_options).positional(popts).run(), vm);
+            po::notify(vm);
+
+            if (vm.count("version"))
+            {
+                std::cout << "somcmp version " << HAPLOTYPES_VERSION << "\n";
+                return 0;
+            }
+
+            if (vm.count("help"))
+            {
+                std::cout << desc << "\n";
+                return 1;
+            }
+
+            if (vm.count("input-file"))
+            {
+                files = vm["input-file"].as< std::vector<std::string> >();
+            }
+
+            if (vm.count("output-file"))
+            {
+                output_file = vm["output-file"].as< std::string >();
+            }
+
+            if (vm.count("output-vcfs"))
+            {
+                output_vcfs = vm["output-vcfs"].as< std::string >();
+            }
+
+            if (vm.count("fp-regions"))
+            {
+                fp_regions = vm["fp-regions"].as< std::string >();
+            }
+
+            if (vm.count("ambiguous-regions"))
+            {
+                ambi_regions = vm["ambiguous-regions"].as< std::vector<std::string> >();
+            }
+
+            if (vm.count("ambi-fp"))
+            {
+                ambi_fp = vm["ambi-fp"].as< bool >();
+            }
+
+            if (vm.count("count-unk"))
+            {
+                count_unk = vm["count-unk"].as< bool >();
+            }
+
+            if (vm.count("fixchr"))
+            {
+                fixchr = vm["fixchr"].as< bool >();
+            }
+
+            if(files.size() != 2)
+            {
+                std::cerr << "Please specify a truth and a query file.\n";
+                return 1;
+            }
+        }
+        catch (po::error & e)
+        {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+
+        BedRegions regions;
+        for(auto const & f : ambi_regions)
+        {
+            // new ambi files have the label in column 5, old ones will look weird here.
+            regions.add(f, 4, "", fixchr);
+        }
+        if(!fp_regions.empty())
+        {
+            regions.add(fp_regions, -1, "FP", fixchr);
+        }
+        regions.finalize();
+
+        // pair records like bcftools isec does
+        bcf_srs_t * reader = bcf_sr_init();
+        reader->require_index = 1;
+        reader->collapse = COLLAPSE_NONE;
+
+        for(auto const & f : files)
+        {
+            if (!bcf_sr_add_reader(reader, f.c_str()))
+            {
+                error("Failed to open or file not indexed: %s\n", f.c_str());
+            }
+        }
+
+        bcf_hdr_t * truth_hdr = bcf_sr_get_header(reader, 0);
+        bcf_hdr_t * query_hdr = bcf_sr_get_header(reader, 1);
+
+        enum { TOTAL_TRUTH, TOTAL_QUERY, TP, FN, FP, AMBI, UNK, N_CATEGORIES };
+        static const char * category_names[] = {"total.truth", "total.query", "tp", "fn", "fp", "ambi", "unk"};
+        Counts counts[N_CATEGORIES];
+        counts[TOTAL_TRUTH].samples = counts[TP].samples = counts[FN].samples = bcf_hdr_nsamples(truth_hdr);
+        counts[TOTAL_QUERY].samples = counts[FP].samples = counts[AMBI].samples = counts[UNK].samples =
+            bcf_hdr_nsamples(query_hdr);
+
+        std::unique_ptr<VcfOutput> fn_out, tp_out, tp_query_out, fp_out, ambi_out, unk_out;
+        if(!output_vcfs.empty())
+        {
+            const boost::filesystem::path dir(output_vcfs);
+            boost::filesystem::create_directories(dir / "tpfn");
+            fn_out.reset(new VcfOutput((dir / "tpfn" / "0000.vcf.gz").string(), truth_hdr));
+            tp_out.reset(new VcfOutput((dir / "tpfn" / "0002.vcf.gz").string(), truth_hdr));
+            tp_query_out.reset(new VcfOutput((dir / "tpfn" / "0003.vcf.gz").string(), query_hdr));
+            fp_out.reset(new VcfOutput((dir / "fp.vcf.gz").string(), query_hdr));
+            ambi_out.reset(new VcfOutput((dir / "ambi.vcf.gz").string(), query_hdr));
+            unk_out.reset(new VcfOutput((dir / "unk.vcf.gz").string(), query_hdr));
+        }
+
+        std::map<std::string, int> ambi_classes;
+        std::map<std::string, int> ambi_reasons;
+        std::vector<BedInterval const *> overlap;
+        std::set<std::string> classes_this_pos;
+
+        while(bcf_sr_next_line(reader))
+        {
+            bcf1_t * truth = bcf_sr_get_line(reader, 0);
+            bcf1_t * query = bcf_sr_get_line(reader, 1);
+
+            if(truth)
+            {
+                counts[TOTAL_TRUTH].add(truth);
+            }
+            if(query)
+            {
+                counts[TOTAL_QUERY].add(query);
+            }
+
+            if(truth && query)
+            {
+                counts[TP].add(truth);
+                if(tp_out)
+                {
+                    tp_out->write(truth);
+                    tp_query_out->write(query);
+                }
+                continue;
+            }
+            if(truth)
+            {
+                counts[FN].add(truth);
+                if(fn_out)
+                {
+                    fn_out->write(truth);
+                }
+                continue;
+            }
+
+            // unmatched query call: classify using the overlapping regions
+            const int64_t start = query->pos + 1;
+            const int64_t end = start + (int64_t)strlen(query->d.allele[0]);
+            regions.intersect(bcf_hdr_id2name(query_hdr, query->rid), start, end, overlap);
+
+            bool is_fp = false;
+            bool is_ambi = false;
+            classes_this_pos.clear();
+            for(auto const * iv : overlap)
+            {
+                std::string reason = iv->value[0];
+                if(reason == "fp")
+                {
+                    reason = ambi_fp ? "FP" : "ambi-fp";
+                }
+                else if(reason == "unk")
+                {
+                    reason = "ambi-unk";
+                }
+                classes_this_pos.insert(reason);
+                ambi_reasons[reason + ": rep. count " + (iv->value.size() > 1 ? iv->value[1] : std::string("*"))]++;
+                for(size_t j = 3; j < iv->value.size(); ++j)
+                {
+                    ambi_reasons[reason + ": " + iv->value[j]]++;
+                }
+                if(reason == "FP")
+                {
+                    is_fp = true;
+                }
+                else
+                {
+                    is_ambi = true;
+                }
+            }
+            for(auto const & c : classes_this_pos)
+            {
+                ambi_classes[c]++;
+            }
+
+            int category;
+            VcfOutput * out;
+            if(is_fp)
+            {
+                category = FP;
+                out = fp_out.get();
+            }
+            else if(is_ambi)
+            {
+                category = AMBI;
+                out = ambi_out.get();
+            }
+            else if(!count_unk)
+            {
+                // when we don't have FP regions, unk stuff becomes FP
+                category = FP;
+                out = fp_out.get();
+            }
+            else
+            {
+                category = UNK;
+                out = unk_out.get();
+            }
+            counts[category].add(query);
+            if(out)
+            {
+                out->write(query);
+            }
+        }
+
+        for(auto * out : {fn_out.get(), tp_out.get(), tp_query_out.get(), fp_out.get(), ambi_out.get(), unk_out.get()})
+        {
+            if(out)
+            {
+                out->close();
+            }
+        }
+        bcf_sr_destroy(reader);
+
+        Json::Value root;
+        for(int c = 0; c < N_CATEGORIES; ++c)
+        {
+            root["counts"][category_names[c]] = counts[c].toJson();
+        }
+        root["ambiclasses"] = Json::Value(Json::objectValue);
+        for(auto const & c : ambi_classes)
+        {
+            root["ambiclasses"][c.first] = c.second;
+        }
+        root["ambireasons"] = Json::Value(Json::objectValue);
+        for(auto const & r : ambi_reasons)
+        {
+            root["ambireasons"][r.first] = r.second;
+        }
+        root["fp_region_size"]["total"] = (Json::Int64)regions.bases_by_label["FP"];
+        root["fp_region_size"]["chromosomes"] = Json::Value(Json::objectValue);
+        for(auto const & c : regions.bases_by_label_and_chr["FP"])
+        {
+            root["fp_region_size"]["chromosomes"][c.first] = (Json::Int64)c.second;
+        }
+
+        Json::FastWriter fw;
+        if(output_file.empty() || output_file == "-")
+        {
+            std::cout << fw.write(root);
+        }
+        else
+        {
+            std::ofstream output(output_file);
+            output << fw.write(root);
+        }
+    }
+    catch(std::runtime_error & e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    catch(std::logic_error & e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -52,6 +52,10 @@
 #include <chrono>
 #include <limits>
 #include <memory>
+#include <mutex>
+#include <sstream>
+
+#include "helpers/OrderedPipeline.hh"
 
 // error needs to come after boost headers.
 #include "Error.hh"
@@ -61,6 +65,104 @@
 using namespace variant;
 using namespace haplotypes;
 
+namespace
+{
+    /** a block of overlapping variants and the validation results for it */
+    struct Superlocus
+    {
+        std::string chr;
+        int64_t start;
+        int64_t end;
+        uint64_t id;
+        std::list<Variants> variants;
+
+        // bed lines for failed records
+        std::string errors;
+        bool failed;
+        uint64_t import_failed_records;
+    };
+
+    /** enumerate haplotypes for a superlocus and record errors */
+    void validateSuperlocus(DiploidReference & dr, Superlocus & sl,
+                            int r1, int max_n_haplotypes, int64_t hb_expand)
+    {
+#ifdef DEBUG_VALIDATEVCF
+        std::cerr << "FINISH block " << sl.id << " " << sl.chr << ":" << sl.start << "-" << sl.end << "\n";
+#endif
+        std::list<std::string> result;
+        int nhaps = 0;
+        if(max_n_haplotypes > 0 && sl.variants.size() > 0)
+        {
+#ifdef DEBUG_VALIDATEVCF
+            for (auto vars : sl.variants) {
+                std::cerr << "PROCESSED: " << vars << "\n";
+            }
+#endif
+            try
+            {
+                dr.setRegion(sl.chr.c_str(), std::max((int64_t )0, sl.start - hb_expand), sl.end + hb_expand,
+                             sl.variants, r1);
+                auto l = dr.result();
+                if(l.size() == 0)
+                {
+                    result.push_back("DIPENUM_FAIL: unknown");
+                }
+                nhaps = (int)l.size();
+            }
+            catch (std::runtime_error const & e)
+            {
+                nhaps = 0;
+                result.push_back(std::string("DIPENUM_FAIL: ") + e.what());
+            }
+        }
+
+        std::ostringstream errors;
+        sl.failed = false;
+        sl.import_failed_records = 0;
+        for(auto & vars : sl.variants)
+        {
+            vars.calls[0] = vars.calls[r1];
+            vars.calls.resize(1);
+
+#ifdef DEBUG_VALIDATEVCF
+            std::cerr << "RAW: " << vars << "\n";
+#endif
+            if((!vars.calls[0].isHomref() && !vars.calls[0].isNocall()) || vars.getInfoFlag("IMPORT_FAIL"))
+            {
+                if(vars.getInfoFlag("IMPORT_FAIL"))
+                {
+                    sl.failed = true;
+                    sl.import_failed_records++;
+                    result.push_back("IMPORT_FAIL");
+                }
+                if(result.size() > 0)
+                {
+                    sl.failed = true;
+                    bool b = false;
+                    std::string allerrors;
+                    for (auto i : result) {
+                        if(!allerrors.empty())
+                        {
+                            allerrors += ",";
+                        }
+                        allerrors += i;
+                        b = true;
+                    }
+                    if(b)
+                    {
+                        allerrors += ",SUPERLOCUS_ID=" + std::to_string(sl.id);
+                        allerrors += ",SUPERLOCUS_NHAPS=" + std::to_string(nhaps);
+                        errors << sl.chr << "\t" << vars.pos << "\t"
+                               << vars.pos + vars.len << "\t" << vars << "\t" << allerrors << "\n";
+                    }
+                }
+            }
+        }
+        sl.errors = errors.str();
+        sl.variants.clear();
+    }
+}
+
 int main(int argc, char* argv[]) {
     namespace po = boost::program_options;
 
@@ -88,6 +190,8 @@ int main(int argc, char* argv[]) {
 
     bool apply_filters = true;
 
+    int threads = 1;
+
     try
     {
         // Declare the supported options.
@@ -108,6 +212,7 @@ int main(int argc, char* argv[]) {
             ("expand-hapblocks", po::value<int64_t>(), "Number of bases to expand around each haplotype block.")
             ("limit", po::value<int64_t>(), "Maximum number of haplotype blocks to process.")
             ("apply-filters", po::value<bool>(), "Apply filtering in VCF (on by default).")
+            ("threads", po::value<int>(), "Number of threads to use for enumerating haplotypes in superloci.")
         ;
 
         po::positional_options_description popts;
@@ -215,6 +320,11 @@ int main(int argc, char* argv[]) {
         {
             apply_filters = vm["apply-filters-truth"].as< bool >();
         }
+
+        if (vm.count("threads"))
+        {
+            threads = vm["threads"].as< int >();
+        }
     }
     catch (po::error & e)
     {
@@ -286,98 +396,80 @@ int main(int argc, char* argv[]) {
         uint64_t failed_blocks = 0;
         uint64_t import_failed_records = 0;
 
-        const auto finish_block = [&block_variants, r1,
-                                   &chr,
-                                   &block_start,
-                                   &block_end,
-                                   &sl_id,
-                                   &dr, max_n_haplotypes,
-                                   hb_window,
-                                   &error_out_stream,
-                                   &total_blocks,
-                                   &failed_blocks,
-                                   &import_failed_records,
-                                   hb_expand] () {
-#ifdef DEBUG_VALIDATEVCF
-            std::cerr << "FINISH block " << sl_id << " " << chr << ":" << block_start << "-" << block_end << "\n";
-#endif
-            sl_id++;
-            std::list<std::string> result;
-            int nhaps = 0;
-            if(max_n_haplotypes > 0 && block_variants.size() > 0)
+        // write errors and count superloci in the order they were found
+        const auto output_superlocus = [&error_out_stream,
+                                        &total_blocks,
+                                        &failed_blocks,
+                                        &import_failed_records] (Superlocus & sl) {
+            if(error_out_stream)
             {
-#ifdef DEBUG_VALIDATEVCF
-                for (auto vars : block_variants) {
-                    std::cerr << "PROCESSED: " << vars << "\n";
-                }
-#endif
-                try
-                {
-                    dr.setRegion(chr.c_str(), std::max((int64_t )0, block_start - hb_expand), block_end + hb_expand,
-                                 block_variants, r1);
-                    auto l = dr.result();
-                    if(l.size() == 0)
-                    {
-                        result.push_back("DIPENUM_FAIL: unknown");
-                    }
-                    nhaps = (int)l.size();
-                }
-                catch (std::runtime_error const & e)
-                {
-                    nhaps = 0;
-                    result.push_back(std::string("DIPENUM_FAIL: ") + e.what());
-                }
+                *error_out_stream << sl.errors;
             }
-
-            bool block_is_failed = false;
-            for(auto & vars : block_variants)
+            sl.errors.clear();
+            if(sl.failed)
             {
-                vars.calls[0] = vars.calls[r1];
-                vars.calls.resize(1);
+                ++failed_blocks;
+            }
+            import_failed_records += sl.import_failed_records;
+            ++total_blocks;
+        };
 
-#ifdef DEBUG_VALIDATEVCF
-                std::cerr << "RAW: " << vars << "\n";
-#endif
-                if((!vars.calls[0].isHomref() && !vars.calls[0].isNocall()) || vars.getInfoFlag("IMPORT_FAIL"))
+        // with more than one thread, superloci are validated by workers which each
+        // have their own reference
+        std::mutex refs_mutex;
+        std::vector< std::unique_ptr<DiploidReference> > refs;
+        std::unique_ptr< parallel::OrderedPipeline<Superlocus> > pipeline;
+        if(threads > 1)
+        {
+            pipeline.reset(new parallel::OrderedPipeline<Superlocus>(
+                threads, 4 * (size_t)threads,
+                [&](Superlocus & sl)
                 {
-                    if(vars.getInfoFlag("IMPORT_FAIL"))
-                    {
-                        block_is_failed = true;
-                        import_failed_records++;
-                        result.push_back("IMPORT_FAIL");
-                    }
-                    if(result.size() > 0)
+                    std::unique_ptr<DiploidReference> wdr;
                     {
-                        block_is_failed = true;
-                        bool b = false;
-                        std::string allerrors;
-                        for (auto i : result) {
-                            if(!allerrors.empty())
-                            {
-                                allerrors += ",";
-                            }
-                            allerrors += i;
-                            b = true;
+                        std::lock_guard<std::mutex> l(refs_mutex);
+                        if(!refs.empty())
+                        {
+                            wdr = std::move(refs.back());
+                            refs.pop_back();
                         }
-                        if(b)
+                        else
                         {
-                            allerrors += ",SUPERLOCUS_ID=" + std::to_string(sl_id);
-                            allerrors += ",SUPERLOCUS_NHAPS=" + std::to_string(nhaps);
-                            if(error_out_stream)
-                            {
-                                *error_out_stream << chr << "\t" << vars.pos << "\t"
-                                                  << vars.pos + vars.len << "\t" << vars << "\t" << allerrors << "\n";
-                            }
+                            wdr.reset(new DiploidReference(gr));
+                            wdr->setNPaths(max_n_haplotypes);
                         }
                     }
-                }
+                    validateSuperlocus(*wdr, sl, r1, max_n_haplotypes, hb_expand);
+                    std::lock_guard<std::mutex> l(refs_mutex);
+                    refs.push_back(std::move(wdr));
+                },
+                output_superlocus));
+        }
+
+        const auto finish_block = [&block_variants,
+                                   &chr,
+                                   &block_start,
+                                   &block_end,
+                                   &sl_id,
+                                   &dr, r1, max_n_haplotypes,
+                                   &pipeline,
+                                   &output_superlocus,
+                                   hb_expand] () {
+            Superlocus sl;
+            sl.chr = chr;
+            sl.start = block_start;
+            sl.end = block_end;
+            sl.id = ++sl_id;
+            sl.variants.swap(block_variants);
+            if(pipeline)
+            {
+                pipeline->push(std::move(sl));
             }
-            if(block_is_failed)
+            else
             {
-                ++failed_blocks;
+                validateSuperlocus(dr, sl, r1, max_n_haplotypes, hb_expand);
+                output_superlocus(sl);
             }
-            ++total_blocks;
-            block_variants.clear();
             block_start = -1;
             block_end = -1;
         };
@@ -477,6 +569,10 @@ int main(int argc, char* argv[]) {
                   << "\n";
 #endif
         finish_block();
+        if(pipeline)
+        {
+            pipeline->finish();
+        }
 
         std::cerr << "Total superloci: " << total_blocks <<
                      " failed: " << failed_blocks <<
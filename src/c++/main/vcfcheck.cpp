@@ -43,14 +43,17 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <chrono>
 #include <limits>
 #include <memory>
+#include <mutex>
 
 #include <htslib/synced_bcf_reader.h>
 #include <helpers/BCFHelpers.hh>
 
 #include "helpers/Roc.hh"
+#include "helpers/OrderedPipeline.hh"
 
 // error needs to come after boost headers.
 #include "Error.hh"
@@ -70,199 +73,262 @@ namespace WARNING {
     };
 }
 
-int main(int argc, char *argv[])
+namespace
 {
-    namespace po = boost::program_options;
-
-    std::string file;
-    std::string output_file;
-
-    // limits
-    std::string chr;
-    int64_t start = -1;
-    int64_t end = -1;
-    int64_t rlimit = -1;
-
-    int64_t message = -1;
-
-    bool apply_filters = false;
-    bool strict_homref = false;
-    bool all_warnings = false;
-    bool check_bcf = false;
+    struct CheckSettings
+    {
+        std::string chr;
+        int64_t message;
+        bool apply_filters;
+        bool strict_homref;
+        bool all_warnings;
+        bool check_bcf;
+        bool index_stats;
+    };
 
-    Json::Value counts_root;
+    typedef std::unique_ptr<bcf_srs_t, decltype(&bcf_sr_destroy)> p_reader;
 
-    try
+    /** open a reader, returns an empty pointer when the file cannot be opened or has no index */
+    p_reader openReader(std::string const & file, bool indexed)
     {
-        try
+        p_reader reader(bcf_sr_init(), bcf_sr_destroy);
+        reader->collapse = COLLAPSE_NONE;
+        if(indexed)
         {
-            // Declare the supported options.
-            po::options_description desc("Allowed options");
-            desc.add_options()
-                ("help,h", "produce help message")
-                ("version", "Show version")
-                ("input-file", po::value<std::string>(), "The input file")
-                ("output-file,o", po::value<std::string>(), "The output JSON file with basic counts.")
-                ("location,l", po::value<std::string>(), "Start location.")
-                ("limit-records", po::value<int64_t>(), "Maximum number of records to process")
-                ("message-every", po::value<int64_t>(), "Print a message every N records.")
-                ("apply-filters,f", po::value<bool>(), "Apply filtering in VCF.")
-                ("strict-homref,H", po::value<bool>(), "Be strict about hom-ref assertions (i.e. don't allow these to overlap).")
-                ("check-bcf-errors", po::value<bool>(), "Check if turning this file into BCF will succeed or fail.")
-                ("all-warnings,W", po::value<bool>(), "Show all warnings, not just the first instance.")
-            ;
-
-            po::positional_options_description popts;
-            popts.add("input-file", -1);
-
-            po::options_description cmdline_options;
-            cmdline_options
-                .add(desc)
-            ;
+            reader->require_index = 1;
+            reader->streaming = 0;
+        }
+        else
+        {
+            reader->require_index = 0;
+            reader->streaming = 1;
+        }
 
-            po::variables_map vm;
+        if (!bcf_sr_add_reader(reader.get(), file.c_str()))
+        {
+            // a failed bcf_sr_add_reader leaves a reader behind which cannot be destroyed
+            reader.release();
+        }
+        return reader;
+    }
 
-            po::store(po::command_line_parser(argc, argv).
-                      options(cmdline_options).positional(popts).run(), vm);
-            po::notify(vm);
+    int64_t contigLength(bcf_hdr_t * hdr, std::string const & chr)
+    {
+        const int rid = bcf_hdr_name2id(hdr, chr.c_str());
+        if(rid >= 0 && hdr->id[BCF_DT_CTG][rid].val)
+        {
+            return hdr->id[BCF_DT_CTG][rid].val->info[0];
+        }
+        return 0;
+    }
 
-            if (vm.count("version"))
-            {
-                std::cout << "vcfcheck version " << HAPLOTYPES_VERSION << "\n";
-                return 0;
-            }
+    /** a range of records to check, and the results of checking them */
+    struct Segment
+    {
+        Segment(std::string const & _chr, int64_t _start, int64_t _end, int64_t _limit, bool _chunk = false) :
+            chr(_chr), start(_start), end(_end), limit(_limit), chunk(_chunk),
+            records(0), nonref_records(0), ref(0), nonref(0), haploid(0), diploid(0), polyploid(0),
+            haploid_X(false), diploid_X(false),
+            has_first(false), first_start(-1), first_overlap_message(0), last_end(-1)
+        {
+            memset(has_warned, 0, sizeof(int)*WARNING::SIZE);
+        }
 
-            if (vm.count("help"))
-            {
-                std::cout << desc << "\n";
-                return 1;
-            }
+        std::string chr;
+        int64_t start;
+        int64_t end;
+        int64_t limit;
+        // chunk of a contig: only records starting in [start, end) are checked, overlaps
+        // with the last record of the previous chunk are checked when adding up the results
+        bool chunk;
+
+        int64_t records;
+        int64_t nonref_records;
+        int64_t ref;
+        int64_t nonref;
+        int64_t haploid;
+        int64_t diploid;
+        int64_t polyploid;
+        int has_warned[WARNING::SIZE];
+        bool haploid_X;
+        bool diploid_X;
+
+        // warnings to print (type -1: print unconditionally)
+        std::vector< std::pair<int, std::string> > messages;
+
+        // first and last record that went into the overlap check
+        bool has_first;
+        int64_t first_start;
+        std::vector<int> first_allele_count;
+        size_t first_overlap_message;
+        int64_t last_end;
+        std::vector<int> last_allele_count;
+    };
 
-            if (vm.count("input-file"))
-            {
-                file = vm["input-file"].as< std::string >();
-            }
+    /** add up segment results in file order */
+    struct Totals
+    {
+        Totals() : records(0), nonref_records(0), ref(0), nonref(0), haploid(0), diploid(0), polyploid(0),
+                   haploid_X(false), diploid_X(false), all_warnings(false), carry(false), last_end(-1)
+        {
+            memset(has_warned, 0, sizeof(int)*WARNING::SIZE);
+        }
 
-            if (vm.count("output-file"))
+        void add(Segment const & s)
+        {
+            // the first record of a chunk is only checked against the previous chunk here
+            std::vector<std::string> boundary;
+            if(s.chunk && s.has_first && carry && last_chr == s.chr && s.first_start < last_end)
             {
-                output_file = vm["output-file"].as< std::string >();
+                for(size_t isample = 0; isample < s.first_allele_count.size(); ++isample)
+                {
+                    if(s.first_allele_count[isample] + last_allele_count[isample] > 2)
+                    {
+                        std::ostringstream msg;
+                        msg << "[W] overlapping records at " << s.chr << ":" << s.first_start << " for sample " << isample << "\n";
+                        boundary.push_back(msg.str());
+                    }
+                }
             }
 
-            if (vm.count("location"))
+            for(size_t m = 0; m <= s.messages.size(); ++m)
             {
-                stringutil::parsePos(vm["location"].as< std::string >(), chr, start, end);
+                if(m == s.first_overlap_message)
+                {
+                    for(auto const & b : boundary)
+                    {
+                        if(all_warnings || !has_warned[WARNING::OVERLAP])
+                        {
+                            std::cerr << b;
+                        }
+                        has_warned[WARNING::OVERLAP]++;
+                    }
+                }
+                if(m < s.messages.size() && (s.messages[m].first < 0 || !has_warned[s.messages[m].first]))
+                {
+                    std::cerr << s.messages[m].second;
+                }
             }
 
-            if (vm.count("limit-records"))
+            for(int w = 0; w < WARNING::SIZE; ++w)
             {
-                rlimit = vm["limit-records"].as< int64_t >();
+                has_warned[w] += s.has_warned[w];
             }
-
-            if (vm.count("message-every"))
+            records += s.records;
+            nonref_records += s.nonref_records;
+            ref += s.ref;
+            nonref += s.nonref;
+            haploid += s.haploid;
+            diploid += s.diploid;
+            polyploid += s.polyploid;
+            haploid_X = haploid_X || s.haploid_X;
+            diploid_X = diploid_X || s.diploid_X;
+
+            if(!s.chunk)
             {
-                message = vm["message-every"].as< int64_t >();
+                carry = false;
             }
-
-            if (vm.count("apply-filters"))
+            else if(s.has_first)
             {
-                apply_filters = vm["apply-filters"].as< bool >();
+                carry = true;
+                last_chr = s.chr;
+                last_end = s.last_end;
+                last_allele_count = s.last_allele_count;
             }
+        }
 
-            if (vm.count("strict-homref"))
-            {
-                strict_homref = vm["strict-homref"].as< bool >();
-            }
+        int64_t records;
+        int64_t nonref_records;
+        int64_t ref;
+        int64_t nonref;
+        int64_t haploid;
+        int64_t diploid;
+        int64_t polyploid;
+        int has_warned[WARNING::SIZE];
+        bool haploid_X;
+        bool diploid_X;
+        bool all_warnings;
+
+        // state of the overlap check at the end of the previous chunk
+        bool carry;
+        std::string last_chr;
+        int64_t last_end;
+        std::vector<int> last_allele_count;
+    };
 
-            if (vm.count("all-warnings"))
-            {
-                all_warnings = vm["all-warnings"].as< bool >();
-            }
+    /**
+     * Check the records in a segment.
+     *
+     * When live is given, warnings are printed straight away and counted against the
+     * totals so far. Otherwise they are kept in the segment until it is added to the totals.
+     * rcount is the running record count for --message-every.
+     */
+    void checkSegment(bcf_srs_t * reader, CheckSettings const & settings,
+                      Segment & segment, Totals const * live, int64_t & rcount)
+    {
+        bcf_hdr_t * hdr = reader->readers[0].header;
+        const int nsamples = bcf_hdr_nsamples(hdr);
 
-            if (vm.count("check-bcf-errors"))
+        auto warn = [&segment, &settings, live](int type, std::string const & msg)
+        {
+            if(type < 0)
             {
-                check_bcf = vm["check-bcf-errors"].as< bool >();
+                if(live)
+                {
+                    std::cerr << msg;
+                }
+                else
+                {
+                    segment.messages.emplace_back(-1, msg);
+                }
+                return;
             }
-
-            if(file.size() == 0)
+            const bool always = settings.all_warnings && type != WARNING::BCFERROR;
+            if(always || !(segment.has_warned[type] + (live ? live->has_warned[type] : 0)))
             {
-                std::cerr << "Please specify one input file / sample.\n";
-                return 1;
+                if(live)
+                {
+                    std::cerr << msg;
+                }
+                else
+                {
+                    segment.messages.emplace_back(always ? -1 : type, msg);
+                }
             }
-        }
-        catch (po::error & e)
-        {
-            std::cerr << e.what() << "\n";
-            return 1;
-        }
+            segment.has_warned[type]++;
+        };
 
-        bcf_srs_t * reader = bcf_sr_init();
-        reader->collapse = COLLAPSE_NONE;
-        if(chr.empty())
-        {
-            reader->require_index = 0;
-            reader->streaming = 1;
-        }
-        else
-        {
-            reader->require_index = 1;
-            reader->streaming = 0;
-        }
-
-        if (!bcf_sr_add_reader(reader, file.c_str()))
-        {
-            error("Failed to open or file not indexed: %s\n", file.c_str());
-        }
-
-        if(!chr.empty())
+        int rid = -1;
+        if(!segment.chr.empty())
         {
+            rid = bcf_hdr_name2id(hdr, segment.chr.c_str());
             int success = 0;
-            if(start < 0)
+            if(segment.start < 0)
             {
-                success = bcf_sr_seek(reader, chr.c_str(), 0);
+                success = bcf_sr_seek(reader, segment.chr.c_str(), 0);
             }
             else
             {
-                success = bcf_sr_seek(reader, chr.c_str(), start);
-                std::cerr << "starting at " << chr << ":" << start << "\n";
+                success = bcf_sr_seek(reader, segment.chr.c_str(), segment.start);
+                if(!settings.index_stats && !segment.chunk)
+                {
+                    std::cerr << "starting at " << segment.chr << ":" << segment.start << "\n";
+                }
             }
             if(success < 0)
             {
-                error("Cannot seek to %s:%i", chr.c_str(), start);
+                error("Cannot seek to %s:%i", segment.chr.c_str(), segment.start);
             }
         }
 
-        bcf_hdr_t * hdr = reader->readers[0].header;
-
-        if(bcf_hdr_nsamples(hdr) < 1)
-        {
-            error("Input file has no samples. Hap.py will not like that.");
-        }
-
-        int nl = 1;
-        int64_t rcount = 0;
-        std::string current_chr;
-
-        int64_t previous_end = -1;
         // this could be improved using and interval list
         // currently, we only check directly adjacent overlaps
-        std::unique_ptr<int[]> previous_allele_count(new int[bcf_hdr_nsamples(hdr)]);
-        memset(previous_allele_count.get(), 0, sizeof(int)*bcf_hdr_nsamples(hdr));
-
-        int has_warned[WARNING::SIZE];
-        memset(has_warned, 0, sizeof(int)*WARNING::SIZE);
-
-        int n_nonref = 0;
-
-        counts_root["records"] = 0;
-        counts_root["ref"] = 0;
-        counts_root["nonref"] = 0;
-        counts_root["haploid"] = 0;
-        counts_root["diploid"] = 0;
-        counts_root["polyploid"] = 0;
-
-        bool haploid_X = false;
-        bool diploid_X = false;
+        int64_t previous_end = -1;
+        std::vector<int> previous_allele_count(nsamples, 0);
 
+        int nl = 1;
+        int64_t segment_count = 0;
+        std::string current_chr;
         while(nl)
         {
             nl = bcf_sr_next_line(reader);
@@ -276,37 +342,48 @@ int main(int argc, char *argv[])
             }
             bcf1_t *line = reader->readers[0].buffer[0];
 
+            if(segment.chunk)
+            {
+                if(line->rid != rid || line->pos >= segment.end)
+                {
+                    break;
+                }
+                // belongs to the previous chunk
+                if(line->pos < segment.start)
+                {
+                    continue;
+                }
+            }
+
             if(line->errcode)
             {
                 const std::string vchr = bcfhelpers::getChrom(hdr, line);
-                if(check_bcf)
+                if(settings.check_bcf)
                 {
                     error("Record at %s:%i will not translate into BCF. Check if the header is incomplete (error code %i)",
                           vchr.c_str(), line->pos+1, line->errcode);
                 }
                 else
                 {
-                    if(!has_warned[WARNING::BCFERROR])
-                    {
-                        std::cerr << "[W] Record at " << vchr << ":" << line->pos+1 <<
-                            " will not translate into BCF. Check if the header is incomplete " <<
-                            " (error code " << line->errcode << ") -- all records like this are skipped." << "\n";
-                    }
-                    has_warned[WARNING::BCFERROR]++;
+                    std::ostringstream msg;
+                    msg << "[W] Record at " << vchr << ":" << line->pos+1 <<
+                        " will not translate into BCF. Check if the header is incomplete " <<
+                        " (error code " << line->errcode << ") -- all records like this are skipped." << "\n";
+                    warn(WARNING::BCFERROR, msg.str());
                     // skip
                     continue;
                 }
             }
 
-            if(rlimit != -1)
+            if(segment.limit != -1)
             {
-                if(rcount >= rlimit)
+                if(segment_count >= segment.limit)
                 {
                     break;
                 }
             }
             const std::string vchr = bcfhelpers::getChrom(hdr, line);
-            if(end != -1 && ((!current_chr.empty() && vchr != current_chr) || line->pos > end))
+            if(segment.end != -1 && ((!current_chr.empty() && vchr != current_chr) || line->pos > segment.end))
             {
                 break;
             }
@@ -315,10 +392,10 @@ int main(int argc, char *argv[])
             {
                 // chromosome switch
                 previous_end = -1;
-                memset(previous_allele_count.get(), 0, sizeof(int)*bcf_hdr_nsamples(hdr));
+                std::fill(previous_allele_count.begin(), previous_allele_count.end(), 0);
             }
 
-            if(apply_filters)
+            if(settings.apply_filters)
             {
                 bcf_unpack(line, BCF_UN_FLT);
 
@@ -346,8 +423,6 @@ int main(int argc, char *argv[])
                 }
             }
 
-            counts_root["records"] = counts_root["records"].asInt() + 1;
-
             bcf_unpack(line, BCF_UN_ALL);
 
             int64_t vstart = -1, vend= -1;
@@ -357,7 +432,7 @@ int main(int argc, char *argv[])
             }
             catch(bcfhelpers::importexception const & e)
             {
-                std::cerr << e.what() << "\n";
+                warn(-1, std::string(e.what()) + "\n");
                 vend = vstart;
             }
             // check
@@ -381,20 +456,18 @@ int main(int argc, char *argv[])
                     ++vstart;
                     if(refpadding > 1)
                     {
-                        if(all_warnings || !has_warned[WARNING::REFPADDING])
-                        {
-                            std::cerr << "[W] variant at " << vchr << ":" << vstart << " has more than one base of reference padding \n";
-                        }
-                        has_warned[WARNING::REFPADDING]++;
+                        std::ostringstream msg;
+                        msg << "[W] variant at " << vchr << ":" << vstart << " has more than one base of reference padding \n";
+                        warn(WARNING::REFPADDING, msg.str());
                     }
                 }
             }
             catch(bcfhelpers::importexception const & e)
             {
-                std::cerr << "[W]" << e.what() << "\n";
+                warn(-1, std::string("[W]") + e.what() + "\n");
             }
 
-            if(line->n_sample != bcf_hdr_nsamples(hdr))
+            if(line->n_sample != nsamples)
             {
                 error("Number of samples in line and header disagrees at %s:%i", vchr.c_str(), vstart);
             }
@@ -406,6 +479,14 @@ int main(int argc, char *argv[])
                 continue;
             }
 
+            const bool first = !segment.has_first;
+            if(first)
+            {
+                segment.has_first = true;
+                segment.first_start = vstart;
+                segment.first_overlap_message = segment.messages.size();
+            }
+
             bool any_alts = false;
             bool any_symbolic = false;
             bool any_uncertain = false;
@@ -469,7 +550,7 @@ int main(int argc, char *argv[])
                         any_alts = true;
                         ++allele_count;
                     }
-                    else if(gt[g] == 0 && strict_homref)
+                    else if(gt[g] == 0 && settings.strict_homref)
                     {
                         ++allele_count;
                     }
@@ -478,75 +559,74 @@ int main(int argc, char *argv[])
                         any_ref = true;
                     }
                 }
-                if(vstart < previous_end && allele_count + previous_allele_count.get()[isample] > 2)
+                if(vstart < previous_end && allele_count + previous_allele_count[isample] > 2)
                 {
-                    if(all_warnings || !has_warned[WARNING::OVERLAP])
-                    {
-                        std::cerr << "[W] overlapping records at " << vchr << ":" << vstart << " for sample " << isample << "\n";
-                    }
-                    has_warned[WARNING::OVERLAP]++;
+                    std::ostringstream msg;
+                    msg << "[W] overlapping records at " << vchr << ":" << vstart << " for sample " << isample << "\n";
+                    warn(WARNING::OVERLAP, msg.str());
                 }
-                previous_allele_count.get()[isample] = allele_count;
+                previous_allele_count[isample] = allele_count;
             }
 
-            if(vchr == "X" || vchr == "chrX" || chr == "x" || vchr == "chrx")
+            if(first)
+            {
+                segment.first_allele_count = previous_allele_count;
+            }
+
+            if(vchr == "X" || vchr == "chrX" || settings.chr == "x" || vchr == "chrx")
             {
                 if(any_haploid)
                 {
-                    haploid_X = true;
+                    segment.haploid_X = true;
                 }
                 if(any_diploid || any_poly)
                 {
-                    diploid_X = true;
+                    segment.diploid_X = true;
                 }
             }
 
             if(any_ref)
             {
-                counts_root["ref"] = counts_root["ref"].asInt() + 1;
+                ++segment.ref;
             }
 
             if(any_nonref)
             {
-                counts_root["nonref"] = counts_root["nonref"].asInt() + 1;
+                ++segment.nonref;
             }
 
             if(any_haploid)
             {
-                counts_root["haploid"] = counts_root["haploid"].asInt() + 1;
+                ++segment.haploid;
             }
 
             if(any_diploid)
             {
-                counts_root["diploid"] = counts_root["diploid"].asInt() + 1;
+                ++segment.diploid;
             }
 
             if(any_poly)
             {
-                counts_root["polyploid"] = counts_root["polyploid"].asInt() + 1;
+                ++segment.polyploid;
             }
 
             if(any_symbolic)
             {
-                if(all_warnings || !has_warned[WARNING::SYMALT])
-                {
-                    std::cerr << "[W] Symbolic / SV ALT alleles at " << vchr << ":" << vstart << "\n";
-                }
-                has_warned[WARNING::SYMALT]++;
+                std::ostringstream msg;
+                msg << "[W] Symbolic / SV ALT alleles at " << vchr << ":" << vstart << "\n";
+                warn(WARNING::SYMALT, msg.str());
             }
 
             if(any_uncertain)
             {
-                if(all_warnings || !has_warned[WARNING::UNCERTAINLENGTH])
-                {
-                    std::cerr << "[W] Alleles with uncertain length at " << vchr << ":" << vstart << "\n";
-                }
-                has_warned[WARNING::UNCERTAINLENGTH]++;
+                std::ostringstream msg;
+                msg << "[W] Alleles with uncertain length at " << vchr << ":" << vstart << "\n";
+                warn(WARNING::UNCERTAINLENGTH, msg.str());
             }
 
             if(any_alts)
             {
-                ++n_nonref;
+                ++segment.nonref_records;
             }
 
             previous_end = vend;
@@ -554,15 +634,363 @@ int main(int argc, char *argv[])
 
             current_chr = vchr;
 
-            if (message > 0 && (rcount % message) == 0)
+            if (settings.message > 0 && (rcount % settings.message) == 0)
             {
                 std::cout << stringutil::formatPos(vchr.c_str(), line->pos) << "\n";
             }
             // count variants here
             ++rcount;
+            ++segment.records;
+            ++segment_count;
+        }
+
+        segment.last_end = previous_end;
+        segment.last_allele_count = previous_allele_count;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    namespace po = boost::program_options;
+
+    std::string file;
+    std::string output_file;
+
+    // limits
+    std::string chr;
+    int64_t start = -1;
+    int64_t end = -1;
+    int64_t rlimit = -1;
+
+    int64_t message = -1;
+
+    bool apply_filters = false;
+    bool strict_homref = false;
+    bool all_warnings = false;
+    bool check_bcf = false;
+
+    // pre-flight mode
+    bool index_stats = false;
+    int sample_blocks = 4;
+    int64_t sample_records = 100;
+
+    int threads = 1;
+    int64_t chunk_records = 1000000;
+
+    Json::Value counts_root;
+
+    try
+    {
+        try
+        {
+            // Declare the supported options.
+            po::options_description desc("Allowed options");
+            desc.add_options()
+                ("help,h", "produce help message")
+                ("version", "Show version")
+                ("input-file", po::value<std::string>(), "The input file")
+                ("output-file,o", po::value<std::string>(), "The output JSON file with basic counts.")
+                ("location,l", po::value<std::string>(), "Start location.")
+                ("limit-records", po::value<int64_t>(), "Maximum number of records to process")
+                ("message-every", po::value<int64_t>(), "Print a message every N records.")
+                ("apply-filters,f", po::value<bool>(), "Apply filtering in VCF.")
+                ("strict-homref,H", po::value<bool>(), "Be strict about hom-ref assertions (i.e. don't allow these to overlap).")
+                ("check-bcf-errors", po::value<bool>(), "Check if turning this file into BCF will succeed or fail.")
+                ("all-warnings,W", po::value<bool>(), "Show all warnings, not just the first instance.")
+                ("index-stats", po::value<bool>(), "Quick check: read the number of records per contig from the index "
+                    "and only check records at a few sampled positions on each contig (X chromosomes are always "
+                    "checked completely to determine the sample gender).")
+                ("sample-blocks", po::value<int>(), "Number of positions to sample per contig with --index-stats.")
+                ("sample-records", po::value<int64_t>(), "Number of records to check at each sampled position.")
+                ("threads", po::value<int>(), "Number of threads to use (indexed inputs are checked in parallel "
+                    "by contig, unless --location, --limit-records or --message-every are given).")
+                ("chunk-records", po::value<int64_t>(), "With --threads, split contigs into chunks of about this "
+                    "many records (using the record counts from the index).")
+            ;
+
+            po::positional_options_description popts;
+            popts.add("input-file", -1);
+
+            po::options_description cmdline_options;
+            cmdline_options
+                .add(desc)
+            ;
+
+            po::variables_map vm;
+
+            po::store(po::command_line_parser(argc, argv).
+                      options(cmdline_options).positional(popts).run(), vm);
+            po::notify(vm);
+
+            if (vm.count("version"))
+            {
+                std::cout << "vcfcheck version " << HAPLOTYPES_VERSION << "\n";
+                return 0;
+            }
+
+            if (vm.count("help"))
+            {
+                std::cout << desc << "\n";
+                return 1;
+            }
+
+            if (vm.count("input-file"))
+            {
+                file = vm["input-file"].as< std::string >();
+            }
+
+            if (vm.count("output-file"))
+            {
+                output_file = vm["output-file"].as< std::string >();
+            }
+
+            if (vm.count("location"))
+            {
+                stringutil::parsePos(vm["location"].as< std::string >(), chr, start, end);
+            }
+
+            if (vm.count("limit-records"))
+            {
+                rlimit = vm["limit-records"].as< int64_t >();
+            }
+
+            if (vm.count("message-every"))
+            {
+                message = vm["message-every"].as< int64_t >();
+            }
+
+            if (vm.count("apply-filters"))
+            {
+                apply_filters = vm["apply-filters"].as< bool >();
+            }
+
+            if (vm.count("strict-homref"))
+            {
+                strict_homref = vm["strict-homref"].as< bool >();
+            }
+
+            if (vm.count("all-warnings"))
+            {
+                all_warnings = vm["all-warnings"].as< bool >();
+            }
+
+            if (vm.count("check-bcf-errors"))
+            {
+                check_bcf = vm["check-bcf-errors"].as< bool >();
+            }
+
+            if (vm.count("index-stats"))
+            {
+                index_stats = vm["index-stats"].as< bool >();
+            }
+
+            if (vm.count("sample-blocks"))
+            {
+                sample_blocks = vm["sample-blocks"].as< int >();
+            }
+
+            if (vm.count("sample-records"))
+            {
+                sample_records = vm["sample-records"].as< int64_t >();
+            }
+
+            if (vm.count("threads"))
+            {
+                threads = vm["threads"].as< int >();
+            }
+
+            if (vm.count("chunk-records"))
+            {
+                chunk_records = std::max((int64_t)1, vm["chunk-records"].as< int64_t >());
+            }
+
+            if(file.size() == 0)
+            {
+                std::cerr << "Please specify one input file / sample.\n";
+                return 1;
+            }
+
+            if(index_stats && (!chr.empty() || rlimit != -1))
+            {
+                std::cerr << "--index-stats cannot be combined with --location or --limit-records.\n";
+                return 1;
+            }
+        }
+        catch (po::error & e)
+        {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+
+        bool parallel_check = threads > 1;
+        if(parallel_check && (!chr.empty() || rlimit != -1 || message > 0))
+        {
+            std::cerr << "[W] --location, --limit-records and --message-every are not supported with --threads"
+                         " -- checking records using a single thread.\n";
+            parallel_check = false;
+        }
+
+        std::vector< std::pair<std::string, uint64_t> > index_counts;
+        if(index_stats && !bcfhelpers::getIndexCounts(file.c_str(), index_counts))
+        {
+            std::cerr << "[W] Cannot read record counts from the index of " << file << " -- checking all records.\n";
+            index_stats = false;
+        }
+
+        p_reader reader = openReader(file, !chr.empty() || index_stats || parallel_check);
+        if(!reader && parallel_check && chr.empty() && !index_stats)
+        {
+            std::cerr << "[W] " << file << " is not indexed -- checking records using a single thread.\n";
+            parallel_check = false;
+            reader = openReader(file, false);
+        }
+        if(!reader)
+        {
+            error("Failed to open or file not indexed: %s\n", file.c_str());
+        }
+
+        bcf_hdr_t * hdr = reader->readers[0].header;
+
+        if(bcf_hdr_nsamples(hdr) < 1)
+        {
+            error("Input file has no samples. Hap.py will not like that.");
+        }
+
+        CheckSettings settings{chr, message, apply_filters, strict_homref, all_warnings, check_bcf, index_stats};
+
+        // the records to check: everything / the given location, or a few positions on each contig
+        std::vector<Segment> segments;
+        uint64_t index_total = 0;
+        if(index_stats)
+        {
+            counts_root["contigs"] = Json::Value(Json::objectValue);
+            for(auto const & c : index_counts)
+            {
+                counts_root["contigs"][c.first] = (Json::UInt64)c.second;
+                index_total += c.second;
+                if(c.second == 0)
+                {
+                    continue;
+                }
+                if(c.first == "X" || c.first == "chrX" || c.first == "x" || c.first == "chrx")
+                {
+                    segments.emplace_back(c.first, 0, std::numeric_limits<int64_t>::max(), -1);
+                    continue;
+                }
+                const int64_t length = contigLength(hdr, c.first);
+                const int nblocks = length > 0 ? std::max(1, sample_blocks) : 1;
+                for(int b = 0; b < nblocks; ++b)
+                {
+                    segments.emplace_back(c.first, length * b / nblocks,
+                                          std::numeric_limits<int64_t>::max(), sample_records);
+                }
+            }
+        }
+        else if(parallel_check)
+        {
+            // split large contigs into chunks with similar record counts, assuming
+            // records are spread evenly along the contig. Without counts in the index,
+            // every contig is checked in one piece.
+            const bool have_counts = bcfhelpers::getIndexCounts(file.c_str(), index_counts);
+            if(!have_counts && reader->regions)
+            {
+                for(int i = 0; i < reader->regions->nseqs; ++i)
+                {
+                    index_counts.push_back(std::make_pair(std::string(reader->regions->seq_names[i]), (uint64_t)0));
+                }
+            }
+            for(auto const & c : index_counts)
+            {
+                if(have_counts && c.second == 0)
+                {
+                    continue;
+                }
+                const int64_t length = contigLength(hdr, c.first);
+                const int64_t nchunks = have_counts && length > 0
+                                      ? ((int64_t)c.second + chunk_records - 1) / chunk_records : 1;
+                for(int64_t b = 0; b < nchunks; ++b)
+                {
+                    // the last chunk also gets anything past the contig length given in the header
+                    segments.emplace_back(c.first, length * b / nchunks,
+                                          b + 1 < nchunks ? length * (b + 1) / nchunks
+                                                          : std::numeric_limits<int64_t>::max(),
+                                          -1, true);
+                }
+            }
+        }
+        else
+        {
+            segments.emplace_back(chr, start, end, rlimit);
         }
 
-        if(haploid_X && !diploid_X)
+        Totals totals;
+        totals.all_warnings = all_warnings;
+        int64_t rcount = 0;
+
+        if(parallel_check)
+        {
+            // each worker thread needs its own reader
+            std::mutex readers_mutex;
+            std::vector<p_reader> readers;
+            readers.push_back(std::move(reader));
+
+            parallel::OrderedPipeline<Segment> pipeline(
+                std::max(1, std::min(threads, (int)segments.size())), 2 * (size_t)threads,
+                [&](Segment & s)
+                {
+                    p_reader r(nullptr, bcf_sr_destroy);
+                    {
+                        std::lock_guard<std::mutex> l(readers_mutex);
+                        if(!readers.empty())
+                        {
+                            r = std::move(readers.back());
+                            readers.pop_back();
+                        }
+                    }
+                    if(!r)
+                    {
+                        r = openReader(file, true);
+                        if(!r)
+                        {
+                            error("Failed to open %s", file.c_str());
+                        }
+                    }
+                    int64_t segment_rcount = 0;
+                    checkSegment(r.get(), settings, s, nullptr, segment_rcount);
+                    std::lock_guard<std::mutex> l(readers_mutex);
+                    readers.push_back(std::move(r));
+                },
+                [&totals](Segment & s)
+                {
+                    totals.add(s);
+                    s.messages.clear();
+                });
+            for(auto & s : segments)
+            {
+                pipeline.push(std::move(s));
+            }
+            pipeline.finish();
+            rcount = totals.records;
+        }
+        else
+        {
+            for(auto & s : segments)
+            {
+                checkSegment(reader.get(), settings, s, &totals, rcount);
+                totals.add(s);
+            }
+        }
+
+        // with --index-stats, only the record totals come from the index; everything else
+        // is counted in the sampled records, so it goes into a separate object
+        Json::Value & checked_root = index_stats ? counts_root["sampled"] : counts_root;
+        checked_root["ref"] = (Json::Int64)totals.ref;
+        checked_root["nonref"] = (Json::Int64)totals.nonref;
+        checked_root["haploid"] = (Json::Int64)totals.haploid;
+        checked_root["diploid"] = (Json::Int64)totals.diploid;
+        checked_root["polyploid"] = (Json::Int64)totals.polyploid;
+
+        if(totals.haploid_X && !totals.diploid_X)
         {
             counts_root["male"] = true;
             std::cout << "[I] X chromosome appears haploid -- assuming this is a male sample" << "\n";
@@ -573,36 +1001,51 @@ int main(int argc, char *argv[])
             counts_root["male"] = false;
         }
 
-        counts_root["REFPADDING"] = has_warned[WARNING::REFPADDING];
-        counts_root["SYMALT"] = has_warned[WARNING::SYMALT];
-        counts_root["OVERLAP"] = has_warned[WARNING::OVERLAP];
-        counts_root["UNCERTAINLENGTH"] = has_warned[WARNING::UNCERTAINLENGTH];
+        checked_root["REFPADDING"] = totals.has_warned[WARNING::REFPADDING];
+        checked_root["SYMALT"] = totals.has_warned[WARNING::SYMALT];
+        checked_root["OVERLAP"] = totals.has_warned[WARNING::OVERLAP];
+        checked_root["UNCERTAINLENGTH"] = totals.has_warned[WARNING::UNCERTAINLENGTH];
         counts_root["records"] = (int)rcount;
+        if(index_stats)
+        {
+            counts_root["checked_records"] = (int)rcount;
+            counts_root["records"] = (Json::UInt64)index_total;
+        }
 
-        if(has_warned[WARNING::BCFERROR])
+        const char * sampled = index_stats ? " (in checked records)" : "";
+        if(totals.has_warned[WARNING::BCFERROR])
         {
-            std::cerr << "[W] Variants that will cause trouble when writing BCF: " << has_warned[WARNING::BCFERROR] << "\n";
+            std::cerr << "[W] Variants that will cause trouble when writing BCF" << sampled << ": " << totals.has_warned[WARNING::BCFERROR] << "\n";
         }
 
-        if(has_warned[WARNING::REFPADDING])
+        if(totals.has_warned[WARNING::REFPADDING])
         {
-            std::cerr << "[W] Variants that have >1 base of reference padding: " << has_warned[WARNING::REFPADDING] << "\n";
+            std::cerr << "[W] Variants that have >1 base of reference padding" << sampled << ": " << totals.has_warned[WARNING::REFPADDING] << "\n";
         }
-        if(has_warned[WARNING::OVERLAP])
+        if(totals.has_warned[WARNING::OVERLAP])
         {
-            std::cerr << "[W] Variants that overlap on the reference allele: " << has_warned[WARNING::OVERLAP] << "\n";
+            std::cerr << "[W] Variants that overlap on the reference allele" << sampled << ": " << totals.has_warned[WARNING::OVERLAP] << "\n";
         }
-        if(has_warned[WARNING::SYMALT])
+        if(totals.has_warned[WARNING::SYMALT])
         {
-            std::cerr << "[W] Variants that have symbolic ALT alleles: " << has_warned[WARNING::SYMALT] << "\n";
+            std::cerr << "[W] Variants that have symbolic ALT alleles" << sampled << ": " << totals.has_warned[WARNING::SYMALT] << "\n";
         }
-        if(has_warned[WARNING::UNCERTAINLENGTH])
+        if(totals.has_warned[WARNING::UNCERTAINLENGTH])
         {
-            std::cerr << "[W] Variants that have alleles with uncertain length: " << has_warned[WARNING::UNCERTAINLENGTH] << "\n";
+            std::cerr << "[W] Variants that have alleles with uncertain length" << sampled << ": " << totals.has_warned[WARNING::UNCERTAINLENGTH] << "\n";
         }
 
-        std::cerr << "[I] Total VCF records:         " << rcount << "\n";
-        std::cerr << "[I] Non-reference VCF records: " << n_nonref << "\n";
+        if(index_stats)
+        {
+            std::cerr << "[I] Total VCF records (index): " << index_total << "\n";
+            std::cerr << "[I] Checked VCF records:       " << rcount << "\n";
+            std::cerr << "[I] Non-reference checked:     " << totals.nonref_records << "\n";
+        }
+        else
+        {
+            std::cerr << "[I] Total VCF records:         " << rcount << "\n";
+            std::cerr << "[I] Non-reference VCF records: " << totals.nonref_records << "\n";
+        }
 
         if(!output_file.empty())
         {
@@ -611,7 +1054,6 @@ int main(int argc, char *argv[])
             output << fw.write(counts_root);
         }
 
-        bcf_sr_destroy(reader);
     }
     catch(std::runtime_error & e)
     {
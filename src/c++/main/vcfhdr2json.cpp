@@ -33,23 +33,96 @@
  *
  */
 
+
 #include <boost/program_options.hpp>
 #include <iostream>
 #include <fstream>
 
 #include "json/json.h"
 
-#include "htslib/tbx.h"
 #include "htslib/vcf.h"
 
+#include "helpers/BCFHelpers.hh"
+
 #include "Version.hh"
 #include "Error.hh"
 
+namespace
+{
+    /** read the header of a VCF / BCF file and the contigs in its index */
+    Json::Value headerToJson(std::string const & file)
+    {
+        // only the header blocks are read here
+        htsFile * fp = bcf_open(file.c_str(), "r");
+        if(!fp)
+        {
+            error("Cannot open %s", file.c_str());
+        }
+        bcf_hdr_t * hdr = bcf_hdr_read(fp);
+        if(!hdr)
+        {
+            bcf_close(fp);
+            error("Cannot read the VCF header from %s", file.c_str());
+        }
+
+        Json::Value root;
+        Json::Value a;
+        for (int i = 0; i < bcf_hdr_nsamples(hdr); ++i)
+        {
+            a.append(hdr->samples[i]);
+        }
+        root["samples"] = a;
+
+        Json::Value fields;
+        for (int i = 0; i < hdr->nhrec; i++)
+        {
+            Json::Value field;
+            field["key"] = hdr->hrec[i]->key;
+            if (!hdr->hrec[i]->value)
+            {
+                Json::Value values;
+
+                for (int j = 0; j < hdr->hrec[i]->nkeys; j++)
+                {
+                    values[hdr->hrec[i]->keys[j]] = hdr->hrec[i]->vals[j];
+                }
+                field["values"] = values;
+            }
+            else
+            {
+                field["value"] = hdr->hrec[i]->value;
+            }
+            fields.append(field);
+        }
+        root["fields"] = fields;
+
+        std::vector<std::string> contigs;
+        if(!bcfhelpers::getIndexContigs(file.c_str(), hdr, contigs))
+        {
+            root["tabix"] = Json::Value::null;
+        }
+        else
+        {
+            root["tabix"] = Json::Value();
+            root["tabix"]["chromosomes"] = Json::Value();
+            for(auto const & c : contigs)
+            {
+                root["tabix"]["chromosomes"].append(c);
+            }
+        }
+
+        bcf_close(fp);
+        bcf_hdr_destroy(hdr);
+        return root;
+    }
+}
+
 int main(int argc, char* argv[]) {
     namespace po = boost::program_options;
 
-    std::string file;
+    std::vector<std::string> files;
     std::string output;
+    bool json_lines = false;
 
     try
     {
@@ -57,14 +130,15 @@ int main(int argc, char* argv[]) {
         po::options_description desc("Allowed options");
         desc.add_options()
             ("help,h", "produce help message")
-            ("version", "Show version")            
-            ("input-file", po::value< std::string >(), "The input files")
+            ("version", "Show version")
+            ("input-file", po::value< std::vector<std::string> >(), "The input files")
             ("output-file", po::value<std::string>(), "The output file name.")
+            ("json-lines", po::value<bool>(), "Write one JSON line per input file. In this mode, any number of input "
+                                              "files can be given, and output goes to stdout unless --output-file is specified.")
         ;
 
         po::positional_options_description popts;
-        popts.add("input-file", 1);
-        popts.add("output-file", 1);
+        popts.add("input-file", -1);
 
         po::options_description cmdline_options;
         cmdline_options
@@ -91,7 +165,7 @@ int main(int argc, char* argv[]) {
 
         if (vm.count("input-file"))
         {
-            file = vm["input-file"].as< std::string > ();
+            files = vm["input-file"].as< std::vector<std::string> > ();
         }
 
         if (vm.count("output-file"))
@@ -99,7 +173,34 @@ int main(int argc, char* argv[]) {
             output = vm["output-file"].as< std::string >();
         }
 
-        if(file.size() == 0)
+        if (vm.count("json-lines"))
+        {
+            json_lines = vm["json-lines"].as< bool >();
+        }
+
+        if(json_lines)
+        {
+            if(output == "")
+            {
+                output = "-";
+            }
+        }
+        else
+        {
+            // vcfhdr2json input.vcf output.json
+            if(output == "" && files.size() == 2)
+            {
+                output = files.back();
+                files.pop_back();
+            }
+            if(files.size() > 1)
+            {
+                std::cerr << "Please use --json-lines to process more than one input file.\n";
+                return 1;
+            }
+        }
+
+        if(files.size() == 0)
         {
             std::cerr << "Please specify an input file.\n";
             return 1;
@@ -119,88 +220,28 @@ int main(int argc, char* argv[]) {
 
     try
     {
-        Json::StyledWriter writer;
-        htsFile * fp = bcf_open(file.c_str(), "r");
-        bcf_hdr_t * hdr = bcf_hdr_read(fp);
-
-        Json::Value root;
-        Json::Value a;
-        for (int i = 0; i < bcf_hdr_nsamples(hdr); ++i)
+        if(json_lines)
         {
-            a.append(hdr->samples[i]);
-        }
-        root["samples"] = a;
-
-        Json::Value fields;
-        for (int i = 0; i < hdr->nhrec; i++)
-        {
-            Json::Value field;
-            field["key"] = hdr->hrec[i]->key;
-            if (!hdr->hrec[i]->value)
+            Json::FastWriter writer;
+            std::ofstream out_file;
+            if(output != "-")
             {
-                Json::Value values;
-
-                for (int j = 0; j < hdr->hrec[i]->nkeys; j++)
-                {
-                    values[hdr->hrec[i]->keys[j]] = hdr->hrec[i]->vals[j];
-                }
-                field["values"] = values;
+                out_file.open(output.c_str());
             }
-            else
+            std::ostream & out = output != "-" ? out_file : std::cout;
+            for(auto const & file : files)
             {
-                field["value"] = hdr->hrec[i]->value;
-            }
-            fields.append(field);
-        }
-        root["fields"] = fields;
-
-        tbx_t * tbx_idx = tbx_index_load(file.c_str());
-        if ( !tbx_idx )
-        {
-            hts_idx_t * csi_idx = bcf_index_load(file.c_str());
-            if(!csi_idx)
-            {
-                root["tabix"] = Json::Value::null;
-            }
-            else
-            {
-                root["tabix"] = Json::Value();
-                root["tabix"]["chromosomes"] = Json::Value();
-
-                int count = 0;
-                const char ** tbx_names = bcf_index_seqnames(csi_idx, hdr, &count);
-
-                for (int i = 0; i < count; ++i)
-                {
-                    root["tabix"]["chromosomes"].append(tbx_names[i]);
-                }
-                free(tbx_names);
-                hts_idx_destroy(csi_idx);
+                // flush after every file so readers can process results as they arrive
+                out << writer.write(headerToJson(file)) << std::flush;
             }
         }
         else
         {
-            root["tabix"] = Json::Value();
-            root["tabix"]["chromosomes"] = Json::Value();
-
-            int count = 0;
-            const char ** tbx_names = tbx_seqnames(tbx_idx, &count);
-
-            for (int i = 0; i < count; ++i)
-            {
-                root["tabix"]["chromosomes"].append(tbx_names[i]);
-            }
-
-            free(tbx_names);
-            tbx_destroy(tbx_idx);
+            Json::StyledWriter writer;
+            Json::Value root = headerToJson(files[0]);
+            std::ofstream out(output.c_str());
+            out << writer.write(root);
         }
-
-
-        std::ofstream out(output.c_str());
-        out << writer.write(root);
-
-        bcf_close(fp);
-        bcf_hdr_destroy(hdr);
     } 
     catch(std::runtime_error & e)
     {
@@ -45,6 +45,10 @@
 #include "GraphReference.hh"
 #include "DiploidCompare.hh"
 #include "VariantInput.hh"
+#include "variant/VariantMergeReader.hh"
+#include "QuantifyPipeline.hh"
+#include "QuantifyRegions.hh"
+#include "helpers/RocOutput.hh"
 
 #include <iostream>
 #include <fstream>
@@ -95,6 +99,31 @@ int main(int argc, char* argv[]) {
     bool always_hapcmp = false;
     bool no_hapcmp = false;
 
+    // in-process quantification
+    std::string out_roc = "";
+    std::string out_quantify_vcf = "";
+    std::vector<std::string> quantify_regions;
+    std::vector<std::string> roc_regions = {"*"};
+    std::string roc_filter = "";
+    double roc_delta = 0.1;
+    bool output_rocs = true;
+    bool output_vtc = true;
+    bool clean_info = true;
+    bool count_homref = false;
+    bool fixchr = false;
+    int threads = 1;
+    int blocksize = 20000;
+
+    bool worker = false;
+    int compression_level = -1;
+
+    // inline preprocessing
+    bool decompose_truth = false;
+    bool leftshift_truth = false;
+    bool decompose_query = false;
+    bool leftshift_query = false;
+    bool haploid_X = false;
+
     try
     {
         // Declare the supported options.
@@ -120,6 +149,34 @@ int main(int argc, char* argv[]) {
             ("apply-filters-query,f", po::value<bool>(), "Apply filtering in query VCF (off by default).")
             ("always-hapcmp", po::value<bool>(), "Always compare haplotype blocks (even if they match). Testing use only/slow.")
             ("no-hapcmp", po::value<bool>(), "Disable haplotype comparison. This overrides all other haplotype comparison options.")
+            ("quantify,Q", po::value<std::string>(), "Count comparison results in-process and write the quantify ROC table (TSV) to this file. "
+                "This replaces running quantify on the output of --output-vcf.")
+            ("quantify-vcf", po::value<std::string>(), "With --quantify, write the annotated VCF (as quantify -v) to this file.")
+            ("quantify-regions", po::value< std::vector<std::string> >(),
+                "Stratification region bed file for --quantify (see quantify -R).")
+            ("roc-regions", po::value< std::vector<std::string> >(), "Regions to compute ROCs in (see quantify --roc-regions).")
+            ("roc-filter", po::value<std::string>(), "Ignore certain filters when creating a ROC.")
+            ("roc-delta", po::value<double>(), "Minium spacing of levels on ROC QQ trace.")
+            ("output-rocs", po::value<bool>(), "Output ROCs with full set of levels of QQ values (default is 1).")
+            ("output-vtc", po::value<bool>(), "Output variant types counted (debugging).")
+            ("clean-info", po::value<bool>(), "Set to zero to preserve INFO fields (default is 1)")
+            ("count-homref", po::value<bool>(), "Count homref locations.")
+            ("fix-chr-regions", po::value<bool>(), "Add chr prefix to regions if necessary (default is off).")
+            ("threads", po::value<int>(), "Number of threads to use for counting with --quantify.")
+            ("blocksize", po::value<int>(), "Number of variants per counting block.")
+            ("compression-level", po::value<int>(), "BGZF compression level for .vcf.gz / .bcf output (0-9, 1 is fastest). "
+                "The default is the htslib default.")
+            ("worker", po::value<bool>(), "Run as a worker process: read requests from stdin, one per line "
+                "(location<TAB>output VCF), and write one line per request to stdout when done "
+                "(OK<TAB>location or ERROR<TAB>location<TAB>message). Input files, indexes and the "
+                "reference stay open between requests.")
+            ("decompose-truth", po::value<bool>(), "Decompose truth variants into primitives while reading (as preprocess -V).")
+            ("leftshift-truth", po::value<bool>(), "Left-shift truth indels while reading (as preprocess -L).")
+            ("decompose-query", po::value<bool>(), "Decompose query variants into primitives while reading (as preprocess -V).")
+            ("leftshift-query", po::value<bool>(), "Left-shift query indels while reading (as preprocess -L).")
+            ("haploid-x", po::value<bool>(), "Expand GTs on chrX: turn 1 into 1/1 (as preprocess --haploid-x). "
+                "With this or any of the options above, both inputs are preprocessed while reading, "
+                "this gives the same results as running them through preprocess first.")
         ;
 
         po::positional_options_description popts;
@@ -270,6 +327,122 @@ int main(int argc, char* argv[]) {
         {
             no_hapcmp = vm["no-hapcmp"].as< bool >();
         }
+
+        if (vm.count("quantify"))
+        {
+            out_roc = vm["quantify"].as< std::string >();
+        }
+
+        if (vm.count("quantify-vcf"))
+        {
+            out_quantify_vcf = vm["quantify-vcf"].as< std::string >();
+        }
+
+        if (vm.count("quantify-regions"))
+        {
+            quantify_regions = vm["quantify-regions"].as< std::vector<std::string> >();
+        }
+
+        if (vm.count("roc-regions"))
+        {
+            roc_regions = vm["roc-regions"].as< std::vector<std::string> >();
+        }
+
+        if (vm.count("roc-filter"))
+        {
+            roc_filter = vm["roc-filter"].as< std::string >();
+        }
+
+        if (vm.count("roc-delta"))
+        {
+            roc_delta = vm["roc-delta"].as< double >();
+        }
+
+        if (vm.count("output-rocs"))
+        {
+            output_rocs = vm["output-rocs"].as< bool >();
+        }
+
+        if (vm.count("output-vtc"))
+        {
+            output_vtc = vm["output-vtc"].as< bool >();
+        }
+
+        if (vm.count("clean-info"))
+        {
+            clean_info = vm["clean-info"].as< bool >();
+        }
+
+        if (vm.count("count-homref"))
+        {
+            count_homref = vm["count-homref"].as< bool >();
+        }
+
+        if (vm.count("fix-chr-regions"))
+        {
+            fixchr = vm["fix-chr-regions"].as< bool >();
+        }
+
+        if (vm.count("threads"))
+        {
+            threads = vm["threads"].as< int >();
+        }
+
+        if (vm.count("blocksize"))
+        {
+            blocksize = vm["blocksize"].as< int >();
+        }
+
+        if (vm.count("compression-level"))
+        {
+            compression_level = vm["compression-level"].as< int >();
+        }
+
+        if (vm.count("worker"))
+        {
+            worker = vm["worker"].as< bool >();
+        }
+
+        if (vm.count("decompose-truth"))
+        {
+            decompose_truth = vm["decompose-truth"].as< bool >();
+        }
+
+        if (vm.count("leftshift-truth"))
+        {
+            leftshift_truth = vm["leftshift-truth"].as< bool >();
+        }
+
+        if (vm.count("decompose-query"))
+        {
+            decompose_query = vm["decompose-query"].as< bool >();
+        }
+
+        if (vm.count("leftshift-query"))
+        {
+            leftshift_query = vm["leftshift-query"].as< bool >();
+        }
+
+        if (vm.count("haploid-x"))
+        {
+            haploid_X = vm["haploid-x"].as< bool >();
+        }
+
+        if (worker && (out_roc != "" || out_vcf != "" || chr != ""))
+        {
+            error("--worker reads locations and output files from stdin, it cannot be combined "
+                  "with --location, --output-vcf or --quantify.");
+        }
+
+        if (out_roc != "" && out_vcf != "")
+        {
+            error("--output-vcf cannot be combined with --quantify, use --quantify-vcf to write the annotated VCF.");
+        }
+
+        if (out_roc == "" && out_quantify_vcf != "")
+        {
+            error("--quantify-vcf requires --quantify.");
+        }
     }
     catch (po::error & e)
     {
@@ -292,50 +465,53 @@ int main(int argc, char* argv[]) {
         VariantReader vr;
         vr.setReturnHomref(false);
 
+        // with inline preprocessing, each input is normalised separately and the results
+        // are merged like vr would merge the preprocessed files
+        std::unique_ptr<VariantMergeReader> p_mr;
+        if(decompose_truth || leftshift_truth || decompose_query || leftshift_query || haploid_X)
+        {
+            p_mr = std::move(std::unique_ptr<VariantMergeReader>(new VariantMergeReader(ref_fasta.c_str())));
+        }
+
         if(regions_bed != "")
         {
-            vr.setRegions(regions_bed.c_str(), true);
+            if(p_mr)
+            {
+                p_mr->setRegions(regions_bed.c_str(), true);
+            }
+            else
+            {
+                vr.setRegions(regions_bed.c_str(), true);
+            }
         }
         if(targets_bed != "")
         {
-            vr.setTargets(targets_bed.c_str(), true);
+            if(p_mr)
+            {
+                p_mr->setTargets(targets_bed.c_str(), true);
+            }
+            else
+            {
+                vr.setTargets(targets_bed.c_str(), true);
+            }
         }
 
-        int r1 = vr.addSample(file1.c_str(), sample1.c_str());
-        int r2 = vr.addSample(file2.c_str(), sample2.c_str());
-
-        vr.setApplyFilters(apply_filters_truth, r1);
-        /* now handled after comparison */
-        /* vr.setApplyFilters(apply_filters_query, r2); */
-
-        // variant input to re-trim alleles
-        bool stop_after_chr_change = false;
-        if(chr != "")
+        int r1, r2;
+        if(p_mr)
         {
-            vr.rewind(chr.c_str(), start);
-            stop_after_chr_change = true;
+            p_mr->setFixChrXGTs(haploid_X);
+            r1 = p_mr->addSample(file1.c_str(), sample1.c_str(), haploid_X, decompose_truth, leftshift_truth);
+            r2 = p_mr->addSample(file2.c_str(), sample2.c_str(), haploid_X, decompose_query, leftshift_query);
+            p_mr->setApplyFilters(apply_filters_truth, r1);
         }
-
-        std::unique_ptr<VariantWriter> pvw;
-        if (out_vcf != "")
+        else
         {
-            pvw = std::move(std::unique_ptr<VariantWriter> (new VariantWriter(out_vcf.c_str(), ref_fasta.c_str())));
-            pvw->addHeader(vr);
-            pvw->addHeader("##INFO=<ID=gtt1,Number=1,Type=String,Description=\"GT of truth call\">");
-            pvw->addHeader("##INFO=<ID=gtt2,Number=1,Type=String,Description=\"GT of query call\">");
-            pvw->addHeader("##INFO=<ID=type,Number=1,Type=String,Description=\"Decision for call (TP/FP/FN/N)\">");
-            pvw->addHeader("##INFO=<ID=kind,Number=1,Type=String,Description=\"Sub-type for decision (match/mismatch type)\">");
-            pvw->addHeader("##INFO=<ID=ctype,Number=1,Type=String,Description=\"Type of comparison performed\">");
-            pvw->addHeader("##INFO=<ID=HapMatch,Number=0,Type=Flag,Description=\"Variant is in matching haplotype block\">");
-            pvw->addHeader("##INFO=<ID=BS,Number=1,Type=Integer,Description=\"Start position of the benchmarking superlocus on current chromosome\">");
-            pvw->addHeader((std::string("##INFO=<ID=IQQ,Number=1,Type=Float,Description=\"Quality value for query variants (")
-                            + qq + ").\">").c_str());
-            if(apply_filters_query)
-            {
-                pvw->addHeader("##INFO=<ID=Q_FILTERED,Number=0,Type=Flag,Description=\"Filtered call in query\">");
-            }
-            pvw->addSample("TRUTH");
-            pvw->addSample("QUERY");
+            r1 = vr.addSample(file1.c_str(), sample1.c_str());
+            r2 = vr.addSample(file2.c_str(), sample2.c_str());
+
+            vr.setApplyFilters(apply_filters_truth, r1);
+            /* now handled after comparison */
+            /* vr.setApplyFilters(apply_filters_query, r2); */
         }
 
         std::ostream * error_out_stream = NULL;
@@ -351,267 +527,398 @@ int main(int argc, char* argv[]) {
         hc.setMaxHapEnum(max_n_haplotypes);
         hc.setDoAlignments(false);
 
-        int64_t nhb = 0;
-        int64_t last_pos = std::numeric_limits<int64_t>::max();
-
-        // hap-block status + update
-        std::list<Variants> block_variants;
-        int64_t block_start = -1;
-        int64_t block_end = -1;
-        int n_nonsnp = 0, calls_1 = 0, calls_2 = 0;
-        bool has_mismatch = false;
-
-        const auto finish_block = [&block_variants, r1, r2,
-                                   &chr,
-                                   &block_start,
-                                   &block_end,
-                                   &n_nonsnp, &calls_1, &calls_2,
-                                   &has_mismatch,
-                                   &pvw, &error_out_stream,
-                                   &hc,
-                                   qq,
-                                   hb_expand,
-                                   no_hapcmp,
-                                   always_hapcmp,
-                                   apply_filters_query] ()
-        {
-            bool hap_match = false, hap_fail = false, hap_run = false;
-            // try HC if we have mismatches, and if the number of calls is > 0
-            if (!no_hapcmp && (always_hapcmp || (has_mismatch && calls_1 > 0 && calls_2 > 0 && n_nonsnp > 0)))
+        // compare one location (or everything when chr is empty) and write the output
+        const auto compare_location = [&](std::string chr, int64_t start, int64_t end, std::string const & out_vcf)
+        {
+            // variant input to re-trim alleles
+            bool stop_after_chr_change = false;
+            if(chr != "")
             {
-                try
+                if(p_mr)
+                {
+                    p_mr->rewind(chr.c_str(), start);
+                }
+                else
+                {
+                    vr.rewind(chr.c_str(), start);
+                }
+                stop_after_chr_change = true;
+            }
+
+            std::unique_ptr<VariantWriter> pvw;
+            if (out_vcf != "" || out_roc != "")
+            {
+                // when quantifying, records are only encoded and passed on to the quantifier
+                pvw = std::move(std::unique_ptr<VariantWriter> (new VariantWriter(out_vcf.c_str(), ref_fasta.c_str(), compression_level)));
+                if(p_mr)
                 {
-                    hap_run = true;
-                    hap_fail = true;
-                    std::list<Variants> vl_filtered = block_variants;
-                    if(apply_filters_query)
+                    pvw->addHeader(p_mr->getReader(r1));
+                    pvw->addHeader(p_mr->getReader(r2));
+                }
+                else
+                {
+                    pvw->addHeader(vr);
+                }
+                pvw->addHeader("##INFO=<ID=gtt1,Number=1,Type=String,Description=\"GT of truth call\">");
+                pvw->addHeader("##INFO=<ID=gtt2,Number=1,Type=String,Description=\"GT of query call\">");
+                pvw->addHeader("##INFO=<ID=type,Number=1,Type=String,Description=\"Decision for call (TP/FP/FN/N)\">");
+                pvw->addHeader("##INFO=<ID=kind,Number=1,Type=String,Description=\"Sub-type for decision (match/mismatch type)\">");
+                pvw->addHeader("##INFO=<ID=ctype,Number=1,Type=String,Description=\"Type of comparison performed\">");
+                pvw->addHeader("##INFO=<ID=HapMatch,Number=0,Type=Flag,Description=\"Variant is in matching haplotype block\">");
+                pvw->addHeader("##INFO=<ID=BS,Number=1,Type=Integer,Description=\"Start position of the benchmarking superlocus on current chromosome\">");
+                pvw->addHeader((std::string("##INFO=<ID=IQQ,Number=1,Type=Float,Description=\"Quality value for query variants (")
+                                + qq + ").\">").c_str());
+                if(apply_filters_query)
+                {
+                    pvw->addHeader("##INFO=<ID=Q_FILTERED,Number=0,Type=Flag,Description=\"Filtered call in query\">");
+                }
+                pvw->addSample("TRUTH");
+                pvw->addSample("QUERY");
+            }
+
+            // in-process quantification: count superloci as they are compared
+            QuantifyRegions regions;
+            std::unique_ptr<FastaFile> quantify_ref;
+            std::unique_ptr<QuantifyPipeline> pqp;
+            if (out_roc != "")
+            {
+                regions.load(quantify_regions, fixchr);
+
+                std::string qparams = "";
+                if(output_vtc)
+                {
+                    qparams += "output_vtc;";
+                }
+                if(regions.hasRegions("CONF"))
+                {
+                    qparams += "count_unk;";
+                }
+                if(count_homref)
+                {
+                    qparams += "count_homref;";
+                }
+                if(clean_info)
+                {
+                    qparams += "clean_info;";
+                }
+                // the QQ values are extracted into IQQ below
+                qparams += "QQ:IQQ;";
+                qparams += "extended_counts;";
+
+                quantify_ref.reset(new FastaFile(ref_fasta.c_str()));
+                pqp.reset(new QuantifyPipeline(pvw->getHeader(), *quantify_ref, regions,
+                                               "xcmp", qparams, roc_filter, threads, blocksize));
+                if (out_quantify_vcf != "")
+                {
+                    pqp->setOutputVCF(out_quantify_vcf);
+                }
+                pqp->setComputeRocs(true);
+            }
+
+            int64_t nhb = 0;
+            int64_t last_pos = std::numeric_limits<int64_t>::max();
+
+            // hap-block status + update
+            std::list<Variants> block_variants;
+            int64_t block_start = -1;
+            int64_t block_end = -1;
+            int n_nonsnp = 0, calls_1 = 0, calls_2 = 0;
+            bool has_mismatch = false;
+
+            const auto finish_block = [&block_variants, r1, r2,
+                                       &chr,
+                                       &block_start,
+                                       &block_end,
+                                       &n_nonsnp, &calls_1, &calls_2,
+                                       &has_mismatch,
+                                       &pvw, &pqp, &error_out_stream,
+                                       &hc,
+                                       qq,
+                                       hb_expand,
+                                       no_hapcmp,
+                                       always_hapcmp,
+                                       apply_filters_query] ()
+            {
+                bool hap_match = false, hap_fail = false, hap_run = false;
+                // try HC if we have mismatches, and if the number of calls is > 0
+                if (!no_hapcmp && (always_hapcmp || (has_mismatch && calls_1 > 0 && calls_2 > 0 && n_nonsnp > 0)))
+                {
+                    try
                     {
-                        for(auto & v : vl_filtered)
+                        hap_run = true;
+                        hap_fail = true;
+                        std::list<Variants> vl_filtered = block_variants;
+                        if(apply_filters_query)
                         {
-                            for(auto & c : v.calls)
+                            for(auto & v : vl_filtered)
                             {
-                                // turn filtered calls into no-calls
-                                for (size_t i = 0; i < c.nfilter; ++i)
+                                for(auto & c : v.calls)
                                 {
-                                    if(c.filter[i] != "PASS" && c.filter[i] != ".")
+                                    // turn filtered calls into no-calls
+                                    for (size_t i = 0; i < c.nfilter; ++i)
                                     {
-                                        c.ngt = 0;
-                                        break;
+                                        if(c.filter[i] != "PASS" && c.filter[i] != ".")
+                                        {
+                                            c.ngt = 0;
+                                            break;
+                                        }
                                     }
                                 }
                             }
                         }
-                    }
-                    hc.setRegion(chr.c_str(), std::max(int64_t(0), block_start-hb_expand), block_end + hb_expand,
-                                 vl_filtered, r1, r2);
-                    DiploidComparisonResult const & hcr = hc.getResult();
+                        hc.setRegion(chr.c_str(), std::max(int64_t(0), block_start-hb_expand), block_end + hb_expand,
+                                     vl_filtered, r1, r2);
+                        DiploidComparisonResult const & hcr = hc.getResult();
 #ifdef DEBUG_XCMP
-                    std::cerr << chr << ":" << block_start << "-" << block_end << " variants: " << "\n";
-                    for(auto const & x : block_variants)
+                        std::cerr << chr << ":" << block_start << "-" << block_end << " variants: " << "\n";
+                        for(auto const & x : block_variants)
+                        {
+                            std::cerr << x << "\n";
+                        }
+                        std::cerr << "Block result: " << "\n";
+                        std::cerr << hcr << "\n";
+#endif
+                        hap_match = hcr.outcome == dco_match;
+                        hap_fail = !(hcr.outcome == dco_match || hcr.outcome == dco_mismatch);
+                    }
+                    catch(std::runtime_error &e)
                     {
-                        std::cerr << x << "\n";
+                        if (error_out_stream)
+                        {
+                            *error_out_stream << chr << "\t" << block_start << "\t" << block_end+1 << "\t" << "hap_error\t" << e.what() << "\n";
+                        }
                     }
-                    std::cerr << "Block result: " << "\n";
-                    std::cerr << hcr << "\n";
-#endif
-                    hap_match = hcr.outcome == dco_match;
-                    hap_fail = !(hcr.outcome == dco_match || hcr.outcome == dco_mismatch);
-                }
-                catch(std::runtime_error &e)
-                {
-                    if (error_out_stream)
+                    catch(std::logic_error &e)
                     {
-                        *error_out_stream << chr << "\t" << block_start << "\t" << block_end+1 << "\t" << "hap_error\t" << e.what() << "\n";
+                        if (error_out_stream)
+                        {
+                            *error_out_stream << chr << "\t" << block_start << "\t" << block_end+1 << "\t" << "hap_error\t" << e.what() << "\n";
+                        }
                     }
                 }
-                catch(std::logic_error &e)
+                std::string result;
+                if(hap_run)
                 {
-                    if (error_out_stream)
+                    if (hap_fail)
                     {
-                        *error_out_stream << chr << "\t" << block_start << "\t" << block_end+1 << "\t" << "hap_error\t" << e.what() << "\n";
+                        result = "hapfail:";
+                    }
+                    else if(has_mismatch)
+                    {
+                        result = "hap:";
+                    }
+                    else
+                    {
+                        result = "simple:";
                     }
-                }
-            }
-            std::string result;
-            if(hap_run)
-            {
-                if (hap_fail)
-                {
-                    result = "hapfail:";
-                }
-                else if(has_mismatch)
-                {
-                    result = "hap:";
                 }
                 else
                 {
                     result = "simple:";
                 }
-            }
-            else
-            {
-                result = "simple:";
-            }
 
-            if(hap_run && !has_mismatch && !hap_match)
-            {
-                result += "suspicious_simple_match";
-            }
-            else if(always_hapcmp && hap_match && ((calls_1 == 0 && calls_2 > 0) || (calls_1 > 0 && calls_2 == 0)))
-            {
-                bool any_filtered = false;
-                for (Variants const & v : block_variants)
+                if(hap_run && !has_mismatch && !hap_match)
                 {
-                    for (Call const & c : v.calls)
+                    result += "suspicious_simple_match";
+                }
+                else if(always_hapcmp && hap_match && ((calls_1 == 0 && calls_2 > 0) || (calls_1 > 0 && calls_2 == 0)))
+                {
+                    bool any_filtered = false;
+                    for (Variants const & v : block_variants)
                     {
-                        for (size_t i = 0; i < c.nfilter; ++i)
+                        for (Call const & c : v.calls)
                         {
-                            if(c.filter[i] != "PASS" && c.filter[i] != ".")
+                            for (size_t i = 0; i < c.nfilter; ++i)
                             {
-                                any_filtered = true;
-                                break;
+                                if(c.filter[i] != "PASS" && c.filter[i] != ".")
+                                {
+                                    any_filtered = true;
+                                    break;
+                                }
                             }
                         }
+                        if(any_filtered)
+                        {
+                            break;
+                        }
                     }
+
                     if(any_filtered)
                     {
-                        break;
+                        result += "match_ignoring_filtered";
+                    }
+                    else
+                    {
+                        result += "suspicious_hap_match";
                     }
                 }
-
-                if(any_filtered)
+                else if(hap_match || !has_mismatch)
                 {
-                    result += "match_ignoring_filtered";
+                    result += "match";
                 }
                 else
                 {
-                    result += "suspicious_hap_match";
+                    result += "mismatch";
                 }
-            }
-            else if(hap_match || !has_mismatch)
-            {
-                result += "match";
-            }
-            else
-            {
-                result += "mismatch";
-            }
 
-            if(error_out_stream && hap_fail)
-            {
-                *error_out_stream << chr << "\t" << block_start << "\t" << block_end+1 << "\t" << result << "\t"
-                                  << has_mismatch << ":" << hap_match << ":" << hap_fail << ":"
-                                  << calls_1 << ":" << calls_2 << ":" << n_nonsnp << "\n";
-            }
-            if (pvw)
-            {
-                for (Variants & v : block_variants)
+                if(error_out_stream && hap_fail)
                 {
-                    v.setInfo("BS", (int)block_start + 1);
-
-                    if(qq == "QUAL")
-                    {
-                        v.setInfo("IQQ", v.calls[r2].qual);
-                    }
-                    else if(v.infos.isMember(qq))
-                    {
-                        v.setInfo("IQQ", v.infos[qq].asFloat());
-                    }
-                    else if(v.calls[r2].formats.isMember(qq))
+                    *error_out_stream << chr << "\t" << block_start << "\t" << block_end+1 << "\t" << result << "\t"
+                                      << has_mismatch << ":" << hap_match << ":" << hap_fail << ":"
+                                      << calls_1 << ":" << calls_2 << ":" << n_nonsnp << "\n";
+                }
+                if (pvw)
+                {
+                    for (Variants & v : block_variants)
                     {
-                        v.setInfo("IQQ", v.calls[r2].formats[qq].asFloat());
-                    }
+                        v.setInfo("BS", (int)block_start + 1);
 
-                    v.setInfo("ctype", result.c_str());
-                    if (hap_match)
-                    {
-                        v.setInfo("HapMatch", true);
-                    }
-                    if(apply_filters_query)
-                    {
-                        for(size_t f = 0; f < v.calls[r2].nfilter; ++f)
+                        if(qq == "QUAL")
+                        {
+                            v.setInfo("IQQ", v.calls[r2].qual);
+                        }
+                        else if(v.infos.isMember(qq))
+                        {
+                            v.setInfo("IQQ", v.infos[qq].asFloat());
+                        }
+                        else if(v.calls[r2].formats.isMember(qq))
                         {
-                            if(v.calls[r2].filter[f] != "PASS" && v.calls[r2].filter[f] != ".")
+                            v.setInfo("IQQ", v.calls[r2].formats[qq].asFloat());
+                        }
+
+                        v.setInfo("ctype", result.c_str());
+                        if (hap_match)
+                        {
+                            v.setInfo("HapMatch", true);
+                        }
+                        if(apply_filters_query)
+                        {
+                            for(size_t f = 0; f < v.calls[r2].nfilter; ++f)
                             {
-                                v.setInfo("Q_FILTERED", true);
-                                break;
+                                if(v.calls[r2].filter[f] != "PASS" && v.calls[r2].filter[f] != ".")
+                                {
+                                    v.setInfo("Q_FILTERED", true);
+                                    break;
+                                }
                             }
                         }
+                        if (pqp)
+                        {
+                            pqp->add(pvw->encode(v));
+                        }
+                        else
+                        {
+                            pvw->put(v);
+                        }
                     }
-                    pvw->put(v);
                 }
-            }
-
-            block_variants.clear();
-            block_start = -1;
-            block_end = -1;
-            n_nonsnp = 0;
-            calls_1 = 0;
-            calls_2 = 0;
-            has_mismatch = false;
-        };
 
-        auto start_time = std::chrono::high_resolution_clock::now();
-        auto last_time = std::chrono::high_resolution_clock::now();
-        while(vr.advance())
-        {
-            if(blimit > 0 && nhb++ > blimit)
+                block_variants.clear();
+                block_start = -1;
+                block_end = -1;
+                n_nonsnp = 0;
+                calls_1 = 0;
+                calls_2 = 0;
+                has_mismatch = false;
+            };
+
+            auto start_time = std::chrono::high_resolution_clock::now();
+            auto last_time = std::chrono::high_resolution_clock::now();
+            while(p_mr ? p_mr->advance() : vr.advance())
             {
-                // reached record limit
-                break;
-            }
-            Variants & v = vr.current();
+                if(blimit > 0 && nhb++ > blimit)
+                {
+                    // reached record limit
+                    break;
+                }
+                Variants & v = p_mr ? p_mr->current() : vr.current();
 
-            if(end != -1 && (v.pos > end || (chr.size() != 0 && chr != v.chr)))
-            {
-                // reached end
-                break;
-            }
+                if(end != -1 && (v.pos > end || (chr.size() != 0 && chr != v.chr)))
+                {
+                    // reached end
+                    break;
+                }
 
-            if(stop_after_chr_change && chr.size() != 0 && chr != v.chr)
-            {
-                // reached end of chr
-                break;
-            }
+                if(stop_after_chr_change && chr.size() != 0 && chr != v.chr)
+                {
+                    // reached end of chr
+                    break;
+                }
 
-            if(chr.size() == 0)
-            {
+                if(chr.size() == 0)
+                {
+                    chr = v.chr;
+                }
+
+                if (v.chr != chr || (block_end > 0 && block_end + hb_window < v.pos))
+                {
+                    finish_block();
+                }
                 chr = v.chr;
-            }
 
-            if (v.chr != chr || (block_end > 0 && block_end + hb_window < v.pos))
-            {
-                finish_block();
-            }
-            chr = v.chr;
+                if (block_start < 0)
+                {
+                    block_start = v.pos;
+                }
+                else
+                {
+                    block_start = std::min(block_start, v.pos);
+                }
 
-            if (block_start < 0)
-            {
-                block_start = v.pos;
-            }
-            else
-            {
-                block_start = std::min(block_start, v.pos);
-            }
+                if (block_end < 0)
+                {
+                    block_end = v.pos + v.len - 1;
+                }
+                else
+                {
+                    block_end = std::max(v.pos + v.len - 1, block_end);
+                }
 
-            if (block_end < 0)
-            {
-                block_end = v.pos + v.len - 1;
-            }
-            else
-            {
-                block_end = std::max(v.pos + v.len - 1, block_end);
-            }
+                if(compareVariants(v, r1, r2, n_nonsnp, calls_1, calls_2, !apply_filters_truth, !apply_filters_query) != dco_match)
+                {
+                    has_mismatch = true;
+                }
 
-            if(compareVariants(v, r1, r2, n_nonsnp, calls_1, calls_2, !apply_filters_truth, !apply_filters_query) != dco_match)
-            {
-                has_mismatch = true;
-            }
+                block_variants.push_back(v);
 
-            block_variants.push_back(v);
+#ifdef DEBUG_XCMP
+                std::cerr << v << "\n";
+                std::cerr << "block_start : " << block_start << "\t"
+                          << "block_end : " << block_end << "\t"
+                          << "block_size : " << block_variants.size() << "\t"
+                          << "n_nonsnp : " << n_nonsnp << "\t"
+                          << "calls_1 : " << calls_1 << "\t"
+                          << "calls_2 : " << calls_2 << "\t"
+                          << "\n";
+#endif
+
+                if(progress)
+                {
+                    using namespace std;
+                    auto end_time = chrono::high_resolution_clock::now();
+                    auto secs = chrono::duration_cast<chrono::seconds>(end_time - last_time).count();
+
+                    if(secs > progress_seconds)
+                    {
+                        auto secs_since_start = chrono::duration_cast<chrono::seconds>(end_time - start_time).count();
+                        std::string mbps = "";
+                        if(last_pos < v.pos)
+                        {
+                            mbps = " mpbs: ";
+                            mbps += std::to_string(double(v.pos - last_pos) / double(secs_since_start) * 1e-6);
+                        }
+                        else
+                        {
+                            last_pos = v.pos;
+                        }
+                        last_time = end_time;
 
+                        std::cerr << "[PROGRESS] Total time: " << secs_since_start << "s Pos: " << v.pos << mbps << "\n";
+                    }
+                }
+            }
 #ifdef DEBUG_XCMP
-            std::cerr << v << "\n";
+            std::cerr << "END\n";
             std::cerr << "block_start : " << block_start << "\t"
                       << "block_end : " << block_end << "\t"
                       << "block_size : " << block_variants.size() << "\t"
@@ -620,43 +927,64 @@ int main(int argc, char* argv[]) {
                       << "calls_2 : " << calls_2 << "\t"
                       << "\n";
 #endif
+            finish_block();
 
-            if(progress)
+            if(pqp)
             {
-                using namespace std;
-                auto end_time = chrono::high_resolution_clock::now();
-                auto secs = chrono::duration_cast<chrono::seconds>(end_time - last_time).count();
+                pqp->finish();
+                std::ofstream out_roc_stream(out_roc);
+                roc::ROCOutput ro(pqp->getRocs(), qq, output_rocs, roc_delta, regions, roc_regions);
+                ro.write(out_roc_stream);
+            }
+        };
 
-                if(secs > progress_seconds)
+        if(worker)
+        {
+            std::string line;
+            while(std::getline(std::cin, line))
+            {
+                if(line.empty())
                 {
-                    auto secs_since_start = chrono::duration_cast<chrono::seconds>(end_time - start_time).count();
-                    std::string mbps = "";
-                    if(last_pos < v.pos)
+                    continue;
+                }
+                std::vector<std::string> request;
+                stringutil::split(line, request, "\t");
+                const std::string location = request[0];
+                try
+                {
+                    if(request.size() != 2 || request[1] == "-")
                     {
-                        mbps = " mpbs: ";
-                        mbps += std::to_string(double(v.pos - last_pos) / double(secs_since_start) * 1e-6);
+                        error("Invalid request: '%s'", line.c_str());
                     }
-                    else
+                    std::string l_chr;
+                    int64_t l_start = -1, l_end = -1;
+                    stringutil::parsePos(location, l_chr, l_start, l_end);
+                    if(l_chr == "")
                     {
-                        last_pos = v.pos;
+                        error("Invalid location in request: '%s'", line.c_str());
                     }
-                    last_time = end_time;
-
-                    std::cerr << "[PROGRESS] Total time: " << secs_since_start << "s Pos: " << v.pos << mbps << "\n";
+                    compare_location(l_chr, l_start, l_end, request[1]);
+                    std::cout << "OK\t" << location << std::endl;
+                }
+                catch(std::runtime_error &e)
+                {
+                    std::cout << "ERROR\t" << location << "\t" << e.what() << std::endl;
+                }
+                catch(std::logic_error &e)
+                {
+                    std::cout << "ERROR\t" << location << "\t" << e.what() << std::endl;
+                }
+                if(error_out_stream)
+                {
+                    error_out_stream->flush();
                 }
             }
         }
-#ifdef DEBUG_XCMP
-        std::cerr << "END\n";
-        std::cerr << "block_start : " << block_start << "\t"
-                  << "block_end : " << block_end << "\t"
-                  << "block_size : " << block_variants.size() << "\t"
-                  << "n_nonsnp : " << n_nonsnp << "\t"
-                  << "calls_1 : " << calls_1 << "\t"
-                  << "calls_2 : " << calls_2 << "\t"
-                  << "\n";
-#endif
-        finish_block();
+        else
+        {
+            compare_location(chr, start, end, out_vcf);
+        }
+
         if(error_out_stream && out_errors != "-")
         {
             delete error_out_stream;
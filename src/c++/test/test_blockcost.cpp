@@ -0,0 +1,62 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/**
+ *
+ * \file test_blockcost.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#define BOOST_TEST_NO_MAIN
+#include <boost/test/unit_test.hpp>
+#include <boost/test/test_tools.hpp>
+
+#include "helpers/BlockCost.hh"
+
+BOOST_AUTO_TEST_CASE(testBlockCost)
+{
+    variant::BlockCost cost;
+    cost.record_weight = 1.0;
+    cost.indel_weight = 1.0;
+    cost.span_weight = 1.0;
+    cost.max_enum = 1024;
+
+    // one hom SNP: one record + one haplotype
+    BOOST_CHECK_CLOSE(cost(1, 0, 0, 1), 2.001, 1e-6);
+    // one het SNP: two haplotypes
+    BOOST_CHECK_CLOSE(cost(1, 1, 0, 1), 3.002, 1e-6);
+    // enumeration is exponential in the number of hets ...
+    BOOST_CHECK_CLOSE(cost(4, 4, 0, 0), 20.0, 1e-6);
+    // ... up to the enumeration limit
+    BOOST_CHECK_CLOSE(cost(20, 20, 0, 0), 1044.0, 1e-6);
+    BOOST_CHECK_CLOSE(cost(100, 100, 0, 0), 1124.0, 1e-6);
+    // indels and long blocks increase the cost per haplotype
+    BOOST_CHECK_CLOSE(cost(2, 1, 1, 2000), 2.0 + 2.0 * 2.0 * 3.0, 1e-6);
+    BOOST_CHECK(cost(10, 3, 0, 100) < cost(10, 6, 0, 100));
+}
@@ -0,0 +1,208 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/**
+ *
+ * \file test_concatparts.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#define BOOST_TEST_NO_MAIN
+#include <boost/test/unit_test.hpp>
+#include <boost/test/test_tools.hpp>
+#include <boost/filesystem.hpp>
+
+#include <string>
+#include <vector>
+
+#include <htslib/hts.h>
+#include <htslib/kstring.h>
+#include <htslib/tbx.h>
+#include <htslib/vcf.h>
+
+#include "helpers/ConcatParts.hh"
+
+namespace
+{
+    /** write a VCF / BCF part with records chr:start..end (step 10) */
+    std::string writePart(bool bcf, std::vector<std::pair<std::string, std::pair<int, int> > > const & ranges)
+    {
+        const std::string filename = boost::filesystem::unique_path(
+            bcf ? "%%%%-%%%%-%%%%-%%%%.bcf" : "%%%%-%%%%-%%%%-%%%%.vcf.gz").string();
+        htsFile * fp = hts_open(filename.c_str(), bcf ? "wb" : "wz");
+        BOOST_REQUIRE(fp);
+        bcf_hdr_t * hdr = bcf_hdr_init("w");
+        bcf_hdr_append(hdr, "##INFO=<ID=PAD,Number=1,Type=String,Description=\"Padding\">");
+        bcf_hdr_append(hdr, "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">");
+        bcf_hdr_append(hdr, "##contig=<ID=chr1,length=100000000>");
+        bcf_hdr_append(hdr, "##contig=<ID=chr2,length=100000000>");
+        bcf_hdr_add_sample(hdr, "SAMPLE");
+        bcf_hdr_add_sample(hdr, NULL);
+        BOOST_REQUIRE_EQUAL(bcf_hdr_write(fp, hdr), 0);
+
+        bcf1_t * rec = bcf_init();
+        kstring_t str = {0, 0, nullptr};
+        // make records long enough to span several BGZF blocks per part
+        const std::string pad(100, 'N');
+        for(auto const & r : ranges)
+        {
+            for(int pos = r.second.first; pos <= r.second.second; pos += 10)
+            {
+                str.l = 0;
+                ksprintf(&str, "%s\t%i\t.\tA\tC\t.\tPASS\tPAD=%s%i\tGT\t0/1", r.first.c_str(), pos, pad.c_str(), pos);
+                BOOST_REQUIRE_EQUAL(vcf_parse(&str, hdr, rec), 0);
+                BOOST_REQUIRE_EQUAL(bcf_write(fp, hdr, rec), 0);
+            }
+        }
+        free(str.s);
+        bcf_destroy(rec);
+        bcf_hdr_destroy(hdr);
+        hts_close(fp);
+        return filename;
+    }
+
+    /** read positions from a file, optionally from a region */
+    std::vector<std::string> readRecords(std::string const & filename, const char * region = nullptr)
+    {
+        std::vector<std::string> result;
+        htsFile * fp = hts_open(filename.c_str(), "r");
+        BOOST_REQUIRE(fp);
+        bcf_hdr_t * hdr = bcf_hdr_read(fp);
+        bcf1_t * rec = bcf_init();
+        if(region && hts_get_format(fp)->format == bcf)
+        {
+            hts_idx_t * idx = bcf_index_load(filename.c_str());
+            BOOST_REQUIRE(idx);
+            hts_itr_t * itr = bcf_itr_querys(idx, hdr, region);
+            BOOST_REQUIRE(itr);
+            while(bcf_itr_next(fp, itr, rec) >= 0)
+            {
+                result.push_back(std::string(bcf_seqname(hdr, rec)) + ":" + std::to_string(rec->pos + 1));
+            }
+            hts_itr_destroy(itr);
+            hts_idx_destroy(idx);
+        }
+        else if(region)
+        {
+            tbx_t * tbx = tbx_index_load(filename.c_str());
+            BOOST_REQUIRE(tbx);
+            hts_itr_t * itr = tbx_itr_querys(tbx, region);
+            BOOST_REQUIRE(itr);
+            kstring_t str = {0, 0, nullptr};
+            while(tbx_itr_next(fp, tbx, itr, &str) >= 0)
+            {
+                BOOST_REQUIRE_EQUAL(vcf_parse(&str, hdr, rec), 0);
+                result.push_back(std::string(bcf_seqname(hdr, rec)) + ":" + std::to_string(rec->pos + 1));
+            }
+            free(str.s);
+            hts_itr_destroy(itr);
+            tbx_destroy(tbx);
+        }
+        else
+        {
+            while(bcf_read(fp, hdr, rec) >= 0)
+            {
+                result.push_back(std::string(bcf_seqname(hdr, rec)) + ":" + std::to_string(rec->pos + 1));
+            }
+        }
+        bcf_destroy(rec);
+        bcf_hdr_destroy(hdr);
+        hts_close(fp);
+        return result;
+    }
+
+    void removeFile(std::string const & f)
+    {
+        boost::filesystem::remove(f);
+        boost::filesystem::remove(f + ".csi");
+        boost::filesystem::remove(f + ".tbi");
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testConcatParts)
+{
+    for(bool bcf : {true, false})
+    {
+        const std::vector<std::string> parts = {
+            writePart(bcf, {{"chr1", {1, 20000}}}),
+            writePart(bcf, {{"chr1", {20001, 20100}}}),
+            writePart(bcf, {}),
+            writePart(bcf, {{"chr1", {20101, 50000}}, {"chr2", {1, 30000}}}),
+        };
+        const std::string output = boost::filesystem::unique_path(
+            bcf ? "%%%%-%%%%-%%%%-%%%%.bcf" : "%%%%-%%%%-%%%%-%%%%.vcf.gz").string();
+
+        bcfhelpers::concatenateParts(parts, output);
+
+        std::vector<std::string> expected;
+        for(auto const & p : parts)
+        {
+            const std::vector<std::string> records = readRecords(p);
+            expected.insert(expected.end(), records.begin(), records.end());
+        }
+        BOOST_CHECK_EQUAL(expected.size(), 8000u);
+        BOOST_CHECK(readRecords(output) == expected);
+
+        // index queries, including ones around the part boundaries
+        for(const char * region : {"chr1:19950-20050", "chr1:20091-20111", "chr1:1-5", "chr2:29000-40000", "chr1:60000-70000"})
+        {
+            std::vector<std::string> in_region;
+            const std::string chr = std::string(region).substr(0, 4);
+            const int start = std::stoi(std::string(region).substr(5));
+            const int end = std::stoi(std::string(region).substr(std::string(region).find('-') + 1));
+            for(auto const & r : expected)
+            {
+                const int pos = std::stoi(r.substr(5));
+                if(r.substr(0, 4) == chr && pos >= start && pos <= end)
+                {
+                    in_region.push_back(r);
+                }
+            }
+            BOOST_CHECK(readRecords(output, region) == in_region);
+        }
+        removeFile(output);
+
+        // parts which are not in order cannot be indexed
+        BOOST_CHECK_THROW(bcfhelpers::concatenateParts({parts[3], parts[0]}, output), std::runtime_error);
+        removeFile(output);
+
+        if(!bcf)
+        {
+            bcfhelpers::concatenateParts(parts, output, HTS_FMT_TBI);
+            BOOST_CHECK(boost::filesystem::exists(output + ".tbi"));
+            BOOST_CHECK(readRecords(output, "chr2:29000-40000").size() == 100u);
+            removeFile(output);
+        }
+
+        for(auto const & p : parts)
+        {
+            removeFile(p);
+        }
+    }
+}
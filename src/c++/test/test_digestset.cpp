@@ -0,0 +1,84 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/**
+ *
+ * \file test_digestset.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#define BOOST_TEST_NO_MAIN
+#include <boost/test/unit_test.hpp>
+#include <boost/test/test_tools.hpp>
+
+#include <random>
+#include <set>
+
+#include "helpers/DigestSet.hh"
+
+BOOST_AUTO_TEST_CASE(testDigests)
+{
+    BOOST_CHECK_EQUAL(hashutil::digest("ACGT"), hashutil::digest(std::string("ACGT")));
+    BOOST_CHECK(hashutil::digest("ACGT") != hashutil::digest("ACGTA"));
+    BOOST_CHECK(hashutil::digest("") != hashutil::digest("A"));
+}
+
+BOOST_AUTO_TEST_CASE(testDigestSetInMemory)
+{
+    hashutil::DigestSet ds;
+    BOOST_CHECK(ds.insert(1));
+    BOOST_CHECK(ds.insert(2));
+    BOOST_CHECK(!ds.insert(1));
+    BOOST_CHECK(ds.contains(2));
+    BOOST_CHECK(!ds.contains(3));
+    BOOST_CHECK_EQUAL(ds.size(), (size_t)2);
+    BOOST_CHECK_EQUAL(ds.spilled(), (size_t)0);
+}
+
+BOOST_AUTO_TEST_CASE(testDigestSetSpill)
+{
+    // tiny budget: digests go to disk often enough to trigger merging of runs
+    hashutil::DigestSet ds(4096);
+    std::set<uint64_t> expected;
+    std::mt19937_64 rng(42);
+
+    for(int i = 0; i < 50000; ++i)
+    {
+        // draw from a small range so we see plenty of duplicates
+        const uint64_t d = rng() % 20000;
+        BOOST_CHECK_EQUAL(ds.insert(d), expected.insert(d).second);
+    }
+    BOOST_CHECK_EQUAL(ds.size(), expected.size());
+    BOOST_CHECK(ds.spilled() > 0);
+
+    for(uint64_t d = 0; d < 20000; ++d)
+    {
+        BOOST_CHECK_EQUAL(ds.contains(d), expected.count(d) > 0);
+    }
+}
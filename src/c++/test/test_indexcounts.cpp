@@ -0,0 +1,131 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/**
+ *
+ * \file test_indexcounts.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#define BOOST_TEST_NO_MAIN
+#include <boost/test/unit_test.hpp>
+#include <boost/test/test_tools.hpp>
+#include <boost/filesystem.hpp>
+
+#include <string>
+#include <vector>
+
+#include <htslib/bgzf.h>
+#include <htslib/tbx.h>
+
+#include "helpers/BCFHelpers.hh"
+
+namespace
+{
+    /** write a bgzipped VCF */
+    std::string writeVCF(std::vector<std::string> const & records)
+    {
+        const std::string filename = boost::filesystem::unique_path("%%%%-%%%%-%%%%-%%%%.vcf.gz").string();
+        std::string data =
+            "##fileformat=VCFv4.1\n"
+            "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n"
+            "##contig=<ID=chr1,length=10000>\n"
+            "##contig=<ID=chr2,length=10000>\n"
+            "##contig=<ID=chr3,length=10000>\n"
+            "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\tSAMPLE\n";
+        for(auto const & r : records)
+        {
+            data += r + "\n";
+        }
+        BGZF * fp = bgzf_open(filename.c_str(), "w");
+        BOOST_REQUIRE(fp);
+        BOOST_REQUIRE_EQUAL(bgzf_write(fp, data.c_str(), data.size()), (ssize_t)data.size());
+        bgzf_close(fp);
+        return filename;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testIndexCounts)
+{
+    const std::string f = writeVCF({
+        "chr1\t100\t.\tA\tC\t.\tPASS\t.\tGT\t0/1",
+        "chr1\t200\t.\tA\tG\t.\tPASS\t.\tGT\t1/1",
+        "chr1\t300\t.\tA\tT\t.\tPASS\t.\tGT\t0/1",
+        "chr3\t5\t.\tC\tA\t.\tPASS\t.\tGT\t0/1",
+    });
+
+    std::vector< std::pair<std::string, uint64_t> > counts;
+
+    // no index yet
+    BOOST_CHECK(!bcfhelpers::getIndexCounts(f.c_str(), counts));
+    BOOST_CHECK(counts.empty());
+
+    BOOST_REQUIRE_EQUAL(tbx_index_build(f.c_str(), 0, &tbx_conf_vcf), 0);
+    BOOST_CHECK(bcfhelpers::getIndexCounts(f.c_str(), counts));
+    BOOST_REQUIRE_EQUAL(counts.size(), (size_t)2);
+    BOOST_CHECK_EQUAL(counts[0].first, "chr1");
+    BOOST_CHECK_EQUAL(counts[0].second, (uint64_t)3);
+    BOOST_CHECK_EQUAL(counts[1].first, "chr3");
+    BOOST_CHECK_EQUAL(counts[1].second, (uint64_t)1);
+
+    boost::filesystem::remove(f);
+    boost::filesystem::remove(f + ".tbi");
+}
+
+BOOST_AUTO_TEST_CASE(testIndexContigs)
+{
+    const std::string f = writeVCF({
+        "chr1\t100\t.\tA\tC\t.\tPASS\t.\tGT\t0/1",
+        "chr3\t5\t.\tC\tA\t.\tPASS\t.\tGT\t0/1",
+    });
+
+    htsFile * fp = bcf_open(f.c_str(), "r");
+    BOOST_REQUIRE(fp);
+    bcf_hdr_t * hdr = bcf_hdr_read(fp);
+    BOOST_REQUIRE(hdr);
+
+    std::vector<std::string> contigs;
+    BOOST_CHECK(!bcfhelpers::getIndexContigs(f.c_str(), hdr, contigs));
+    BOOST_CHECK(contigs.empty());
+
+    // contig names are read from the tabix meta data in both index formats
+    for(int min_shift : {0, 14})
+    {
+        BOOST_REQUIRE_EQUAL(tbx_index_build(f.c_str(), min_shift, &tbx_conf_vcf), 0);
+        BOOST_CHECK(bcfhelpers::getIndexContigs(f.c_str(), hdr, contigs));
+        BOOST_REQUIRE_EQUAL(contigs.size(), (size_t)2);
+        BOOST_CHECK_EQUAL(contigs[0], "chr1");
+        BOOST_CHECK_EQUAL(contigs[1], "chr3");
+        boost::filesystem::remove(f + (min_shift ? ".csi" : ".tbi"));
+    }
+
+    bcf_hdr_destroy(hdr);
+    bcf_close(fp);
+    boost::filesystem::remove(f);
+}
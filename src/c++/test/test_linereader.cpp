@@ -0,0 +1,131 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/**
+ *
+ * \file test_linereader.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#define BOOST_TEST_NO_MAIN
+#include <boost/test/unit_test.hpp>
+#include <boost/test/test_tools.hpp>
+#include <boost/filesystem.hpp>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "helpers/LineReader.hh"
+
+namespace
+{
+    std::vector<std::string> readLines(std::string const & filename)
+    {
+        std::vector<std::string> result;
+        textio::LineReader r(filename);
+        textio::Field line;
+        while(r.next(line))
+        {
+            result.push_back(line.str());
+        }
+        return result;
+    }
+
+    std::vector<std::string> split(std::string const & line, std::string const & seps)
+    {
+        std::vector<textio::Field> fields;
+        textio::splitFields(line.c_str(), line.size(), seps, fields);
+        std::vector<std::string> result;
+        for(auto const & f : fields)
+        {
+            result.push_back(f.str());
+        }
+        return result;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testSplitFields)
+{
+    BOOST_CHECK(split("", "\t").empty());
+    BOOST_CHECK(split("a\tbb\t\tc", "\t") == std::vector<std::string>({"a", "bb", "", "c"}));
+    BOOST_CHECK(split("a\t", "\t") == std::vector<std::string>({"a", ""}));
+    BOOST_CHECK(split("a;b,c", ";,") == std::vector<std::string>({"a", "b", "c"}));
+    BOOST_CHECK(split(",", ";,") == std::vector<std::string>({"", ""}));
+
+    std::vector<textio::Field> fields;
+    const std::string line = "PASS\t.";
+    textio::splitFields(line.c_str(), line.size(), "\t", fields);
+    BOOST_CHECK(fields[0] == "PASS");
+    BOOST_CHECK(!(fields[0] == "PAS"));
+    BOOST_CHECK(fields[1] == ".");
+}
+
+BOOST_AUTO_TEST_CASE(testLineReader)
+{
+    // long lines make sure we cross buffer boundaries when reading compressed input
+    std::string content;
+    std::vector<std::string> expected;
+    for(int i = 0; i < 20000; ++i)
+    {
+        expected.push_back(std::to_string(i) + "\t" + std::string((size_t)(i % 300), 'A') + "\tTP");
+        content += expected.back() + "\n";
+    }
+    expected.push_back("");
+    expected.push_back("last line");
+    content += "\nlast line";
+
+    const std::string plain = boost::filesystem::unique_path("%%%%-%%%%-%%%%-%%%%.tsv").string();
+    FILE * f = fopen(plain.c_str(), "w");
+    BOOST_REQUIRE(f);
+    fwrite(content.c_str(), 1, content.size(), f);
+    fclose(f);
+
+    const std::string compressed = plain + ".gz";
+    gzFile gz = gzopen(compressed.c_str(), "wb");
+    BOOST_REQUIRE(gz);
+    gzwrite(gz, content.c_str(), (unsigned)content.size());
+    gzclose(gz);
+
+    const std::string empty = plain + ".empty";
+    f = fopen(empty.c_str(), "w");
+    BOOST_REQUIRE(f);
+    fclose(f);
+
+    BOOST_CHECK(readLines(plain) == expected);
+    BOOST_CHECK(readLines(compressed) == expected);
+    BOOST_CHECK(readLines(empty).empty());
+    BOOST_CHECK_THROW(textio::LineReader(plain + ".missing"), std::runtime_error);
+
+    boost::filesystem::remove(plain);
+    boost::filesystem::remove(compressed);
+    boost::filesystem::remove(empty);
+}
@@ -0,0 +1,81 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/**
+ *
+ * \file test_orderedpipeline.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#define BOOST_TEST_NO_MAIN
+#include <boost/test/unit_test.hpp>
+#include <boost/test/test_tools.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "helpers/OrderedPipeline.hh"
+
+BOOST_AUTO_TEST_CASE(testOrderedPipelineOrder)
+{
+    typedef std::unique_ptr<int> item_t;
+    std::vector<int> result;
+    {
+        parallel::OrderedPipeline<item_t> p(4, 3,
+                                            [](item_t & x) { *x *= 2; },
+                                            [&result](item_t & x) { result.push_back(*x); });
+        for(int i = 0; i < 1000; ++i)
+        {
+            p.push(item_t(new int(i)));
+        }
+        p.finish();
+    }
+
+    BOOST_REQUIRE_EQUAL(result.size(), (size_t)1000);
+    for(int i = 0; i < 1000; ++i)
+    {
+        BOOST_CHECK_EQUAL(result[i], 2*i);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testOrderedPipelineError)
+{
+    parallel::OrderedPipeline<int> p(2, 4,
+                                     [](int & x) { if(x == 10) { throw std::runtime_error("failed"); } },
+                                     [](int &) {});
+    BOOST_CHECK_THROW(
+        {
+            for(int i = 0; i < 100; ++i)
+            {
+                int x = i;
+                p.push(std::move(x));
+            }
+            p.finish();
+        }, std::runtime_error);
+}
@@ -0,0 +1,153 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/**
+ *
+ * \file test_positionscanner.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#define BOOST_TEST_NO_MAIN
+#include <boost/test/unit_test.hpp>
+#include <boost/test/test_tools.hpp>
+#include <boost/filesystem.hpp>
+
+#include <string>
+#include <vector>
+
+#include <htslib/bgzf.h>
+#include <htslib/tbx.h>
+
+#include "helpers/PositionScanner.hh"
+
+namespace
+{
+    /** write a bgzipped + indexed VCF */
+    std::string writeVCF(std::vector<std::string> const & records)
+    {
+        const std::string filename = boost::filesystem::unique_path("%%%%-%%%%-%%%%-%%%%.vcf.gz").string();
+        std::string data =
+            "##fileformat=VCFv4.1\n"
+            "##INFO=<ID=END,Number=1,Type=Integer,Description=\"End position\">\n"
+            "##FILTER=<ID=LowQ,Description=\"Low quality\">\n"
+            "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n"
+            "##contig=<ID=chr1,length=10000>\n"
+            "##contig=<ID=chr2,length=10000>\n"
+            "##contig=<ID=chr3,length=10000>\n"
+            "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\tSAMPLE\n";
+        for(auto const & r : records)
+        {
+            data += r + "\n";
+        }
+        BGZF * fp = bgzf_open(filename.c_str(), "w");
+        BOOST_REQUIRE(fp);
+        BOOST_REQUIRE_EQUAL(bgzf_write(fp, data.c_str(), data.size()), (ssize_t)data.size());
+        bgzf_close(fp);
+        BOOST_REQUIRE_EQUAL(tbx_index_build(filename.c_str(), 0, &tbx_conf_vcf), 0);
+        return filename;
+    }
+
+    std::string toString(std::vector<bcfhelpers::PositionScanner::Line> const & lines)
+    {
+        std::string result;
+        for(auto const & l : lines)
+        {
+            result += std::to_string(l.pos) + "-" + std::to_string(l.end) + " ";
+        }
+        return result;
+    }
+
+    std::string countsToString(std::vector<bcfhelpers::PositionScanner::Line> const & lines)
+    {
+        std::string result;
+        for(auto const & l : lines)
+        {
+            result += std::to_string(l.hets) + ":" + std::to_string(l.indels) + " ";
+        }
+        return result;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testPositionScanner)
+{
+    const std::string f1 = writeVCF({
+        "chr1\t100\t.\tA\tC\t.\tPASS\t.\tGT\t0/1",
+        "chr1\t200\t.\tA\tG\t.\tLowQ\t.\tGT\t1/1",
+        "chr1\t300\t.\tA\tT\t.\tPASS\t.\tGT\t0/0",
+        "chr1\t400\t.\tC\t<NON_REF>\t.\tPASS\tEND=450\tGT\t0/1",
+        "chr1\t500\t.\tAT\tA\t.\tPASS\t.\tGT\t1|0",
+        "chr2\t10\t.\tG\tT\t.\tPASS\t.\tGT\t1",
+    });
+    const std::string f2 = writeVCF({
+        "chr1\t100\t.\tA\tG\t.\tPASS\t.\tGT\t0/1",
+        "chr1\t500\t.\tATT\tA\t.\tPASS\t.\tGT\t./1",
+        "chr1\t500\t.\tAT\tA\t.\tPASS\t.\tGT\t0/1",
+        "chr1\t600\t.\tT\tTA,TAA\t.\t.\t.\tGT\t1/2",
+        "chr3\t5\t.\tC\tA\t.\tPASS\t.\tGT\t0/1",
+    });
+
+    {
+        bcfhelpers::PositionScanner scanner({f1, f2}, false);
+        const std::vector<std::string> expected_contigs{"chr1", "chr2", "chr3"};
+        BOOST_CHECK(scanner.getContigs() == expected_contigs);
+
+        std::vector<bcfhelpers::PositionScanner::Line> lines;
+        BOOST_CHECK(scanner.scan("chr1", 0, -1, lines));
+        // records at the same position with different alleles give separate lines,
+        // matching records are merged, 0/0 calls are skipped, END gives the extent
+        BOOST_CHECK_EQUAL(toString(lines), "99-99 99-99 199-199 399-449 499-500 499-501 599-599 ");
+        // unphased hets and indels (including symbolic ALTs) in each line
+        BOOST_CHECK_EQUAL(countsToString(lines), "1:0 1:0 0:0 1:1 1:2 0:1 1:1 ");
+
+        lines.clear();
+        BOOST_CHECK(scanner.scan("chr1", 0, 400, lines));
+        BOOST_CHECK_EQUAL(toString(lines), "99-99 99-99 199-199 399-449 ");
+
+        lines.clear();
+        BOOST_CHECK(scanner.scan("chr3", 0, -1, lines));
+        BOOST_CHECK_EQUAL(toString(lines), "4-4 ");
+
+        lines.clear();
+        BOOST_CHECK(!scanner.scan("chrX", 0, -1, lines));
+        BOOST_CHECK(lines.empty());
+    }
+
+    {
+        bcfhelpers::PositionScanner scanner({f1, f2}, true);
+        std::vector<bcfhelpers::PositionScanner::Line> lines;
+        BOOST_CHECK(scanner.scan("chr1", 0, -1, lines));
+        BOOST_CHECK_EQUAL(toString(lines), "99-99 99-99 399-449 499-500 499-501 599-599 ");
+    }
+
+    for(auto const & f : {f1, f2})
+    {
+        boost::filesystem::remove(f);
+        boost::filesystem::remove(f + ".tbi");
+    }
+}
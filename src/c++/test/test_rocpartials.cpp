@@ -0,0 +1,159 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/**
+ *
+ * \file test_rocpartials.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#define BOOST_TEST_NO_MAIN
+#include <boost/test/unit_test.hpp>
+#include <boost/test/test_tools.hpp>
+#include <boost/filesystem.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "helpers/RocPartials.hh"
+
+namespace
+{
+    roc::Observation makeObs(double level, roc::DecisionType dt, uint64_t n, uint64_t flags)
+    {
+        roc::Observation o;
+        o.level = level;
+        o.dt = dt;
+        o.n = n;
+        o.flags = flags;
+        return o;
+    }
+
+    /** add some observations for one shard; tied levels make the output depend on observation order */
+    void addShard(roc::RocMap & rocs, int shard)
+    {
+        using roc::DecisionType;
+        for(int j = 0; j < 50; ++j)
+        {
+            const double level = (j % 7 == 0) ? std::numeric_limits<double>::quiet_NaN() : (double)((j * 13 + shard) % 11);
+            const DecisionType dt = (DecisionType)((j + shard) % roc::NDecisionTypes);
+            rocs["SNP:*:ALL"].add(makeObs(level, dt, 1 + (j % 3), (j % 2) ? roc::OBS_FLAG_AM : roc::OBS_FLAG_HET));
+            if(j % 4 == 0)
+            {
+                rocs["INDEL:CONF:PASS"].add(makeObs(level / 2, dt, 1, roc::OBS_FLAG_LM | roc::OBS_FLAG_D1_5));
+            }
+        }
+    }
+
+    std::string levelsToString(roc::Roc const & r)
+    {
+        std::vector<roc::Level> levels;
+        r.getLevels(levels);
+        std::string result;
+        for(auto const & l : levels)
+        {
+            result += std::to_string(l.level);
+            for(int j = 0; j < roc::NDecisionTypes; ++j)
+            {
+                result += ":" + std::to_string(l.counts[j]);
+            }
+            result += ":" + std::to_string(l.fp_gt()) + ":" + std::to_string(l.fp_al()) + " ";
+        }
+        return result;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testRocPartialsMerge)
+{
+    roc::RocMap all;
+    variant::QuantifyRegions all_regions;
+    all_regions.setRegionSize("CONF", 12345);
+    all_regions.setRegionSize("TS_boundary", 99);
+
+    std::vector<std::string> files;
+    for(int shard = 0; shard < 3; ++shard)
+    {
+        roc::RocMap rocs;
+        addShard(rocs, shard);
+        addShard(all, shard);
+        files.push_back(boost::filesystem::unique_path("%%%%-%%%%-%%%%-%%%%.qpart").string());
+        roc::writePartial(files.back(), "QUAL", rocs, all_regions);
+    }
+
+    roc::RocMap merged;
+    variant::QuantifyRegions merged_regions;
+    std::string qq_header;
+    for(auto const & f : files)
+    {
+        roc::mergePartial(f, qq_header, merged, merged_regions);
+    }
+
+    BOOST_CHECK_EQUAL(qq_header, "QUAL");
+    BOOST_CHECK_EQUAL(merged_regions.getRegionSize("CONF"), 12345);
+    BOOST_CHECK_EQUAL(merged_regions.getRegionSize("TS_boundary"), 99);
+    BOOST_CHECK_EQUAL(merged_regions.getRegionNames().size(), 2);
+
+    BOOST_REQUIRE_EQUAL(merged.size(), all.size());
+    for(auto const & r : all)
+    {
+        auto m = merged.find(r.first);
+        BOOST_REQUIRE(m != merged.end());
+        const roc::Level t1 = r.second.getTotals();
+        const roc::Level t2 = m->second.getTotals();
+        for(int j = 0; j < roc::NDecisionTypes; ++j)
+        {
+            BOOST_CHECK_EQUAL(t1.counts[j], t2.counts[j]);
+        }
+        BOOST_CHECK_EQUAL(t1.fp_gt(), t2.fp_gt());
+        BOOST_CHECK_EQUAL(t1.fp_al(), t2.fp_al());
+        BOOST_CHECK_EQUAL(levelsToString(r.second), levelsToString(m->second));
+    }
+
+    for(auto const & f : files)
+    {
+        boost::filesystem::remove(f);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(testRocPartialsInvalid)
+{
+    const std::string filename = boost::filesystem::unique_path("%%%%-%%%%-%%%%-%%%%.qpart").string();
+    {
+        std::ofstream f(filename);
+        f << "not a partial results file\n";
+    }
+    roc::RocMap rocs;
+    variant::QuantifyRegions regions;
+    std::string qq_header;
+    BOOST_CHECK_THROW(roc::mergePartial(filename, qq_header, rocs, regions), std::runtime_error);
+    boost::filesystem::remove(filename);
+}
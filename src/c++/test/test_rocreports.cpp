@@ -0,0 +1,92 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/**
+ *
+ * \file test_rocreports.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#define BOOST_TEST_NO_MAIN
+#include <boost/test/unit_test.hpp>
+#include <boost/test/test_tools.hpp>
+
+#include <cmath>
+#include <limits>
+
+#include "helpers/RocReports.hh"
+
+BOOST_AUTO_TEST_CASE(testRocReportsJeffreysCI)
+{
+    // reference values computed by numerical integration of the beta pdf
+    struct { uint64_t x, n; double lower, upper; } cases[] = {
+        {5, 10, 0.2235286703, 0.7764713297},
+        {90, 100, 0.8298760703, 0.9474153247},
+        {3, 1000, 0.0008456348, 0.0079843674},
+        {9990, 10000, 0.9982267851, 0.9994857430},
+    };
+
+    for(auto const & c : cases)
+    {
+        double p, lower, upper;
+        roc::jeffreysCI(c.x, c.n, 0.05, p, lower, upper);
+        BOOST_CHECK_CLOSE(p, ((double)c.x) / c.n, 1e-10);
+        BOOST_CHECK_CLOSE(lower, c.lower, 1e-5);
+        BOOST_CHECK_CLOSE(upper, c.upper, 1e-5);
+    }
+
+    // special cases
+    double p, lower, upper;
+    roc::jeffreysCI(0, 0, 0.05, p, lower, upper);
+    BOOST_CHECK_EQUAL(p, 0.0);
+    BOOST_CHECK_EQUAL(lower, 0.0);
+    BOOST_CHECK_EQUAL(upper, 1.0);
+
+    roc::jeffreysCI(10, 10, 0.05, p, lower, upper);
+    BOOST_CHECK_CLOSE(lower, std::pow(0.025, 0.1), 1e-10);
+    BOOST_CHECK_EQUAL(upper, 1.0);
+
+    roc::jeffreysCI(0, 10, 0.05, p, lower, upper);
+    BOOST_CHECK_EQUAL(lower, 0.0);
+    BOOST_CHECK_CLOSE(upper, 1 - std::pow(0.025, 0.1), 1e-10);
+}
+
+BOOST_AUTO_TEST_CASE(testRocReportsFormatDouble)
+{
+    BOOST_CHECK_EQUAL(roc::formatDouble(0.0), "0.0");
+    BOOST_CHECK_EQUAL(roc::formatDouble(12.0), "12.0");
+    BOOST_CHECK_EQUAL(roc::formatDouble(0.1), "0.1");
+    BOOST_CHECK_EQUAL(roc::formatDouble(-2.5), "-2.5");
+    BOOST_CHECK_EQUAL(roc::formatDouble(1.0/3.0), "0.3333333333333333");
+    BOOST_CHECK_EQUAL(roc::formatDouble(0.0001), "0.0001");
+    BOOST_CHECK_EQUAL(roc::formatDouble(0.00001), "1e-05");
+    BOOST_CHECK_EQUAL(roc::formatDouble(1.5e16), "1.5e+16");
+    BOOST_CHECK_EQUAL(roc::formatDouble(123456789012345.0), "123456789012345.0");
+    BOOST_CHECK_EQUAL(roc::formatDouble(std::numeric_limits<double>::quiet_NaN()), "");
+}
@@ -0,0 +1,151 @@
+// -*- mode: c++; indent-tabs-mode: nil; -*-
+//
+// Copyright (c) 2010-2015 Illumina, Inc.
+// All rights reserved.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+/**
+ *
+ * \file test_table.cpp
+ * \author Peter Krusche
+ * \email pkrusche@illumina.com
+ *
+ */
+
+#define BOOST_TEST_NO_MAIN
+#include <boost/test/unit_test.hpp>
+#include <boost/test/test_tools.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "helpers/Table.hh"
+
+BOOST_AUTO_TEST_CASE(testTableValues)
+{
+    table::Table t;
+    t.set("r1", "a", 1.5);
+    t.set("r1", "b", "x");
+    t.set("r2", "a", "y");
+
+    BOOST_CHECK_EQUAL(t.getDouble("r1", "a"), 1.5);
+    BOOST_CHECK_EQUAL(t.getString("r1", "a"), std::to_string(1.5));
+    BOOST_CHECK_EQUAL(t.getString("r1", "b"), "x");
+    // strings aren't converted, missing values give the default
+    BOOST_CHECK(std::isnan(t.getDouble("r2", "a")));
+    BOOST_CHECK_EQUAL(t.getDouble("r2", "b", 2.0), 2.0);
+    BOOST_CHECK_EQUAL(t.getString("r3", "a"), ".");
+    BOOST_CHECK_EQUAL(t.getString("r1", "c", "-"), "-");
+
+    // overwrite with a different type
+    t.set("r2", "a", 3.0);
+    BOOST_CHECK_EQUAL(t.getDouble("r2", "a"), 3.0);
+    t.set("r1", "a", "z");
+    BOOST_CHECK_EQUAL(t.getString("r1", "a"), "z");
+
+    std::vector<std::string> values;
+    t.getStrings("r1", {"a", "b", "c"}, values);
+    BOOST_CHECK(values == std::vector<std::string>({"z", "x", "."}));
+
+    t.unset("r1", "b");
+    BOOST_CHECK_EQUAL(t.getString("r1", "b"), ".");
+    BOOST_CHECK(t.hasRow("r1"));
+    BOOST_CHECK(!t.hasRow("r3"));
+}
+
+BOOST_AUTO_TEST_CASE(testTableHandles)
+{
+    table::Table t;
+    const auto r1 = t.row("r1");
+    const auto c1 = t.column("c1");
+    BOOST_CHECK_EQUAL(t.row("r1"), r1);
+    BOOST_CHECK_EQUAL(t.column("c1"), c1);
+    BOOST_CHECK(t.row("r2") != r1);
+
+    t.set(r1, c1, 4.0);
+    t.set(t.row("r2"), c1, "s");
+    BOOST_CHECK_EQUAL(t.getDouble("r1", "c1"), 4.0);
+    BOOST_CHECK_EQUAL(t.getString("r2", "c1"), "s");
+
+    table::Table::handle_t c2 = 0;
+    BOOST_CHECK(t.findColumn("c1", c2));
+    BOOST_CHECK_EQUAL(c2, c1);
+    BOOST_CHECK(!t.findColumn("c2", c2));
+    std::vector<std::string> values;
+    t.getStrings(r1, {c1, (table::Table::handle_t)-1}, values);
+    BOOST_CHECK(values == std::vector<std::string>({std::to_string(4.0), "."}));
+    BOOST_CHECK(t.getRowHandles() == std::vector<table::Table::handle_t>({r1, t.row("r2")}));
+
+    // columns without values aren't written
+    t.column("unused");
+    std::ostringstream o;
+    o << t;
+    const std::string out = o.str();
+    BOOST_CHECK_EQUAL(out.substr(0, out.find('\n')), "c1");
+}
+
+BOOST_AUTO_TEST_CASE(testTableDropRows)
+{
+    table::Table t;
+    for(int i = 0; i < 10; ++i)
+    {
+        const std::string r = "r" + std::to_string(i);
+        t.set(r, "b", (double)i);
+        if(i % 2 == 0)
+        {
+            t.set(r, "a", "even");
+        }
+    }
+    t.dropRowsWithMissing("a");
+
+    std::vector<std::string> rows = t.getRows();
+    std::sort(rows.begin(), rows.end());
+    BOOST_CHECK(rows == std::vector<std::string>({"r0", "r2", "r4", "r6", "r8"}));
+    BOOST_CHECK(!t.hasRow("r1"));
+    BOOST_CHECK_EQUAL(t.getString("r1", "b"), ".");
+
+    // rows can be added again after removing them
+    t.set("r1", "b", 1.0);
+    BOOST_CHECK_EQUAL(t.getDouble("r1", "b"), 1.0);
+    BOOST_CHECK_EQUAL(t.getString("r1", "a"), ".");
+
+    std::ostringstream o;
+    o << t;
+    std::string line;
+    std::istringstream i(o.str());
+    std::getline(i, line);
+    BOOST_CHECK_EQUAL(line, "a\tb");
+    size_t n_rows = 0;
+    while(std::getline(i, line))
+    {
+        ++n_rows;
+    }
+    BOOST_CHECK_EQUAL(n_rows, (size_t)6);
+
+    t.dropRowsWithMissing("no such column");
+    BOOST_CHECK(t.getRows().empty());
+}
@@ -219,3 +219,54 @@ BOOST_AUTO_TEST_CASE(testVariantStatisticsCountVariants)
 
     BOOST_CHECK(count > 0);
 }
+
+BOOST_AUTO_TEST_CASE(testVariantCountsMergeAndSerialize)
+{
+    boost::filesystem::path p(__FILE__);
+    boost::filesystem::path ptp = p.parent_path()
+                                   .parent_path()   // test
+                                   .parent_path()   // c++
+                                   .parent_path()   // src
+                                    / boost::filesystem::path("example")
+                                    / boost::filesystem::path("chr21.fa");
+
+    FastaFile f(ptp.c_str());
+    VariantStatistics vs1(f);
+    VariantStatistics vs2(f);
+
+    RefVar rv;
+
+    // 1x snp
+    rv.start = 10;
+    rv.end = 10;
+    rv.alt = "T";
+    vs1.add("chr21", rv);
+
+    // 10x del
+    rv.start = 20;
+    rv.end = 30;
+    rv.alt = "N";
+    vs2.add("chr21", rv);
+    vs2.add("chr21", rv);
+
+    VariantCounts merged = vs1.getCounts();
+    merged += vs2.getCounts();
+
+    std::ostringstream oss;
+    merged.write(oss);
+
+    VariantCounts read_back;
+    std::istringstream iss(oss.str());
+    read_back.read(iss);
+
+    BOOST_CHECK(memcmp(&merged, &read_back, sizeof(VariantCounts)) == 0);
+
+    Json::Value result = VariantStatistics::toJson(read_back);
+    BOOST_CHECK_EQUAL(result["al__s"].asUInt64(), (uint64_t)1);
+    BOOST_CHECK_EQUAL(result["al__d"].asUInt64(), (uint64_t)2);
+    BOOST_CHECK_EQUAL(result["nuc__d"].asUInt64(), (uint64_t)20);
+
+    // truncated input
+    std::istringstream iss_short(oss.str().substr(0, oss.str().size() - 1));
+    BOOST_CHECK_THROW(read_back.read(iss_short), std::runtime_error);
+}
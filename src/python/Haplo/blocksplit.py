@@ -23,25 +23,44 @@ import tempfile
 import time
 
 
-def blocksplitWrapper(location_str, args):
-    starttime = time.time()
-    tf = tempfile.NamedTemporaryFile(delete=False,
-                                     dir=args.scratch_prefix,
-                                     prefix="result.%s" % location_str,
-                                     suffix=".chunks.bed")
-    tf.close()
-
+def blocksplitCommand(location_str, output_name, args):
+    """ Make the blocksplit command line for one location
+    """
     if location_str:
         loc = " -l %s" % location_str
     else:
-        loc = ""
-    to_run = "blocksplit %s %s%s -o %s --window %i --nblocks %i -f 0" % \
-             (args.vcf1.replace(" ", "\\ "),
-              args.vcf2.replace(" ", "\\ "),
-              loc,
-              tf.name,
-              args.window*2,
-              args.pieces)
+        # whole file: contigs are scanned in parallel inside blocksplit
+        loc = " --threads %i" % args.threads
+    return "blocksplit %s %s%s -o %s --window %i --nblocks %i -f 0 --max-enum %i" % \
+           (args.vcf1.replace(" ", "\\ "),
+            args.vcf2.replace(" ", "\\ "),
+            loc,
+            output_name,
+            args.window*2,
+            args.pieces,
+            args.max_enum)
+
+
+def blocksplitWrapper(location_str, args):
+    starttime = time.time()
+    ledger = getattr(args, "ledger", None)
+    if ledger:
+        # input file names contain the keys of the preprocessing stage
+        key = ledger.key("blocksplit", blocksplitCommand(location_str, "", args))
+        e = ledger.lookup(key)
+        if e:
+            logging.info("blocksplit for %s -- using checkpoint %s" % (location_str, key))
+            return e["outputs"][0]
+        output_name = ledger.output("blocksplit", key, ".chunks.bed")
+    else:
+        tf = tempfile.NamedTemporaryFile(delete=False,
+                                         dir=args.scratch_prefix,
+                                         prefix="result.%s" % location_str,
+                                         suffix=".chunks.bed")
+        tf.close()
+        output_name = tf.name
+
+    to_run = blocksplitCommand(location_str, output_name, args)
 
     tfe = tempfile.NamedTemporaryFile(delete=False,
                                       dir=args.scratch_prefix,
@@ -66,6 +85,9 @@ def blocksplitWrapper(location_str, args):
                 logging.warn(l.replace("\n", ""))
         os.unlink(tfe.name)
 
+    if ledger:
+        ledger.record("blocksplit", key, [output_name])
+
     elapsed = time.time() - starttime
     logging.info("blocksplit for %s -- time taken %.2f" % (location_str, elapsed))
-    return tf.name
+    return output_name
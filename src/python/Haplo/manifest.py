@@ -0,0 +1,216 @@
+# coding=utf-8
+#
+# Copyright (c) 2010-2015 Illumina, Inc.
+# All rights reserved.
+#
+# This file is distributed under the simplified BSD license.
+# The full text can be found here (and in LICENSE.txt in the root folder of
+# this distribution):
+#
+# https://github.com/Illumina/licenses/blob/master/Simplified-BSD-License.txt
+#
+# Sharded hap.py runs: manifest of independent xcmp / quantify tasks
+#
+# hap.py --write-manifest preprocesses the inputs, splits them into shards
+# using blocksplit, and writes a JSON manifest that lists the exact commands
+# for each shard. Each shard compares its locations using xcmp and counts
+# the result using quantify --write-partial. The shards do not depend on
+# each other and can be run by any scheduler (all paths in the manifest are
+# absolute). hap.py --merge-manifest then combines the partial results into
+# the usual reports; hap.py --run-manifest runs all shards locally first.
+#
+# Author:
+#
+# Peter Krusche <pkrusche@illumina.com>
+#
+
+import os
+import json
+import logging
+import shutil
+import subprocess
+import time
+
+import Tools
+import Tools.checkpoint
+from Tools import bcftools
+from Tools.parallel import runParallel, getPool
+import Haplo.xcmp
+import Haplo.quantify
+
+MANIFEST_VERSION = 1
+
+
+def makeShards(locations, args, regions, workdir, internal_format_suffix):
+    """ Make the list of shard tasks
+
+    :param locations: list of locations (in genome order, one shard each)
+    :param args: hap.py arguments (after preprocessing, args.vcf1 / vcf2 are
+                 the preprocessed files)
+    :param regions: dictionary of stratification region names and bed files
+    :param workdir: directory for shard outputs
+    :param internal_format_suffix: ".bcf" or ".vcf.gz" for the annotated VCF parts
+    :return: list of shard dictionaries
+    """
+    shards = []
+    chunk_costs = getattr(args, "chunk_costs", {})
+    for i, location in enumerate(locations):
+        sid = "shard.%05i" % i
+        prefix = os.path.join(workdir, sid)
+        xcmp_output = prefix + ".xcmp.bcf"
+        partial = prefix + ".qpart"
+        vcf = prefix + internal_format_suffix if args.write_vcf else None
+
+        commands = [Haplo.xcmp.xcmpCommand(location, xcmp_output, args),
+                    "bcftools index -f '%s'" % xcmp_output,
+                    # xcmp extracts whichever field we're using into the IQQ info field
+                    Haplo.quantify.quantify_command(xcmp_output,
+                                                    write_vcf=vcf,
+                                                    regions=regions,
+                                                    reference=args.ref,
+                                                    threads=1,
+                                                    output_vtc=args.output_vtc,
+                                                    qtype="xcmp",
+                                                    roc_val="IQQ",
+                                                    roc_header=args.roc,
+                                                    roc_filter=args.roc_filter,
+                                                    roc_delta=args.roc_delta,
+                                                    roc_regions=args.roc_regions,
+                                                    clean_info=not args.preserve_info,
+                                                    strat_fixchr=args.strat_fixchr,
+                                                    write_partial=partial)]
+        if args.delete_scratch:
+            commands.append("rm -f '%s' '%s.csi'" % (xcmp_output, xcmp_output))
+
+        shard = {"id": sid,
+                 "location": location,
+                 "commands": commands,
+                 "outputs": {"partial": partial}}
+        if vcf:
+            shard["outputs"]["vcf"] = vcf
+        if location in chunk_costs:
+            shard["variants"], shard["predicted_cost"] = chunk_costs[location]
+        shards.append(shard)
+    return shards
+
+
+def writeManifest(filename, shards, settings, workdir):
+    """ Write manifest JSON
+
+    :param filename: output file name
+    :param shards: shard list from makeShards
+    :param settings: settings for merging (see hap.py)
+    :param workdir: directory containing all scratch files for this run
+    """
+    manifest = {"version": MANIFEST_VERSION,
+                "hap.py": Tools.version,
+                "workdir": workdir,
+                "settings": settings,
+                "shards": shards}
+    with open(filename, "w") as f:
+        json.dump(manifest, f, indent=2, sort_keys=True)
+    logging.info("Wrote manifest with %i shards to %s" % (len(shards), filename))
+
+
+def loadManifest(filename):
+    """ Read and check a manifest """
+    with open(filename) as f:
+        manifest = json.load(f)
+    if manifest.get("version") != MANIFEST_VERSION:
+        raise Exception("Unsupported manifest version in %s: %s" % (filename, str(manifest.get("version"))))
+    if manifest.get("hap.py") != Tools.version:
+        logging.warn("Manifest %s was written by hap.py %s, this is %s." % (filename,
+                                                                          manifest.get("hap.py"),
+                                                                          Tools.version))
+    return manifest
+
+
+def runShard(shard, ledger=None):
+    """ Run the commands for one shard
+
+    :param shard: shard dictionary from the manifest
+    :param ledger: Tools.checkpoint.Ledger to skip / record completed shards
+    """
+    starttime = time.time()
+    if ledger:
+        key = ledger.key("shard", shard["commands"])
+        if ledger.lookup(key):
+            logging.info("%s for %s -- using checkpoint %s" % (shard["id"], shard["location"], key))
+            return shard["id"]
+    for to_run in shard["commands"]:
+        logging.info("Running '%s'" % to_run)
+        po = subprocess.Popen(to_run, shell=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        o, e = po.communicate()
+        level = logging.INFO if po.returncode == 0 else logging.ERROR
+        for l in o.splitlines():
+            logging.log(level, "[%s stdout] %s" % (shard["id"], l))
+        for l in e.splitlines():
+            logging.log(level, "[%s stderr] %s" % (shard["id"], l))
+        if po.returncode != 0:
+            raise Exception("Command for %s (%s) failed: %s" % (shard["id"], shard["location"], to_run))
+
+    if ledger:
+        ledger.record("shard", key, sorted(shard["outputs"].values()), id=shard["id"])
+
+    elapsed = time.time() - starttime
+    logging.info("%s for %s -- time taken %.2f" % (shard["id"], shard["location"], elapsed))
+    return shard["id"]
+
+
+def runShards(manifest, threads, resume=False):
+    """ Run all shards locally, using up to threads processes
+
+    :param resume: skip shards that have completed in an earlier run
+    """
+    shards = manifest["shards"]
+    # completed shards are always recorded so a failed run can be resumed
+    ledger = Tools.checkpoint.Ledger(manifest["workdir"])
+    if not resume:
+        ledger.entries = {}
+    logging.info("Running %i shards using %i parallel processes." % (len(shards), threads))
+    res = runParallel(getPool(threads), runShard, shards, ledger)
+    failed = [s["id"] for s, r in zip(shards, res) if r is None]
+    if failed:
+        raise Exception("%i shards failed: %s" % (len(failed), ", ".join(failed)))
+
+
+def mergeShards(manifest):
+    """ Combine shard outputs into the final tables and VCF
+
+    :return: the name of the ROC table file written by quantify
+    """
+    settings = manifest["settings"]
+    shards = manifest["shards"]
+
+    missing = [s["id"] for s in shards if not os.path.exists(s["outputs"]["partial"])]
+    if missing:
+        raise Exception("Results for %i shards are missing: %s" % (len(missing), ", ".join(missing)))
+
+    roc_table = settings["reports_prefix"] + ".roc.tsv"
+    logging.info("Merging %i partial results..." % len(shards))
+    Haplo.quantify.merge_partials([s["outputs"]["partial"] for s in shards],
+                                  roc_table,
+                                  output_rocs=settings["output_rocs"],
+                                  roc_header=settings["roc_header"],
+                                  roc_delta=settings["roc_delta"],
+                                  roc_regions=settings["roc_regions"],
+                                  summary_prefix=settings["reports_prefix"],
+                                  summary_filter=settings["summary_filter"],
+                                  ci_alpha=settings["ci_alpha"],
+                                  write_counts=settings["write_counts"])
+
+    vcfs = [s["outputs"]["vcf"] for s in shards if "vcf" in s["outputs"]]
+    if vcfs:
+        output_vcf = settings["reports_prefix"] + settings["internal_format_suffix"]
+        logging.info("Concatenating and indexing annotated VCF parts...")
+        bcftools.concatenateAndIndexParts(output_vcf, vcfs,
+                                          "csi" if output_vcf.endswith(".bcf") else "tbi")
+    return roc_table
+
+
+def cleanup(manifest):
+    """ Remove scratch files for a manifest """
+    try:
+        shutil.rmtree(manifest["workdir"])
+    except OSError as e:
+        logging.warn("Cannot remove scratch directory %s: %s" % (manifest["workdir"], str(e)))
@@ -25,7 +25,7 @@ import itertools
 import multiprocessing
 
 from Tools.parallel import runParallel, getPool
-from Tools.bcftools import runBcftools, concatenateParts
+from Tools.bcftools import runBcftools, concatenateAndIndexParts
 from Tools.vcfextract import extractHeadersJSON
 
 
@@ -53,6 +53,10 @@ def preprocessWrapper(file_and_location, args):
     if args["haploid_x"]:
         to_run += " --haploid-x 1"
 
+    # the parts are concatenated without recompressing, so this sets the level for the final output
+    if args["compression_level"] >= 0:
+        to_run += " --compression-level %i" % args["compression_level"]
+
     tfe = tempfile.NamedTemporaryFile(delete=False,
                                       prefix="stderr",
                                       suffix=".log")
@@ -144,7 +148,8 @@ def partialCredit(vcfname,
                   window=10000,
                   leftshift=True,
                   decompose=True,
-                  haploid_x=False):
+                  haploid_x=False,
+                  compression_level=-1):
     """ Partial-credit-process a VCF file according to our args """
 
     pool = getPool(int(threads))
@@ -156,10 +161,10 @@ def partialCredit(vcfname,
             if not h["tabix"]["chromosomes"]:
                 logging.warn("Empty input or not tabix indexed")
                 if outputname.endswith(".bcf"):
-                    runBcftools("view", "-O", "b", "-o", outputname, vcfname)
+                    runBcftools("view", "-O", "b", "-l", str(compression_level), "-o", outputname, vcfname)
                     runBcftools("index", outputname)
                 else:
-                    runBcftools("view", "-O", "z", "-o", outputname, vcfname)
+                    runBcftools("view", "-O", "z", "-l", str(compression_level), "-o", outputname, vcfname)
                     runBcftools("index", "-t", outputname)
                 # just return the same file
                 return
@@ -195,18 +200,18 @@ def partialCredit(vcfname,
                            "decompose": decompose,
                            "leftshift": leftshift,
                            "haploid_x": haploid_x,
-                           "bcf": outputname.endswith(".bcf")})
+                           "bcf": outputname.endswith(".bcf"),
+                           "compression_level": compression_level})
 
         if None in res:
             raise Exception("One of the preprocess jobs failed")
         if not res:
             raise Exception("No blocks were processed. List of locations: %s" % str(list(locations)))
 
-        concatenateParts(outputname, *res)
         if outputname.endswith(".vcf.gz"):
-            runBcftools("index", "-f", "-t", outputname)
+            concatenateAndIndexParts(outputname, res, "tbi")
         else:  # use bcf
-            runBcftools("index", "-f", outputname)
+            concatenateAndIndexParts(outputname, res)
     finally:
         for r in res:
             try:
@@ -60,47 +60,74 @@ def _locations_tmp_bed_file(locations):
     return tf.name
 
 
-def run_quantify(filename,
-                 output_file=None, write_vcf=False, regions=None,
-                 reference=Tools.defaultReference(),
-                 locations=None, threads=1,
-                 output_vtc=False,
-                 output_rocs=False,
-                 qtype=None,
-                 roc_file=None,
-                 roc_val=None,
-                 roc_header=None,
-                 roc_filter=None,
-                 roc_delta=None,
-                 roc_regions=None,
-                 clean_info=True,
-                 strat_fixchr=False):
-    """Run quantify and return parsed JSON
+def _run_and_log(run_str):
+    """ run a command, log its output (as errors if it fails) """
+    tfe = tempfile.NamedTemporaryFile(delete=False,
+                                      prefix="stderr",
+                                      suffix=".log")
+    tfo = tempfile.NamedTemporaryFile(delete=False,
+                                      prefix="stdout",
+                                      suffix=".log")
 
-    :param filename: the VCF file name
-    :param output_file: output file name (if None, will use a temp file)
-    :param write_vcf: write annotated VCF (give filename)
-    :type write_vcf: str
-    :param regions: dictionary of stratification region names and file names
-    :param reference: reference fasta path
-    :param locations: a location to use
-    :param output_vtc: enable / disable the VTC field
-    :param output_rocs: enable / disable output of ROCs by QQ level
-    :param roc_file: filename for a TSV file with ROC observations
-    :param roc_val: field to use for ROC QQ
-    :param roc_header: name of ROC value for tables
-    :param roc_filter: ROC filtering settings
-    :param roc_delta: ROC minimum spacing between levels
-    :param roc_regions: List of regions to output full ROCs for
-    :param clean_info: remove unused INFO fields
-    :param strat_fixchr: fix chr naming in stratification regions
-    :returns: parsed counts JSON
-    """
+    logging.info("Running '%s'" % run_str)
 
-    if not output_file:
-        output_file = tempfile.NamedTemporaryFile().name
+    try:
+        subprocess.check_call(run_str, shell=True, stdout=tfo, stderr=tfe)
+    except:
+        tfo.close()
+        tfe.close()
+        with open(tfo.name) as f:
+            for l in f:
+                logging.error("[stdout] " + l.replace("\n", ""))
+        os.unlink(tfo.name)
+        with open(tfe.name) as f:
+            for l in f:
+                logging.error("[stderr] " + l.replace("\n", ""))
+        os.unlink(tfe.name)
+        raise
 
-    run_str = "quantify '%s' -o '%s'" % (filename.replace(" ", "\\ "), output_file)
+    tfo.close()
+    tfe.close()
+    with open(tfo.name) as f:
+        for l in f:
+            logging.info("[stdout] " + l.replace("\n", ""))
+    os.unlink(tfo.name)
+    with open(tfe.name) as f:
+        for l in f:
+            logging.info("[stderr] " + l.replace("\n", ""))
+    os.unlink(tfe.name)
+
+
+def quantify_command(filename,
+                     output_file=None, write_vcf=False, regions=None,
+                     reference=Tools.defaultReference(),
+                     threads=1,
+                     output_vtc=False,
+                     output_rocs=False,
+                     qtype=None,
+                     roc_file=None,
+                     roc_val=None,
+                     roc_header=None,
+                     roc_filter=None,
+                     roc_delta=None,
+                     roc_regions=None,
+                     clean_info=True,
+                     strat_fixchr=False,
+                     summary_prefix=None,
+                     summary_filter=None,
+                     ci_alpha=0.0,
+                     write_counts=True,
+                     write_partial=None):
+    """Make the quantify command line, see run_quantify for the parameters
+
+    :param write_partial: write binary partial results to this file (see merge_partials)
+    :returns: the command as a string
+    """
+    run_str = "quantify '%s'" % filename.replace(" ", "\\ ")
+    if output_file:
+        run_str += " -o '%s'" % output_file
+    if write_partial:
+        run_str += " --write-partial '%s'" % write_partial
     run_str += " -r '%s'" % reference.replace(" ", "\\ ")
     run_str += " --threads %i" % threads
 
@@ -143,9 +170,18 @@ def run_quantify(filename,
     else:
         run_str += " --fix-chr-regions 0"
 
+    if summary_prefix:
+        run_str += " --output-summary '%s'" % summary_prefix
+        if summary_filter:
+            run_str += " --summary-filter '%s'" % summary_filter
+        if ci_alpha:
+            run_str += " --ci-alpha %f" % ci_alpha
+        if write_counts:
+            run_str += " --write-counts 1"
+        else:
+            run_str += " --write-counts 0"
+
     if write_vcf:
-        if not write_vcf.endswith(".vcf.gz") and not write_vcf.endswith(".bcf"):
-            write_vcf += ".vcf.gz"
         run_str += " -v '%s'" % write_vcf
 
     if regions:
@@ -156,49 +192,89 @@ def run_quantify(filename,
         for r in roc_regions:
             run_str += " --roc-regions '%s'" % r
 
+    return run_str
+
+
+def run_quantify(filename,
+                 output_file=None, write_vcf=False, regions=None,
+                 reference=Tools.defaultReference(),
+                 locations=None, threads=1,
+                 output_vtc=False,
+                 output_rocs=False,
+                 qtype=None,
+                 roc_file=None,
+                 roc_val=None,
+                 roc_header=None,
+                 roc_filter=None,
+                 roc_delta=None,
+                 roc_regions=None,
+                 clean_info=True,
+                 strat_fixchr=False,
+                 summary_prefix=None,
+                 summary_filter=None,
+                 ci_alpha=0.0,
+                 write_counts=True):
+    """Run quantify and return parsed JSON
+
+    :param filename: the VCF file name
+    :param output_file: output file name (if None, will use a temp file)
+    :param write_vcf: write annotated VCF (give filename)
+    :type write_vcf: str
+    :param regions: dictionary of stratification region names and file names
+    :param reference: reference fasta path
+    :param locations: a location to use
+    :param output_vtc: enable / disable the VTC field
+    :param output_rocs: enable / disable output of ROCs by QQ level
+    :param roc_file: filename for a TSV file with ROC observations
+    :param roc_val: field to use for ROC QQ
+    :param roc_header: name of ROC value for tables
+    :param roc_filter: ROC filtering settings
+    :param roc_delta: ROC minimum spacing between levels
+    :param roc_regions: List of regions to output full ROCs for
+    :param clean_info: remove unused INFO fields
+    :param strat_fixchr: fix chr naming in stratification regions
+    :param summary_prefix: write summary / extended / ROC CSV files with this prefix
+    :param summary_filter: only use this filter (ALL / PASS) for the summary files
+    :param ci_alpha: confidence level for Jeffrey's CI in the summary files (0 to disable)
+    :param write_counts: write extended counts along with the summary
+    :returns: parsed counts JSON
+    """
+
+    if not output_file:
+        output_file = tempfile.NamedTemporaryFile().name
+
+    if write_vcf:
+        if not write_vcf.endswith(".vcf.gz") and not write_vcf.endswith(".bcf"):
+            write_vcf += ".vcf.gz"
+
+    run_str = quantify_command(filename, output_file, write_vcf, regions, reference,
+                               threads=threads,
+                               output_vtc=output_vtc,
+                               output_rocs=output_rocs,
+                               qtype=qtype,
+                               roc_file=roc_file,
+                               roc_val=roc_val,
+                               roc_header=roc_header,
+                               roc_filter=roc_filter,
+                               roc_delta=roc_delta,
+                               roc_regions=roc_regions,
+                               clean_info=clean_info,
+                               strat_fixchr=strat_fixchr,
+                               summary_prefix=summary_prefix,
+                               summary_filter=summary_filter,
+                               ci_alpha=ci_alpha,
+                               write_counts=write_counts)
+
     location_file = None
     if locations:
         location_file = _locations_tmp_bed_file(locations)
         run_str += " --only '%s'" % location_file
 
-    tfe = tempfile.NamedTemporaryFile(delete=False,
-                                      prefix="stderr",
-                                      suffix=".log")
-    tfo = tempfile.NamedTemporaryFile(delete=False,
-                                      prefix="stdout",
-                                      suffix=".log")
-
-    logging.info("Running '%s'" % run_str)
-
     try:
-        subprocess.check_call(run_str, shell=True, stdout=tfo, stderr=tfe)
-    except:
-        tfo.close()
-        tfe.close()
-        with open(tfo.name) as f:
-            for l in f:
-                logging.error("[stdout] " + l.replace("\n", ""))
-        os.unlink(tfo.name)
-        with open(tfe.name) as f:
-            for l in f:
-                logging.error("[stderr] " + l.replace("\n", ""))
-        os.unlink(tfe.name)
+        _run_and_log(run_str)
+    finally:
         if location_file:
             os.unlink(location_file)
-        raise
-
-    tfo.close()
-    tfe.close()
-    with open(tfo.name) as f:
-        for l in f:
-            logging.info("[stdout] " + l.replace("\n", ""))
-    os.unlink(tfo.name)
-    with open(tfe.name) as f:
-        for l in f:
-            logging.info("[stderr] " + l.replace("\n", ""))
-    os.unlink(tfe.name)
-    if location_file:
-        os.unlink(location_file)
 
     if write_vcf and write_vcf.endswith(".bcf"):
         runBcftools("index", write_vcf)
@@ -208,3 +284,58 @@ def run_quantify(filename,
         subprocess.check_call(to_run, shell=True)
 
 
+def merge_partials(partials,
+                   output_file,
+                   output_rocs=False,
+                   roc_header=None,
+                   roc_delta=None,
+                   roc_regions=None,
+                   summary_prefix=None,
+                   summary_filter=None,
+                   ci_alpha=0.0,
+                   write_counts=True):
+    """Combine partial results written by quantify --write-partial
+
+    Partials must be given in genome order to reproduce the ROC levels of
+    a single quantify run exactly.
+
+    :param partials: list of partial results files
+    :param output_file: output file name for the ROC table
+    :param output_rocs: enable / disable output of ROCs by QQ level
+    :param roc_header: name of ROC value for tables (default: as stored in the partials)
+    :param roc_delta: ROC minimum spacing between levels
+    :param roc_regions: List of regions to output full ROCs for
+    :param summary_prefix: write summary / extended / ROC CSV files with this prefix
+    :param summary_filter: only use this filter (ALL / PASS) for the summary files
+    :param ci_alpha: confidence level for Jeffrey's CI in the summary files (0 to disable)
+    :param write_counts: write extended counts along with the summary
+    """
+    run_str = "quantify --merge %s -o '%s'" % (" ".join("'%s'" % p for p in partials), output_file)
+
+    if output_rocs:
+        run_str += " --output-rocs 1"
+    else:
+        run_str += " --output-rocs 0"
+
+    if roc_header:
+        run_str += " --qq-header %s" % roc_header
+
+    if roc_delta:
+        run_str += " --roc-delta %f" % roc_delta
+
+    if roc_regions:
+        for r in roc_regions:
+            run_str += " --roc-regions '%s'" % r
+
+    if summary_prefix:
+        run_str += " --output-summary '%s'" % summary_prefix
+        if summary_filter:
+            run_str += " --summary-filter '%s'" % summary_filter
+        if ci_alpha:
+            run_str += " --ci-alpha %f" % ci_alpha
+        if write_counts:
+            run_str += " --write-counts 1"
+        else:
+            run_str += " --write-counts 0"
+
+    _run_and_log(run_str)
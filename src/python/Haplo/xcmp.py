@@ -18,68 +18,125 @@
 # Peter Krusche <pkrusche@illumina.com>
 #
 
+
 import os
 import logging
 import tempfile
-import time
-import subprocess
+
+from Tools.parallel import runWorkers
 
 
-def xcmpWrapper(location_str, args):
-    """ Haplotype block comparison wrapper function
+def xcmpOptions(args):
+    """ xcmp options shared by all chunks
     """
-    starttime = time.time()
-    tf = tempfile.NamedTemporaryFile(delete=False,
-                                     dir=args.scratch_prefix,
-                                     prefix="result.%s" % location_str,
-                                     suffix=".bcf")
-    tf.close()
-
-    to_run = "xcmp %s %s -l %s -o %s -r %s -f %i -n %i --expand-hapblocks %i " \
-             "--window %i --no-hapcmp %i --qq %s" % \
-             (args.vcf1.replace(" ", "\\ "),
-              args.vcf2.replace(" ", "\\ "),
-              location_str,
-              tf.name,
-              args.ref,
+    to_run = "-r %s -f %i -n %i --expand-hapblocks %i " \
+             "--window %i --no-hapcmp %i --qq %s --compression-level %i" % \
+             (args.ref,
               1 if args.pass_only else 0,  # -f == apply-filtering
               args.max_enum,
               args.hb_expand,
               args.window,
               1 if args.no_hc else 0,
-              args.roc if args.roc else "QUAL")
+              args.roc if args.roc else "QUAL",
+              args.scratch_compression_level)
+
+    if args.inline_preprocessing:
+        # the same steps hap.py otherwise runs in pre.preprocess
+        to_run += " --decompose-truth %i --leftshift-truth %i" \
+                  " --decompose-query %i --leftshift-query %i --haploid-x %i" % \
+                  (1 if args.preprocessing_truth and args.preprocessing_decompose else 0,
+                   1 if args.preprocessing_truth and args.preprocessing_leftshift else 0,
+                   1 if args.preprocessing_decompose else 0,
+                   1 if args.preprocessing_leftshift else 0,
+                   1 if args.gender == "male" else 0)
 
     if args.verbose:
         # this prints information on failed sites
         to_run += " -e -"
 
     # regions / targets already have been taken care of in blocksplit / preprocessing
+    return to_run
+
+
+def xcmpCommand(location_str, output_name, args):
+    """ Make the xcmp command line for comparing one chunk
+    """
+    return "xcmp %s %s -l %s -o %s %s" % \
+           (args.vcf1.replace(" ", "\\ "),
+            args.vcf2.replace(" ", "\\ "),
+            location_str,
+            output_name,
+            xcmpOptions(args))
+
+
+def xcmpWorkerCommand(args):
+    """ Make the command line for an xcmp worker process (see xcmp --worker)
+    """
+    return "xcmp %s %s --worker 1 %s" % \
+           (args.vcf1.replace(" ", "\\ "),
+            args.vcf2.replace(" ", "\\ "),
+            xcmpOptions(args))
 
-    tfe = tempfile.NamedTemporaryFile(delete=False,
-                                      dir=args.scratch_prefix,
-                                      prefix="stderr",
-                                      suffix=".log")
-    tfo = tempfile.NamedTemporaryFile(delete=False,
-                                      dir=args.scratch_prefix,
-                                      prefix="stdout",
-                                      suffix=".log")
 
+def logChunkTime(location_str, elapsed, args):
     try:
-        logging.info("Running '%s'" % to_run)
-        subprocess.check_call(to_run, shell=True, stdout=tfo, stderr=tfe)
-    finally:
-        tfo.close()
-        tfe.close()
-        with open(tfo.name) as f:
-            for l in f:
-                logging.info(l.replace("\n", ""))
-        os.unlink(tfo.name)
-        with open(tfe.name) as f:
-            for l in f:
-                logging.warn(l.replace("\n", ""))
-        os.unlink(tfe.name)
-
-    elapsed = time.time() - starttime
-    logging.info("xcmp for chunk %s -- time taken %.2f" % (location_str, elapsed))
-
-    return tf.name
+        nvars, cost = args.chunk_costs[location_str]
+        logging.info("xcmp for chunk %s -- time taken %.2f (%i variants, predicted cost %.1f)" %
+                     (location_str, elapsed, nvars, cost))
+    except (AttributeError, KeyError):
+        logging.info("xcmp for chunk %s -- time taken %.2f" % (location_str, elapsed))
+
+
+def runXcmp(locations, args):
+    """ Haplotype block comparison for a list of chunks
+
+    Chunks are compared by args.threads xcmp worker processes which keep the
+    input files, indexes and reference open between chunks.
+
+    :return: list of output files, None for chunks that failed
+    """
+    ledger = getattr(args, "ledger", None)
+    outputs = [None] * len(locations)
+    keys = {}
+    requests = []
+    requested = []
+    for i, location_str in enumerate(locations):
+        if ledger:
+            # input file names contain the keys of the preprocessing stage
+            key = ledger.key("xcmp", xcmpCommand(location_str, "", args), args.ref_digest)
+            e = ledger.lookup(key)
+            if e:
+                logging.info("xcmp for chunk %s -- using checkpoint %s" % (location_str, key))
+                outputs[i] = e["outputs"][0]
+                continue
+            keys[i] = key
+            output_name = ledger.output("xcmp", key, ".bcf")
+        else:
+            tf = tempfile.NamedTemporaryFile(delete=False,
+                                             dir=args.scratch_prefix,
+                                             prefix="result.%s" % location_str,
+                                             suffix=".bcf")
+            tf.close()
+            output_name = tf.name
+        requests.append("%s\t%s" % (location_str, output_name))
+        requested.append((i, output_name))
+
+    if not requests:
+        return outputs
+
+    results = runWorkers(xcmpWorkerCommand(args), requests, args.threads, args.scratch_prefix)
+
+    for (i, output_name), r in zip(requested, results):
+        if r is not None and r[0][0] == "OK":
+            if ledger:
+                ledger.record("xcmp", keys[i], [output_name])
+            logChunkTime(locations[i], r[1], args)
+            outputs[i] = output_name
+            continue
+        if r is not None:
+            logging.error("xcmp for chunk %s failed: %s" % (locations[i], " ".join(r[0][2:])))
+        try:
+            os.unlink(output_name)
+        except OSError:
+            pass
+    return outputs
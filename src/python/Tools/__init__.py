@@ -83,6 +83,8 @@ def init():
         "dipenum",
         "hapcmp",
         "xcmp",
+        "concatparts",
+        "somcmp",
         "bcftools",
         "samtools",
     ]
@@ -18,6 +18,10 @@ import gzip
 
 import Tools
 
+# BGZF compression level for intermediate files which are deleted after use:
+# level 1 is much faster to write than the default and files are only slightly larger
+SCRATCH_COMPRESSION_LEVEL = 1
+
 
 def runBcftools(*args):
     """ Run bcftools, return output
@@ -57,6 +61,20 @@ def parseStats(output, colname="count"):
     return result
 
 
+def countsToStats(counts, colname="count"):
+    """ Make the same table as parseStats from a dictionary of counts by type
+    (e.g. the counts written by somcmp)
+    """
+    result = {}
+    # insert in the order bcftools stats prints these, so rows come out like in parseStats
+    for name in ["samples", "records", "no-ALTs", "SNPs", "MNPs", "indels", "others",
+                 "multiallelic sites", "multiallelic SNP sites"]:
+        result[name] = int(counts[name])
+
+    result = pandas.DataFrame(list(result.iteritems()), columns=["type", colname])
+    return result
+
+
 def countVCFRows(filename):
     """ Count the number of rows in a VCF
     :param filename: VCF file name
@@ -145,13 +163,46 @@ def concatenateParts(output, *args):
                 pass
 
 
+def concatenateAndIndexParts(output, parts, index="csi"):
+    """ Concatenate sorted, non-overlapping VCF / BCF parts and index the result
+
+    This uses concatparts, which copies the compressed blocks of each part
+    rather than re-compressing every record, and builds the index while
+    copying. If that fails (e.g. because the parts overlap), we fall back
+    to bcftools concat + index.
+
+    :param output: output file name
+    :param parts: list of input files, in order
+    :param index: "csi" or "tbi"
+    """
+    tf = tempfile.NamedTemporaryFile(suffix=".txt", delete=False)
+    try:
+        for p in parts:
+            tf.write(p + "\n")
+        tf.close()
+        runme = ["concatparts", "-F", tf.name, "-o", output, "--index", index]
+        logging.info(" ".join(runme))
+        po = subprocess.Popen(runme, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        o, e = po.communicate()
+        if po.returncode != 0:
+            logging.warn("concatparts failed, using bcftools concat instead: %s" % e.strip())
+            concatenateParts(output, *parts)
+            if index == "tbi":
+                runBcftools("index", "-f", "-t", output)
+            else:
+                runBcftools("index", "-f", output)
+    finally:
+        os.unlink(tf.name)
+
+
 # noinspection PyShadowingBuiltins
 def preprocessVCF(input, output, location="",
                   pass_only=True,
                   chrprefix=True, norm=False,
                   regions=None, targets=None,
                   reference=Tools.defaultReference(),
-                  filters_only=None):
+                  filters_only=None,
+                  compression_level=-1):
     """ Preprocess a VCF + create index
 
     :param input: the input VCF / BCF / ...
@@ -164,6 +215,7 @@ def preprocessVCF(input, output, location="",
     :param targets: specify a subset of target regions (streaming traversal)
     :param reference: reference fasta file to use
     :param filters_only: require a set of filters (overridden by pass_only)
+    :param compression_level: BGZF compression level for the output (-1 for the default)
     """
     vargs = ["view", input]
     
@@ -193,6 +245,7 @@ def preprocessVCF(input, output, location="",
         # anything needs tabix? if so do an intermediate stage where we
         # index first
         if regions:
+            vargs += ["-l", str(SCRATCH_COMPRESSION_LEVEL)]
             if int_suffix == ".vcf.gz":
                 vargs += ["-o", tff.name, "-O", "z"]
                 runBcftools(*vargs)
@@ -206,6 +259,11 @@ def preprocessVCF(input, output, location="",
         if norm:
             vargs += ["|", "bcftools", "norm", "-f",  reference, "-c", "x", "-D"]
 
+        if compression_level >= 0:
+            if norm:
+                # bcftools norm cannot set the compression level
+                vargs += ["|", "bcftools", "view"]
+            vargs += ["-l", str(compression_level)]
         vargs += ["-o", output]
         if int_suffix == ".vcf.gz":
             vargs += ["-O", "z"]
@@ -0,0 +1,133 @@
+# coding=utf-8
+#
+# Copyright (c) 2010-2015 Illumina, Inc.
+# All rights reserved.
+#
+# This file is distributed under the simplified BSD license.
+# The full text can be found here (and in LICENSE.txt in the root folder of
+# this distribution):
+#
+# https://github.com/Illumina/licenses/blob/master/Simplified-BSD-License.txt
+#
+# Ledger of completed pipeline stages for resumable runs
+#
+# Each stage is identified by a hash of its inputs and parameters. When a
+# stage has been recorded and all its outputs still exist, it does not need
+# to run again. The ledger is a file with one JSON entry per line which
+# entries are appended to, so it can be written from several processes and
+# survives interruptions (an incomplete last line is ignored).
+#
+# Author:
+#
+# Peter Krusche <pkrusche@illumina.com>
+#
+
+import os
+import json
+import hashlib
+import logging
+import time
+
+import Tools
+
+LEDGER_NAME = "hap.py.ledger"
+
+
+class Ledger(object):
+    """ Record of completed stages in a scratch directory
+    """
+    def __init__(self, directory):
+        self.directory = os.path.abspath(directory)
+        self.filename = os.path.join(self.directory, LEDGER_NAME)
+        self.entries = {}
+        self.digests = {}
+        if os.path.exists(self.filename):
+            with open(self.filename) as f:
+                for l in f:
+                    try:
+                        e = json.loads(l)
+                    except ValueError:
+                        # incomplete line from an interrupted run
+                        continue
+                    if e.get("type") == "digest":
+                        self.digests[e["file"]] = e
+                    else:
+                        self.entries[e["key"]] = e
+            logging.info("Read %i checkpoints from %s" % (len(self.entries), self.filename))
+
+    def key(self, stage, *parts):
+        """ Make the key for a stage from its parameters (anything JSON-serializable) """
+        h = hashlib.sha1()
+        h.update(json.dumps([Tools.version, stage] + list(parts), sort_keys=True))
+        return h.hexdigest()
+
+    def fileDigest(self, filename):
+        """ Content hash of a file. Hashes are cached in the ledger by path, size and
+        modification time so every file is only read once.
+        """
+        if not filename:
+            return None
+        filename = os.path.abspath(filename)
+        st = os.stat(filename)
+        e = self.digests.get(filename)
+        if e and e["size"] == st.st_size and e["mtime"] == st.st_mtime:
+            return e["digest"]
+        starttime = time.time()
+        h = hashlib.sha1()
+        with open(filename, "rb") as f:
+            for block in iter(lambda: f.read(1 << 20), ""):
+                h.update(block)
+        e = {"type": "digest",
+             "file": filename,
+             "size": st.st_size,
+             "mtime": st.st_mtime,
+             "digest": h.hexdigest()}
+        self._append(e)
+        self.digests[filename] = e
+        logging.info("Hashed %s -- time taken %.2f" % (filename, time.time() - starttime))
+        return e["digest"]
+
+    def output(self, stage, key, suffix):
+        """ Output file name for a stage """
+        return os.path.join(self.directory, "%s.%s%s" % (stage, key[:16], suffix))
+
+    def lookup(self, key):
+        """ Return the entry for a completed stage, or None if it needs to run """
+        e = self.entries.get(key)
+        if e and all(os.path.exists(x) for x in e["outputs"]):
+            return e
+        return None
+
+    def record(self, stage, key, outputs, **info):
+        """ Record a completed stage
+
+        :param stage: stage name
+        :param key: stage key (see key())
+        :param outputs: list of output files
+        :param info: additional information to keep (must be JSON-serializable)
+        """
+        e = {"type": "stage",
+             "stage": stage,
+             "key": key,
+             "outputs": outputs,
+             "info": info,
+             "time": time.time()}
+        self._append(e)
+        self.entries[key] = e
+
+    def remove(self):
+        """ Delete the ledger file """
+        try:
+            os.unlink(self.filename)
+        except OSError:
+            pass
+
+    def _append(self, e):
+        # single appending write per entry, so concurrent writers don't interleave
+        line = json.dumps(e, sort_keys=True) + "\n"
+        fd = os.open(self.filename, os.O_WRONLY | os.O_APPEND | os.O_CREAT, 0644)
+        try:
+            os.write(fd, line)
+            os.fsync(fd)
+        finally:
+            os.close(fd)
@@ -11,7 +11,8 @@
 
 import os
 import sys
-import pandas
+import csv
+import gzip
 import time
 import math
 
@@ -61,6 +62,50 @@ def dataframeToMetricsTable(table_id, df):
     return replaceNaNs(mdict)
 
 
+def csvToMetricsTable(table_id, filename):
+    """ Convert a CSV file (e.g. as written by quantify --output-summary) to a PUMA metrics table
+
+    Column types are inferred like pandas.read_csv would: int64 when all values are
+    integers, double when all values are numeric or empty, string otherwise.
+
+    :param table_id: the table id / label
+    :param filename: CSV file name, may be gzipped
+    :return: a dictionary in metrics table format
+    :rtype: dict
+    """
+    if filename.endswith(".gz"):
+        f = gzip.open(filename)
+    else:
+        f = open(filename)
+    try:
+        reader = csv.reader(f)
+        header = next(reader)
+        rows = list(reader)
+    finally:
+        f.close()
+
+    mdict = {"id": table_id, "label": table_id, "type": "Table", "data": [], "properties": []}
+
+    ldict = {'id': 'types', "label": 'types', "type": "string", "values": list(range(0, len(rows)))}
+    mdict["data"].append(ldict)
+    for i, name in enumerate(header):
+        values = [r[i] for r in rows]
+        coltype = "string"
+        try:
+            values = [int(v) for v in values]
+            coltype = "int64"
+        except ValueError:
+            try:
+                values = [float(v) if v != "" else float("nan") for v in values]
+                coltype = "double"
+            except ValueError:
+                pass
+        ldict = {'id': name, "label": name, "type": coltype, "values": values}
+        mdict["data"].append(ldict)
+
+    return replaceNaNs(mdict)
+
+
 def makeMetricsObject(name):
     """ Create PUMA metrics dictionary
 
@@ -19,6 +19,9 @@ import subprocess
 import multiprocessing
 import cPickle
 import tempfile
+import threading
+import time
+import Queue
 from itertools import islice, izip, repeat
 
 from . import LoggingWriter
@@ -99,3 +102,68 @@ def runParallel(pool, fun, par, *args, **kwargs):
         for c in par:
             result.append(parMapper( (c, { "fun": fun, "args": args, "kwargs": kwargs } ) ))
     return result
+
+
+def runWorkers(command, requests, threads, scratch_prefix=None):
+    """ run requests using persistent worker processes
+
+    Each worker is started once using command (a shell command line). It reads
+    one request per line from stdin and answers each with one line on stdout,
+    starting with OK or ERROR (see e.g. xcmp --worker). Requests are handed to
+    whichever worker is idle.
+
+    :param command: command line to start a worker
+    :param requests: list of request lines
+    :param threads: number of workers
+    :param scratch_prefix: directory for worker log files
+    :return: list of (answer fields, time taken) for each request, None for
+             requests that did not get an answer
+    """
+    pending = Queue.Queue()
+    for i in xrange(0, len(requests)):
+        pending.put(i)
+    results = [None] * len(requests)
+
+    def worker():
+        tfe = tempfile.NamedTemporaryFile(delete=False,
+                                          dir=scratch_prefix,
+                                          prefix="stderr",
+                                          suffix=".log")
+        try:
+            po = subprocess.Popen(command, shell=True,
+                                  stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=tfe)
+            while True:
+                try:
+                    i = pending.get_nowait()
+                except Queue.Empty:
+                    break
+                starttime = time.time()
+                try:
+                    po.stdin.write(requests[i] + "\n")
+                    po.stdin.flush()
+                    answer = po.stdout.readline()
+                except IOError:
+                    answer = None
+                if not answer:
+                    logging.error("Worker process exited while processing '%s'" % requests[i])
+                    break
+                results[i] = (answer.rstrip("\n").split("\t"), time.time() - starttime)
+            try:
+                po.stdin.close()
+            except IOError:
+                pass
+            po.wait()
+        finally:
+            tfe.close()
+            with open(tfe.name) as f:
+                for l in f:
+                    logging.warn(l.replace("\n", ""))
+            os.unlink(tfe.name)
+
+    logging.info("Starting %i worker processes: '%s'" % (threads, command))
+    workers = [threading.Thread(target=worker) for _ in xrange(0, max(1, min(threads, len(requests))))]
+    for w in workers:
+        w.start()
+    for w in workers:
+        w.join()
+    return results
@@ -17,6 +17,10 @@ import gzip
 import re
 import time
 import json
+import copy
+import multiprocessing
+
+from Tools import which
 
 
 def field(val):
@@ -75,6 +79,97 @@ def splitIndex(ffield):
         return ffield, None
 
 
+def _indexValue(val, ii):
+    """ Apply an index from splitIndex to a value """
+    if ii is not None:
+        try:
+            if ii < len(val):
+                val = val[ii]
+            else:
+                val = None
+        except:
+            pass
+    return val
+
+
+def featxExtract(vcfname, features, threads=None):
+    """ Same as vcfExtract, but use the featx tool to read the VCF file.
+
+    featx writes the text of each feature into a table column, here we turn these
+    into the same values that vcfExtract returns.
+
+    :param vcfname: the vcf file name
+    :param features: list of features to extract
+    :param threads: number of threads for featx (default: number of CPUs)
+    """
+    if threads is None:
+        threads = multiprocessing.cpu_count()
+
+    cmd = ["featx", vcfname, "--threads", str(threads)]
+    for f in features:
+        cmd += ["-F", f]
+
+    feature_index = [splitIndex(f) for f in features]
+    feature_kind = []
+    for f in features:
+        lf = f.lower()
+        kind = None
+        for k in ["chr", "pos", "id", "ref", "alt", "qual", "fil"]:
+            if lf.startswith(k):
+                kind = k
+                break
+        if kind is None and (f.startswith("I.") or f.startswith("S.")):
+            kind = "field"
+        feature_kind.append(kind)
+
+    logging.info(" ".join(cmd))
+    # stderr goes to a file so featx cannot block on it while we read the output
+    ef = tempfile.TemporaryFile()
+    sp = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=ef)
+    # column headers
+    sp.stdout.readline()
+    for line in sp.stdout:
+        spl = line[:-1].split("\t")
+        current = []
+        for i, f in enumerate(features):
+            raw = spl[i]
+            kind = feature_kind[i]
+            if kind == "pos":
+                val = int(raw)
+            elif kind == "alt":
+                val = _indexValue(raw.split(","), feature_index[i][1])
+            elif kind == "qual":
+                try:
+                    val = float(raw)
+                except:
+                    val = None
+            elif kind == "fil":
+                if raw == "PASS" or raw == ".":
+                    val = []
+                else:
+                    val = raw.split(",")
+                val = _indexValue(val, feature_index[i][1])
+            elif kind == "field":
+                if raw == "":
+                    val = None
+                elif raw == "True" and f.startswith("I."):
+                    val = True
+                else:
+                    val = _indexValue(field(raw), feature_index[i][1])
+            elif kind is None:
+                val = f
+            else:
+                val = raw
+            current.append(val)
+        yield current
+
+    sp.wait()
+    if sp.returncode != 0:
+        ef.seek(0)
+        raise Exception("featx call failed on file %s: %s" % (vcfname, ef.read()))
+    ef.close()
+
+
 def vcfExtract(vcfname, features, filterfun=None):
     """ Given a list of VCF features, get tab-separated list from VCF file
 
@@ -84,6 +179,12 @@ def vcfExtract(vcfname, features, filterfun=None):
 
     """
 
+    # filter functions work on the VCF lines, which featx doesn't return
+    if not filterfun and which("featx"):
+        for x in featxExtract(vcfname, features):
+            yield x
+        return
+
     if vcfname.endswith(".gz"):
         ff = gzip.GzipFile(vcfname)
     else:
@@ -209,39 +310,68 @@ def extractHeaders(vcfname):
             break
 
 
+# headers read by vcfhdr2json, by file name, size and modification time (also of the index)
+_header_cache = {}
+
+
+def _headerCacheKey(vcfname):
+    key = [os.path.abspath(vcfname)]
+    for f in [vcfname, vcfname + ".csi", vcfname + ".tbi"]:
+        try:
+            st = os.stat(f)
+            key += [st.st_size, st.st_mtime]
+        except OSError:
+            key += [None, None]
+    return tuple(key)
+
+
 def extractHeadersJSON(vcfname):
     """ Extract the VCF header and turn into JSON
-    :param vcfname: VCF file name
-    :return: VCF header in JSON format
-    """
-    tf = tempfile.NamedTemporaryFile(delete=False)
-    tf.close()
-    vfh = {}
 
-    try:
-        sp = subprocess.Popen("vcfhdr2json '%s' '%s'" % (vcfname, tf.name),
+    Several files can be passed in a list, their headers are then read using a
+    single vcfhdr2json call. Results are cached until a file or its index changes.
+
+    :param vcfname: VCF file name, or list of VCF file names
+    :return: VCF header in JSON format (a list of headers when passing a list of files)
+    """
+    vcfnames = vcfname if type(vcfname) is list else [vcfname]
+    keys = [_headerCacheKey(x) for x in vcfnames]
+    to_read = []
+    to_read_keys = []
+    for x, k in zip(vcfnames, keys):
+        if k not in _header_cache and k not in to_read_keys:
+            to_read.append(x)
+            to_read_keys.append(k)
+
+    if to_read:
+        sp = subprocess.Popen("vcfhdr2json --json-lines 1 %s" % " ".join(["'%s'" % x for x in to_read]),
                               shell=True, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
         o, e = sp.communicate()
 
         if sp.returncode != 0:
-            raise Exception("vcfhdr2json call failed on file %s: %s / %s" % (vcfname, o, e))
-
-        vfh = json.load(open(tf.name))
-
-        # fix empty chr list
-        if "tabix" not in vfh or not vfh["tabix"]:
-            vfh["tabix"] = {}
-        if "chromosomes" not in vfh["tabix"]:
-            vfh["tabix"]["chromosomes"] = None
-        if not vfh["tabix"]["chromosomes"]:
-            vfh["tabix"]["chromosomes"] = []
-        if type(vfh["tabix"]["chromosomes"]) is not list:
-            vfh["tabix"]["chromosomes"] = [vfh["tabix"]["chromosomes"]]
-    finally:
-        try:
-            os.unlink(tf.name)
-        except:
-            pass
-
-    return vfh
+            raise Exception("vcfhdr2json call failed on file %s: %s / %s" % (", ".join(to_read), o, e))
+
+        lines = o.splitlines()
+        if len(lines) != len(to_read):
+            raise Exception("vcfhdr2json returned %i headers for %i files" % (len(lines), len(to_read)))
+
+        for k, l in zip(to_read_keys, lines):
+            vfh = json.loads(l)
+
+            # fix empty chr list
+            if "tabix" not in vfh or not vfh["tabix"]:
+                vfh["tabix"] = {}
+            if "chromosomes" not in vfh["tabix"]:
+                vfh["tabix"]["chromosomes"] = None
+            if not vfh["tabix"]["chromosomes"]:
+                vfh["tabix"]["chromosomes"] = []
+            if type(vfh["tabix"]["chromosomes"]) is not list:
+                vfh["tabix"]["chromosomes"] = [vfh["tabix"]["chromosomes"]]
+            _header_cache[k] = vfh
+
+    # callers may modify the result
+    result = [copy.deepcopy(_header_cache[k]) for k in keys]
+    if type(vcfname) is list:
+        return result
+    return result[0]
 
@@ -43,16 +43,106 @@ from Tools import bcftools
 from Tools.parallel import runParallel, getPool
 from Tools.bcftools import preprocessVCF, bedOverlapCheck
 from Tools.fastasize import fastaContigLengths
+import Tools.checkpoint
 import Haplo.blocksplit
 import Haplo.xcmp
 import Haplo.vcfeval
 import Haplo.quantify
 import Haplo.partialcredit
+import Haplo.manifest
 
 import qfy
 import pre
 
 
+def preprocessInput(args, name, vcf_input, locations, filters,
+                    leftshift, decompose, norm, internal_format_suffix, tempfiles):
+    """ Preprocess truth or query, sets args.gender
+
+    When running with --resume, the result of an earlier run with the same inputs
+    and parameters is reused.
+
+    :return: the preprocessed file name
+    """
+    ledger = args.ledger
+    key = None
+    if ledger:
+        key = ledger.key(name + ".pp",
+                         ledger.fileDigest(vcf_input),
+                         args.ref_digest,
+                         ledger.fileDigest(args.regions_bedfile),
+                         ledger.fileDigest(args.targets_bedfile),
+                         locations, filters, args.fixchr,
+                         leftshift, decompose, norm,
+                         args.preprocess_window, args.gender,
+                         internal_format_suffix, args.inline_preprocessing)
+        e = ledger.lookup(key)
+        if e:
+            logging.info("Using checkpoint for %s preprocessing: %s" % (name, e["outputs"][0]))
+            tempfiles += e["outputs"]
+            args.gender = e["info"]["gender"]
+            return e["outputs"][0]
+        output_name = ledger.output(name + ".pp", key, internal_format_suffix)
+    else:
+        tf = tempfile.NamedTemporaryFile(delete=False,
+                                         dir=args.scratch_prefix,
+                                         prefix=name + ".pp",
+                                         suffix=internal_format_suffix)
+        tf.close()
+        output_name = tf.name
+    tempfiles.append(output_name)
+    tempfiles.append(output_name + ".csi")
+    tempfiles.append(output_name + ".tbi")
+
+    args.gender = pre.preprocess(vcf_input,
+                                 output_name,
+                                 args.ref,
+                                 locations,
+                                 filters,
+                                 args.fixchr,
+                                 args.regions_bedfile,
+                                 args.targets_bedfile,
+                                 leftshift,
+                                 decompose,
+                                 norm,
+                                 args.preprocess_window,
+                                 args.threads,
+                                 args.gender,
+                                 args.full_check,
+                                 args.scratch_compression_level,
+                                 not args.inline_preprocessing)
+
+    if ledger:
+        ledger.record(name + ".pp", key,
+                      [x for x in [output_name, output_name + ".csi", output_name + ".tbi"]
+                       if os.path.exists(x)],
+                      gender=args.gender)
+    return output_name
+
+
+def runManifest(args):
+    """ Run and / or merge the shards in a manifest written by --write-manifest """
+    manifest = Haplo.manifest.loadManifest(args.run_manifest or args.merge_manifest)
+    if args.run_manifest:
+        Haplo.manifest.runShards(manifest, args.threads, args.resume)
+
+    roc_table = Haplo.manifest.mergeShards(manifest)
+
+    settings = manifest["settings"]
+    margs = argparse.Namespace(reports_prefix=settings["reports_prefix"],
+                               write_counts=settings["write_counts"],
+                               write_json=settings["write_json"],
+                               runner="hap.py",
+                               quiet=args.quiet,
+                               verbose=args.verbose)
+    qfy.writeMetrics(margs, roc_table)
+
+    if settings["delete_scratch"]:
+        Haplo.manifest.cleanup(manifest)
+    else:
+        logging.info("Scratch files kept in %s" % manifest["workdir"])
+
+
 def main():
     parser = argparse.ArgumentParser("Haplotype Comparison")
 
@@ -72,6 +162,17 @@ def main():
     parser.add_argument("--keep-scratch", dest="delete_scratch",
                         default=True, action="store_false",
                         help="Filename prefix for scratch report output.")
+    parser.add_argument("--scratch-compression-level", dest="scratch_compression_level",
+                        default=bcftools.SCRATCH_COMPRESSION_LEVEL, type=int,
+                        help="BGZF compression level for intermediate VCF / BCF files (0-9, 0 means no "
+                             "compression, -1 uses the htslib default).")
+    parser.add_argument("--resume", dest="resume",
+                        default=False, action="store_true",
+                        help="Record completed preprocessing, blocksplit and xcmp steps in a ledger in the "
+                             "scratch directory (default: <report-prefix>.scratch) and skip the ones that "
+                             "have completed already with the same inputs and parameters. Scratch files "
+                             "are kept when a run fails so it can be restarted with --resume. With "
+                             "--run-manifest, completed shards are skipped.")
 
 
     # add quantification args
@@ -83,6 +184,9 @@ def main():
                         help="Preprocess truth file with same settings as query (default is to accept truth in original format).")
     parser.add_argument("--usefiltered-truth", dest="usefiltered_truth", action="store_true", default=False,
                         help="Use filtered variant calls in truth file (by default, only PASS calls in the truth file are used)")
+    parser.add_argument("--inline-preprocessing", dest="inline_preprocessing", action="store_true", default=False,
+                        help="Left-shift / decompose variants and fix haploid chrX GTs in xcmp while reading the "
+                             "inputs rather than writing preprocessed copies first (xcmp engine only).")
     parser.add_argument("--preprocessing-window-size", dest="preprocess_window",
                         default=10000, type=int,
                         help="Preprocessing window size (variants further apart than that size are not expected to interfere).")
@@ -121,6 +225,21 @@ def main():
                              "to save time when running hap.py with vcfeval. If no SDF folder is "
                              "specified, hap.py will create a temporary one.")
 
+    # sharded execution
+    parser.add_argument("--write-manifest", dest="write_manifest", default=None,
+                        help="Preprocess and split the comparison into shards, then write a JSON manifest "
+                             "with the xcmp / quantify commands for each shard to this file and stop. "
+                             "Shards are independent and can be run on different machines (scratch files "
+                             "must be on a shared file system, see --scratch-prefix).")
+    parser.add_argument("--manifest-shards", dest="manifest_shards",
+                        default=64, type=int,
+                        help="Number of shards per location for --write-manifest.")
+    parser.add_argument("--run-manifest", dest="run_manifest", default=None,
+                        help="Run all shards in a manifest locally (using --threads processes), then merge "
+                             "the results as with --merge-manifest.")
+    parser.add_argument("--merge-manifest", dest="merge_manifest", default=None,
+                        help="Combine the results of all shards in a manifest into the final reports.")
+
     if Tools.has_sge:
         parser.add_argument("--force-interactive", dest="force_interactive",
                             default=False, action="store_true",
@@ -187,6 +306,16 @@ def main():
         parser.print_help()
         raise Exception("Please qsub me so I get approximately 1 GB of RAM per thread.")
 
+    if args.run_manifest or args.merge_manifest:
+        runManifest(args)
+        return
+
+    if args.inline_preprocessing and args.engine != "xcmp":
+        raise Exception("Inline preprocessing is only supported by the xcmp engine.")
+
+    if args.write_manifest and args.engine != "xcmp":
+        raise Exception("Manifests can only be written when using the xcmp engine.")
+
     if not args.ref:
         args.ref = Tools.defaultReference()
 
@@ -218,6 +347,27 @@ def main():
         raise Exception("Input file %s does not exist." % args.vcf2)
 
     tempfiles = []
+    completed = False
+
+    if args.write_manifest:
+        # all paths in the manifest must work from any working directory
+        args.write_manifest = os.path.abspath(args.write_manifest)
+        args.reports_prefix = os.path.abspath(args.reports_prefix)
+        args.ref = os.path.abspath(args.ref)
+        # the preprocessed inputs and shard outputs go here, it is removed after merging
+        args.scratch_prefix = tempfile.mkdtemp(prefix="hap.py.shards.",
+                                               dir=os.path.abspath(args.scratch_prefix) if args.scratch_prefix
+                                               else os.path.dirname(args.write_manifest))
+
+    args.ledger = None
+    default_scratch = None
+    if args.resume and not args.write_manifest:
+        if not args.scratch_prefix:
+            default_scratch = args.reports_prefix + ".scratch"
+            args.scratch_prefix = default_scratch
+        Tools.mkdir_p(args.scratch_prefix)
+        args.ledger = Tools.checkpoint.Ledger(args.scratch_prefix)
+        args.ref_digest = args.ledger.fileDigest(args.ref)
 
     # xcmp supports bcf; others don't
     if args.engine == "xcmp" and (args.bcf or (args.vcf1.endswith(".bcf") and args.vcf2.endswith(".bcf"))):
@@ -228,33 +378,29 @@ def main():
     try:
         logging.info("Comparing %s and %s" % (args.vcf1, args.vcf2))
 
+        # with inline preprocessing, xcmp left-shifts / decomposes while reading
+        pp_truth = args.preprocessing_truth and not args.inline_preprocessing
+        pp_query = not args.inline_preprocessing
+
+        # read both input headers using one vcfhdr2json call, preprocessing
+        # gets them from the cache. Errors are reported when preprocessing.
+        try:
+            vcfextract.extractHeadersJSON([args.vcf1, args.vcf2])
+        except Exception as e:
+            logging.debug("Cannot read input headers: %s" % str(e))
+
         logging.info("Preprocessing truth: %s" % args.vcf1)
         starttime = time.time()
 
-        ttf = tempfile.NamedTemporaryFile(delete=False,
-                                          dir=args.scratch_prefix,
-                                          prefix="truth.pp",
-                                          suffix=internal_format_suffix)
-        ttf.close()
-        tempfiles.append(ttf.name)
-        tempfiles.append(ttf.name + ".csi")
-        tempfiles.append(ttf.name + ".tbi")
-        args.gender = pre.preprocess(args.vcf1,
-                                     ttf.name,
-                                     args.ref,
-                                     args.locations,
-                                     None if args.usefiltered_truth else "*",  # filters
-                                     args.fixchr,
-                                     args.regions_bedfile,
-                                     args.targets_bedfile,
-                                     args.preprocessing_leftshift if args.preprocessing_truth else False,
-                                     args.preprocessing_decompose if args.preprocessing_truth else False,
-                                     args.preprocessing_norm if args.preprocessing_truth else False,
-                                     args.preprocess_window,
-                                     args.threads,
-                                     args.gender)
-
-        args.vcf1 = ttf.name
+        ttf = preprocessInput(args, "truth", args.vcf1,
+                              args.locations,
+                              None if args.usefiltered_truth else "*",  # filters
+                              args.preprocessing_leftshift if pp_truth else False,
+                              args.preprocessing_decompose if pp_truth else False,
+                              args.preprocessing_norm if args.preprocessing_truth else False,
+                              internal_format_suffix, tempfiles)
+
+        args.vcf1 = ttf
         h1 = vcfextract.extractHeadersJSON(args.vcf1)
 
         elapsed = time.time() - starttime
@@ -282,30 +428,16 @@ def main():
         else:
             filtering = args.filters_only
 
-        qtf = tempfile.NamedTemporaryFile(delete=False,
-                                          dir=args.scratch_prefix,
-                                          prefix="query.pp",
-                                          suffix=internal_format_suffix)
-        qtf.close()
-        tempfiles.append(qtf.name)
-        tempfiles.append(qtf.name + ".csi")
-        tempfiles.append(qtf.name + ".tbi")
-        pre.preprocess(args.vcf2,
-                       qtf.name,
-                       args.ref,
-                       str(",".join(args.locations)),
-                       filtering,
-                       args.fixchr,
-                       args.regions_bedfile,
-                       args.targets_bedfile,
-                       args.preprocessing_leftshift,
-                       args.preprocessing_decompose,
-                       args.preprocessing_norm,
-                       args.preprocess_window,
-                       args.threads,
-                       args.gender)  # same gender as truth above
-
-        args.vcf2 = qtf.name
+        # same gender as truth above
+        qtf = preprocessInput(args, "query", args.vcf2,
+                              str(",".join(args.locations)),
+                              filtering,
+                              args.preprocessing_leftshift if pp_query else False,
+                              args.preprocessing_decompose if pp_query else False,
+                              args.preprocessing_norm,
+                              internal_format_suffix, tempfiles)
+
+        args.vcf2 = qtf
         h2 = vcfextract.extractHeadersJSON(args.vcf2)
 
         elapsed = time.time() - starttime
@@ -322,13 +454,16 @@ def main():
                 logging.warn("No calls for location %s in query!" % _xc)
 
         pool = getPool(args.threads)
-        if args.threads > 1 and args.engine == "xcmp":
+        if (args.threads > 1 or args.write_manifest) and args.engine == "xcmp":
             logging.info("Running using %i parallel processes." % args.threads)
 
             # find balanced pieces
             # cap parallelism at 64 since otherwise bcftools concat below might run out
             # of file handles
-            args.pieces = min(args.threads, 64)
+            if args.write_manifest:
+                args.pieces = args.manifest_shards
+            else:
+                args.pieces = min(args.threads, 64)
             res = runParallel(pool, Haplo.blocksplit.blocksplitWrapper, args.locations, args)
 
             if None in res:
@@ -337,16 +472,21 @@ def main():
             tempfiles += res
 
             args.locations = []
+            # predicted comparison cost for each chunk, logged next to the xcmp run time
+            args.chunk_costs = {}
             for f in res:
                 with open(f) as fp:
                     for l in fp:
-                        ll = l.strip().split("\t", 3)
+                        ll = l.strip().split("\t")
                         if len(ll) < 3:
                             continue
                         xchr = ll[0]
                         start = int(ll[1]) + 1
                         end = int(ll[2])
-                        args.locations.append("%s:%i-%i" % (xchr, start, end))
+                        location = "%s:%i-%i" % (xchr, start, end)
+                        args.locations.append(location)
+                        if len(ll) >= 5:
+                            args.chunk_costs[location] = (int(ll[3]), float(ll[4]))
 
         # count variants before normalisation
         if "samples" not in h1 or not h1["samples"]:
@@ -355,6 +495,29 @@ def main():
         if "samples" not in h2 or not h2["samples"]:
             raise Exception("Cannot read sample names from query VCF file")
 
+        if args.write_manifest:
+            regions = dict((k, os.path.abspath(v)) for k, v in qfy.quantifyRegions(args).iteritems())
+            shards = Haplo.manifest.makeShards(args.locations, args, regions,
+                                               args.scratch_prefix, internal_format_suffix)
+            settings = {"reports_prefix": args.reports_prefix,
+                        "internal_format_suffix": internal_format_suffix,
+                        "roc_header": args.roc,
+                        "output_rocs": args.do_roc,
+                        "roc_delta": args.roc_delta,
+                        "roc_regions": args.roc_regions,
+                        "summary_filter": qfy.summaryFilter(args),
+                        "ci_alpha": args.ci_alpha,
+                        "write_counts": args.write_counts,
+                        "write_json": args.write_json,
+                        "delete_scratch": args.delete_scratch}
+            Haplo.manifest.writeManifest(args.write_manifest, shards, settings, args.scratch_prefix)
+            # the preprocessed inputs are needed by the shards
+            keep = [ttf, ttf + ".csi", ttf + ".tbi",
+                    qtf, qtf + ".csi", qtf + ".tbi"]
+            tempfiles = [x for x in tempfiles if x not in keep]
+            completed = True
+            return
+
         tf = tempfile.NamedTemporaryFile(delete=False,
                                          dir=args.scratch_prefix,
                                          prefix="hap.py.result.",
@@ -368,7 +531,7 @@ def main():
         if args.engine == "xcmp":
             # do xcmp
             logging.info("Using xcmp for comparison")
-            res = runParallel(pool, Haplo.xcmp.xcmpWrapper, args.locations, args)
+            res = Haplo.xcmp.runXcmp(args.locations, args)
             tempfiles += [x for x in res if x is not None]  # VCFs
 
             if None in res:
@@ -383,10 +546,8 @@ def main():
             if len(runme_list) == 0:
                 raise Exception("No outputs to concatenate!")
 
-            logging.info("Concatenating...")
-            bcftools.concatenateParts(output_name, *runme_list)
-            logging.info("Indexing...")
-            bcftools.runBcftools("index", output_name)
+            logging.info("Concatenating and indexing...")
+            bcftools.concatenateAndIndexParts(output_name, runme_list)
             # passed to quantify
             args.type = "xcmp"
             # xcmp extracts whichever field we're using into the QQ info field
@@ -402,14 +563,24 @@ def main():
         args.in_vcf = [output_name]
         args.runner = "hap.py"
         qfy.quantify(args)
+        completed = True
 
     finally:
-        if args.delete_scratch:
+        if args.ledger and not completed:
+            logging.info("Scratch files kept in %s, rerun with --resume to continue." % args.scratch_prefix)
+        elif args.delete_scratch:
             for x in tempfiles:
                 try:
                     os.remove(x)
                 except:
                     pass
+            if args.ledger:
+                args.ledger.remove()
+                if default_scratch:
+                    try:
+                        os.rmdir(default_scratch)
+                    except OSError:
+                        pass
         else:
             logging.info("Scratch files kept : %s" % (str(tempfiles)))
 
@@ -39,7 +39,7 @@ sys.path.append(os.path.abspath(os.path.join(scriptDir, '..', 'lib', 'python27')
 
 import Tools
 from Tools import vcfextract
-from Tools.bcftools import preprocessVCF, bedOverlapCheck
+from Tools.bcftools import preprocessVCF, bedOverlapCheck, runBcftools, SCRATCH_COMPRESSION_LEVEL
 from Tools.parallel import runParallel, getPool
 from Tools.fastasize import fastaContigLengths
 
@@ -76,6 +76,9 @@ def preprocess(vcf_input,
                windowsize=10000,
                threads=1,
                gender=None,
+               full_check=False,
+               compression_level=-1,
+               fix_haploid_x=True,
                ):
     """ Preprocess a single VCF file
 
@@ -93,6 +96,12 @@ def preprocess(vcf_input,
     :param windowsize: normalisation window size
     :param threads: number of threads to for preprcessing
     :param gender: the gender of the sample ("male" / "female" / "auto" / None)
+    :param full_check: check all records in the input (otherwise, for indexed inputs, only record
+                       counts from the index and a sample of records are checked)
+    :param compression_level: BGZF compression level for the output (-1 for the default,
+                              intermediate files always use a fast level)
+    :param fix_haploid_x: turn haploid GTs on chrX into homozygous diploid ones when the gender is male
+                          (switch off when the comparison does this, see xcmp --haploid-x)
 
     :return: the gender if auto-determined (otherwise the same value as gender parameter)
     """
@@ -117,10 +126,16 @@ def preprocess(vcf_input,
             int_suffix = ".vcf.gz"
             int_format = "z"
 
+        # a quick check uses counts from the index and only reads a few records on each contig
+        # (all of chrX for the gender check); converting VCF to BCF needs every record checked
         if vcf_output.endswith(".bcf"):
-            mf = subprocess.check_output("vcfcheck %s --check-bcf-errors 1" % vcf_input, shell=True)
+            mf = subprocess.check_output("vcfcheck %s --check-bcf-errors 1 --index-stats %i --threads %i" %
+                                         (vcf_input, 0 if full_check or not vcf_input.endswith(".bcf") else 1,
+                                          threads),
+                                         shell=True)
         else:
-            mf = subprocess.check_output("vcfcheck %s --check-bcf-errors 0" % vcf_input, shell=True)
+            mf = subprocess.check_output("vcfcheck %s --check-bcf-errors 0 --index-stats %i --threads %i" %
+                                         (vcf_input, 0 if full_check else 1, threads), shell=True)
 
         if gender == "auto":
             logging.info(mf)
@@ -154,7 +169,8 @@ def preprocess(vcf_input,
                                                       suffix=int_suffix)
                     vtf.close()
                     tempfiles.append(vtf.name)
-                    runBcftools("view", "-o", vtf.name, "-O", int_format, vcf_input)
+                    runBcftools("view", "-o", vtf.name, "-O", int_format,
+                                "-l", str(SCRATCH_COMPRESSION_LEVEL), vcf_input)
                     runBcftools("index", vtf.name)
                     h2 = vcfextract.extractHeadersJSON(vcf_input)
                     chrlist = h2["tabix"]["chromosomes"]
@@ -188,9 +204,11 @@ def preprocess(vcf_input,
                       regions,
                       targets,
                       reference,
-                      required_filters)
+                      required_filters,
+                      SCRATCH_COMPRESSION_LEVEL if vtf != vcf_output else compression_level)
 
-        if leftshift or decompose or gender == "male":
+        haploid_x = gender == "male" and fix_haploid_x
+        if leftshift or decompose or haploid_x:
             Haplo.partialcredit.partialCredit(vtf,
                                               vcf_output,
                                               reference,
@@ -199,7 +217,8 @@ def preprocess(vcf_input,
                                               window=windowsize,
                                               leftshift=leftshift,
                                               decompose=decompose,
-                                              haploid_x=gender == "male")
+                                              haploid_x=haploid_x,
+                                              compression_level=compression_level)
     finally:
         for t in tempfiles:
             try:
@@ -236,7 +255,8 @@ def preprocessWrapper(args):
                args.preprocessing_norm,
                args.window,
                args.threads,
-               args.gender)
+               args.gender,
+               args.full_check)
 
     elapsed = time.time() - starttime
     logging.info("preprocess for %s -- time taken %.2f" % (args.input, elapsed))
@@ -293,6 +313,11 @@ def updateArgs(parser):
                              " but may fail for VCF files that have broken headers or records that "
                              " don't comply with the header.")
 
+    parser.add_argument("--full-vcf-check", dest="full_check", action="store_true", default=False,
+                        help="Check all input records before preprocessing. By default, indexed inputs are "
+                             "checked quickly using the record counts in the index and a sample of records "
+                             "on each contig.")
+
     # genotype handling on chrX.
     parser.add_argument("--gender", dest="gender", choices=["male", "female", "auto", "none"], default="auto",
                         help="Specify gender. This determines how haploid calls on chrX get treated: for male samples,"
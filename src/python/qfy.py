@@ -29,19 +29,46 @@ import argparse
 import logging
 import traceback
 import multiprocessing
-import pandas
 import json
 import tempfile
 import gzip
+import csv
 
 scriptDir = os.path.abspath(os.path.dirname(__file__))
 sys.path.append(os.path.abspath(os.path.join(scriptDir, '..', 'lib', 'python27')))
 
 import Tools
 import Tools.vcfextract
-from Tools.metric import makeMetricsObject, dataframeToMetricsTable
+from Tools.metric import makeMetricsObject, csvToMetricsTable
 import Haplo.quantify
-import Haplo.happyroc
+
+
+def quantifyRegions(args):
+    """ Get the dictionary of stratification region names and bed files """
+    qfyregions = {}
+
+    if args.fp_bedfile:
+        if not os.path.exists(args.fp_bedfile):
+            raise Exception("FP / Confident region file not found at %s" % args.fp_bedfile)
+        qfyregions["CONF"] = args.fp_bedfile
+
+    if args.strat_tsv:
+        with open(args.strat_tsv) as sf:
+            for l in sf:
+                n, _, f = l.strip().partition("\t")
+                if n in qfyregions:
+                    raise Exception("Duplicate stratification region ID: %s" % n)
+                if not f:
+                    if n:
+                        raise Exception("No file for stratification region %s" % n)
+                    else:
+                        continue
+                if not os.path.exists(f):
+                    f = os.path.join(os.path.abspath(os.path.dirname(args.strat_tsv)), f)
+                if not os.path.exists(f):
+                    raise Exception("Quantification region file %s not found" % f)
+                qfyregions[n] = f
+    return qfyregions
 
 
 def quantify(args):
@@ -69,29 +96,7 @@ def quantify(args):
     output_vcf = args.reports_prefix + internal_format_suffix
     roc_table = args.reports_prefix + ".roc.tsv"
 
-    qfyregions = {}
-
-    if args.fp_bedfile:
-        if not os.path.exists(args.fp_bedfile):
-            raise Exception("FP / Confident region file not found at %s" % args.fp_bedfile)
-        qfyregions["CONF"] = args.fp_bedfile
-
-    if args.strat_tsv:
-        with open(args.strat_tsv) as sf:
-            for l in sf:
-                n, _, f = l.strip().partition("\t")
-                if n in qfyregions:
-                    raise Exception("Duplicate stratification region ID: %s" % n)
-                if not f:
-                    if n:
-                        raise Exception("No file for stratification region %s" % n)
-                    else:
-                        continue
-                if not os.path.exists(f):
-                    f = os.path.join(os.path.abspath(os.path.dirname(args.strat_tsv)), f)
-                if not os.path.exists(f):
-                    raise Exception("Quantification region file %s not found" % f)
-                qfyregions[n] = f
+    qfyregions = quantifyRegions(args)
 
     if vcf_name == output_vcf or vcf_name == output_vcf + internal_format_suffix:
         raise Exception("Cannot overwrite input VCF: %s would overwritten with output name %s." % (vcf_name, output_vcf))
@@ -102,6 +107,8 @@ def quantify(args):
     except:
         pass
 
+    filter_handling = summaryFilter(args)
+
     Haplo.quantify.run_quantify(vcf_name,
                                 roc_table,
                                 output_vcf if args.write_vcf else False,
@@ -117,10 +124,17 @@ def quantify(args):
                                 roc_delta=args.roc_delta,
                                 roc_regions=args.roc_regions,
                                 clean_info=not args.preserve_info,
-                                strat_fixchr=args.strat_fixchr)
+                                strat_fixchr=args.strat_fixchr,
+                                summary_prefix=args.reports_prefix,
+                                summary_filter=filter_handling,
+                                ci_alpha=args.ci_alpha,
+                                write_counts=args.write_counts)
+
+    writeMetrics(args, roc_table)
 
-    metrics_output = makeMetricsObject("%s.comparison" % args.runner)
 
+def summaryFilter(args):
+    """ Filter column value to use for the summary files (None to use all rows) """
     filter_handling = None
     try:
         if args.engine == "vcfeval" or not args.usefiltered:
@@ -128,60 +142,33 @@ def quantify(args):
     except AttributeError:
         # if we run this through qfy, these arguments are not present
         pass
+    return filter_handling
 
-    res = Haplo.happyroc.roc(roc_table, args.reports_prefix + ".roc",
-                             filter_handling=filter_handling,
-                             ci_alpha=args.ci_alpha)
-    df = res["all"]
-
-    # only use summary numbers
-    df = df[(df["QQ"] == "*") & (df["Filter"].isin(["ALL", "PASS"]))]
-
-    summary_columns = ["Type",
-                       "Filter",
-                       "TRUTH.TOTAL",
-                       "TRUTH.TP",
-                       "TRUTH.FN",
-                       "QUERY.TOTAL",
-                       "QUERY.FP",
-                       "QUERY.UNK",
-                       "FP.gt",
-                       "METRIC.Recall",
-                       "METRIC.Precision",
-                       "METRIC.Frac_NA"]
-
-    for additional_column in ["TRUTH.TOTAL.TiTv_ratio",
-                              "QUERY.TOTAL.TiTv_ratio",
-                              "TRUTH.TOTAL.het_hom_ratio",
-                              "QUERY.TOTAL.het_hom_ratio"]:
-        summary_columns.append(additional_column)
-
-    # Remove subtype
-    summary_df = df[(df["Subtype"] == "*") & (df["Genotype"] == "*") & (df["Subset"] == "*")]
-
-    summary_df[summary_columns].to_csv(args.reports_prefix + ".summary.csv", index=False)
-
-    metrics_output["metrics"].append(dataframeToMetricsTable("summary.metrics",
-                                                             summary_df[summary_columns]))
 
-    if args.write_counts:
-        df.to_csv(args.reports_prefix + ".extended.csv", index=False)
-        metrics_output["metrics"].append(dataframeToMetricsTable("all.metrics", df))
+def writeMetrics(args, roc_table):
+    """ Print the summary and write the JSON metrics from the tables written by quantify """
+    metrics_output = makeMetricsObject("%s.comparison" % args.runner)
 
-    essential_numbers = summary_df[summary_columns]
+    # summary, extended and ROC tables are written by quantify
+    summary_csv = args.reports_prefix + ".summary.csv"
+    metrics_output["metrics"].append(csvToMetricsTable("summary.metrics", summary_csv))
 
-    pandas.set_option('display.max_columns', 500)
-    pandas.set_option('display.width', 1000)
+    if args.write_counts:
+        metrics_output["metrics"].append(csvToMetricsTable("all.metrics",
+                                                           args.reports_prefix + ".extended.csv"))
 
-    essential_numbers = essential_numbers[essential_numbers["Type"].isin(
-        ["SNP", "INDEL"])]
+    with open(summary_csv) as f:
+        essential_numbers = [l for l in csv.reader(f)]
+    essential_numbers = essential_numbers[:1] + [l for l in essential_numbers[1:] if l[0] in ["SNP", "INDEL"]]
+    widths = [max(len(l[i]) for l in essential_numbers) for i in range(0, len(essential_numbers[0]))]
+    essential_numbers = "\n".join(" ".join(v.rjust(w) for v, w in zip(l, widths)) for l in essential_numbers)
 
-    logging.info("\n" + essential_numbers.to_string(index=False))
+    logging.info("\n" + essential_numbers)
 
     # in default mode, print result summary to stdout
     if not args.quiet and not args.verbose:
         print "Benchmarking Summary:"
-        print essential_numbers.to_string(index=False)
+        print essential_numbers
 
     # keep this for verbose output
     if not args.verbose:
@@ -190,8 +177,15 @@ def quantify(args):
         except:
             pass
 
-    for t in res.iterkeys():
-        metrics_output["metrics"].append(dataframeToMetricsTable("roc." + t, res[t]))
+    # these are all the ROC tables quantify can write (see RocReports.hh), it
+    # removes the ones it doesn't write
+    roc_names = ["all"] + ["Locations.%s%s" % (t, f)
+                           for t in ["SNP", "INDEL"]
+                           for f in ["", ".PASS", ".SEL"]]
+    for t in sorted(roc_names):
+        roc_csv = args.reports_prefix + ".roc." + t + ".csv.gz"
+        if os.path.exists(roc_csv):
+            metrics_output["metrics"].append(csvToMetricsTable("roc." + t, roc_csv))
 
     # gzip JSON output
     if args.write_json:
@@ -32,7 +32,7 @@ import tempfile
 import shutil
 import pandas
 import numpy as np
-import gzip
+import subprocess
 import json
 from collections import Counter
 
@@ -40,9 +40,8 @@ scriptDir = os.path.abspath(os.path.dirname(__file__))
 sys.path.append(os.path.abspath(os.path.join(scriptDir, '..', 'lib', 'python27')))
 
 import Tools
-from Tools.bcftools import runBcftools, parseStats, preprocessVCF
+from Tools.bcftools import runBcftools, countsToStats, preprocessVCF
 from Tools.bamstats import bamStats
-from Tools.bedintervaltree import BedIntervalTree
 from Tools.roc import ROC
 from Tools.ci import binomialCI
 from Tools.metric import makeMetricsObject, dataframeToMetricsTable
@@ -296,140 +295,43 @@ def main():
         if not (args.cont and os.path.exists(nqpath + ".csi")):
             runBcftools("index", nqpath)
 
-        logging.info("Intersecting")
-
-        tpfn_files = all([os.path.exists(os.path.join(scratch, "tpfn", "0000.vcf.gz")),
-                          os.path.exists(os.path.join(scratch, "tpfn", "0001.vcf.gz")),
-                          os.path.exists(os.path.join(scratch, "tpfn", "0002.vcf.gz"))])
-
-        tpfn_r_files = all([os.path.exists(os.path.join(scratch, "tpfn", "0000.vcf.gz")),
-                            os.path.exists(os.path.join(scratch, "tpfn", "0001.vcf.gz")),
-                            os.path.exists(os.path.join(scratch, "tpfn", "0002.vcf.gz"))])
-
-        if not (args.cont and tpfn_files):
-            runBcftools("isec", ntpath, nqpath, "-p", os.path.join(scratch, "tpfn"), "-O", "z")
-        else:
-            logging.info("Continuing from %s" % os.path.join(scratch, "tpfn"))
-
-        if args.features and not (args.cont and tpfn_r_files):
-            # only need to do this for getting the feature table
-            runBcftools("isec", nqpath, ntpath, "-p", os.path.join(scratch, "tpfn_r"), "-O", "z")
-
-        logging.info("Getting FPs / Ambi / Unk")
+        logging.info("Intersecting / getting FPs / Ambi / Unk")
 
         fppath = os.path.join(scratch, "fp.vcf.gz")
         unkpath = os.path.join(scratch, "unk.vcf.gz")
         ambipath = os.path.join(scratch, "ambi.vcf.gz")
+        somcmp_json = os.path.join(scratch, "somcmp.json")
+
+        if not (args.cont and os.path.exists(somcmp_json)):
+            # somcmp matches alleles like bcftools isec, classifies unmatched query calls using
+            # the FP / ambiguous regions and counts each category like bcftools stats
+            cmd = ["somcmp", ntpath, nqpath,
+                   "-o", somcmp_json,
+                   "--output-vcfs", scratch,
+                   "--ambi-fp", "1" if args.ambi_fp else "0",
+                   "--count-unk", "1" if args.count_unk else "0",
+                   "--fixchr", "1" if args.fixchr_truth else "0"]
+            if args.ambi:
+                for aBED in args.ambi:
+                    cmd += ["-a", aBED]
+            if args.FP:
+                cmd += ["-f", args.FP]
+            logging.info(" ".join(cmd))
+            subprocess.check_call(cmd)
+        else:
+            logging.info("Continuing from %s" % somcmp_json)
 
-        # get header to print to unk and ambi VCFs
-        rununiquepath = os.path.join(scratch, "tpfn", "0001.vcf.gz")
-        header = runBcftools("view", rununiquepath, "--header-only")
-
-        fp = Tools.BGZipFile(fppath, True)
-        fp.write(header)
-
-        unk = Tools.BGZipFile(unkpath, True)
-        unk.write(header)
-
-        ambi = Tools.BGZipFile(ambipath, True)
-        ambi.write(header)
-
-        ambiClasses = Counter()
-        ambiReasons = Counter()
-
-        fpclasses = BedIntervalTree()
-        if args.ambi:
-            # can have multiple ambiguous BED files
-            for aBED in args.ambi:
-                # auto-label from first value after chr start end
-                # new ambi files have the label in position 4
-                # old ones will look weird here.
-                fpclasses.addFromBed(aBED, lambda xe: xe[4], args.fixchr_truth)
-
-        if args.FP:
-            fpclasses.addFromBed(args.FP, "FP", args.fixchr_truth)
-
-        # split VCF into FP, UNK and AMBI
-        toProcess = gzip.open(rununiquepath, "rb")
-        for entry in toProcess:
-            if entry[0] == '#':
-                continue
-
-            fields = entry.strip().split("\t")
-            chrom = fields[0]
-            start = int(fields[1])
-            stop = int(fields[1]) + len(fields[3])
-
-            overlap = fpclasses.intersect(chrom, start, stop)
-
-            is_fp = False
-            is_ambi = False
-
-            classes_this_pos = set()
-
-            for o in overlap:
-                reason = o.value[0]
-                if reason == "fp" and args.ambi_fp:
-                    reason = "FP"
-                elif reason == "fp":
-                    reason = "ambi-fp"
-                elif reason == "unk":
-                    reason = "ambi-unk"
-
-                classes_this_pos.add(reason)
-                try:
-                    ambiReasons["%s: rep. count %s" % (reason, o.value[1])] += 1
-                except IndexError:
-                    ambiReasons["%s: rep. count *" % reason] += 1
-                for x in o.value[3:]:
-                    ambiReasons["%s: %s" % (reason, x)] += 1
-                if reason == "FP":
-                    is_fp = True
-                else:
-                    is_ambi = True
-
-            for reason in classes_this_pos:
-                ambiClasses[reason] += 1
-
-            if is_fp:
-                fp.write(entry)
-            elif is_ambi:
-                ambi.write(entry)
-            elif not args.count_unk:
-                # when we don't have FP regions, unk stuff becomes FP
-                fp.write(entry)
-            else:
-                unk.write(entry)
-
-        toProcess.close()
-
-        # since 0001.vcf.gz should already be sorted, we can just convert to bgzipped vcf
-        # and create index
-        fp.close()
-        ambi.close()
-        unk.close()
-
-        runBcftools("index", "--tbi", fppath)
-        runBcftools("index", "--tbi", unkpath)
-        runBcftools("index", "--tbi", ambipath)
-
-        logging.info("Counting variants...")
-
-        truthcounts = parseStats(runBcftools("stats", ntpath), "total.truth")
-        querycounts = parseStats(runBcftools("stats", nqpath), "total.query")
+        with open(somcmp_json) as f:
+            somcmp_result = json.load(f)
 
-        tpcounts = parseStats(runBcftools("stats", os.path.join(scratch, "tpfn", "0002.vcf.gz")), "tp")
-        fncounts = parseStats(runBcftools("stats", os.path.join(scratch, "tpfn", "0000.vcf.gz")), "fn")
-        fpcounts = parseStats(runBcftools("stats", fppath), "fp")
-        ambicounts = parseStats(runBcftools("stats", ambipath), "ambi")
-        unkcounts = parseStats(runBcftools("stats", unkpath), "unk")
+        ambiClasses = Counter(somcmp_result["ambiclasses"])
+        ambiReasons = Counter(somcmp_result["ambireasons"])
 
-        res = pandas.merge(truthcounts, querycounts, on="type")
-        res = pandas.merge(res, tpcounts, on="type")
-        res = pandas.merge(res, fpcounts, on="type")
-        res = pandas.merge(res, fncounts, on="type")
-        res = pandas.merge(res, unkcounts, on="type")
-        res = pandas.merge(res, ambicounts, on="type")
+        counts = somcmp_result["counts"]
+        res = pandas.merge(countsToStats(counts["total.truth"], "total.truth"),
+                           countsToStats(counts["total.query"], "total.query"), on="type")
+        for col in ["tp", "fp", "fn", "unk", "ambi"]:
+            res = pandas.merge(res, countsToStats(counts[col], col), on="type")
 
         # no explicit guarantee that total.query is equal to unk + ambi + fp + tp
         # testSum = res["fp"] + res["tp"] + res["unk"] + res["ambi"]
@@ -491,7 +393,7 @@ def main():
 
             # TP_r is a hint for fset, they are both TPs
             logging.info("Collecting TP info (2)...")
-            tps2 = fset.collect(os.path.join(scratch, "tpfn_r", "0002.vcf.gz"), "TP_r")
+            tps2 = fset.collect(os.path.join(scratch, "tpfn", "0003.vcf.gz"), "TP_r")
 
             # this is slow because it tries to sort
             # ... which we don't need to do since tps1 and tps2 have the same ordering
@@ -692,7 +594,7 @@ def main():
 
         res = res[(res["total.truth"] > 0)]
 
-        any_fp = fpclasses.countbases(label="FP")
+        any_fp = somcmp_result["fp_region_size"]["total"]
 
         fp_region_count = 0
         auto_size = True
@@ -713,7 +615,7 @@ def main():
                         if end:
                             end = int(end)
                     else:
-                        fp_region_count += fpclasses.countbases(chrom, label="FP")
+                        fp_region_count += somcmp_result["fp_region_size"]["chromosomes"].get(chrom, 0)
                 else:
                     fp_region_count = any_fp
             else:
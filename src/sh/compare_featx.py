@@ -0,0 +1,36 @@
+#!/usr/bin/env python
+
+# Compare the feature values from featx (Tools.vcfextract.featxExtract) to the
+# ones we get when parsing the VCF in Python
+
+import os
+import sys
+
+sys.path.append(os.path.abspath(os.path.join(os.environ["HCDIR"], '..', 'lib', 'python27')))
+
+import Tools.vcfextract
+
+FEATURES = ["CHROM", "POS", "REF", "ALT", "ALT[0]", "QUAL", "FILTER", "FILTER[0]",
+            "I.SOMATIC", "I.QSS", "I.NONE",
+            "S.2.AU", "S.1.TU[1]", "S.2.DP", "S.2.AU[5]"]
+
+
+def main():
+    vcfname = sys.argv[1]
+    featx_rows = Tools.vcfextract.featxExtract(vcfname, FEATURES, threads=4)
+    # any filter function makes vcfExtract read the file itself
+    vcf_rows = Tools.vcfextract.vcfExtract(vcfname, FEATURES, filterfun=lambda line: False)
+
+    count = 0
+    for r1, r2 in map(None, featx_rows, vcf_rows):
+        if r1 != r2:
+            raise Exception("Feature mismatch in record %i: %s != %s" % (count, str(r1), str(r2)))
+        count += 1
+
+    if count == 0:
+        raise Exception("No records in %s" % vcfname)
+    print "ok (%i records)" % count
+
+
+if __name__ == '__main__':
+    main()
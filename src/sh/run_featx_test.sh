@@ -0,0 +1,63 @@
+#!/bin/bash
+
+##############################################################
+# Test setup
+##############################################################
+
+DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+. ${DIR}/detect_vars.sh
+
+##############################################################
+# Test featx
+##############################################################
+
+# the feature table must not depend on the input format or on how
+# the file is split up for reading it in parallel
+echo "Running featx test"
+TF="${DIR}/../data/temp_featx"
+INPUT="${DIR}/../../example/sompy/strelka_admix_snvs.vcf.gz"
+FEATURES="-F CHROM -F POS -F REF -F ALT -F QUAL -F FILTER -F I.SOMATIC -F I.QSS -F I.NONE -F S.2.AU -F S.1.TU[1] -F S.2.DP"
+
+gunzip -c ${INPUT} | bgzip > ${TF}.vcf.gz && tabix -f -p vcf ${TF}.vcf.gz && \
+${HCDIR}/bcftools view -Ob -o ${TF}.bcf ${TF}.vcf.gz && ${HCDIR}/bcftools index -f ${TF}.bcf
+
+if [ $? -ne 0 ]; then
+	echo "featx test FAILED: cannot create indexed inputs."
+	exit 1
+fi
+
+# unindexed input is read in one go
+${HCDIR}/featx --input-file ${INPUT} ${FEATURES} -o ${TF}.plain.tsv
+
+for F in vcf.gz bcf; do
+	${HCDIR}/featx --input-file ${TF}.${F} ${FEATURES} --threads 1 -o ${TF}.${F}.1.tsv && \
+	${HCDIR}/featx --input-file ${TF}.${F} ${FEATURES} --threads 4 --shard-size 5000000 -o ${TF}.${F}.4.tsv && \
+	diff ${TF}.plain.tsv ${TF}.${F}.1.tsv && \
+	diff ${TF}.plain.tsv ${TF}.${F}.4.tsv
+
+	if [ $? -ne 0 ]; then
+		echo "featx test FAILED for ${F} input. See ${TF}.*"
+		exit 1
+	fi
+done
+
+# one row per record, the first ones are checked against the expected output
+[[ $(wc -l < ${TF}.plain.tsv) -eq $(( $(gunzip -c ${INPUT} | grep -vc '^#') + 1 )) ]] && \
+head -n $(wc -l < ${DIR}/../data/expected_featx.tsv) ${TF}.plain.tsv | diff - ${DIR}/../data/expected_featx.tsv
+
+if [ $? -ne 0 ]; then
+	echo "featx test FAILED, output differs from ${DIR}/../data/expected_featx.tsv. See ${TF}.plain.tsv"
+	exit 1
+fi
+
+# vcfExtract uses featx when it can find it, values must be the same as when
+# parsing the VCF in Python (including [n] indexing)
+${PYTHON} ${DIR}/compare_featx.py ${TF}.vcf.gz
+
+if [ $? -ne 0 ]; then
+	echo "featx test FAILED, featxExtract and vcfExtract differ."
+	exit 1
+fi
+
+echo "featx test SUCCEEDED."
+rm -f ${TF}.*
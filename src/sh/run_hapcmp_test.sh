@@ -25,7 +25,8 @@ if [[ -f "$HG19" ]]; then
 		--progress=0 -n 512 \
 		--output-sequences=1 \
 		--do-alignment=1 \
-		-b ${TF_r}
+		-b ${TF_r} \
+		-d ${TF_r}.diffs.json
 
 	diff ${TF_r} ${TF_e}
 
@@ -34,7 +35,32 @@ if [[ -f "$HG19" ]]; then
 		exit 1
 	else
 		echo "hapcmp test SUCCEEDED."
-		rm ${TF_r}
+	fi
+
+	echo "Running hapcmp test (--threads 4)"
+	TF_t="${DIR}/../data/temp_hapcmp_threads.bed"
+	# lines which aren't regions are passed through to stdout
+	(echo "# hapcmp test"; cat $ID/hc.bed) | ${HCDIR}/hapcmp -r $HG19 \
+		- \
+		$ID/hc.vcf.gz \
+		$ID/PG_hc.vcf.gz \
+		--progress=0 -n 512 \
+		--output-sequences=1 \
+		--do-alignment=1 \
+		--threads 4 \
+		-b ${TF_t} \
+		-d ${TF_t}.diffs.json > ${TF_t}.stdout
+
+	diff ${TF_t} ${TF_e} && \
+	diff ${TF_t}.diffs.json ${TF_r}.diffs.json && \
+	[[ "$(cat ${TF_t}.stdout)" == "# hapcmp test" ]]
+
+	if [ $? -ne 0 ]; then
+		echo "hapcmp test (--threads 4) FAILED. See ${TF_t}, ${TF_t}.diffs.json and ${TF_t}.stdout."
+		exit 1
+	else
+		echo "hapcmp test (--threads 4) SUCCEEDED."
+		rm ${TF_r} ${TF_r}.diffs.json ${TF_t} ${TF_t}.diffs.json ${TF_t}.stdout
 	fi
 else
 	echo "hapcmp test SKIPPED. Set the HG19 environment variable to point to a hg19 reference with '>chr21 ...' naming."
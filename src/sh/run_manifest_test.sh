@@ -0,0 +1,84 @@
+#!/bin/bash
+
+# Sharded hap.py runs: the merged results of a manifest must match a
+# single hap.py run with the same chunks
+#
+
+set +e
+
+DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+. ${DIR}/detect_vars.sh
+
+echo "Manifest test for ${HCVERSION} from ${HCDIR}"
+
+TMP_OUT=`mktemp -t happy.XXXXXXXXXX`
+
+# reference run using 4 chunks
+${PYTHON} ${HCDIR}/hap.py \
+			 	-l chr21 \
+			 	${DIR}/../../example/happy/PG_NA12878_chr21.vcf.gz \
+			 	${DIR}/../../example/happy/NA12878_chr21.vcf.gz \
+			 	-f ${DIR}/../../example/happy/PG_Conf_chr21.bed.gz \
+			 	-r ${DIR}/../../example/chr21.fa \
+			 	-o ${TMP_OUT}.single \
+			 	--threads 4 \
+			 	--force-interactive
+
+if [[ $? != 0 ]]; then
+	echo "hap.py failed!"
+	exit 1
+fi
+
+# same comparison split into 4 shards
+${PYTHON} ${HCDIR}/hap.py \
+			 	-l chr21 \
+			 	${DIR}/../../example/happy/PG_NA12878_chr21.vcf.gz \
+			 	${DIR}/../../example/happy/NA12878_chr21.vcf.gz \
+			 	-f ${DIR}/../../example/happy/PG_Conf_chr21.bed.gz \
+			 	-r ${DIR}/../../example/chr21.fa \
+			 	-o ${TMP_OUT}.sharded \
+			 	--threads 4 \
+			 	--manifest-shards 4 \
+			 	--write-manifest ${TMP_OUT}.manifest.json \
+			 	--force-interactive
+
+if [[ $? != 0 ]]; then
+	echo "hap.py --write-manifest failed!"
+	exit 1
+fi
+
+${PYTHON} ${HCDIR}/hap.py \
+			 	--run-manifest ${TMP_OUT}.manifest.json \
+			 	--threads 4 \
+			 	--force-interactive
+
+if [[ $? != 0 ]]; then
+	echo "hap.py --run-manifest failed!"
+	exit 1
+fi
+
+for x in summary.csv extended.csv; do
+	diff ${TMP_OUT}.single.${x} ${TMP_OUT}.sharded.${x}
+	if [[ $? != 0 ]]; then
+		echo "Sharded ${x} differs! -- diff ${TMP_OUT}.single.${x} ${TMP_OUT}.sharded.${x}"
+		exit 1
+	fi
+done
+
+for x in ${TMP_OUT}.single.roc.*.csv.gz; do
+	y=${x/.single./.sharded.}
+	diff <(gunzip -c ${x}) <(gunzip -c ${y})
+	if [[ $? != 0 ]]; then
+		echo "Sharded ROC differs! -- diff ${x} ${y}"
+		exit 1
+	fi
+done
+
+diff <(gunzip -c ${TMP_OUT}.single.vcf.gz | grep -v ^#) <(gunzip -c ${TMP_OUT}.sharded.vcf.gz | grep -v ^#)
+if [[ $? != 0 ]]; then
+	echo "Sharded VCF differs! -- diff ${TMP_OUT}.single.vcf.gz ${TMP_OUT}.sharded.vcf.gz"
+	exit 1
+fi
+
+rm -rf ${TMP_OUT}.*
+rm -f ${TMP_OUT}
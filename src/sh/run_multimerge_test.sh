@@ -43,6 +43,55 @@ else
 	rm ${TF}
 fi
 
+echo "Running Multimerge multi-contig test (--threads)"
+MC1=${DIR}/../data/multicontig1.vcf
+MC2=${DIR}/../data/multicontig2.vcf
+for f in ${MC1} ${MC2}; do
+	cat ${f} | bgzip > ${f}.gz
+	tabix -f -p vcf ${f}.gz
+done
+
+MCTMP=`mktemp -d -t multimerge.XXXXXXXXXX`
+
+# contigs are merged in parallel with more than one thread, the output must not change
+for args in "--process-full=1" \
+            "--process-split=1 --homref-split=1 --homref-vcf-out=HOMREF" \
+            "--process-split=1 -R ${DIR}/../data/multicontig.bed"; do
+	for t in 1 4; do
+		${HCDIR}/multimerge ${MC1}.gz:NA12877 ${MC2}.gz:NA12878 -r ${DIR}/../data/chrQ.fa \
+			-o ${MCTMP}/out.${t}.vcf.gz ${args/HOMREF/${MCTMP}/homref.${t}.vcf.gz} --threads ${t} > ${MCTMP}/log.${t} 2>&1
+		if [ $? -ne 0 ] || grep -q "single thread" ${MCTMP}/log.${t}; then
+			cat ${MCTMP}/log.${t}
+			echo "Multimerge multi-contig test FAILED: multimerge ${args} --threads ${t}"
+			exit 1
+		fi
+	done
+
+	diff <(gunzip -c ${MCTMP}/out.1.vcf.gz | grep -v ^#) <(gunzip -c ${MCTMP}/out.4.vcf.gz | grep -v ^#)
+	if [ $? -ne 0 ]; then
+		echo "Multimerge multi-contig test FAILED: calls differ for ${args}"
+		exit 1
+	fi
+
+	if [[ -f ${MCTMP}/homref.1.vcf.gz ]]; then
+		diff <(gunzip -c ${MCTMP}/homref.1.vcf.gz | grep -v ^#) <(gunzip -c ${MCTMP}/homref.4.vcf.gz | grep -v ^#)
+		if [ $? -ne 0 ]; then
+			echo "Multimerge multi-contig test FAILED: homref blocks differ for ${args}"
+			exit 1
+		fi
+		# homref blocks must be written for every contig
+		HRCONTIGS=`gunzip -c ${MCTMP}/homref.1.vcf.gz | grep -v ^# | cut -f 1 | uniq | tr '\n' ' '`
+		if [[ "${HRCONTIGS}" != "chrQ chrR chrS chrT " ]]; then
+			echo "Multimerge multi-contig test FAILED: homref blocks only for ${HRCONTIGS}"
+			exit 1
+		fi
+		rm -f ${MCTMP}/homref.*
+	fi
+done
+
+echo "Multimerge multi-contig test SUCCEEDED."
+rm -rf ${MCTMP}
+
 if [[ -f "$HG19" ]]; then
 	echo "Running Multimerge test (2)"
 
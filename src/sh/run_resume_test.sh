@@ -0,0 +1,127 @@
+#!/bin/bash
+
+# hap.py --resume: stages recorded in the ledger must be reused when their
+# outputs still exist, recomputed when they don't or when their inputs or
+# parameters change, and a resumed run must give the same results as a
+# clean run.
+#
+
+set +e
+
+DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+. ${DIR}/detect_vars.sh
+
+echo "Resume test for ${HCVERSION} from ${HCDIR}"
+
+TMP_OUT=`mktemp -t happy.XXXXXXXXXX`
+SCRATCH=${TMP_OUT}.scratch
+LEDGER=${SCRATCH}/hap.py.ledger
+
+# the query is copied so we can change it later
+cp ${DIR}/../../example/happy/NA12878_chr21.vcf.gz ${TMP_OUT}.query.vcf.gz
+cp ${DIR}/../../example/happy/NA12878_chr21.vcf.gz.tbi ${TMP_OUT}.query.vcf.gz.tbi
+
+function happy
+{
+	${PYTHON} ${HCDIR}/hap.py \
+			 	-l chr21:10000000-20000000 \
+			 	${DIR}/../../example/happy/PG_NA12878_chr21.vcf.gz \
+			 	${TMP_OUT}.query.vcf.gz \
+			 	-f ${DIR}/../../example/happy/PG_Conf_chr21.bed.gz \
+			 	-r ${DIR}/../../example/chr21.fa \
+			 	--threads 4 \
+			 	--force-interactive \
+			 	--verbose \
+			 	"$@"
+}
+
+function resume
+{
+	happy -o ${TMP_OUT}.$1 --resume --keep-scratch --scratch-prefix ${SCRATCH} \
+		  --logfile ${TMP_OUT}.$1.log "${@:2}"
+	if [[ $? != 0 ]]; then
+		echo "hap.py --resume failed! -- see ${TMP_OUT}.$1.log"
+		exit 1
+	fi
+}
+
+# count matching lines in a log
+function count
+{
+	grep -c "$2" ${TMP_OUT}.$1.log
+}
+
+function compare
+{
+	diff ${TMP_OUT}.clean.summary.csv ${TMP_OUT}.$1.summary.csv && \
+	diff <(gunzip -c ${TMP_OUT}.clean.vcf.gz | grep -v ^#) <(gunzip -c ${TMP_OUT}.$1.vcf.gz | grep -v ^#)
+	if [[ $? != 0 ]]; then
+		echo "Results of $1 run differ from clean run! -- see ${TMP_OUT}.clean.* and ${TMP_OUT}.$1.*"
+		exit 1
+	fi
+}
+
+happy -o ${TMP_OUT}.clean --logfile ${TMP_OUT}.clean.log
+if [[ $? != 0 ]]; then
+	echo "hap.py failed!"
+	exit 1
+fi
+
+# first run writes the ledger
+resume first
+compare first
+
+NCHUNKS=$(count first "xcmp for chunk .* -- time taken")
+if [[ $NCHUNKS -lt 2 || $(grep -c '"stage": "xcmp"' ${LEDGER}) -ne $NCHUNKS ]]; then
+	echo "Expected one ledger entry for each of several xcmp chunks, got $NCHUNKS chunks. See ${LEDGER}"
+	exit 1
+fi
+
+# remove the output of one xcmp chunk, only this one must run again
+REMOVED=$(grep '"stage": "xcmp"' ${LEDGER} | head -n 1 | sed 's/.*"outputs": \["\([^"]*\)".*/\1/')
+if [[ ! -f ${REMOVED} ]]; then
+	echo "Cannot find xcmp output in ${LEDGER}"
+	exit 1
+fi
+rm ${REMOVED}
+
+resume second
+compare second
+
+if [[ $(count second "Using checkpoint for truth preprocessing") -ne 1 || \
+	  $(count second "Using checkpoint for query preprocessing") -ne 1 || \
+	  $(count second "blocksplit for .* -- using checkpoint") -ne 1 || \
+	  $(count second "xcmp for chunk .* -- using checkpoint") -ne $(( NCHUNKS - 1 )) || \
+	  $(count second "xcmp for chunk .* -- time taken") -ne 1 || \
+	  ! -f ${REMOVED} ]]; then
+	echo "Resumed run didn't recompute exactly one xcmp chunk. See ${TMP_OUT}.second.log"
+	exit 1
+fi
+
+# a changed parameter invalidates the comparison but not the preprocessing
+resume window -w 40
+
+if [[ $(count window "Using checkpoint for truth preprocessing") -ne 1 || \
+	  $(count window "Using checkpoint for query preprocessing") -ne 1 || \
+	  $(count window "xcmp for chunk .* -- using checkpoint") -ne 0 ]]; then
+	echo "Changing -w didn't invalidate the xcmp checkpoints. See ${TMP_OUT}.window.log"
+	exit 1
+fi
+
+# changing the query (same file name) invalidates its preprocessing and
+# everything downstream
+gunzip -c ${DIR}/../../example/happy/NA12878_chr21.vcf.gz | awk '!/^#/ && !d { d = 1; next } { print }' \
+	| bgzip > ${TMP_OUT}.query.vcf.gz
+tabix -f -p vcf ${TMP_OUT}.query.vcf.gz
+
+resume query
+
+if [[ $(count query "Using checkpoint for truth preprocessing") -ne 1 || \
+	  $(count query "Using checkpoint for query preprocessing") -ne 0 || \
+	  $(count query "xcmp for chunk .* -- using checkpoint") -ne 0 ]]; then
+	echo "Changing the query didn't invalidate its checkpoints. See ${TMP_OUT}.query.log"
+	exit 1
+fi
+
+rm -rf ${TMP_OUT}.*
+rm -f ${TMP_OUT}
@@ -60,6 +60,19 @@ else
 	echo "Hapcmp test SUCCEEDED!"
 fi
 
+##############################################################
+# Test validatevcf
+##############################################################
+
+/bin/bash ${DIR}/run_validatevcf_test.sh
+
+if [[ $? -ne 0 ]]; then
+	echo "validatevcf test FAILED!"
+	exit 1
+else
+	echo "validatevcf test SUCCEEDED!"
+fi
+
 ##############################################################
 # Test Hap.py + path traversals
 ##############################################################
@@ -215,6 +228,32 @@ else
 	echo "Quantify integration test SUCCEEDED!"
 fi
 
+##############################################################
+# Test sharded runs via manifest
+##############################################################
+
+/bin/bash ${DIR}/run_manifest_test.sh
+
+if [[ $? -ne 0 ]]; then
+	echo "Manifest test FAILED!"
+	exit 1
+else
+	echo "Manifest test SUCCEEDED!"
+fi
+
+##############################################################
+# Test resuming runs
+##############################################################
+
+/bin/bash ${DIR}/run_resume_test.sh
+
+if [[ $? -ne 0 ]]; then
+	echo "Resume test FAILED!"
+	exit 1
+else
+	echo "Resume test SUCCEEDED!"
+fi
+
 ##############################################################
 # Test PG Counting
 ##############################################################
@@ -240,3 +279,16 @@ if [[ $? -ne 0 ]]; then
 else
 	echo "Som.py test SUCCEEDED!"
 fi
+
+##############################################################
+# Test featx
+##############################################################
+
+/bin/bash ${DIR}/run_featx_test.sh
+
+if [[ $? -ne 0 ]]; then
+	echo "featx test FAILED!"
+	exit 1
+else
+	echo "featx test SUCCEEDED!"
+fi
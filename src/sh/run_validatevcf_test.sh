@@ -0,0 +1,42 @@
+#!/bin/bash
+
+##############################################################
+# Test setup
+##############################################################
+
+DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+. ${DIR}/detect_vars.sh
+
+##############################################################
+# Test validatevcf
+##############################################################
+
+# superloci are validated on worker threads, failures and totals must come out
+# the same as with a single thread
+echo "Running validatevcf test"
+TF="${DIR}/../data/temp_validatevcf"
+ID="${DIR}/../../example/happy"
+
+echo -e "chr21\t10000000\t20000000" > ${TF}.regions.bed
+
+for VCF in PG_NA12878_hg38-chr21.vcf.gz NA12878-GATK3-chr21.vcf.gz; do
+	for T in 1 4; do
+		${HCDIR}/validatevcf --input-vcf ${ID}/${VCF} -r ${ID}/hg38.chr21.fa \
+			-R ${TF}.regions.bed -n 4 --progress=0 \
+			--threads ${T} \
+			-e ${TF}.${T}.bed 2> ${TF}.${T}.log
+		grep "Total superloci" ${TF}.${T}.log > ${TF}.${T}.totals
+	done
+
+	[[ -s ${TF}.1.totals ]] && \
+	diff ${TF}.1.totals ${TF}.4.totals && \
+	diff ${TF}.1.bed ${TF}.4.bed
+
+	if [ $? -ne 0 ]; then
+		echo "validatevcf test FAILED for ${VCF}. See ${TF}.*"
+		exit 1
+	fi
+done
+
+echo "validatevcf test SUCCEEDED."
+rm -f ${TF}.*